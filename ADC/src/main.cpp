@@ -1,14 +1,31 @@
 #include <Arduino.h>
 
+#include <AdcSampler.h>
+
+#define SAMPLE_RATE 100
+#define REPORT_INTERVAL 1000L
+
+AdcSampler adcSampler(A0);
+unsigned long lastReportMillis = 0;
+
 void setup() {
   // put your setup code here, to run once:
   Serial.begin(9600);
   Serial.println("ESP8266 ADC Demo");
+
+  /* A0 is read by a timer, loop() only looks at the statistics */
+  adcSampler.begin(SAMPLE_RATE);
 }
 
 void loop() {
   // put your main code here, to run repeatedly:
-  Serial.printf("ADC=%d", analogRead(A0));
-  Serial.println();
-  delay(1000);
+  adcSampler.update();
+
+  if ((millis() - lastReportMillis) >= REPORT_INTERVAL) {
+    lastReportMillis = millis();
+    Serial.printf("ADC=%d, min=%d, max=%d, mean=%.1f, median=%.1f",
+                  adcSampler.latest(), adcSampler.minimum(), adcSampler.maximum(),
+                  adcSampler.mean(), adcSampler.percentile(50));
+    Serial.println();
+  }
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "LineReader.h"
+
+LineReader::LineReader(Stream &stream) : _stream(stream), _start(0), _end(0), _eof(false), _skipping(false)
+{
+}
+
+bool LineReader::next(LineView &line)
+{
+    while (true)
+    {
+        char *newline = (char *)memchr(_buffer + _start, '\n', _end - _start);
+        if (newline != NULL)
+        {
+            size_t end = newline - _buffer;
+            bool skipped = _skipping;
+            _skipping = false;
+            if (!skipped)
+            {
+                emit(line, end, false);
+            }
+            _start = end + 1;
+            if (!skipped)
+            {
+                return true;
+            }
+            continue;
+        }
+
+        if (_eof)
+        {
+            if (_start < _end && !_skipping)
+            {
+                emit(line, _end, false);
+                _start = _end;
+                return true;
+            }
+            return false;
+        }
+
+        // Keep the partial line and fill the rest of the buffer.
+        if (_start > 0)
+        {
+            memmove(_buffer, _buffer + _start, _end - _start);
+            _end -= _start;
+            _start = 0;
+        }
+
+        if (_end == LINE_READER_BUFFER_SIZE)
+        {
+            if (_skipping)
+            {
+                _end = 0;
+                continue;
+            }
+
+            // The buffer may end exactly where the line does: look at what
+            // follows before calling the line truncated. A "\r" read here
+            // belongs to the skipped rest if the line goes on after all.
+            int c = _stream.peek();
+            if (c == '\r')
+            {
+                _stream.read();
+                c = _stream.peek();
+            }
+            if (c == '\n' || c < 0)
+            {
+                if (c == '\n')
+                {
+                    _stream.read();
+                }
+                emit(line, _end, false);
+                _start = _end;
+                return true;
+            }
+
+            emit(line, _end, true);
+            _start = _end;
+            _skipping = true;
+            return true;
+        }
+
+        size_t length = _stream.readBytes(_buffer + _end, LINE_READER_BUFFER_SIZE - _end);
+        if (length == 0)
+        {
+            _eof = true;
+        }
+        _end += length;
+    }
+}
+
+void LineReader::emit(LineView &line, size_t end, bool truncated)
+{
+    if (!truncated && end > _start && _buffer[end - 1] == '\r')
+    {
+        end--;
+    }
+    _buffer[end] = '\0';
+
+    line.data = _buffer + _start;
+    line.length = end - _start;
+    line.truncated = truncated;
+}
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include "FS.h"
 #include "LittleFS.h"
+#include "LineReader.h"
 
 void setup() {
   // put your setup code here, to run once:
@@ -28,11 +29,11 @@ void setup() {
     Serial.println("Failed to open file.");
   }
 
-  String text = file.readString();
-
-  int index = text.indexOf("\r\n");
-  Serial.print(text.substring(0, index));
-  Serial.print(text.substring(index, text.length() - 1));
+  LineReader reader(file);
+  LineView line;
+  while (reader.next(line)) {
+    Serial.println(line.data);
+  }
 
   file.close();
   
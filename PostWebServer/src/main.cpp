@@ -1,12 +1,16 @@
 #include <Arduino.h>
 #include "ESP8266WiFi.h"
 #include "ESP8266WebServer.h"
+#include "WifiConnection.h"
 
 #define SSID_NAME "ESP8266"
 #define SSID_PASSWORD "12345678"
+#define FALLBACK_AP_NAME "ESP8266_PostWebServer"
 
 ESP8266WebServer webServer;
+WifiConnection wifiConnection;
 
+void onWifiStateChanged(WifiConnectionState state);
 void handleRoot(void);
 void handlePostPlainText(void);
 void handlePostForm(void);
@@ -21,16 +25,10 @@ void setup() {
   Serial.begin(9600);
   Serial.println("POST demo.");
   
-  // Connect to WIFI
-  WiFi.begin(SSID_NAME, SSID_PASSWORD);
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
-  }
-
-  // WIFI connected
-  Serial.print("WIFI connected. IP: ");
-  Serial.println(WiFi.localIP());
+  // Connect to WIFI, the web server is up in the meantime
+  wifiConnection.setFallbackAP(FALLBACK_AP_NAME, IPAddress(192, 168, 4, 1));
+  wifiConnection.onStateChanged(onWifiStateChanged);
+  wifiConnection.begin(SSID_NAME, SSID_PASSWORD);
 
   // Setup web server
   webServer.begin(80);
@@ -45,6 +43,19 @@ void setup() {
 void loop() {
   // put your main code here, to run repeatedly:
   webServer.handleClient();
+  wifiConnection.loop();
+}
+
+void onWifiStateChanged(WifiConnectionState state) {
+  if (state == WIFI_CONNECTION_CONNECTED) {
+    // WIFI connected
+    Serial.print("WIFI connected. IP: ");
+    Serial.println(WiFi.localIP());
+  }
+  else if (state == WIFI_CONNECTION_BACKOFF && wifiConnection.fallback()) {
+    Serial.print("WIFI not reachable, SoftAP " FALLBACK_AP_NAME ". IP: ");
+    Serial.println(WiFi.softAPIP());
+  }
 }
 
 
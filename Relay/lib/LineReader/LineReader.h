@@ -0,0 +1,45 @@
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include <Arduino.h>
+
+#ifndef LINE_READER_BUFFER_SIZE
+#define LINE_READER_BUFFER_SIZE 128
+#endif
+
+/*
+ * One line returned by LineReader, without its "\n" or "\r\n". Points into
+ * the reader's buffer and is NUL-terminated; valid until the next call.
+ */
+struct LineView
+{
+    const char *data;
+    size_t length;
+    bool truncated; // The line was longer than the buffer, the rest is skipped.
+};
+
+/*
+ * Reads a stream (usually a LittleFS File) line by line through one fixed
+ * buffer. Nothing is allocated and no line is copied; a line longer than
+ * LINE_READER_BUFFER_SIZE is cut at that length. "\n" and "\r\n" endings
+ * may be mixed, a last line without an ending is returned as well.
+ */
+class LineReader
+{
+public:
+    LineReader(Stream &stream);
+
+    bool next(LineView &line);
+
+private:
+    void emit(LineView &line, size_t end, bool truncated);
+
+    Stream &_stream;
+    char _buffer[LINE_READER_BUFFER_SIZE + 1];
+    size_t _start;
+    size_t _end;
+    bool _eof;
+    bool _skipping;
+};
+
+#endif
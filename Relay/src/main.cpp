@@ -1,9 +1,11 @@
 #include <Arduino.h>
 #include "ESP8266WiFi.h"
-#include "ESP8266WebServer.h"
+#include "HttpServer.h"
 #include "FS.h"
 #include "LittleFS.h"
+#include "LineReader.h"
 #include "resource.h"
+#include "PageTemplate.h"
 
 #define RELAY_STATE_OFF 0
 #define RELAY_STATE_ON 1
@@ -20,7 +22,10 @@ String ssidPassword;
 String relayDisplayName;
 int relayState = RELAY_STATE_DEFAULT;
 
-ESP8266WebServer webserver;
+HttpServer webserver;
+
+PageTemplate homePageTemplate(RELAY_PAGE, RELAY_PAGE_KEYS, RELAY_SLOT_COUNT);
+PageTemplate statusPageTemplate(STATUS_PAGE, STATUS_PAGE_KEYS, STATUS_SLOT_COUNT);
 
 IPAddress ipAddress(192, 168, 10, 1);
 
@@ -51,10 +56,13 @@ void onRelayHomePage(void);
 void onRelayOn(void);
 void onRelayOff(void);
 
-String buildStatusPageHtml(void);
-String buildConfigPageHtml(void);
-String buildHomePageHtml(void);
-String buildRedirectHtml(void);
+void sendStatusPageHtml(void);
+void sendConfigPageHtml(void);
+void sendHomePageHtml(void);
+void sendRedirectHtml(void);
+void sendGzipPage(const uint8_t *page, size_t length, const char *etag, const char *cacheControl);
+String getStatusPageValue(uint8_t slot);
+String getHomePageValue(uint8_t slot);
 
 void onSoftAPModeStationConnected(const WiFiEventSoftAPModeStationConnected& event);
 void onSoftAPModeStationDisconnected(const WiFiEventSoftAPModeStationDisconnected& event);
@@ -87,7 +95,14 @@ void setup() {
     Serial.println("[Setup] Load configuration failed.");
   }
 
+  /* Page Templates */
+  if (!homePageTemplate.compile() || !statusPageTemplate.compile()) {
+    Serial.println("[Setup] Failed to compile page templates.");
+  }
+
   /* Web Server */
+  const char *headerKeys[] = {"If-None-Match", "Accept-Encoding"};
+  webserver.collectHeaders(headerKeys, 2);
   webserver.begin(80);
   webserver.on("/", onRelayHomePage);
   webserver.on("/relay_on", onRelayOn);
@@ -174,19 +189,14 @@ bool loadWifiConfig(void) {
     return false;
   }
 
-  String cfg = file.readString();
+  // One field per line: SSID, password, display name.
+  LineReader reader(file);
+  LineView line;
+  ssidName = reader.next(line) ? line.data : "";
+  ssidPassword = reader.next(line) ? line.data : "";
+  relayDisplayName = reader.next(line) ? line.data : "";
   file.close();
 
-  int index = cfg.indexOf("\r\n");
-  ssidName = cfg.substring(0, index);
-  cfg.remove(0, index + 2);
-
-  index = cfg.indexOf("\r\n");
-  ssidPassword = cfg.substring(0, index);
-  cfg.remove(0, index + 2);
-
-  relayDisplayName = cfg;
-
   Serial.println("Loaded configuration.");
   Serial.printf("    SSID: %s\r\n", ssidName.c_str());
   Serial.printf("    Password: %s\r\n", ssidPassword.c_str());
@@ -225,12 +235,12 @@ void onPageNotFound(void) {
 
 void onStatusPage(void) {
   Serial.println("[WebServer] Opening 'Status' page.");
-  webserver.send(200, "text/html", buildStatusPageHtml());
+  sendStatusPageHtml();
 }
 
 void onConfigHomePage(void) {
   Serial.println("[WebServer] Opening configuration page.");
-  webserver.send(200, "text/html", buildConfigPageHtml());
+  sendConfigPageHtml();
 }
 
 void onConfigApplyPage(void) {
@@ -253,7 +263,7 @@ void onConfigApplyPage(void) {
   Serial.printf("SSID: %s, Password: %s\r\n", ssidName.c_str(), ssidPassword.c_str());
   saveWifiConfig(ssidName, ssidPassword, relayDisplayName);
 
-  webserver.send(200, "text/html", buildRedirectHtml());
+  sendRedirectHtml();
 
   WiFi.disconnect(false);
   WiFi.begin(ssidName, ssidPassword);
@@ -261,45 +271,93 @@ void onConfigApplyPage(void) {
 
 void onRelayHomePage(void) {
   Serial.println("Opening relay page.");
-  webserver.send(200, "text/html", buildHomePageHtml());
+  sendHomePageHtml();
 }
 
 void onRelayOn(void) {
   Serial.println("Relay -> ON");
   writeRelay(RELAY_STATE_ON);
-  webserver.send(200, "text/html", buildRedirectHtml());
+  sendRedirectHtml();
 }
 
 void onRelayOff(void) {
   Serial.println("Relay -> OFF");
   writeRelay(RELAY_STATE_OFF);
-  webserver.send(200, "text/html", buildRedirectHtml());
+  sendRedirectHtml();
+}
+
+void sendStatusPageHtml(void) {
+  statusPageTemplate.send(webserver, 200, "text/html", getStatusPageValue);
+}
+
+String getStatusPageValue(uint8_t slot) {
+  switch (slot) {
+  case STATUS_SLOT_STA_STATUS:
+    return getStatusString();
+  case STATUS_SLOT_SSID_NAME:
+    return (WiFi.status() == WL_CONNECTED) ? WiFi.SSID() : NOT_AVAILABLE;
+  case STATUS_SLOT_STA_IP_ADDRESS:
+    return (WiFi.status() == WL_CONNECTED) ? WiFi.localIP().toString() : NOT_AVAILABLE;
+  case STATUS_SLOT_AP_SSID:
+    return SOFTAP_SSID_NAME;
+  case STATUS_SLOT_AP_IP_ADDRESS:
+    return WiFi.softAPIP().toString();
+  default:
+    return "";
+  }
+}
+
+void sendConfigPageHtml(void) {
+  sendGzipPage(CONFIG_PAGE, CONFIG_PAGE_LENGTH, CONFIG_PAGE_ETAG, CACHE_CONTROL_PAGE);
 }
 
-String buildStatusPageHtml(void) {
-  String str = String(STATUS_PAGE);
-  str.replace(STATUS_STA_STATUS, getStatusString());
-  str.replace(STATUS_SSID_NAME, (WiFi.status() == WL_CONNECTED) ? WiFi.SSID() : NOT_AVAILABLE);
-  str.replace(STATUS_STA_IP_ADDRESS, (WiFi.status() == WL_CONNECTED) ? WiFi.localIP().toString() : NOT_AVAILABLE);
-  str.replace(STATUS_AP_SSID, SOFTAP_SSID_NAME);
-  str.replace(STATUS_AP_IP_ADDRESS, WiFi.softAPIP().toString());
-  return str;
+void sendHomePageHtml(void) {
+  homePageTemplate.send(webserver, 200, "text/html", getHomePageValue);
 }
 
-String buildConfigPageHtml(void) {
-  return CONFIG_PAGE;
+String getHomePageValue(uint8_t slot) {
+  switch (slot) {
+  case RELAY_SLOT_NAME:
+    return relayDisplayName;
+  case RELAY_SLOT_STATE:
+    return (relayState == RELAY_STATE_OFF) ? "ON" : "OFF";
+  case RELAY_SLOT_HREF:
+    return (relayState == RELAY_STATE_OFF) ? "relay_on" : "relay_off";
+  default:
+    return "";
+  }
 }
 
-String buildHomePageHtml(void) {
-  String str = String(RELAY_PAGE);
-  str.replace(RELAY_NAME, relayDisplayName);
-  str.replace(RELAY_STATE, (relayState == RELAY_STATE_OFF) ? "ON" : "OFF");
-  str.replace(RELAY_HREF, (relayState == RELAY_STATE_OFF) ? "relay_on" : "relay_off");
-  return str;
+void sendRedirectHtml(void) {
+  // The action already ran, send a client without gzip home all the same.
+  if (webserver.header("Accept-Encoding").indexOf("gzip") < 0) {
+    webserver.sendHeader("Location", "/");
+    webserver.send(303, "text/html", "<a href=\"/\">Back</a>");
+    return;
+  }
+
+  sendGzipPage(REDIRECT_PAGE, REDIRECT_PAGE_LENGTH, REDIRECT_PAGE_ETAG, CACHE_CONTROL_PAGE);
 }
 
-String buildRedirectHtml(void) {
-  return REDIRECT_PAGE;
+void sendGzipPage(const uint8_t *page, size_t length, const char *etag, const char *cacheControl) {
+  // The pages are only stored gzipped, tell caches the body depends on it.
+  webserver.sendHeader("Vary", "Accept-Encoding");
+  if (webserver.header("Accept-Encoding").indexOf("gzip") < 0) {
+    webserver.send(406, "text/plain", "This page needs a browser that accepts gzip.");
+    return;
+  }
+
+  webserver.sendHeader("ETag", etag);
+  webserver.sendHeader("Cache-Control", cacheControl);
+
+  // Conditional GET, the client already has this page.
+  if (webserver.header("If-None-Match").indexOf(etag) >= 0) {
+    webserver.send(304);
+    return;
+  }
+
+  webserver.sendHeader("Content-Encoding", "gzip");
+  webserver.send_P(200, "text/html", (PGM_P)page, length);
 }
 
 void onSoftAPModeStationConnected(const WiFiEventSoftAPModeStationConnected& event) {
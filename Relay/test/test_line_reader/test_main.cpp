@@ -0,0 +1,278 @@
+/*
+ * Host tests for LineReader: line endings, lines at and around the buffer
+ * size, and a benchmark of reading wifi.cfg against the readString(),
+ * indexOf(), substring() and remove() it replaced, with the heap
+ * allocations of each counted.
+ *
+ *     pio test -e native -f test_line_reader
+ */
+#include <LineReader.h>
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+
+// Every operator new of the test binary, the shim's String included.
+static size_t allocations;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *block = malloc(size ? size : 1);
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void operator delete(void *block) noexcept
+{
+    free(block);
+}
+
+void operator delete(void *block, size_t size) noexcept
+{
+    free(block);
+}
+
+/*
+ * Stream over a string, read in bulk like a LittleFS File.
+ */
+class MemoryStream : public Stream
+{
+public:
+    MemoryStream(const std::string &data) : _data(data), _position(0) {}
+
+    int available(void) override
+    {
+        return (int)(_data.size() - _position);
+    }
+
+    int read(void) override
+    {
+        return (_position < _data.size()) ? (uint8_t)_data[_position++] : -1;
+    }
+
+    int peek(void) override
+    {
+        return (_position < _data.size()) ? (uint8_t)_data[_position] : -1;
+    }
+
+    size_t readBytes(char *buffer, size_t length) override
+    {
+        size_t count = _data.size() - _position;
+        if (count > length)
+        {
+            count = length;
+        }
+        memcpy(buffer, _data.data() + _position, count);
+        _position += count;
+        return count;
+    }
+
+    size_t write(uint8_t c) override
+    {
+        return 0;
+    }
+
+    void rewind(void)
+    {
+        _position = 0;
+    }
+
+private:
+    std::string _data;
+    size_t _position;
+};
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static void assertLine(LineReader &reader, const std::string &expected, bool truncated, const char *message)
+{
+    LineView line;
+    TEST_ASSERT_TRUE_MESSAGE(reader.next(line), message);
+    TEST_ASSERT_EQUAL_MESSAGE(expected.size(), line.length, message);
+    TEST_ASSERT_TRUE_MESSAGE(expected == std::string(line.data, line.length), message);
+    TEST_ASSERT_EQUAL_MESSAGE(0, line.data[line.length], message);
+    TEST_ASSERT_EQUAL_MESSAGE(truncated, line.truncated, message);
+}
+
+/* -------------------------------------------------- */
+
+static void test_endings(void)
+{
+    MemoryStream stream("ssid\r\npassword\nname\r\n\r\nlast");
+    LineReader reader(stream);
+    assertLine(reader, "ssid", false, "CRLF");
+    assertLine(reader, "password", false, "LF");
+    assertLine(reader, "name", false, "CRLF");
+    assertLine(reader, "", false, "empty line");
+    assertLine(reader, "last", false, "no ending");
+
+    LineView line;
+    TEST_ASSERT_FALSE(reader.next(line));
+    TEST_ASSERT_FALSE(reader.next(line));
+}
+
+static void test_empty_stream(void)
+{
+    MemoryStream stream("");
+    LineReader reader(stream);
+    LineView line;
+    TEST_ASSERT_FALSE(reader.next(line));
+}
+
+static void test_line_filling_buffer_with_cr(void)
+{
+    // The content and its "\r" exactly fill the buffer, "\n" is still unread.
+    std::string text(LINE_READER_BUFFER_SIZE - 1, 'a');
+    MemoryStream stream(text + "\r\nnext\r\n");
+    LineReader reader(stream);
+    assertLine(reader, text, false, "first");
+    assertLine(reader, "next", false, "second");
+}
+
+static void test_line_of_buffer_size(void)
+{
+    std::string text(LINE_READER_BUFFER_SIZE, 'b');
+    const char *endings[] = {"\n", "\r\n", ""};
+    for (const char *ending : endings)
+    {
+        MemoryStream stream(text + ending + (*ending ? "next\n" : ""));
+        LineReader reader(stream);
+        assertLine(reader, text, false, ending);
+        if (*ending)
+        {
+            assertLine(reader, "next", false, ending);
+        }
+        LineView line;
+        TEST_ASSERT_FALSE(reader.next(line));
+    }
+}
+
+static void test_long_line_truncated(void)
+{
+    std::string text(LINE_READER_BUFFER_SIZE * 3 + 5, 'c');
+    text[LINE_READER_BUFFER_SIZE] = '\r';
+    MemoryStream stream(text + "\r\nnext\n");
+    LineReader reader(stream);
+    assertLine(reader, text.substr(0, LINE_READER_BUFFER_SIZE), true, "long");
+    assertLine(reader, "next", false, "after long");
+}
+
+static void test_all_lengths(void)
+{
+    // Every length around one and two buffers, with both endings.
+    char message[64];
+    for (size_t length = 0; length <= LINE_READER_BUFFER_SIZE * 2 + 2; length++)
+    {
+        for (int crlf = 0; crlf < 2; crlf++)
+        {
+            std::string text(length, 'x');
+            MemoryStream stream(text + (crlf ? "\r\n" : "\n") + "next" + (crlf ? "\r\n" : "\n"));
+            LineReader reader(stream);
+            snprintf(message, sizeof(message), "length %u, %s", (unsigned)length, crlf ? "CRLF" : "LF");
+
+            bool truncated = length > LINE_READER_BUFFER_SIZE;
+            assertLine(reader, text.substr(0, LINE_READER_BUFFER_SIZE), truncated, message);
+            assertLine(reader, "next", false, message);
+        }
+    }
+}
+
+/* -------------------------------------------------- */
+
+// wifi.cfg as saveWifiConfig() writes it.
+#define WIFI_CFG "HomeNetwork-5G\r\ncorrect horse battery staple\r\nLiving room lamp"
+
+// How loadWifiConfig() read wifi.cfg before LineReader.
+static void parseWithReadString(Stream &stream, String &ssid, String &password, String &name)
+{
+    String cfg = stream.readString();
+
+    int index = cfg.indexOf("\r\n");
+    ssid = cfg.substring(0, index);
+    cfg.remove(0, index + 2);
+
+    index = cfg.indexOf("\r\n");
+    password = cfg.substring(0, index);
+    cfg.remove(0, index + 2);
+
+    name = cfg;
+}
+
+static void parseWithLineReader(Stream &stream, String &ssid, String &password, String &name)
+{
+    LineReader reader(stream);
+    LineView line;
+    ssid = reader.next(line) ? line.data : "";
+    password = reader.next(line) ? line.data : "";
+    name = reader.next(line) ? line.data : "";
+}
+
+// Parses WIFI_CFG `passes` times; returns the time per parse in microseconds
+// and the allocations per parse.
+template <typename Parse>
+static double measure(Parse parse, int passes, double &allocationsPerParse)
+{
+    MemoryStream stream(WIFI_CFG);
+    String ssid;
+    String password;
+    String name;
+
+    size_t before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++)
+    {
+        stream.rewind();
+        parse(stream, ssid, password, name);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    allocationsPerParse = (double)(allocations - before) / passes;
+
+    TEST_ASSERT_EQUAL_STRING("HomeNetwork-5G", ssid.c_str());
+    TEST_ASSERT_EQUAL_STRING("correct horse battery staple", password.c_str());
+    TEST_ASSERT_EQUAL_STRING("Living room lamp", name.c_str());
+    return elapsed.count() / passes;
+}
+
+static void test_compare_with_read_string(void)
+{
+    const int passes = 100000;
+    double readStringAllocations;
+    double lineReaderAllocations;
+    double readStringTime = measure(parseWithReadString, passes, readStringAllocations);
+    double lineReaderTime = measure(parseWithLineReader, passes, lineReaderAllocations);
+
+    // Only the three strings that are kept may touch the heap.
+    TEST_ASSERT_TRUE(lineReaderAllocations <= 3);
+    TEST_ASSERT_TRUE(lineReaderAllocations < readStringAllocations);
+
+    char message[160];
+    snprintf(message, sizeof(message),
+             "readString %.3f us, %.1f allocations; LineReader %.3f us, %.1f allocations (per parse)",
+             readStringTime, readStringAllocations, lineReaderTime, lineReaderAllocations);
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_endings);
+    RUN_TEST(test_empty_stream);
+    RUN_TEST(test_line_filling_buffer_with_cr);
+    RUN_TEST(test_line_of_buffer_size);
+    RUN_TEST(test_long_line_truncated);
+    RUN_TEST(test_all_lengths);
+    RUN_TEST(test_compare_with_read_string);
+    return UNITY_END();
+}
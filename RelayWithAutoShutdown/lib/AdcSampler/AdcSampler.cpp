@@ -0,0 +1,182 @@
+#include "AdcSampler.h"
+
+static_assert((ADC_SAMPLER_QUEUE_SIZE & (ADC_SAMPLER_QUEUE_SIZE - 1)) == 0, "ADC_SAMPLER_QUEUE_SIZE must be a power of two");
+static_assert((ADC_SAMPLER_WINDOW & (ADC_SAMPLER_WINDOW - 1)) == 0 && ADC_SAMPLER_WINDOW <= 128,
+              "ADC_SAMPLER_WINDOW must be a power of two up to 128");
+static_assert(ADC_SAMPLER_RANGE % ADC_SAMPLER_BINS == 0, "ADC_SAMPLER_BINS must divide the ADC range");
+
+#define ADC_SAMPLER_BIN_WIDTH (ADC_SAMPLER_RANGE / ADC_SAMPLER_BINS)
+
+AdcSampler::AdcSampler(uint8_t pin)
+    : _pin(pin), _rate(0), _head(0), _tail(0), _overruns(0), _sequence(0), _count(0), _sum(0),
+      _minFront(0), _minCount(0), _maxFront(0), _maxCount(0)
+{
+    memset(_bins, 0, sizeof(_bins));
+}
+
+void AdcSampler::begin(uint16_t rate)
+{
+    if (rate < 1)
+    {
+        rate = 1;
+    }
+    if (rate > ADC_SAMPLER_MAX_RATE)
+    {
+        rate = ADC_SAMPLER_MAX_RATE;
+    }
+
+    // The Ticker counts whole milliseconds, report the rate it really runs at.
+    uint32_t interval = 1000 / rate;
+    _rate = 1000 / interval;
+    _ticker.attach_ms(interval, onTick, this);
+}
+
+void AdcSampler::end(void)
+{
+    _ticker.detach();
+    _rate = 0;
+}
+
+void AdcSampler::sample(void)
+{
+    // A conversion right now, for a reading before the first tick.
+    onTick(this);
+    update();
+}
+
+void AdcSampler::update(void)
+{
+    uint8_t head = _head;
+    uint8_t tail = _tail;
+    while (tail != head)
+    {
+        add(_queue[tail]);
+        tail = (tail + 1) & (ADC_SAMPLER_QUEUE_SIZE - 1);
+    }
+    _tail = tail;
+}
+
+uint16_t AdcSampler::latest(void) const
+{
+    return _count > 0 ? at(_sequence - 1) : 0;
+}
+
+uint16_t AdcSampler::minimum(void) const
+{
+    return _minCount > 0 ? at(_minQueue[_minFront]) : 0;
+}
+
+uint16_t AdcSampler::maximum(void) const
+{
+    return _maxCount > 0 ? at(_maxQueue[_maxFront]) : 0;
+}
+
+float AdcSampler::mean(void) const
+{
+    return _count > 0 ? (float)_sum / _count : 0.0f;
+}
+
+float AdcSampler::percentile(uint8_t percent) const
+{
+    if (_count == 0)
+    {
+        return 0.0f;
+    }
+    if (percent > 100)
+    {
+        percent = 100;
+    }
+
+    // Walk the bins to the one holding the requested rank.
+    float rank = (_count - 1) * percent / 100.0f;
+    uint16_t before = 0;
+    uint8_t bin = 0;
+    while (bin < ADC_SAMPLER_BINS - 1 && before + _bins[bin] <= rank)
+    {
+        before += _bins[bin];
+        bin++;
+    }
+
+    float value = bin * ADC_SAMPLER_BIN_WIDTH;
+    if (_bins[bin] > 0)
+    {
+        value += ADC_SAMPLER_BIN_WIDTH * (rank - before + 0.5f) / _bins[bin];
+    }
+
+    // The edges of the window are known exactly.
+    if (value < minimum())
+    {
+        return minimum();
+    }
+    if (value > maximum())
+    {
+        return maximum();
+    }
+    return value;
+}
+
+void AdcSampler::onTick(AdcSampler *sampler)
+{
+    uint8_t head = sampler->_head;
+    uint8_t next = (head + 1) & (ADC_SAMPLER_QUEUE_SIZE - 1);
+    if (next == sampler->_tail)
+    {
+        sampler->_overruns++;
+        return;
+    }
+
+    sampler->_queue[head] = analogRead(sampler->_pin);
+    sampler->_head = next;
+}
+
+void AdcSampler::add(uint16_t value)
+{
+    if (value >= ADC_SAMPLER_RANGE)
+    {
+        value = ADC_SAMPLER_RANGE - 1;
+    }
+
+    // A full window drops its oldest sample, which shares the new one's slot.
+    if (_count == ADC_SAMPLER_WINDOW)
+    {
+        uint32_t oldest = _sequence - ADC_SAMPLER_WINDOW;
+        uint16_t old = at(oldest);
+        _sum -= old;
+        _bins[old / ADC_SAMPLER_BIN_WIDTH]--;
+        if (_minCount > 0 && _minQueue[_minFront] == oldest)
+        {
+            _minFront = (_minFront + 1) % ADC_SAMPLER_WINDOW;
+            _minCount--;
+        }
+        if (_maxCount > 0 && _maxQueue[_maxFront] == oldest)
+        {
+            _maxFront = (_maxFront + 1) % ADC_SAMPLER_WINDOW;
+            _maxCount--;
+        }
+    }
+    else
+    {
+        _count++;
+    }
+
+    _window[_sequence % ADC_SAMPLER_WINDOW] = value;
+    _sum += value;
+    _bins[value / ADC_SAMPLER_BIN_WIDTH]++;
+
+    // Samples that can no longer be the minimum or maximum leave the queues.
+    while (_minCount > 0 && at(_minQueue[(_minFront + _minCount - 1) % ADC_SAMPLER_WINDOW]) >= value)
+    {
+        _minCount--;
+    }
+    _minQueue[(_minFront + _minCount) % ADC_SAMPLER_WINDOW] = _sequence;
+    _minCount++;
+
+    while (_maxCount > 0 && at(_maxQueue[(_maxFront + _maxCount - 1) % ADC_SAMPLER_WINDOW]) <= value)
+    {
+        _maxCount--;
+    }
+    _maxQueue[(_maxFront + _maxCount) % ADC_SAMPLER_WINDOW] = _sequence;
+    _maxCount++;
+
+    _sequence++;
+}
@@ -0,0 +1,78 @@
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include <Arduino.h>
+#include <Ticker.h>
+
+#define ADC_SAMPLER_QUEUE_SIZE 32
+#define ADC_SAMPLER_WINDOW 64
+#define ADC_SAMPLER_BINS 64
+#define ADC_SAMPLER_RANGE 1024
+#define ADC_SAMPLER_MAX_RATE 1000
+
+/*
+ * Reads an analog pin at a fixed rate and keeps statistics over the last
+ * ADC_SAMPLER_WINDOW samples, so the readers share one set of conversions.
+ *
+ * A Ticker takes the conversions and hands them to loop() through a
+ * single-producer, single-consumer ring. The SDK runs Ticker callbacks
+ * outside interrupts, where analogRead() is allowed. update() moves the
+ * queued samples into the window; when loop() falls behind by more than
+ * ADC_SAMPLER_QUEUE_SIZE samples, new ones are dropped and counted.
+ *
+ * minimum() and maximum() come from monotonic queues, mean() from a running
+ * sum and percentile() from a histogram of ADC_SAMPLER_BINS bins,
+ * interpolated within the bin. None of them depends on the window size.
+ */
+class AdcSampler
+{
+public:
+    AdcSampler(uint8_t pin);
+
+    void begin(uint16_t rate);
+    void end(void);
+
+    void sample(void);
+    void update(void);
+
+    uint16_t rate(void) const { return _rate; }
+    uint16_t count(void) const { return _count; }
+    uint32_t overruns(void) const { return _overruns; }
+
+    uint16_t latest(void) const;
+    uint16_t minimum(void) const;
+    uint16_t maximum(void) const;
+    float mean(void) const;
+    float percentile(uint8_t percent) const;
+
+private:
+    static void onTick(AdcSampler *sampler);
+    void add(uint16_t value);
+    uint16_t at(uint32_t sequence) const { return _window[sequence % ADC_SAMPLER_WINDOW]; }
+
+    uint8_t _pin;
+    uint16_t _rate;
+    Ticker _ticker;
+
+    // _head is only written by the Ticker, _tail only by update().
+    uint16_t _queue[ADC_SAMPLER_QUEUE_SIZE];
+    volatile uint8_t _head;
+    volatile uint8_t _tail;
+    volatile uint32_t _overruns;
+
+    uint16_t _window[ADC_SAMPLER_WINDOW];
+    uint32_t _sequence;
+    uint16_t _count;
+    uint32_t _sum;
+    uint16_t _bins[ADC_SAMPLER_BINS];
+
+    // Sequence numbers of window samples, the front is the minimum/maximum.
+    uint32_t _minQueue[ADC_SAMPLER_WINDOW];
+    uint32_t _maxQueue[ADC_SAMPLER_WINDOW];
+    uint8_t _minFront;
+    uint8_t _minCount;
+    uint8_t _maxFront;
+    uint8_t _maxCount;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include "BootCache.h"
+#include <Crc32.h>
+
+bool BootCache::load(BootSnapshot &snapshot)
+{
+    if (!ESP.rtcUserMemoryRead(BOOT_CACHE_RTC_OFFSET, (uint32_t *)&snapshot, sizeof(snapshot)))
+    {
+        return false;
+    }
+
+    return snapshot.magic == BOOT_CACHE_MAGIC && snapshot.version == BOOT_CACHE_VERSION &&
+           snapshot.size == sizeof(snapshot) && snapshot.crc == crc32(&snapshot, offsetof(BootSnapshot, crc));
+}
+
+bool BootCache::save(BootSnapshot &snapshot)
+{
+    snapshot.magic = BOOT_CACHE_MAGIC;
+    snapshot.version = BOOT_CACHE_VERSION;
+    snapshot.size = sizeof(snapshot);
+    snapshot.crc = crc32(&snapshot, offsetof(BootSnapshot, crc));
+    return ESP.rtcUserMemoryWrite(BOOT_CACHE_RTC_OFFSET, (uint32_t *)&snapshot, sizeof(snapshot));
+}
+
+void BootCache::invalidate(void)
+{
+    uint32_t magic = 0;
+    ESP.rtcUserMemoryWrite(BOOT_CACHE_RTC_OFFSET, &magic, sizeof(magic));
+}
@@ -0,0 +1,48 @@
+#ifndef BOOT_CACHE_H
+#define BOOT_CACHE_H
+
+#include <Arduino.h>
+#include <ConfigStore.h>
+
+#define BOOT_CACHE_MAGIC 0x544F4F42 // "BOOT"
+#define BOOT_CACHE_VERSION 3
+
+// In 4-byte blocks. OTA keeps its boot command in the first 128 bytes.
+#define BOOT_CACHE_RTC_OFFSET 32
+
+/*
+ * Runtime state kept in RTC user memory, which survives ESP.restart(), OTA,
+ * watchdog and exception resets but not a power cycle. Of the configuration
+ * it keeps everything but the WiFi credentials, which stay on flash only.
+ */
+struct BootSnapshot
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+
+    uint32_t relayState;
+    uint32_t epoch;        // UTC seconds when written, 0 if the time was never known.
+    uint32_t uptimeMillis; // Time since the last power on when written.
+
+    uint32_t configCrc; // CRC of the whole ConfigRecord, credentials included.
+    uint8_t configSettings[CONFIG_SETTINGS_SIZE]; // ConfigStore::getSettings().
+
+    uint32_t crc;
+};
+
+static_assert(sizeof(BootSnapshot) <= 512 - BOOT_CACHE_RTC_OFFSET * 4, "BootSnapshot does not fit RTC user memory");
+
+/*
+ * Reads and writes the BootSnapshot, checked with magic, version, size and
+ * CRC32. Garbage left in RTC memory after a cold boot fails the check.
+ */
+class BootCache
+{
+public:
+    static bool load(BootSnapshot &snapshot);
+    static bool save(BootSnapshot &snapshot);
+    static void invalidate(void);
+};
+
+#endif
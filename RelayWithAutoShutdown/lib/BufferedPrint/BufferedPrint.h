@@ -0,0 +1,61 @@
+#ifndef BUFFERED_PRINT_H
+#define BUFFERED_PRINT_H
+
+#include <Arduino.h>
+
+#define BUFFERED_PRINT_SIZE 256
+
+/*
+ * Print adapter that collects small writes in a fixed buffer and forwards
+ * them to the target in blocks. Serializers such as ArduinoJson write one
+ * character at a time, which would otherwise become one TCP write each.
+ */
+class BufferedPrint : public Print
+{
+public:
+    BufferedPrint(Print &target) : _target(target), _length(0) {}
+    ~BufferedPrint() { flush(); }
+
+    size_t write(uint8_t c) override
+    {
+        if (_length == BUFFERED_PRINT_SIZE)
+        {
+            flush();
+        }
+        _buffer[_length++] = c;
+        return 1;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        if (_length + size > BUFFERED_PRINT_SIZE)
+        {
+            flush();
+        }
+        if (size > BUFFERED_PRINT_SIZE)
+        {
+            return _target.write(buffer, size);
+        }
+        memcpy(_buffer + _length, buffer, size);
+        _length += size;
+        return size;
+    }
+
+    using Print::write;
+
+    void flush(void) override
+    {
+        if (_length > 0)
+        {
+            _target.write(_buffer, _length);
+            _length = 0;
+        }
+    }
+
+private:
+    Print &_target;
+    uint8_t _buffer[BUFFERED_PRINT_SIZE];
+    size_t _length;
+};
+
+#endif
@@ -0,0 +1,409 @@
+#include "ConfigStore.h"
+#include <LittleFS.h>
+#include <Crc32.h>
+
+// Only the settings may be patched, never the header or the CRC.
+#define CONFIG_FIELDS_BEGIN offsetof(ConfigRecord, ssid)
+#define CONFIG_FIELDS_END offsetof(ConfigRecord, crc)
+
+#define CONFIG_DEFAULT_MIN_ON_TIME 60
+#define CONFIG_DEFAULT_MIN_OFF_TIME 60
+#define CONFIG_DEFAULT_LDR_HYSTERESIS 10
+#define CONFIG_DEFAULT_TIME_ZONE "CST-8" // UTC+8, no DST
+
+struct ConfigVersion
+{
+    size_t size;      // Record size, with the CRC in its last four bytes.
+    size_t fieldsEnd; // Where the fields of the next version start.
+};
+
+// Earlier layouts, CONFIG_VERSION - 1 entries.
+static const ConfigVersion CONFIG_VERSIONS[] = {
+    {CONFIG_V1_SIZE, offsetof(ConfigRecord, backupNetworks)},
+    {CONFIG_V2_SIZE, offsetof(ConfigRecord, minOnTime)},
+    {CONFIG_V3_SIZE, offsetof(ConfigRecord, timeZone)},
+    {CONFIG_V4_SIZE, offsetof(ConfigRecord, enableLocation)},
+    {CONFIG_V5_SIZE, offsetof(ConfigRecord, moreBackupNetworks)},
+};
+static_assert(sizeof(CONFIG_VERSIONS) / sizeof(CONFIG_VERSIONS[0]) == CONFIG_VERSION - 1, "Describe the previous layout");
+static_assert(offsetof(ConfigRecord, backupNetworks) + sizeof(uint32_t) <= CONFIG_V1_SIZE, "Version 1 layout changed");
+static_assert(offsetof(ConfigRecord, minOnTime) + sizeof(uint32_t) <= CONFIG_V2_SIZE, "Version 2 layout changed");
+static_assert(offsetof(ConfigRecord, timeZone) + sizeof(uint32_t) <= CONFIG_V3_SIZE, "Version 3 layout changed");
+static_assert(offsetof(ConfigRecord, enableLocation) + sizeof(uint32_t) <= CONFIG_V4_SIZE, "Version 4 layout changed");
+static_assert(offsetof(ConfigRecord, moreBackupNetworks) + sizeof(uint32_t) <= CONFIG_V5_SIZE, "Version 5 layout changed");
+
+struct ConfigRange
+{
+    size_t begin;
+    size_t end;
+};
+
+// Together the two cover the fields, padding included.
+static const ConfigRange SETTINGS_RANGES[] = {
+    {offsetof(ConfigRecord, relayDisplayName), offsetof(ConfigRecord, backupNetworks)},
+    {offsetof(ConfigRecord, minOnTime), offsetof(ConfigRecord, moreBackupNetworks)},
+};
+static const ConfigRange CREDENTIAL_RANGES[] = {
+    {offsetof(ConfigRecord, ssid), offsetof(ConfigRecord, relayDisplayName)},
+    {offsetof(ConfigRecord, backupNetworks), offsetof(ConfigRecord, minOnTime)},
+    {offsetof(ConfigRecord, moreBackupNetworks), offsetof(ConfigRecord, crc)},
+};
+
+ConfigStore::ConfigStore(const char *path)
+    : _path(path), _tempPath(String(path) + ".tmp"), _journalPath(String(path) + ".jnl"),
+      _hasCurrent(false), _baseCrc(0), _journalLength(0)
+{
+}
+
+bool ConfigStore::load(ConfigRecord &record)
+{
+    _hasCurrent = false;
+
+    File file = LittleFS.open(_path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    size_t length = file.read((uint8_t *)&record, sizeof(record));
+    file.close();
+
+    bool upgraded = false;
+    if (!checkRecord(record, length, upgraded))
+    {
+        Serial.printf("[Config] %s is not a valid version %d record.\r\n", _path, CONFIG_VERSION);
+        return false;
+    }
+
+    replayJournal(record);
+
+    if (upgraded)
+    {
+        // If this fails the next save() writes a full record anyway.
+        seal(record);
+        Serial.printf("[Config] Upgraded %s to version %d.\r\n", _path, CONFIG_VERSION);
+        writeRecord(record);
+        return true;
+    }
+
+    _current = record;
+    _hasCurrent = true;
+    return true;
+}
+
+bool ConfigStore::loadCredentials(ConfigRecord &record)
+{
+    // Leaves _current alone: without it the next save() writes a full record.
+    File file = LittleFS.open(_path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    bool loaded = file.size() == sizeof(record);
+    for (const ConfigRange &range : CREDENTIAL_RANGES)
+    {
+        size_t length = range.end - range.begin;
+        loaded = loaded && file.seek(range.begin) && file.read((uint8_t *)&record + range.begin, length) == length;
+    }
+    file.close();
+    return loaded;
+}
+
+bool ConfigStore::save(ConfigRecord &record)
+{
+    seal(record);
+
+    if (!_hasCurrent)
+    {
+        return writeRecord(record);
+    }
+
+    // Range of bytes that changed since the last load or save.
+    size_t first = CONFIG_FIELDS_BEGIN;
+    size_t last = CONFIG_FIELDS_END;
+    const uint8_t *current = (const uint8_t *)&_current;
+    const uint8_t *next = (const uint8_t *)&record;
+    while (first < last && current[first] == next[first])
+    {
+        first++;
+    }
+    while (last > first && current[last - 1] == next[last - 1])
+    {
+        last--;
+    }
+
+    if (first == last)
+    {
+        return true;
+    }
+
+    size_t length = last - first;
+    size_t entrySize = sizeof(JournalEntry) + length + sizeof(uint32_t);
+    size_t journalLength = (_journalLength > 0) ? _journalLength : sizeof(JournalHeader);
+    if (length <= CONFIG_JOURNAL_MAX_PATCH && journalLength + entrySize <= CONFIG_JOURNAL_LIMIT &&
+        appendPatch(first, length, record))
+    {
+        _current = record;
+        return true;
+    }
+
+    return writeRecord(record);
+}
+
+bool ConfigStore::exists(void)
+{
+    return LittleFS.exists(_path);
+}
+
+bool ConfigStore::remove(void)
+{
+    _hasCurrent = false;
+    _journalLength = 0;
+    LittleFS.remove(_journalPath);
+    LittleFS.remove(_tempPath);
+    return LittleFS.remove(_path);
+}
+
+void ConfigStore::clear(ConfigRecord &record)
+{
+    memset(&record, 0, sizeof(record));
+    record.turnOnThreshold = -1.0f;
+    record.shutdownThreshold = -1.0f;
+    record.turnOnBeginHour = record.turnOnBeginMinute = -1;
+    record.turnOnEndHour = record.turnOnEndMinute = -1;
+    record.shutdownBeginHour = record.shutdownBeginMinute = -1;
+    record.shutdownEndHour = record.shutdownEndMinute = -1;
+    record.minOnTime = CONFIG_DEFAULT_MIN_ON_TIME;
+    record.minOffTime = CONFIG_DEFAULT_MIN_OFF_TIME;
+    record.ldrHysteresis = CONFIG_DEFAULT_LDR_HYSTERESIS;
+    strcpy(record.timeZone, CONFIG_DEFAULT_TIME_ZONE);
+}
+
+void ConfigStore::seal(ConfigRecord &record)
+{
+    record.magic = CONFIG_MAGIC;
+    record.version = CONFIG_VERSION;
+    record.size = sizeof(record);
+    record.crc = crc32(&record, offsetof(ConfigRecord, crc));
+}
+
+bool ConfigStore::isValid(const ConfigRecord &record)
+{
+    return record.magic == CONFIG_MAGIC && record.version == CONFIG_VERSION && record.size == sizeof(record) &&
+           record.crc == crc32(&record, offsetof(ConfigRecord, crc));
+}
+
+void ConfigStore::setString(char *field, size_t size, const String &value)
+{
+    // Truncates, and clears the rest so equal records compare equal.
+    size_t length = value.length() < size - 1 ? value.length() : size - 1;
+    while (length < value.length() && length > 0 && (value[length] & 0xC0) == 0x80)
+    {
+        length--; // Do not cut a UTF-8 sequence in half.
+    }
+    memset(field, 0, size);
+    memcpy(field, value.c_str(), length);
+}
+
+void ConfigStore::getSettings(const ConfigRecord &record, uint8_t *settings)
+{
+    for (const ConfigRange &range : SETTINGS_RANGES)
+    {
+        memcpy(settings, (const uint8_t *)&record + range.begin, range.end - range.begin);
+        settings += range.end - range.begin;
+    }
+}
+
+void ConfigStore::setSettings(ConfigRecord &record, const uint8_t *settings)
+{
+    for (const ConfigRange &range : SETTINGS_RANGES)
+    {
+        memcpy((uint8_t *)&record + range.begin, settings, range.end - range.begin);
+        settings += range.end - range.begin;
+    }
+}
+
+ConfigNetwork &ConfigStore::backupNetwork(ConfigRecord &record, uint8_t index)
+{
+    // Index 0 is the version 2 slot, the rest were appended in version 6.
+    return (index == 0) ? record.backupNetworks[0] : record.moreBackupNetworks[index - 1];
+}
+
+const ConfigNetwork &ConfigStore::backupNetwork(const ConfigRecord &record, uint8_t index)
+{
+    return (index == 0) ? record.backupNetworks[0] : record.moreBackupNetworks[index - 1];
+}
+
+/* -------------------------------------------------- */
+
+bool ConfigStore::checkRecord(ConfigRecord &record, size_t length, bool &upgraded)
+{
+    // Sets _baseCrc to the CRC stored in the file, which the journal refers to.
+    upgraded = false;
+    if (length == sizeof(record) && isValid(record))
+    {
+        _baseCrc = record.crc;
+        return true;
+    }
+
+    if (record.magic != CONFIG_MAGIC || record.version < 1 || record.version >= CONFIG_VERSION)
+    {
+        return false;
+    }
+    const ConfigVersion &version = CONFIG_VERSIONS[record.version - 1];
+    if (length != version.size || record.size != version.size)
+    {
+        return false;
+    }
+
+    uint32_t crc;
+    memcpy(&crc, (const uint8_t *)&record + version.size - sizeof(crc), sizeof(crc));
+    if (crc != crc32(&record, version.size - sizeof(crc)))
+    {
+        return false;
+    }
+
+    // The old record ends with its CRC, in what are new fields now.
+    ConfigRecord defaults;
+    clear(defaults);
+    memcpy((uint8_t *)&record + version.fieldsEnd, (const uint8_t *)&defaults + version.fieldsEnd,
+           CONFIG_FIELDS_END - version.fieldsEnd);
+    _baseCrc = crc;
+    upgraded = true;
+    return true;
+}
+
+bool ConfigStore::writeRecord(const ConfigRecord &record)
+{
+    File file = LittleFS.open(_tempPath, "w");
+    if (!file)
+    {
+        Serial.printf("[Config] Failed to create %s.\r\n", _tempPath.c_str());
+        return false;
+    }
+    size_t length = file.write((const uint8_t *)&record, sizeof(record));
+    file.close();
+
+    // Read it back before it replaces the good copy.
+    ConfigRecord check;
+    file = LittleFS.open(_tempPath, "r");
+    bool verified = file && length == sizeof(record) && file.read((uint8_t *)&check, sizeof(check)) == sizeof(check) &&
+                    memcmp(&check, &record, sizeof(record)) == 0;
+    if (file)
+    {
+        file.close();
+    }
+
+    if (!verified || !LittleFS.rename(_tempPath, _path))
+    {
+        Serial.printf("[Config] Failed to write %s, keeping the previous one.\r\n", _path);
+        LittleFS.remove(_tempPath);
+        return false;
+    }
+
+    // The journal belongs to the old record; its header no longer matches
+    // even if removing it fails here.
+    LittleFS.remove(_journalPath);
+    _journalLength = 0;
+    _baseCrc = record.crc;
+    _current = record;
+    _hasCurrent = true;
+    return true;
+}
+
+bool ConfigStore::appendPatch(size_t offset, size_t length, const ConfigRecord &record)
+{
+    File file;
+    if (_journalLength == 0)
+    {
+        file = LittleFS.open(_journalPath, "w");
+        JournalHeader header = {CONFIG_JOURNAL_MAGIC, _baseCrc};
+        if (!file || file.write((const uint8_t *)&header, sizeof(header)) != sizeof(header))
+        {
+            return false;
+        }
+        _journalLength = sizeof(header);
+    }
+    else
+    {
+        file = LittleFS.open(_journalPath, "a");
+        if (!file)
+        {
+            return false;
+        }
+    }
+
+    uint8_t buffer[sizeof(JournalEntry) + CONFIG_JOURNAL_MAX_PATCH + sizeof(uint32_t)];
+    JournalEntry entry = {(uint16_t)offset, (uint16_t)length};
+    memcpy(buffer, &entry, sizeof(entry));
+    memcpy(buffer + sizeof(entry), (const uint8_t *)&record + offset, length);
+    uint32_t crc = crc32(buffer, sizeof(entry) + length);
+    memcpy(buffer + sizeof(entry) + length, &crc, sizeof(crc));
+
+    size_t size = sizeof(entry) + length + sizeof(crc);
+    size_t written = file.write(buffer, size);
+    file.close();
+
+    if (written != size)
+    {
+        // A torn entry ends the replay; fold everything into a full record.
+        _journalLength = CONFIG_JOURNAL_LIMIT;
+        return false;
+    }
+    _journalLength += size;
+    return true;
+}
+
+void ConfigStore::replayJournal(ConfigRecord &record)
+{
+    _journalLength = 0;
+
+    File file = LittleFS.open(_journalPath, "r");
+    if (!file)
+    {
+        return;
+    }
+
+    JournalHeader header;
+    if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != CONFIG_JOURNAL_MAGIC ||
+        header.baseCrc != _baseCrc)
+    {
+        // Left over from before the last full write.
+        file.close();
+        LittleFS.remove(_journalPath);
+        return;
+    }
+
+    size_t fileSize = file.size();
+    size_t length = sizeof(header);
+    uint8_t count = 0;
+    uint8_t buffer[sizeof(JournalEntry) + CONFIG_JOURNAL_MAX_PATCH + sizeof(uint32_t)];
+    JournalEntry entry;
+    while (file.read((uint8_t *)&entry, sizeof(entry)) == sizeof(entry))
+    {
+        if (entry.length == 0 || entry.length > CONFIG_JOURNAL_MAX_PATCH || entry.offset < CONFIG_FIELDS_BEGIN ||
+            entry.offset + entry.length > CONFIG_FIELDS_END)
+        {
+            break;
+        }
+
+        uint32_t crc;
+        memcpy(buffer, &entry, sizeof(entry));
+        if (file.read(buffer + sizeof(entry), entry.length) != entry.length ||
+            file.read((uint8_t *)&crc, sizeof(crc)) != sizeof(crc) || crc != crc32(buffer, sizeof(entry) + entry.length))
+        {
+            break;
+        }
+
+        memcpy((uint8_t *)&record + entry.offset, buffer + sizeof(entry), entry.length);
+        length += sizeof(entry) + entry.length + sizeof(crc);
+        count++;
+    }
+    file.close();
+
+    seal(record);
+    // Garbage after the last good entry would hide later appends.
+    _journalLength = (length == fileSize) ? length : CONFIG_JOURNAL_LIMIT;
+    Serial.printf("[Config] Applied %d journal entries.\r\n", count);
+}
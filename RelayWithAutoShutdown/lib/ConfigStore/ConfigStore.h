@@ -0,0 +1,164 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+#define CONFIG_MAGIC 0x47464352 // "RCFG"
+#define CONFIG_VERSION 6
+#define CONFIG_V1_SIZE 196
+#define CONFIG_V2_SIZE 292
+#define CONFIG_V3_SIZE 300
+#define CONFIG_V4_SIZE 340
+#define CONFIG_V5_SIZE 348
+
+#define CONFIG_SSID_SIZE 33
+#define CONFIG_PASSWORD_SIZE 65
+#define CONFIG_NAME_SIZE 64
+#define CONFIG_TIME_ZONE_SIZE 40
+
+// Networks tried when the primary one is out of reach. The first one was
+// added in version 2, the others in version 6; see backupNetwork().
+#define CONFIG_BACKUP_NETWORKS 3
+
+#define CONFIG_JOURNAL_MAGIC 0x4C4E4A43 // "CJNL"
+#define CONFIG_JOURNAL_MAX_PATCH 48
+#define CONFIG_JOURNAL_LIMIT 512
+
+struct ConfigNetwork
+{
+    char ssid[CONFIG_SSID_SIZE];
+    char password[CONFIG_PASSWORD_SIZE];
+};
+
+/*
+ * Persisted configuration, stored as is. Bump CONFIG_VERSION whenever the
+ * layout changes. New fields go right before crc, so an older record is
+ * upgraded by filling them in from clear() (see ConfigStore::load()).
+ */
+struct ConfigRecord
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+
+    char ssid[CONFIG_SSID_SIZE];
+    char password[CONFIG_PASSWORD_SIZE];
+    char relayDisplayName[CONFIG_NAME_SIZE];
+
+    uint8_t enableTurnOnThreshold;
+    uint8_t enableShutdownThreshold;
+    float turnOnThreshold;
+    float shutdownThreshold;
+
+    uint8_t enableTurnOnTimeRange;
+    int8_t turnOnBeginHour;
+    int8_t turnOnBeginMinute;
+    int8_t turnOnEndHour;
+    int8_t turnOnEndMinute;
+
+    uint8_t enableShutdownTimeRange;
+    int8_t shutdownBeginHour;
+    int8_t shutdownBeginMinute;
+    int8_t shutdownEndHour;
+    int8_t shutdownEndMinute;
+
+    // Version 2
+    ConfigNetwork backupNetworks[1];
+
+    // Version 3
+    uint16_t minOnTime;    // Seconds the relay stays on before automation may switch it off.
+    uint16_t minOffTime;   // Seconds the relay stays off before automation may switch it on.
+    uint8_t ldrHysteresis; // Percent of an LDR threshold a held condition may drift past it.
+
+    // Version 4
+    char timeZone[CONFIG_TIME_ZONE_SIZE]; // POSIX TZ rule, such as "CST-8".
+
+    // Version 5
+    uint8_t enableLocation; // Sunrise and sunset times from the location below.
+    float latitude;         // Degrees, north positive.
+    float longitude;        // Degrees, east positive.
+
+    // Version 6
+    ConfigNetwork moreBackupNetworks[CONFIG_BACKUP_NETWORKS - 1];
+
+    uint32_t crc;
+};
+
+// The fields that are not WiFi credentials: from the display name to the
+// version 2 backup network, and versions 3 to 5. They may be kept outside
+// the flash, the credentials may not; see getSettings().
+#define CONFIG_SETTINGS_SIZE                                                               \
+    (offsetof(ConfigRecord, backupNetworks) - offsetof(ConfigRecord, relayDisplayName) + \
+     offsetof(ConfigRecord, moreBackupNetworks) - offsetof(ConfigRecord, minOnTime))
+
+/*
+ * Keeps a ConfigRecord in LittleFS, checked with magic, version, size and
+ * CRC32. The file is never removed or rewritten in place, so a power loss
+ * during save() leaves either the old or the new configuration.
+ *
+ * A full record is written to "<path>.tmp", read back, verified and renamed
+ * over <path>. A small change is instead appended to "<path>.jnl" as a patch
+ * of the bytes that differ. The journal starts with the CRC of the record it
+ * applies to and each patch has its own CRC, so load() ignores a stale
+ * journal and stops at a torn last entry. Once the journal would grow past
+ * CONFIG_JOURNAL_LIMIT bytes it is folded into a new full record.
+ *
+ * An older record is upgraded on load and written back as the current
+ * version.
+ *
+ * loadCredentials() reads only the WiFi credentials, for a record whose
+ * other fields are known from elsewhere (the RTC warm-boot snapshot). It
+ * checks nothing; the caller seals the record and compares the CRC with
+ * one it trusts.
+ */
+class ConfigStore
+{
+public:
+    ConfigStore(const char *path);
+
+    bool load(ConfigRecord &record);
+    bool loadCredentials(ConfigRecord &record);
+    bool save(ConfigRecord &record);
+    bool exists(void);
+    bool remove(void);
+
+    static void clear(ConfigRecord &record);
+    static void seal(ConfigRecord &record);
+    static bool isValid(const ConfigRecord &record);
+    static void setString(char *field, size_t size, const String &value);
+    static void getSettings(const ConfigRecord &record, uint8_t *settings);
+    static void setSettings(ConfigRecord &record, const uint8_t *settings);
+    static ConfigNetwork &backupNetwork(ConfigRecord &record, uint8_t index);
+    static const ConfigNetwork &backupNetwork(const ConfigRecord &record, uint8_t index);
+
+private:
+    struct JournalHeader
+    {
+        uint32_t magic;
+        uint32_t baseCrc;
+    };
+
+    struct JournalEntry
+    {
+        uint16_t offset;
+        uint16_t length;
+    };
+
+    bool checkRecord(ConfigRecord &record, size_t length, bool &upgraded);
+    bool writeRecord(const ConfigRecord &record);
+    bool appendPatch(size_t offset, size_t length, const ConfigRecord &record);
+    void replayJournal(ConfigRecord &record);
+
+    const char *_path;
+    String _tempPath;
+    String _journalPath;
+
+    // Last record loaded or saved, what the files on flash add up to.
+    ConfigRecord _current;
+    bool _hasCurrent;
+    uint32_t _baseCrc;
+    size_t _journalLength;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "EventStream.h"
+#include <BufferedPrint.h>
+
+#ifdef ASYNC_WEBSERVER
+
+EventStream::EventStream(const char *uri) : _onConnect(NULL), _source(uri)
+{
+}
+
+void EventStream::begin(HttpServer &server, EventStreamConnect onConnect)
+{
+    _onConnect = onConnect;
+    _source.onConnect([this](AsyncEventSourceClient *client) {
+        (void)client;
+        if (_onConnect != NULL)
+        {
+            _onConnect();
+        }
+    });
+    server.server().addHandler(&_source);
+}
+
+bool EventStream::hasSubscribers(void)
+{
+    return _source.count() > 0;
+}
+
+void EventStream::publish(const char *event, JsonDocument &doc)
+{
+    String data;
+    serializeJson(doc, data);
+    _source.send(data.c_str(), event);
+}
+
+void EventStream::loop(void)
+{
+    // AsyncEventSource queues and drops on its own.
+}
+
+#else
+
+static const char EVENT_STREAM_HEADER[] PROGMEM =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "retry: 5000\n\n";
+
+EventStream::EventStream(const char *uri) : _onConnect(NULL), _uri(uri), _server(NULL), _lastKeepAliveMillis(0)
+{
+}
+
+void EventStream::begin(HttpServer &server, EventStreamConnect onConnect)
+{
+    _server = &server;
+    _onConnect = onConnect;
+    server.on(_uri, [this]() { onRequest(); });
+}
+
+void EventStream::onRequest(void)
+{
+    if (_server->method() != HTTP_GET)
+    {
+        _server->send(405, "application/json", "{\"error\":\"Method not allowed\"}");
+        return;
+    }
+
+    if (!subscribe(_server->client()))
+    {
+        _server->send(503, "application/json", "{\"error\":\"Too many event clients\"}");
+        return;
+    }
+
+    if (_onConnect != NULL)
+    {
+        _onConnect();
+    }
+}
+
+bool EventStream::subscribe(WiFiClient client)
+{
+    for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++)
+    {
+        if (_clients[i].connected())
+        {
+            continue;
+        }
+
+        client.setNoDelay(true);
+        client.write_P(EVENT_STREAM_HEADER, strlen_P(EVENT_STREAM_HEADER));
+        _clients[i] = client;
+        return true;
+    }
+    return false;
+}
+
+bool EventStream::hasSubscribers(void)
+{
+    for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++)
+    {
+        if (_clients[i].connected())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void EventStream::publish(const char *event, JsonDocument &doc)
+{
+    for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++)
+    {
+        if (_clients[i].connected() && !send(_clients[i], event, doc))
+        {
+            // A client that cannot keep up is dropped, it will reconnect.
+            _clients[i].stop();
+        }
+    }
+}
+
+void EventStream::loop(void)
+{
+    unsigned long currentMillis = millis();
+    if ((currentMillis - _lastKeepAliveMillis) < EVENT_STREAM_KEEPALIVE_INTERVAL)
+    {
+        return;
+    }
+    _lastKeepAliveMillis = currentMillis;
+
+    for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++)
+    {
+        if (_clients[i].connected() && _clients[i].write(":\n\n", 3) != 3)
+        {
+            _clients[i].stop();
+        }
+    }
+}
+
+bool EventStream::send(WiFiClient &client, const char *event, JsonDocument &doc)
+{
+    size_t length = strlen(event) + measureJson(doc) + 16;
+    if (client.availableForWrite() < length)
+    {
+        return false;
+    }
+
+    BufferedPrint output(client);
+    output.print("event: ");
+    output.print(event);
+    output.print("\ndata: ");
+    serializeJson(doc, output);
+    output.print("\n\n");
+    return true;
+}
+
+#endif
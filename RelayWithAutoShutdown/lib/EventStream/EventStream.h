@@ -0,0 +1,51 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <ArduinoJson.h>
+#include <HttpServer.h>
+
+#define EVENT_STREAM_MAX_CLIENTS 4
+#define EVENT_STREAM_KEEPALIVE_INTERVAL 15000L
+
+/*
+ * Called after a client subscribed to the event stream.
+ */
+typedef void (*EventStreamConnect)(void);
+
+/*
+ * Server-Sent Events hub. Subscribed clients keep their connection open and
+ * receive every published event as "event: <name>" with a JSON data line.
+ *
+ * With ASYNC_WEBSERVER the connections are held by ESPAsyncWebServer's
+ * AsyncEventSource, otherwise by the fixed client table below.
+ */
+class EventStream
+{
+public:
+    EventStream(const char *uri);
+
+    void begin(HttpServer &server, EventStreamConnect onConnect);
+    bool hasSubscribers(void);
+    void publish(const char *event, JsonDocument &doc);
+    void loop(void);
+
+private:
+    EventStreamConnect _onConnect;
+
+#ifdef ASYNC_WEBSERVER
+    AsyncEventSource _source;
+#else
+    void onRequest(void);
+    bool subscribe(WiFiClient client);
+    bool send(WiFiClient &client, const char *event, JsonDocument &doc);
+
+    const char *_uri;
+    HttpServer *_server;
+    WiFiClient _clients[EVENT_STREAM_MAX_CLIENTS];
+    unsigned long _lastKeepAliveMillis;
+#endif
+};
+
+#endif
@@ -0,0 +1,330 @@
+#include "HttpServer.h"
+
+#ifdef ASYNC_WEBSERVER
+
+AsyncWebServerAdapter::AsyncWebServerAdapter(uint16_t port)
+    : _server(port), _handlerCount(0), _notFoundHandler(NULL), _pendingCount(0),
+      _request(NULL), _stream(NULL), _responded(false), _contentLength(CONTENT_LENGTH_NOT_SET), _headerCount(0)
+{
+}
+
+void AsyncWebServerAdapter::begin(void)
+{
+    _server.begin();
+}
+
+void AsyncWebServerAdapter::begin(uint16_t port)
+{
+    // The port is fixed when the AsyncWebServer is constructed.
+    (void)port;
+    begin();
+}
+
+void AsyncWebServerAdapter::stop(void)
+{
+    _server.end();
+    _server.reset();
+    _handlerCount = 0;
+    _notFoundHandler = NULL;
+    _pendingCount = 0;
+}
+
+void AsyncWebServerAdapter::close(void)
+{
+    stop();
+}
+
+void AsyncWebServerAdapter::handleClient(void)
+{
+    // Requests queued while a handler runs are served on the next call.
+    uint8_t count = _pendingCount;
+    for (uint8_t i = 0; i < count && _pendingCount > 0; i++)
+    {
+        PendingRequest pending = _pending[0];
+        remove(pending.request);
+        dispatch(pending.request, pending.route);
+    }
+}
+
+void AsyncWebServerAdapter::on(const char *uri, THandlerFunction handler)
+{
+    if (_handlerCount >= ASYNC_WEBSERVER_MAX_ROUTES)
+    {
+        Serial.printf("[WebServer] Too many routes, %s ignored.\r\n", uri);
+        return;
+    }
+
+    uint8_t route = _handlerCount++;
+    _handlers[route] = handler;
+    _server.on(
+        uri, HTTP_ANY,
+        [this, route](AsyncWebServerRequest *request) { enqueue(request, route); },
+        NULL, onBody);
+}
+
+void AsyncWebServerAdapter::onNotFound(THandlerFunction handler)
+{
+    _notFoundHandler = handler;
+    _server.onNotFound([this](AsyncWebServerRequest *request) { enqueue(request, ASYNC_WEBSERVER_NOT_FOUND); });
+    _server.onRequestBody(onBody);
+}
+
+void AsyncWebServerAdapter::collectHeaders(const char *headerKeys[], size_t count)
+{
+    // ESPAsyncWebServer keeps every request header.
+    (void)headerKeys;
+    (void)count;
+}
+
+WebRequestMethodComposite AsyncWebServerAdapter::method(void)
+{
+    return _request->method();
+}
+
+String AsyncWebServerAdapter::uri(void)
+{
+    return _request->url();
+}
+
+String AsyncWebServerAdapter::arg(const String &name)
+{
+    if (name == "plain")
+    {
+        return _request->_tempObject ? String((const char *)_request->_tempObject) : String();
+    }
+    return _request->arg(name);
+}
+
+bool AsyncWebServerAdapter::hasArg(const String &name)
+{
+    if (name == "plain")
+    {
+        return _request->_tempObject != NULL;
+    }
+    return _request->hasArg(name.c_str());
+}
+
+String AsyncWebServerAdapter::header(const String &name)
+{
+    AsyncWebHeader *header = _request->getHeader(name);
+    return header ? header->value() : String();
+}
+
+bool AsyncWebServerAdapter::hasHeader(const String &name)
+{
+    return _request->hasHeader(name);
+}
+
+void AsyncWebServerAdapter::sendHeader(const String &name, const String &value, bool first)
+{
+    (void)first;
+    if (_headerCount >= ASYNC_WEBSERVER_MAX_HEADERS)
+    {
+        return;
+    }
+    _headerNames[_headerCount] = name;
+    _headerValues[_headerCount] = value;
+    _headerCount++;
+}
+
+void AsyncWebServerAdapter::setContentLength(size_t length)
+{
+    _contentLength = length;
+}
+
+void AsyncWebServerAdapter::send(int code)
+{
+    if (_request == NULL)
+    {
+        return;
+    }
+    respond(_request->beginResponse(code));
+}
+
+void AsyncWebServerAdapter::send(int code, const char *contentType, const String &content)
+{
+    if (_request == NULL)
+    {
+        return;
+    }
+
+    if (_contentLength == CONTENT_LENGTH_NOT_SET || content.length() > 0)
+    {
+        respond(_request->beginResponse(code, contentType, content));
+        return;
+    }
+
+    // The body follows with sendContent(), collect it in a stream response.
+    _stream = _request->beginResponseStream(contentType);
+    _stream->setCode(code);
+    for (uint8_t i = 0; i < _headerCount; i++)
+    {
+        _stream->addHeader(_headerNames[i], _headerValues[i]);
+    }
+    _headerCount = 0;
+}
+
+void AsyncWebServerAdapter::send_P(int code, PGM_P contentType, PGM_P content, size_t length)
+{
+    if (_request == NULL)
+    {
+        return;
+    }
+    respond(_request->beginResponse_P(code, String(FPSTR(contentType)), (const uint8_t *)content, length));
+}
+
+void AsyncWebServerAdapter::sendContent(const String &content)
+{
+    sendContent(content.c_str(), content.length());
+}
+
+void AsyncWebServerAdapter::sendContent(const char *content, size_t length)
+{
+    if (_stream != NULL && length > 0)
+    {
+        _stream->write((const uint8_t *)content, length);
+    }
+}
+
+void AsyncWebServerAdapter::sendContent_P(PGM_P content, size_t length)
+{
+    if (_stream == NULL)
+    {
+        return;
+    }
+
+    char buffer[64];
+    while (length > 0)
+    {
+        size_t size = (length < sizeof(buffer)) ? length : sizeof(buffer);
+        memcpy_P(buffer, content, size);
+        _stream->write((const uint8_t *)buffer, size);
+        content += size;
+        length -= size;
+    }
+}
+
+void AsyncWebServerAdapter::sendChunked(int code, const char *contentType, AwsResponseFiller filler)
+{
+    if (_request == NULL)
+    {
+        return;
+    }
+
+    // The filler runs from the TCP stack until it returns 0, long after the
+    // handler returned, so it must only use state it owns.
+    AsyncWebServerResponse *response = _request->beginChunkedResponse(contentType, filler);
+    response->setCode(code);
+    respond(response);
+}
+
+void AsyncWebServerAdapter::enqueue(AsyncWebServerRequest *request, uint8_t route)
+{
+    if (_pendingCount >= ASYNC_WEBSERVER_MAX_PENDING)
+    {
+        request->send(503, "text/plain", "Server busy");
+        return;
+    }
+
+    _pending[_pendingCount].request = request;
+    _pending[_pendingCount].route = route;
+    _pendingCount++;
+
+    // The request object is freed when its client goes away, forget it then.
+    // This can also happen while its handler runs, if the handler yields.
+    request->onDisconnect([this, request]() {
+        remove(request);
+        if (_request == request)
+        {
+            _request = NULL;
+        }
+    });
+}
+
+void AsyncWebServerAdapter::remove(AsyncWebServerRequest *request)
+{
+    for (uint8_t i = 0; i < _pendingCount; i++)
+    {
+        if (_pending[i].request != request)
+        {
+            continue;
+        }
+
+        for (uint8_t j = i + 1; j < _pendingCount; j++)
+        {
+            _pending[j - 1] = _pending[j];
+        }
+        _pendingCount--;
+        return;
+    }
+}
+
+void AsyncWebServerAdapter::dispatch(AsyncWebServerRequest *request, uint8_t route)
+{
+    _request = request;
+    _stream = NULL;
+    _responded = false;
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    _headerCount = 0;
+
+    THandlerFunction &handler = (route == ASYNC_WEBSERVER_NOT_FOUND) ? _notFoundHandler : _handlers[route];
+    if (handler)
+    {
+        handler();
+    }
+
+    if (_request == NULL)
+    {
+        delete _stream;
+    }
+    else if (_stream != NULL)
+    {
+        _request->send(_stream);
+    }
+    else if (!_responded)
+    {
+        _request->send(500, "text/plain", "No response");
+    }
+
+    _request = NULL;
+    _stream = NULL;
+}
+
+void AsyncWebServerAdapter::respond(AsyncWebServerResponse *response)
+{
+    for (uint8_t i = 0; i < _headerCount; i++)
+    {
+        response->addHeader(_headerNames[i], _headerValues[i]);
+    }
+    _headerCount = 0;
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+
+    _request->send(response);
+    _responded = true;
+}
+
+void AsyncWebServerAdapter::onBody(AsyncWebServerRequest *request, uint8_t *data, size_t length, size_t index, size_t total)
+{
+    // Keep a raw body (JSON) for arg("plain"), like ESP8266WebServer does.
+    if (total > ASYNC_WEBSERVER_MAX_BODY)
+    {
+        return;
+    }
+
+    if (index == 0)
+    {
+        request->_tempObject = malloc(total + 1);
+    }
+
+    if (request->_tempObject != NULL)
+    {
+        char *body = (char *)request->_tempObject;
+        memcpy(body + index, data, length);
+        if (index + length == total)
+        {
+            body[total] = '\0';
+        }
+    }
+}
+
+#endif
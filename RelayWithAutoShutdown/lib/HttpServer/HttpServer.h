@@ -0,0 +1,147 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <Arduino.h>
+
+/*
+ * Web server used by the firmware, selected at build time.
+ *
+ * By default this is the polling ESP8266WebServer. With ASYNC_WEBSERVER
+ * defined it is AsyncWebServerAdapter, which offers the same calls the route
+ * handlers use on top of ESPAsyncWebServer, so the handlers build unchanged.
+ */
+#ifdef ASYNC_WEBSERVER
+
+#include <ESPAsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+#include <functional>
+
+#ifndef CONTENT_LENGTH_UNKNOWN
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#endif
+#ifndef CONTENT_LENGTH_NOT_SET
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+#endif
+
+#define ASYNC_WEBSERVER_MAX_ROUTES 16
+#define ASYNC_WEBSERVER_MAX_PENDING 8
+#define ASYNC_WEBSERVER_MAX_HEADERS 4
+#define ASYNC_WEBSERVER_MAX_BODY 1024
+#define ASYNC_WEBSERVER_NOT_FOUND 0xFF
+
+/*
+ * ESP8266WebServer-style front end for ESPAsyncWebServer.
+ *
+ * Connections are accepted, read and written by the async TCP stack, so a
+ * slow or stalled client no longer holds up the others. Complete requests are
+ * queued and handleClient() runs their handlers from loop(), which keeps
+ * delay(), LittleFS and WiFi calls in the handlers safe. Responses are sent
+ * asynchronously once the handler returns: a sendChunked() body is pulled
+ * from its filler as the TCP window allows, a body given to sendContent() is
+ * collected in memory first.
+ */
+class AsyncWebServerAdapter
+{
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    AsyncWebServerAdapter(uint16_t port = 80);
+
+    void begin(void);
+    void begin(uint16_t port);
+    void stop(void);
+    void close(void);
+    void handleClient(void);
+
+    void on(const char *uri, THandlerFunction handler);
+    void onNotFound(THandlerFunction handler);
+    void collectHeaders(const char *headerKeys[], size_t count);
+
+    WebRequestMethodComposite method(void);
+    String uri(void);
+    String arg(const String &name);
+    bool hasArg(const String &name);
+    String header(const String &name);
+    bool hasHeader(const String &name);
+
+    void sendHeader(const String &name, const String &value, bool first = false);
+    void setContentLength(size_t length);
+    void send(int code);
+    void send(int code, const char *contentType, const String &content);
+    void send_P(int code, PGM_P contentType, PGM_P content, size_t length);
+    void sendContent(const String &content);
+    void sendContent(const char *content, size_t length);
+    void sendContent_P(PGM_P content, size_t length);
+    void sendChunked(int code, const char *contentType, AwsResponseFiller filler);
+
+    AsyncWebServer &server(void) { return _server; }
+
+private:
+    struct PendingRequest
+    {
+        AsyncWebServerRequest *request;
+        uint8_t route;
+    };
+
+    void enqueue(AsyncWebServerRequest *request, uint8_t route);
+    void remove(AsyncWebServerRequest *request);
+    void dispatch(AsyncWebServerRequest *request, uint8_t route);
+    void respond(AsyncWebServerResponse *response);
+
+    static void onBody(AsyncWebServerRequest *request, uint8_t *data, size_t length, size_t index, size_t total);
+
+    AsyncWebServer _server;
+    THandlerFunction _handlers[ASYNC_WEBSERVER_MAX_ROUTES];
+    uint8_t _handlerCount;
+    THandlerFunction _notFoundHandler;
+
+    PendingRequest _pending[ASYNC_WEBSERVER_MAX_PENDING];
+    uint8_t _pendingCount;
+
+    // State of the request whose handler is running.
+    AsyncWebServerRequest *_request;
+    AsyncResponseStream *_stream;
+    bool _responded;
+    size_t _contentLength;
+    String _headerNames[ASYNC_WEBSERVER_MAX_HEADERS];
+    String _headerValues[ASYNC_WEBSERVER_MAX_HEADERS];
+    uint8_t _headerCount;
+};
+
+typedef AsyncWebServerAdapter HttpServer;
+
+#else
+
+#include <ESP8266WebServer.h>
+
+typedef ESP8266WebServer HttpServer;
+
+#endif
+
+/*
+ * Print target for a response body whose headers were already sent with
+ * setContentLength() and send(code, type, ""). Works with both servers.
+ */
+class HttpContentPrint : public Print
+{
+public:
+    HttpContentPrint(HttpServer &server) : _server(server) {}
+
+    size_t write(uint8_t c) override
+    {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        _server.sendContent((const char *)buffer, size);
+        return size;
+    }
+
+    using Print::write;
+
+private:
+    HttpServer &_server;
+};
+
+#endif
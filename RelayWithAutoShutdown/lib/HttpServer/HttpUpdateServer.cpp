@@ -0,0 +1,68 @@
+#include "HttpUpdateServer.h"
+
+#ifdef ASYNC_WEBSERVER
+
+#include <Updater.h>
+
+static const char UPDATE_PAGE[] PROGMEM =
+    "<html><body><form method='POST' action='' enctype='multipart/form-data'>"
+    "<input type='file' accept='.bin,.bin.gz' name='firmware'>"
+    "<input type='submit' value='Update Firmware'>"
+    "</form></body></html>";
+
+void AsyncHTTPUpdateServer::setup(AsyncWebServerAdapter *server, const char *path)
+{
+    // Registered on the async server directly: the upload is written to
+    // flash as it arrives instead of being queued for loop().
+    server->server().on(path, HTTP_GET, [](AsyncWebServerRequest *request) {
+        request->send_P(200, "text/html", UPDATE_PAGE);
+    });
+    server->server().on(path, HTTP_POST, onUploadDone, onUpload);
+}
+
+void AsyncHTTPUpdateServer::onUpload(AsyncWebServerRequest *request, const String &fileName, size_t index, uint8_t *data, size_t length, bool final)
+{
+    if (index == 0)
+    {
+        Serial.printf("[Update] Firmware: %s\r\n", fileName.c_str());
+        Update.runAsync(true);
+        uint32_t maxSketchSpace = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
+        if (!Update.begin(maxSketchSpace))
+        {
+            Update.printError(Serial);
+        }
+    }
+
+    if (!Update.hasError() && Update.write(data, length) != length)
+    {
+        Update.printError(Serial);
+    }
+
+    if (final)
+    {
+        if (Update.end(true))
+        {
+            Serial.printf("[Update] Success: %u bytes\r\n", (unsigned int)(index + length));
+        }
+        else
+        {
+            Update.printError(Serial);
+        }
+    }
+}
+
+void AsyncHTTPUpdateServer::onUploadDone(AsyncWebServerRequest *request)
+{
+    if (Update.hasError() || !Update.isFinished())
+    {
+        request->send(500, "text/plain", "Update failed");
+        return;
+    }
+
+    AsyncWebServerResponse *response = request->beginResponse(200, "text/html", "Update Success! Rebooting...");
+    response->addHeader("Connection", "close");
+    request->onDisconnect([]() { ESP.restart(); });
+    request->send(response);
+}
+
+#endif
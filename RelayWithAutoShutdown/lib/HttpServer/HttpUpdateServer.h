@@ -0,0 +1,33 @@
+#ifndef HTTP_UPDATE_SERVER_H
+#define HTTP_UPDATE_SERVER_H
+
+#include <HttpServer.h>
+
+/*
+ * Firmware upload page for HttpServer: ESP8266HTTPUpdateServer by default,
+ * AsyncHTTPUpdateServer with ASYNC_WEBSERVER. Both serve an upload form on
+ * GET and flash the posted image on POST, then reboot.
+ */
+#ifdef ASYNC_WEBSERVER
+
+class AsyncHTTPUpdateServer
+{
+public:
+    void setup(AsyncWebServerAdapter *server, const char *path = "/update");
+
+private:
+    static void onUpload(AsyncWebServerRequest *request, const String &fileName, size_t index, uint8_t *data, size_t length, bool final);
+    static void onUploadDone(AsyncWebServerRequest *request);
+};
+
+typedef AsyncHTTPUpdateServer HttpUpdateServer;
+
+#else
+
+#include <ESP8266HTTPUpdateServer.h>
+
+typedef ESP8266HTTPUpdateServer HttpUpdateServer;
+
+#endif
+
+#endif
@@ -0,0 +1,96 @@
+#include "NtpClock.h"
+
+// Seconds from 1900, the NTP era, to 1970. The unsigned difference stays
+// right across the NTP era rollover in 2036.
+#define NTP_UNIX_OFFSET 2208988800UL
+
+#define NTP_MODE_CLIENT 3
+#define NTP_MODE_SERVER 4
+#define NTP_VERSION 4
+
+NtpClock::NtpClock(WiFiUDP &udp, const char *server)
+    : _udp(udp), _server(server), _waiting(false), _timeSet(false), _requestMillis(0), _epoch(0), _epochMillis(0)
+{
+}
+
+void NtpClock::begin(void)
+{
+    _udp.begin(NTP_CLOCK_LOCAL_PORT);
+}
+
+bool NtpClock::request(void)
+{
+    // An answer to an earlier, abandoned request must not be taken for this one.
+    while (_udp.parsePacket() > 0)
+    {
+        _udp.flush();
+    }
+
+    uint8_t packet[NTP_CLOCK_PACKET_SIZE];
+    memset(packet, 0, sizeof(packet));
+    packet[0] = (NTP_VERSION << 3) | NTP_MODE_CLIENT;
+
+    _waiting = false;
+    if (!_udp.beginPacket(_server, NTP_CLOCK_SERVER_PORT))
+    {
+        return false;
+    }
+    _udp.write(packet, sizeof(packet));
+    if (!_udp.endPacket())
+    {
+        return false;
+    }
+
+    _waiting = true;
+    _requestMillis = millis();
+    return true;
+}
+
+NtpClockResult NtpClock::poll(void)
+{
+    if (!_waiting)
+    {
+        return NTP_CLOCK_IDLE;
+    }
+
+    int size = _udp.parsePacket();
+    if (size >= NTP_CLOCK_PACKET_SIZE)
+    {
+        uint8_t packet[NTP_CLOCK_PACKET_SIZE];
+        _udp.read(packet, sizeof(packet));
+        _udp.flush();
+
+        // A server's answer; stratum 0 is a refusal (kiss-o'-death).
+        uint32_t seconds = ((uint32_t)packet[40] << 24) | ((uint32_t)packet[41] << 16) | ((uint32_t)packet[42] << 8) | packet[43];
+        if ((packet[0] & 0x07) == NTP_MODE_SERVER && packet[1] != 0 && seconds != 0)
+        {
+            _epoch = seconds - NTP_UNIX_OFFSET;
+            _epochMillis = millis();
+            _timeSet = true;
+            _waiting = false;
+            return NTP_CLOCK_UPDATED;
+        }
+    }
+    else if (size > 0)
+    {
+        _udp.flush();
+    }
+
+    if (millis() - _requestMillis >= (unsigned long)NTP_CLOCK_TIMEOUT)
+    {
+        _waiting = false;
+        return NTP_CLOCK_TIMED_OUT;
+    }
+    return NTP_CLOCK_WAITING;
+}
+
+unsigned long NtpClock::getEpochTime(void) const
+{
+    return _epoch + (millis() - _epochMillis) / 1000;
+}
+
+void NtpClock::setEpochTime(unsigned long epoch)
+{
+    _epoch = epoch;
+    _epochMillis = millis();
+}
@@ -0,0 +1,55 @@
+#ifndef NTP_CLOCK_H
+#define NTP_CLOCK_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+#define NTP_CLOCK_SERVER_PORT 123
+#define NTP_CLOCK_LOCAL_PORT 1337
+#define NTP_CLOCK_PACKET_SIZE 48
+// A request without a valid answer after this long is given up.
+#define NTP_CLOCK_TIMEOUT 1000L
+
+enum NtpClockResult
+{
+    NTP_CLOCK_IDLE,     // No request outstanding.
+    NTP_CLOCK_WAITING,  // Sent, no answer yet.
+    NTP_CLOCK_UPDATED,  // The answer came in and set the clock.
+    NTP_CLOCK_TIMED_OUT // No valid answer within NTP_CLOCK_TIMEOUT.
+};
+
+/*
+ * UTC clock set over SNTP without blocking: request() sends the query and
+ * poll(), called from loop(), takes the answer once it has come in. Between
+ * answers the time runs on with millis(). The accessors are NTPClient's,
+ * whose forceUpdate() waits up to a second for every answer.
+ *
+ * Only the server name is resolved synchronously, by WiFiUDP::beginPacket();
+ * after the first request lwIP answers that from its DNS cache.
+ */
+class NtpClock
+{
+public:
+    NtpClock(WiFiUDP &udp, const char *server);
+
+    void begin(void);
+    bool request(void);
+    NtpClockResult poll(void);
+    bool waiting(void) const { return _waiting; }
+
+    // True once an answer has set the clock; setEpochTime() does not count.
+    bool isTimeSet(void) const { return _timeSet; }
+    unsigned long getEpochTime(void) const;
+    void setEpochTime(unsigned long epoch);
+
+private:
+    WiFiUDP &_udp;
+    const char *_server;
+    bool _waiting;
+    bool _timeSet;
+    unsigned long _requestMillis;
+    unsigned long _epoch;
+    unsigned long _epochMillis;
+};
+
+#endif
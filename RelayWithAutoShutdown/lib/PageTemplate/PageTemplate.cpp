@@ -0,0 +1,237 @@
+#include "PageTemplate.h"
+
+PageTemplate::PageTemplate(PGM_P source, const char *const *keys, uint8_t keyCount)
+    : _source(source), _keys(keys), _keyCount(keyCount), _segmentCount(0), _chunk(NULL), _chunkLength(0)
+{
+}
+
+bool PageTemplate::compile(void)
+{
+    size_t length = strlen_P(_source);
+    size_t begin = 0;
+    size_t index = 0;
+
+    _segmentCount = 0;
+    while (index < length)
+    {
+        char c = pgm_read_byte(_source + index);
+        uint8_t slot = PAGE_TEMPLATE_NO_SLOT;
+        size_t keyLength = 0;
+        for (uint8_t k = 0; k < _keyCount; k++)
+        {
+            if (_keys[k][0] != c)
+            {
+                continue;
+            }
+
+            keyLength = strlen(_keys[k]);
+            if (strncmp_P(_keys[k], _source + index, keyLength) == 0)
+            {
+                slot = k;
+                break;
+            }
+        }
+
+        if (slot == PAGE_TEMPLATE_NO_SLOT)
+        {
+            index++;
+            continue;
+        }
+
+        if ((index > begin && !addSegment(begin, index - begin, PAGE_TEMPLATE_NO_SLOT)) || !addSegment(index, keyLength, slot))
+        {
+            _segmentCount = 0;
+            return false;
+        }
+
+        index += keyLength;
+        begin = index;
+    }
+
+    if (length > begin && !addSegment(begin, length - begin, PAGE_TEMPLATE_NO_SLOT))
+    {
+        _segmentCount = 0;
+        return false;
+    }
+
+    return true;
+}
+
+#ifdef ASYNC_WEBSERVER
+
+void PageTemplate::send(HttpServer &server, int code, const char *contentType, PageTemplateValue value)
+{
+    // The values come from the firmware state, so read them here in loop()
+    // rather than from the TCP callbacks that fill the response.
+    std::shared_ptr<Cursor> cursor(new Cursor());
+    cursor->values.reset(new String[_keyCount]);
+    cursor->segment = 0;
+    cursor->offset = 0;
+    for (uint8_t i = 0; i < _segmentCount; i++)
+    {
+        uint8_t slot = _segments[i].slot;
+        if (slot != PAGE_TEMPLATE_NO_SLOT && cursor->values[slot].length() == 0)
+        {
+            cursor->values[slot] = value(slot);
+        }
+    }
+
+    server.sendChunked(code, contentType, [this, cursor](uint8_t *buffer, size_t maxLength, size_t index) -> size_t {
+        (void)index;
+        return fill(*cursor, buffer, maxLength);
+    });
+}
+
+size_t PageTemplate::fill(Cursor &cursor, uint8_t *buffer, size_t maxLength) const
+{
+    // Not compiled (or too many placeholders), the page is one plain segment.
+    uint8_t count = (_segmentCount == 0) ? 1 : _segmentCount;
+    size_t length = 0;
+
+    while (length < maxLength && cursor.segment < count)
+    {
+        size_t offset = 0;
+        size_t size = 0;
+        uint8_t slot = PAGE_TEMPLATE_NO_SLOT;
+        if (_segmentCount == 0)
+        {
+            size = strlen_P(_source);
+        }
+        else
+        {
+            offset = _segments[cursor.segment].offset;
+            size = _segments[cursor.segment].length;
+            slot = _segments[cursor.segment].slot;
+        }
+        if (slot != PAGE_TEMPLATE_NO_SLOT)
+        {
+            size = cursor.values[slot].length();
+        }
+
+        size_t part = size - cursor.offset;
+        if (part > maxLength - length)
+        {
+            part = maxLength - length;
+        }
+
+        if (slot == PAGE_TEMPLATE_NO_SLOT)
+        {
+            memcpy_P(buffer + length, _source + offset + cursor.offset, part);
+        }
+        else
+        {
+            memcpy(buffer + length, cursor.values[slot].c_str() + cursor.offset, part);
+        }
+        length += part;
+        cursor.offset += part;
+
+        if (cursor.offset == size)
+        {
+            cursor.segment++;
+            cursor.offset = 0;
+        }
+    }
+
+    // 0 ends the chunked response.
+    return length;
+}
+
+#else
+
+void PageTemplate::send(HttpServer &server, int code, const char *contentType, PageTemplateValue value)
+{
+    char chunk[PAGE_TEMPLATE_CHUNK_SIZE];
+    _chunk = chunk;
+    _chunkLength = 0;
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(code, contentType, "");
+
+    if (_segmentCount == 0)
+    {
+        // Not compiled (or too many placeholders), send the page as it is.
+        write_P(server, _source, strlen_P(_source));
+    }
+
+    for (uint8_t i = 0; i < _segmentCount; i++)
+    {
+        const Segment &segment = _segments[i];
+        if (segment.slot == PAGE_TEMPLATE_NO_SLOT)
+        {
+            write_P(server, _source + segment.offset, segment.length);
+        }
+        else
+        {
+            String text = value(segment.slot);
+            write(server, text.c_str(), text.length());
+        }
+    }
+
+    flush(server);
+    server.sendContent("");
+
+    _chunk = NULL;
+}
+
+#endif
+
+bool PageTemplate::addSegment(size_t offset, size_t length, uint8_t slot)
+{
+    if (_segmentCount >= PAGE_TEMPLATE_MAX_SEGMENTS || offset > 0xFFFF || length > 0xFFFF)
+    {
+        return false;
+    }
+
+    _segments[_segmentCount].offset = offset;
+    _segments[_segmentCount].length = length;
+    _segments[_segmentCount].slot = slot;
+    _segmentCount++;
+    return true;
+}
+
+#ifndef ASYNC_WEBSERVER
+
+void PageTemplate::write(HttpServer &server, const char *data, size_t length)
+{
+    if (_chunkLength + length > PAGE_TEMPLATE_CHUNK_SIZE)
+    {
+        flush(server);
+    }
+
+    if (length > PAGE_TEMPLATE_CHUNK_SIZE)
+    {
+        server.sendContent(data, length);
+        return;
+    }
+
+    memcpy(_chunk + _chunkLength, data, length);
+    _chunkLength += length;
+}
+
+void PageTemplate::write_P(HttpServer &server, PGM_P data, size_t length)
+{
+    if (_chunkLength + length > PAGE_TEMPLATE_CHUNK_SIZE)
+    {
+        flush(server);
+    }
+
+    if (length > PAGE_TEMPLATE_CHUNK_SIZE)
+    {
+        server.sendContent_P(data, length);
+        return;
+    }
+
+    memcpy_P(_chunk + _chunkLength, data, length);
+    _chunkLength += length;
+}
+
+void PageTemplate::flush(HttpServer &server)
+{
+    if (_chunkLength > 0)
+    {
+        server.sendContent(_chunk, _chunkLength);
+        _chunkLength = 0;
+    }
+}
+
+#endif
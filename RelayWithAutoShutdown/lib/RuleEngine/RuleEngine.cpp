@@ -0,0 +1,207 @@
+#include "RuleEngine.h"
+
+RuleEngine::RuleEngine(void) : _count(0)
+{
+    memset(_hysteresis, 0, sizeof(_hysteresis));
+    for (uint8_t i = 0; i < RULE_ANCHOR_COUNT; i++)
+    {
+        _anchors[i] = -1;
+    }
+    _anchors[RULE_ANCHOR_NONE] = 0;
+}
+
+void RuleEngine::clear(void)
+{
+    _count = 0;
+}
+
+void RuleEngine::setHysteresis(uint8_t sensor, float ratio)
+{
+    if (sensor < RULE_SENSOR_COUNT)
+    {
+        _hysteresis[sensor] = ratio;
+    }
+}
+
+void RuleEngine::setAnchor(uint8_t anchor, int16_t minute)
+{
+    if (anchor > RULE_ANCHOR_NONE && anchor < RULE_ANCHOR_COUNT)
+    {
+        _anchors[anchor] = minute;
+    }
+}
+
+bool RuleEngine::add(const Rule &rule)
+{
+    if (_count >= RULE_MAX_RULES || !isValid(rule))
+    {
+        return false;
+    }
+
+    _held[_count] = 0;
+    Rule &compiled = _rules[_count++];
+    compiled = rule;
+    for (uint8_t i = 0; i < compiled.conditionCount; i++)
+    {
+        // Sunset - 15 becomes today's minute of the day.
+        RuleCondition &condition = compiled.conditions[i];
+        if (!resolve(condition.low, condition.lowAnchor) || !resolve(condition.high, condition.highAnchor))
+        {
+            condition.op = RULE_OP_NEVER;
+            continue;
+        }
+
+        // A time range that starts where it ends spans the whole day.
+        if (condition.sensor == RULE_SENSOR_TIME && condition.op == RULE_OP_BETWEEN && condition.low == condition.high)
+        {
+            condition.low = 0;
+            condition.high = RULE_MINUTES_PER_DAY - 1;
+        }
+
+        // 22:00 to 06:00 is everything but 06:01 to 21:59.
+        if (condition.op == RULE_OP_BETWEEN && condition.low > condition.high)
+        {
+            float low = condition.high + 1;
+            condition.high = condition.low - 1;
+            condition.low = low;
+            condition.op = RULE_OP_OUTSIDE;
+        }
+    }
+    return true;
+}
+
+int8_t RuleEngine::evaluate(const RuleInputs &inputs)
+{
+    int8_t match = -1;
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        _held[i] = states(i, inputs);
+        if (_held[i] == (1 << _rules[i].conditionCount) - 1)
+        {
+            match = i;
+        }
+    }
+    return match;
+}
+
+bool RuleEngine::changed(const RuleInputs &inputs) const
+{
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if (states(i, inputs) != _held[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RuleEngine::isValid(const Rule &rule)
+{
+    if (rule.action > RULE_ACTION_RELAY_ON || rule.conditionCount == 0 || rule.conditionCount > RULE_MAX_CONDITIONS)
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < rule.conditionCount; i++)
+    {
+        const RuleCondition &condition = rule.conditions[i];
+        if (condition.sensor >= RULE_SENSOR_COUNT || condition.op > RULE_OP_BETWEEN ||
+            condition.lowAnchor >= RULE_ANCHOR_COUNT || condition.highAnchor >= RULE_ANCHOR_COUNT)
+        {
+            return false;
+        }
+
+        if (condition.sensor == RULE_SENSOR_TIME)
+        {
+            // Whole minutes of the day or from an anchor; only time ranges may wrap.
+            if ((condition.op != RULE_OP_LESS_EQUAL && !isValidTime(condition.low, condition.lowAnchor)) ||
+                (condition.op != RULE_OP_GREATER_EQUAL && !isValidTime(condition.high, condition.highAnchor)))
+            {
+                return false;
+            }
+        }
+        else if ((condition.op == RULE_OP_BETWEEN && condition.low > condition.high) ||
+                 condition.lowAnchor != RULE_ANCHOR_NONE || condition.highAnchor != RULE_ANCHOR_NONE)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RuleEngine::isValidTime(float minute, uint8_t anchor)
+{
+    if (minute != (int)minute || anchor >= RULE_ANCHOR_COUNT)
+    {
+        return false;
+    }
+    if (anchor == RULE_ANCHOR_NONE)
+    {
+        return minute >= 0 && minute < RULE_MINUTES_PER_DAY;
+    }
+    return minute >= -RULE_MAX_ANCHOR_OFFSET && minute <= RULE_MAX_ANCHOR_OFFSET;
+}
+
+uint8_t RuleEngine::states(uint8_t index, const RuleInputs &inputs) const
+{
+    // Every condition is looked at, each one keeps its own hysteresis.
+    const Rule &rule = _rules[index];
+    uint8_t states = 0;
+    for (uint8_t j = 0; j < rule.conditionCount; j++)
+    {
+        if (matches(rule.conditions[j], inputs, _held[index] & (1 << j)))
+        {
+            states |= 1 << j;
+        }
+    }
+    return states;
+}
+
+bool RuleEngine::matches(const RuleCondition &condition, const RuleInputs &inputs, bool held) const
+{
+    if (!inputs.valid[condition.sensor])
+    {
+        return false;
+    }
+
+    // A held condition lets go only once the value is clearly past the limit.
+    float ratio = held ? _hysteresis[condition.sensor] : 0.0f;
+    float low = condition.low - fabsf(condition.low) * ratio;
+    float high = condition.high + fabsf(condition.high) * ratio;
+
+    float value = inputs.values[condition.sensor];
+    switch (condition.op)
+    {
+    case RULE_OP_LESS_EQUAL:
+        return value <= high;
+    case RULE_OP_GREATER_EQUAL:
+        return value >= low;
+    case RULE_OP_BETWEEN:
+        return value >= low && value <= high;
+    case RULE_OP_NEVER:
+        return false;
+    default:
+        // Holding outside the range means staying away from it.
+        low = condition.low + fabsf(condition.low) * ratio;
+        high = condition.high - fabsf(condition.high) * ratio;
+        return value < low || value > high;
+    }
+}
+
+bool RuleEngine::resolve(float &limit, uint8_t anchor) const
+{
+    if (anchor == RULE_ANCHOR_NONE)
+    {
+        return true;
+    }
+    if (_anchors[anchor] < 0)
+    {
+        return false;
+    }
+
+    // An offset past midnight wraps around to the same day's clock.
+    int minute = (_anchors[anchor] + (int)limit) % RULE_MINUTES_PER_DAY;
+    limit = (minute < 0) ? minute + RULE_MINUTES_PER_DAY : minute;
+    return true;
+}
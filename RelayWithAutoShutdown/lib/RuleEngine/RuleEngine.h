@@ -0,0 +1,129 @@
+#ifndef RULE_ENGINE_H
+#define RULE_ENGINE_H
+
+#include <Arduino.h>
+
+#define RULE_MAX_CONDITIONS 3
+#define RULE_MAX_RULES 10
+
+#define RULE_MINUTES_PER_DAY 1440
+#define RULE_MAX_ANCHOR_OFFSET 720
+
+enum RuleSensor
+{
+    RULE_SENSOR_LDR,
+    RULE_SENSOR_TIME, // Local minute of the day, 0 to 1439.
+    RULE_SENSOR_COUNT
+};
+
+enum RuleOperator
+{
+    RULE_OP_LESS_EQUAL,    // value <= high
+    RULE_OP_GREATER_EQUAL, // value >= low
+    RULE_OP_BETWEEN,       // low <= value <= high; a time range may wrap past midnight
+    RULE_OP_OUTSIDE,       // value < low || value > high; only produced by compiling
+    RULE_OP_NEVER          // A limit's anchor has no time today; only produced by compiling
+};
+
+/*
+ * What a time limit is counted from. Anchored limits are an offset in
+ * minutes from the anchor's time of day, set with setAnchor().
+ */
+enum RuleAnchor
+{
+    RULE_ANCHOR_NONE, // The limit is a minute of the day.
+    RULE_ANCHOR_SUNRISE,
+    RULE_ANCHOR_SUNSET,
+    RULE_ANCHOR_DAWN,
+    RULE_ANCHOR_DUSK,
+    RULE_ANCHOR_COUNT
+};
+
+enum RuleAction
+{
+    RULE_ACTION_RELAY_OFF,
+    RULE_ACTION_RELAY_ON
+};
+
+struct RuleCondition
+{
+    uint8_t sensor;
+    uint8_t op;
+    uint8_t lowAnchor;  // RuleAnchor of low, time conditions only.
+    uint8_t highAnchor; // RuleAnchor of high.
+    float low;
+    float high;
+};
+
+/*
+ * The action is taken while all conditions hold. Stored as is by RuleStore.
+ */
+struct Rule
+{
+    uint8_t action;
+    uint8_t conditionCount;
+    uint8_t reserved[2];
+    RuleCondition conditions[RULE_MAX_CONDITIONS];
+};
+
+/*
+ * Current sensor values; a condition on an invalid value never holds.
+ */
+struct RuleInputs
+{
+    float values[RULE_SENSOR_COUNT];
+    bool valid[RULE_SENSOR_COUNT];
+};
+
+/*
+ * Flat table of compiled rules, evaluated in one pass.
+ *
+ * add() checks a rule and compiles it: a time range that wraps past
+ * midnight becomes the complementary RULE_OP_OUTSIDE range, so evaluating
+ * a condition is one or two float compares, and one with equal ends covers
+ * the whole day. Limits anchored to sunrise or sunset are resolved to a
+ * minute of the day at that point too, so compile again once the anchor
+ * times change, which is once a day. Later rules take precedence.
+ *
+ * With a hysteresis set for a sensor, a condition that held at the last
+ * evaluation keeps holding until the value is that fraction of the limit
+ * past it, so a value wavering around a threshold does not flip it.
+ */
+class RuleEngine
+{
+public:
+    RuleEngine(void);
+
+    void clear(void);
+    bool add(const Rule &rule);
+    void setHysteresis(uint8_t sensor, float ratio);
+
+    // Minute of the day of an anchor, -1 while it has none. Used by add().
+    void setAnchor(uint8_t anchor, int16_t minute);
+
+    uint8_t count(void) const { return _count; }
+    const Rule &rule(uint8_t index) const { return _rules[index]; }
+
+    // Index of the last rule whose conditions all hold, -1 if none.
+    int8_t evaluate(const RuleInputs &inputs);
+
+    // Whether evaluate() would see any condition flip, a cheap check for
+    // a value or the time crossing a rule boundary. Changes nothing.
+    bool changed(const RuleInputs &inputs) const;
+
+    static bool isValid(const Rule &rule);
+    static bool isValidTime(float minute, uint8_t anchor);
+
+private:
+    uint8_t states(uint8_t index, const RuleInputs &inputs) const;
+    bool matches(const RuleCondition &condition, const RuleInputs &inputs, bool held) const;
+    bool resolve(float &limit, uint8_t anchor) const;
+
+    Rule _rules[RULE_MAX_RULES];
+    uint8_t _held[RULE_MAX_RULES]; // One bit per condition.
+    uint8_t _count;
+    float _hysteresis[RULE_SENSOR_COUNT];
+    int16_t _anchors[RULE_ANCHOR_COUNT];
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include "RuleStore.h"
+#include <LittleFS.h>
+#include <Crc32.h>
+
+RuleStore::RuleStore(const char *path) : _path(path), _tempPath(String(path) + ".tmp")
+{
+}
+
+bool RuleStore::load(Rule *rules, uint8_t &count)
+{
+    count = 0;
+    File file = LittleFS.open(_path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    Header header;
+    size_t length = file.read((uint8_t *)&header, sizeof(header));
+    bool valid = length == sizeof(header) && header.magic == RULE_STORE_MAGIC && header.version == RULE_STORE_VERSION &&
+                 header.size == sizeof(Rule) && header.count <= RULE_STORE_MAX_RULES;
+    if (valid)
+    {
+        size_t size = header.count * sizeof(Rule);
+        length = file.read((uint8_t *)rules, size);
+        valid = length == size && crc32(rules, size) == header.crc;
+    }
+    file.close();
+
+    if (!valid)
+    {
+        Serial.printf("[Rules] %s is not a valid rule table.\r\n", _path);
+        return false;
+    }
+    count = header.count;
+    return true;
+}
+
+bool RuleStore::save(const Rule *rules, uint8_t count)
+{
+    if (count > RULE_STORE_MAX_RULES)
+    {
+        return false;
+    }
+
+    Header header;
+    header.magic = RULE_STORE_MAGIC;
+    header.version = RULE_STORE_VERSION;
+    header.size = sizeof(Rule);
+    header.count = count;
+    header.crc = crc32(rules, count * sizeof(Rule));
+
+    File file = LittleFS.open(_tempPath, "w");
+    if (!file)
+    {
+        return false;
+    }
+    size_t length = file.write((const uint8_t *)&header, sizeof(header));
+    length += file.write((const uint8_t *)rules, count * sizeof(Rule));
+    file.close();
+
+    if (length != sizeof(header) + count * sizeof(Rule))
+    {
+        LittleFS.remove(_tempPath);
+        return false;
+    }
+    return LittleFS.rename(_tempPath, _path);
+}
+
+bool RuleStore::remove(void)
+{
+    return LittleFS.remove(_path);
+}
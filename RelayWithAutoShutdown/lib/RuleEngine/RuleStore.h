@@ -0,0 +1,40 @@
+#ifndef RULE_STORE_H
+#define RULE_STORE_H
+
+#include <Arduino.h>
+#include "RuleEngine.h"
+
+#define RULE_STORE_MAGIC 0x454C5552 // "RULE"
+#define RULE_STORE_VERSION 1
+#define RULE_STORE_MAX_RULES 8
+
+/*
+ * Keeps the rules added over HTTP in one LittleFS file: a header with magic,
+ * version, rule size, count and the CRC32 of the rules, then the rules as
+ * is. Written to "<path>.tmp" and renamed, so a power loss keeps the old
+ * table.
+ */
+class RuleStore
+{
+public:
+    RuleStore(const char *path);
+
+    bool load(Rule *rules, uint8_t &count);
+    bool save(const Rule *rules, uint8_t count);
+    bool remove(void);
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint8_t size;
+        uint8_t count;
+        uint32_t crc;
+    };
+
+    const char *_path;
+    String _tempPath;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "ScheduleStore.h"
+#include <LittleFS.h>
+#include <Crc32.h>
+
+ScheduleStore::ScheduleStore(const char *path) : _path(path), _tempPath(String(path) + ".tmp")
+{
+}
+
+bool ScheduleStore::load(ScheduleEntry *entries, uint8_t &count, uint16_t *exceptions, uint8_t &exceptionCount)
+{
+    count = 0;
+    exceptionCount = 0;
+    File file = LittleFS.open(_path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    Header header;
+    size_t length = file.read((uint8_t *)&header, sizeof(header));
+    bool valid = length == sizeof(header) && header.magic == SCHEDULE_STORE_MAGIC &&
+                 header.version == SCHEDULE_STORE_VERSION && header.size == sizeof(ScheduleEntry) &&
+                 header.count <= SCHEDULE_MAX_ENTRIES && header.exceptionCount <= SCHEDULE_MAX_EXCEPTIONS;
+    if (valid)
+    {
+        size_t entriesSize = header.count * sizeof(ScheduleEntry);
+        size_t exceptionsSize = header.exceptionCount * sizeof(uint16_t);
+        length = file.read((uint8_t *)entries, entriesSize);
+        length += file.read((uint8_t *)exceptions, exceptionsSize);
+        valid = length == entriesSize + exceptionsSize &&
+                crc32(exceptions, exceptionsSize, crc32(entries, entriesSize)) == header.crc;
+    }
+    file.close();
+
+    if (!valid)
+    {
+        Serial.printf("[Schedule] %s is not a valid schedule.\r\n", _path);
+        return false;
+    }
+    count = header.count;
+    exceptionCount = header.exceptionCount;
+    return true;
+}
+
+bool ScheduleStore::save(const ScheduleEntry *entries, uint8_t count, const uint16_t *exceptions, uint8_t exceptionCount)
+{
+    if (count > SCHEDULE_MAX_ENTRIES || exceptionCount > SCHEDULE_MAX_EXCEPTIONS)
+    {
+        return false;
+    }
+
+    size_t entriesSize = count * sizeof(ScheduleEntry);
+    size_t exceptionsSize = exceptionCount * sizeof(uint16_t);
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SCHEDULE_STORE_MAGIC;
+    header.version = SCHEDULE_STORE_VERSION;
+    header.size = sizeof(ScheduleEntry);
+    header.count = count;
+    header.exceptionCount = exceptionCount;
+    header.crc = crc32(exceptions, exceptionsSize, crc32(entries, entriesSize));
+
+    File file = LittleFS.open(_tempPath, "w");
+    if (!file)
+    {
+        return false;
+    }
+    size_t length = file.write((const uint8_t *)&header, sizeof(header));
+    length += file.write((const uint8_t *)entries, entriesSize);
+    length += file.write((const uint8_t *)exceptions, exceptionsSize);
+    file.close();
+
+    if (length != sizeof(header) + entriesSize + exceptionsSize)
+    {
+        LittleFS.remove(_tempPath);
+        return false;
+    }
+    return LittleFS.rename(_tempPath, _path);
+}
+
+bool ScheduleStore::remove(void)
+{
+    return LittleFS.remove(_path);
+}
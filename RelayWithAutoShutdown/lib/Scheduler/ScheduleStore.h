@@ -0,0 +1,41 @@
+#ifndef SCHEDULE_STORE_H
+#define SCHEDULE_STORE_H
+
+#include <Arduino.h>
+#include "Scheduler.h"
+
+#define SCHEDULE_STORE_MAGIC 0x44484353 // "SCHD"
+#define SCHEDULE_STORE_VERSION 1
+
+/*
+ * Keeps the schedule in one LittleFS file: a header with magic, version,
+ * entry size, counts and the CRC32 of what follows, then the entries and
+ * the exception dates as is. Written to "<path>.tmp" and renamed, like the
+ * rule table.
+ */
+class ScheduleStore
+{
+public:
+    ScheduleStore(const char *path);
+
+    bool load(ScheduleEntry *entries, uint8_t &count, uint16_t *exceptions, uint8_t &exceptionCount);
+    bool save(const ScheduleEntry *entries, uint8_t count, const uint16_t *exceptions, uint8_t exceptionCount);
+    bool remove(void);
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint8_t size;
+        uint8_t count;
+        uint8_t exceptionCount;
+        uint8_t reserved[3];
+        uint32_t crc;
+    };
+
+    const char *_path;
+    String _tempPath;
+};
+
+#endif
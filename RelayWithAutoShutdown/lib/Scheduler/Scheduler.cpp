@@ -0,0 +1,171 @@
+#include "Scheduler.h"
+
+#define SECONDS_PER_DAY 86400UL
+
+Scheduler::Scheduler(void) : _anchorFunction(NULL)
+{
+    clear();
+}
+
+void Scheduler::clear(void)
+{
+    _count = 0;
+    _exceptionCount = 0;
+    _heapCount = 0;
+}
+
+bool Scheduler::add(const ScheduleEntry &entry)
+{
+    if (_count >= SCHEDULE_MAX_ENTRIES || !isValid(entry))
+    {
+        return false;
+    }
+    _entries[_count] = entry;
+    _fireTimes[_count] = SCHEDULE_NEVER;
+    _count++;
+    return true;
+}
+
+bool Scheduler::addException(uint16_t day)
+{
+    if (_exceptionCount >= SCHEDULE_MAX_EXCEPTIONS)
+    {
+        return false;
+    }
+    _exceptions[_exceptionCount++] = day;
+    return true;
+}
+
+void Scheduler::start(uint32_t now)
+{
+    _heapCount = 0;
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        _fireTimes[i] = nextFire(_entries[i], now);
+        if (_fireTimes[i] != SCHEDULE_NEVER)
+        {
+            _heap[_heapCount++] = i;
+        }
+    }
+
+    for (int8_t i = _heapCount / 2 - 1; i >= 0; i--)
+    {
+        siftDown(i);
+    }
+}
+
+int8_t Scheduler::poll(uint32_t now)
+{
+    if (_heapCount == 0 || _fireTimes[_heap[0]] > now)
+    {
+        return -1;
+    }
+
+    // Missed occurrences are not caught up, the entry moves past now.
+    uint8_t index = _heap[0];
+    _fireTimes[index] = nextFire(_entries[index], now + 1);
+    if (_fireTimes[index] == SCHEDULE_NEVER)
+    {
+        _heap[0] = _heap[--_heapCount];
+    }
+    siftDown(0);
+    return index;
+}
+
+bool Scheduler::isValid(const ScheduleEntry &entry)
+{
+    if (entry.action > SCHEDULE_ACTION_RELAY_ON || entry.weekdays > SCHEDULE_ALL_WEEKDAYS)
+    {
+        return false;
+    }
+    if (entry.anchor == 0 ? (entry.minute < 0 || entry.minute >= SCHEDULE_MINUTES_PER_DAY)
+                          : (entry.minute < -SCHEDULE_MAX_ANCHOR_OFFSET || entry.minute > SCHEDULE_MAX_ANCHOR_OFFSET))
+    {
+        return false;
+    }
+    // Either weekly or dated, never both.
+    return (entry.weekdays != 0) != (entry.day != 0);
+}
+
+uint32_t Scheduler::nextFire(const ScheduleEntry &entry, uint32_t from) const
+{
+    uint32_t time;
+    if (entry.day != 0)
+    {
+        return (fireTime(entry, entry.day, time) && time >= from) ? time : SCHEDULE_NEVER;
+    }
+
+    // Each exception can push the entry back by at most a week.
+    uint32_t day = from / SECONDS_PER_DAY;
+    for (uint16_t i = 0; i <= 7 * (_exceptionCount + 1); i++, day++)
+    {
+        // 1970-01-01 was a Thursday.
+        uint8_t weekday = (day + 4) % 7;
+        if ((entry.weekdays & (1 << weekday)) && !isException(day) && fireTime(entry, day, time) && time >= from)
+        {
+            return time;
+        }
+    }
+    return SCHEDULE_NEVER;
+}
+
+bool Scheduler::fireTime(const ScheduleEntry &entry, uint16_t day, uint32_t &time) const
+{
+    int32_t minute = entry.minute;
+    if (entry.anchor != 0)
+    {
+        int16_t anchor = _anchorFunction ? _anchorFunction(entry.anchor, day) : -1;
+        if (anchor < 0)
+        {
+            return false;
+        }
+
+        // Kept on its own day, like a rule's anchored limit.
+        minute = (anchor + minute) % SCHEDULE_MINUTES_PER_DAY;
+        if (minute < 0)
+        {
+            minute += SCHEDULE_MINUTES_PER_DAY;
+        }
+    }
+    time = day * SECONDS_PER_DAY + minute * 60UL;
+    return true;
+}
+
+bool Scheduler::isException(uint16_t day) const
+{
+    for (uint8_t i = 0; i < _exceptionCount; i++)
+    {
+        if (_exceptions[i] == day)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Scheduler::siftDown(uint8_t position)
+{
+    while (true)
+    {
+        uint8_t smallest = position;
+        uint8_t left = position * 2 + 1;
+        uint8_t right = left + 1;
+        if (left < _heapCount && _fireTimes[_heap[left]] < _fireTimes[_heap[smallest]])
+        {
+            smallest = left;
+        }
+        if (right < _heapCount && _fireTimes[_heap[right]] < _fireTimes[_heap[smallest]])
+        {
+            smallest = right;
+        }
+        if (smallest == position)
+        {
+            return;
+        }
+
+        uint8_t swap = _heap[position];
+        _heap[position] = _heap[smallest];
+        _heap[smallest] = swap;
+        position = smallest;
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+#define SCHEDULE_MAX_ENTRIES 16
+#define SCHEDULE_MAX_EXCEPTIONS 16
+#define SCHEDULE_MINUTES_PER_DAY 1440
+#define SCHEDULE_ALL_WEEKDAYS 0x7F
+#define SCHEDULE_MAX_ANCHOR_OFFSET 720
+#define SCHEDULE_NEVER 0xFFFFFFFF
+
+enum ScheduleAction
+{
+    SCHEDULE_ACTION_RELAY_OFF = 0,
+    SCHEDULE_ACTION_RELAY_ON = 1
+};
+
+/*
+ * Switches a relay at a local time, either on some weekdays or on one date.
+ * The time is a fixed minute of the day, or an offset from an anchor such
+ * as sunset whose time changes from day to day. Stored as is, so only
+ * fixed-size fields.
+ */
+struct ScheduleEntry
+{
+    uint8_t action;
+    uint8_t relay;
+    uint8_t weekdays; // Bit 0 is Sunday; 0 for a dated entry.
+    uint8_t anchor;   // 0 for a fixed time, else handed to the anchor function.
+    int16_t minute;   // Local minute of the day, or minutes from the anchor.
+    uint16_t day;     // Dated entry: local days since 1970-01-01, else 0.
+};
+
+// Local minute of the day of an anchor on a day, -1 if it has none then.
+typedef int16_t (*ScheduleAnchorFunction)(uint8_t anchor, uint16_t day);
+
+/*
+ * Fires schedule entries at their local time.
+ *
+ * Every entry knows its next fire time, and a min-heap keeps the earliest
+ * one on top, so checking whether anything is due is one compare no matter
+ * how many entries there are. When an entry fires only its own next time
+ * is worked out again. Weekly entries are skipped on the exception dates,
+ * dated entries are not and drop out once past.
+ *
+ * Times are local seconds since 1970-01-01. start() must be called again
+ * whenever the clock, the time zone or the anchor times change. An anchored
+ * entry is skipped on days its anchor has no time, and one that finds none
+ * in the days looked ahead drops out until the next start().
+ */
+class Scheduler
+{
+public:
+    Scheduler(void);
+
+    void clear(void);
+    bool add(const ScheduleEntry &entry);
+    bool addException(uint16_t day);
+    void setAnchorFunction(ScheduleAnchorFunction function) { _anchorFunction = function; }
+
+    void start(uint32_t now);
+    int8_t poll(uint32_t now);
+
+    uint32_t next(void) const { return _heapCount > 0 ? _fireTimes[_heap[0]] : SCHEDULE_NEVER; }
+    int8_t nextEntry(void) const { return _heapCount > 0 ? _heap[0] : -1; }
+
+    uint8_t count(void) const { return _count; }
+    const ScheduleEntry &entry(uint8_t index) const { return _entries[index]; }
+    uint8_t exceptionCount(void) const { return _exceptionCount; }
+    uint16_t exception(uint8_t index) const { return _exceptions[index]; }
+
+    static bool isValid(const ScheduleEntry &entry);
+
+private:
+    uint32_t nextFire(const ScheduleEntry &entry, uint32_t from) const;
+    bool fireTime(const ScheduleEntry &entry, uint16_t day, uint32_t &time) const;
+    bool isException(uint16_t day) const;
+    void siftDown(uint8_t position);
+
+    ScheduleEntry _entries[SCHEDULE_MAX_ENTRIES];
+    uint32_t _fireTimes[SCHEDULE_MAX_ENTRIES];
+    uint8_t _count;
+
+    uint16_t _exceptions[SCHEDULE_MAX_EXCEPTIONS];
+    uint8_t _exceptionCount;
+
+    uint8_t _heap[SCHEDULE_MAX_ENTRIES]; // Entry indices by fire time.
+    uint8_t _heapCount;
+
+    ScheduleAnchorFunction _anchorFunction;
+};
+
+#endif
@@ -0,0 +1,19 @@
+#include "SensorFilter.h"
+
+SensorFilter::SensorFilter(float alpha) : _alpha(alpha), _value(0.0f), _ready(false)
+{
+}
+
+float SensorFilter::add(float sample)
+{
+    // The first sample starts the average instead of ramping up from zero.
+    _value = _ready ? _value + _alpha * (sample - _value) : sample;
+    _ready = true;
+    return _value;
+}
+
+void SensorFilter::reset(void)
+{
+    _value = 0.0f;
+    _ready = false;
+}
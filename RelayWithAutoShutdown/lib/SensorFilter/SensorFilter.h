@@ -0,0 +1,29 @@
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+#include <Arduino.h>
+
+/*
+ * Exponential moving average of a reading, which rides out short changes
+ * such as passing headlights. Feed it a value that has already dropped
+ * single outliers, such as a median. With samples every T seconds the
+ * average follows a step to 63% in about T / alpha seconds.
+ */
+class SensorFilter
+{
+public:
+    SensorFilter(float alpha);
+
+    float add(float sample);
+    void reset(void);
+
+    float value(void) const { return _value; }
+    bool ready(void) const { return _ready; }
+
+private:
+    float _alpha;
+    float _value;
+    bool _ready;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "StateLog.h"
+#include <LittleFS.h>
+#include <Crc32.h>
+
+StateLog::StateLog(const char *path)
+    : _active(0), _activeCount(0), _sequence(0), _stored(0), _hasStored(false), _pending(0), _hasPending(false),
+      _changeMillis(0), _writeMillis(0), _written(false)
+{
+    _paths[0] = String(path) + ".0";
+    _paths[1] = String(path) + ".1";
+}
+
+bool StateLog::load(uint32_t &value)
+{
+    Record latest[2];
+    uint16_t count[2];
+    bool valid[2];
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        valid[i] = scan(i, latest[i], count[i]);
+    }
+
+    if (!valid[0] && !valid[1])
+    {
+        return false;
+    }
+
+    // Sequence numbers are compared as a difference, which survives wrap-around.
+    uint8_t newest = (!valid[1] || (valid[0] && (int32_t)(latest[0].sequence - latest[1].sequence) > 0)) ? 0 : 1;
+    _active = newest;
+    _activeCount = count[newest];
+    _sequence = latest[newest].sequence;
+    _stored = latest[newest].value;
+    _hasStored = true;
+
+    value = _stored;
+    return true;
+}
+
+void StateLog::set(uint32_t value)
+{
+    _pending = value;
+    _hasPending = !_hasStored || value != _stored;
+    _changeMillis = millis();
+}
+
+void StateLog::loop(void)
+{
+    if (!_hasPending)
+    {
+        return;
+    }
+
+    unsigned long currentMillis = millis();
+    if ((currentMillis - _changeMillis) < STATE_LOG_SETTLE_TIME)
+    {
+        return;
+    }
+    if (_written && (currentMillis - _writeMillis) < STATE_LOG_MIN_INTERVAL)
+    {
+        return;
+    }
+
+    flush();
+}
+
+bool StateLog::flush(void)
+{
+    if (!_hasPending)
+    {
+        return true;
+    }
+
+    _writeMillis = millis();
+    _written = true;
+    if (!write(_pending))
+    {
+        // Retried after the next interval.
+        Serial.println("[StateLog] Failed to write state.");
+        return false;
+    }
+
+    _stored = _pending;
+    _hasStored = true;
+    _hasPending = false;
+    return true;
+}
+
+bool StateLog::scan(uint8_t index, Record &latest, uint16_t &count)
+{
+    count = 0;
+    File file = LittleFS.open(_paths[index], "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    // Records are appended in order, the last valid one is the newest.
+    bool found = false;
+    Record record;
+    while (count < STATE_LOG_SLOTS && file.read((uint8_t *)&record, sizeof(record)) == sizeof(record))
+    {
+        count++;
+        if (record.crc == crc32(&record, offsetof(Record, crc)))
+        {
+            latest = record;
+            found = true;
+        }
+    }
+    if (file.size() != count * sizeof(record))
+    {
+        // Torn or unexpected tail, later appends would not line up.
+        count = STATE_LOG_SLOTS;
+    }
+    file.close();
+    return found;
+}
+
+bool StateLog::write(uint32_t value)
+{
+    const char *mode = "a";
+    if (_activeCount >= STATE_LOG_SLOTS)
+    {
+        // Start over in the other file, this one keeps the last state meanwhile.
+        _active ^= 1;
+        _activeCount = 0;
+    }
+    if (_activeCount == 0)
+    {
+        mode = "w";
+    }
+
+    File file = LittleFS.open(_paths[_active], mode);
+    if (!file)
+    {
+        return false;
+    }
+
+    Record record;
+    record.sequence = _sequence + 1;
+    record.value = value;
+    record.crc = crc32(&record, offsetof(Record, crc));
+    size_t length = file.write((const uint8_t *)&record, sizeof(record));
+    file.close();
+
+    _activeCount++;
+    if (length != sizeof(record))
+    {
+        // Move on to the other file rather than append after a torn record.
+        _activeCount = STATE_LOG_SLOTS;
+        return false;
+    }
+    _sequence = record.sequence;
+    return true;
+}
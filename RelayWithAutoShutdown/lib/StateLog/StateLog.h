@@ -0,0 +1,59 @@
+#ifndef STATE_LOG_H
+#define STATE_LOG_H
+
+#include <Arduino.h>
+
+#define STATE_LOG_SLOTS 64
+#define STATE_LOG_SETTLE_TIME 1000L
+#define STATE_LOG_MIN_INTERVAL 10000L
+
+/*
+ * Keeps one small value (the relay state) across reboots without wearing
+ * out the flash.
+ *
+ * set() only records the value. loop() writes it once it has been stable for
+ * STATE_LOG_SETTLE_TIME and at most once every STATE_LOG_MIN_INTERVAL, so a
+ * burst of changes costs a single write of the final value. A value equal to
+ * the one on flash is not written at all.
+ *
+ * Records carry a sequence number and a CRC and are appended to one of two
+ * files of STATE_LOG_SLOTS slots each, "<path>.0" and "<path>.1". When one is
+ * full the other is started over, so the newest valid record survives a power
+ * loss at any point and LittleFS spreads the writes over its blocks.
+ */
+class StateLog
+{
+public:
+    StateLog(const char *path);
+
+    bool load(uint32_t &value);
+    void set(uint32_t value);
+    void loop(void);
+    bool flush(void);
+
+private:
+    struct Record
+    {
+        uint32_t sequence;
+        uint32_t value;
+        uint32_t crc;
+    };
+
+    bool scan(uint8_t index, Record &latest, uint16_t &count);
+    bool write(uint32_t value);
+
+    String _paths[2];
+    uint8_t _active;
+    uint16_t _activeCount;
+    uint32_t _sequence;
+
+    uint32_t _stored;
+    bool _hasStored;
+    uint32_t _pending;
+    bool _hasPending;
+    unsigned long _changeMillis;
+    unsigned long _writeMillis;
+    bool _written;
+};
+
+#endif
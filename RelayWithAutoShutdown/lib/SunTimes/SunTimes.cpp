@@ -0,0 +1,101 @@
+#include "SunTimes.h"
+
+#include <math.h>
+
+#define SECONDS_PER_DAY 86400L
+
+// 2000-01-01 12:00 UTC, the J2000.0 epoch, in days and seconds since 1970.
+#define J2000_DAY 10957
+#define J2000_SECONDS 946728000L
+
+#define DEGREES (M_PI / 180.0)
+
+// Sun's altitude at each event: refraction and the solar disc, then civil
+// twilight.
+static const double EVENT_ALTITUDES[] = {-0.833, -0.833, -6.0, -6.0};
+
+SunTimes::SunTimes(void) : _hasLocation(false), _latitude(0.0f), _longitude(0.0f)
+{
+    invalidate();
+}
+
+void SunTimes::setLocation(float latitude, float longitude)
+{
+    if (_hasLocation && latitude == _latitude && longitude == _longitude)
+    {
+        return;
+    }
+    _hasLocation = true;
+    _latitude = latitude;
+    _longitude = longitude;
+    invalidate();
+}
+
+void SunTimes::clearLocation(void)
+{
+    _hasLocation = false;
+    invalidate();
+}
+
+bool SunTimes::update(uint16_t day)
+{
+    if (day == _day)
+    {
+        return false;
+    }
+
+    _day = day;
+    if (!_hasLocation)
+    {
+        for (uint8_t i = 0; i < SUN_EVENT_COUNT; i++)
+        {
+            _times[i] = SUN_TIME_NONE;
+        }
+        return true;
+    }
+    calculate(day, _latitude, _longitude, _times);
+    return true;
+}
+
+void SunTimes::calculate(uint16_t day, float latitude, float longitude, uint32_t times[SUN_EVENT_COUNT])
+{
+    // Days from J2000.0 to the mean solar noon of that date at this longitude
+    // (east positive). Double precision, a float only resolves ~90 s here.
+    double noon = (int32_t)day - J2000_DAY - longitude / 360.0;
+
+    // Solar mean anomaly, equation of the centre and ecliptic longitude.
+    double anomaly = fmod(357.5291 + 0.98560028 * noon, 360.0) * DEGREES;
+    double centre = 1.9148 * sin(anomaly) + 0.0200 * sin(2 * anomaly) + 0.0003 * sin(3 * anomaly);
+    double ecliptic = fmod(anomaly / DEGREES + centre + 180.0 + 102.9372, 360.0) * DEGREES;
+
+    // Solar transit, and the sun's declination.
+    double transit = noon + 0.0053 * sin(anomaly) - 0.0069 * sin(2 * ecliptic);
+    double declination = asin(sin(ecliptic) * sin(23.4397 * DEGREES));
+
+    double phi = latitude * DEGREES;
+    for (uint8_t i = 0; i < SUN_EVENT_COUNT; i++)
+    {
+        // Hour angle at which the sun reaches the event's altitude.
+        double cosHourAngle = (sin(EVENT_ALTITUDES[i] * DEGREES) - sin(phi) * sin(declination)) /
+                              (cos(phi) * cos(declination));
+        if (cosHourAngle < -1.0 || cosHourAngle > 1.0)
+        {
+            // The sun stays above or below that altitude all day.
+            times[i] = SUN_TIME_NONE;
+            continue;
+        }
+
+        double hourAngle = acos(cosHourAngle) / DEGREES / 360.0;
+        double event = (i == SUN_EVENT_SUNRISE || i == SUN_EVENT_DAWN) ? transit - hourAngle : transit + hourAngle;
+        times[i] = (uint32_t)(J2000_SECONDS + (int64_t)floor(event * SECONDS_PER_DAY + 0.5));
+    }
+}
+
+void SunTimes::invalidate(void)
+{
+    _day = 0;
+    for (uint8_t i = 0; i < SUN_EVENT_COUNT; i++)
+    {
+        _times[i] = SUN_TIME_NONE;
+    }
+}
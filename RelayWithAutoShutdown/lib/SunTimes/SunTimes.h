@@ -0,0 +1,55 @@
+#ifndef SUN_TIMES_H
+#define SUN_TIMES_H
+
+#include <stdint.h>
+
+#define SUN_TIME_NONE 0xFFFFFFFF
+
+enum SunEvent
+{
+    SUN_EVENT_SUNRISE,
+    SUN_EVENT_SUNSET,
+    SUN_EVENT_DAWN, // Start of civil twilight, the sun 6 degrees below the horizon.
+    SUN_EVENT_DUSK, // End of civil twilight.
+    SUN_EVENT_COUNT
+};
+
+/*
+ * Sunrise, sunset and civil twilight at a location, worked out offline with
+ * the NOAA sunrise equation. Good to about a minute between the polar
+ * circles, which is as close as a real horizon gets anyway.
+ *
+ * The trigonometry runs once per date: update() computes the events of the
+ * given day and keeps them until the day or the location changes, time()
+ * is then a table lookup. Days are counted from 1970-01-01 and the events
+ * are UTC seconds; an event that does not happen on that day, such as
+ * sunset in midsummer above the arctic circle, is SUN_TIME_NONE.
+ */
+class SunTimes
+{
+public:
+    SunTimes(void);
+
+    void setLocation(float latitude, float longitude);
+    void clearLocation(void);
+    bool hasLocation(void) const { return _hasLocation; }
+
+    // Whether the events had to be worked out, false if cached.
+    bool update(uint16_t day);
+    uint16_t day(void) const { return _day; }
+    uint32_t time(uint8_t event) const { return event < SUN_EVENT_COUNT ? _times[event] : SUN_TIME_NONE; }
+
+    static void calculate(uint16_t day, float latitude, float longitude, uint32_t times[SUN_EVENT_COUNT]);
+
+private:
+    void invalidate(void);
+
+    bool _hasLocation;
+    float _latitude;
+    float _longitude;
+
+    uint16_t _day; // 0 while nothing is cached.
+    uint32_t _times[SUN_EVENT_COUNT];
+};
+
+#endif
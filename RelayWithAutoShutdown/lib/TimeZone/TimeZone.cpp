@@ -0,0 +1,251 @@
+#include "TimeZone.h"
+
+#include <stddef.h>
+
+static bool isAlpha(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool parseNumber(const char *&p, int32_t &value, int32_t max)
+{
+    if (*p < '0' || *p > '9')
+    {
+        return false;
+    }
+    value = 0;
+    while (*p >= '0' && *p <= '9')
+    {
+        value = value * 10 + (*p++ - '0');
+        if (value > max)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Zone abbreviation, three or more letters or anything quoted in <>.
+static bool parseName(const char *&p)
+{
+    const char *begin = p;
+    if (*p == '<')
+    {
+        while (*p != '\0' && *p != '>')
+        {
+            p++;
+        }
+        if (*p != '>')
+        {
+            return false;
+        }
+        p++;
+        return p - begin > 2;
+    }
+
+    while (isAlpha(*p))
+    {
+        p++;
+    }
+    return p - begin >= 3;
+}
+
+// [+|-]hh[:mm[:ss]] in seconds.
+static bool parseTime(const char *&p, int32_t &seconds, int32_t maxHours)
+{
+    int32_t sign = 1;
+    if (*p == '+' || *p == '-')
+    {
+        sign = (*p++ == '-') ? -1 : 1;
+    }
+
+    int32_t hours, minutes = 0, secs = 0;
+    if (!parseNumber(p, hours, maxHours))
+    {
+        return false;
+    }
+    if (*p == ':')
+    {
+        p++;
+        if (!parseNumber(p, minutes, 59))
+        {
+            return false;
+        }
+        if (*p == ':')
+        {
+            p++;
+            if (!parseNumber(p, secs, 59))
+            {
+                return false;
+            }
+        }
+    }
+    seconds = sign * (hours * 3600 + minutes * 60 + secs);
+    return true;
+}
+
+// ,Mm.w.d[/time]
+static bool parseTransition(const char *&p, TimeZoneTransition &transition)
+{
+    int32_t month, week, weekday;
+    if (*p++ != ',' || *p++ != 'M' || !parseNumber(p, month, 12) || month < 1 || *p++ != '.' ||
+        !parseNumber(p, week, 5) || week < 1 || *p++ != '.' || !parseNumber(p, weekday, 6))
+    {
+        return false;
+    }
+
+    int32_t seconds = 2 * 3600;
+    if (*p == '/')
+    {
+        p++;
+        if (!parseTime(p, seconds, 167))
+        {
+            return false;
+        }
+    }
+
+    transition.month = month;
+    transition.week = week;
+    transition.weekday = weekday;
+    transition.minute = seconds / 60;
+    return true;
+}
+
+/* -------------------------------------------------- */
+
+TimeZone::TimeZone(void) : _year(0), _start(0), _end(0)
+{
+    parse("UTC0", _rule);
+}
+
+bool TimeZone::set(const char *posix)
+{
+    TimeZoneRule rule;
+    if (!parse(posix, rule))
+    {
+        return false;
+    }
+    _rule = rule;
+    _year = 0;
+    return true;
+}
+
+bool TimeZone::parse(const char *posix, TimeZoneRule &rule)
+{
+    if (posix == NULL)
+    {
+        return false;
+    }
+
+    // POSIX offsets count west of UTC, the rule keeps them east.
+    const char *p = posix;
+    int32_t offset;
+    if (!parseName(p) || !parseTime(p, offset, 24))
+    {
+        return false;
+    }
+    rule.offset = -offset;
+    rule.dstOffset = rule.offset;
+    rule.dst = false;
+    if (*p == '\0')
+    {
+        return true;
+    }
+
+    if (!parseName(p))
+    {
+        return false;
+    }
+    rule.dstOffset = rule.offset + 3600;
+    if (*p != ',' && *p != '\0')
+    {
+        if (!parseTime(p, offset, 24))
+        {
+            return false;
+        }
+        rule.dstOffset = -offset;
+    }
+
+    // The dates have no portable default, they must be given.
+    if (!parseTransition(p, rule.start) || !parseTransition(p, rule.end) || *p != '\0')
+    {
+        return false;
+    }
+    rule.dst = true;
+    return true;
+}
+
+int32_t TimeZone::offset(uint32_t utc)
+{
+    return isDst(utc) ? _rule.dstOffset : _rule.offset;
+}
+
+bool TimeZone::isDst(uint32_t utc)
+{
+    if (!_rule.dst)
+    {
+        return false;
+    }
+
+    int32_t year;
+    uint8_t month, day;
+    civilFromDays((utc + _rule.offset) / 86400, year, month, day);
+    if (year != _year)
+    {
+        _year = year;
+        _start = transitionTime(year, _rule.start, _rule.offset);
+        _end = transitionTime(year, _rule.end, _rule.dstOffset);
+    }
+
+    // Southern zones start DST late in the year and end it early.
+    if (_start < _end)
+    {
+        return utc >= _start && utc < _end;
+    }
+    return utc >= _start || utc < _end;
+}
+
+int32_t TimeZone::daysFromCivil(int32_t year, uint8_t month, uint8_t day)
+{
+    // Days since 1970-01-01 in the proleptic Gregorian calendar.
+    year -= (month <= 2) ? 1 : 0;
+    int32_t era = (year >= 0 ? year : year - 399) / 400;
+    int32_t yearOfEra = year - era * 400;
+    int32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+void TimeZone::civilFromDays(int32_t days, int32_t &year, uint8_t &month, uint8_t &day)
+{
+    days += 719468;
+    int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int32_t dayOfEra = days - era * 146097;
+    int32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int32_t monthIndex = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+int64_t TimeZone::transitionTime(int32_t year, const TimeZoneTransition &transition, int32_t offset)
+{
+    static const uint8_t DAYS_IN_MONTH[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    uint8_t daysInMonth = DAYS_IN_MONTH[transition.month - 1];
+    if (transition.month == 2 && (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)))
+    {
+        daysInMonth = 29;
+    }
+
+    int32_t first = daysFromCivil(year, transition.month, 1);
+    uint8_t firstWeekday = weekday(first);
+    int32_t day = 1 + (transition.weekday + 7 - firstWeekday) % 7 + (transition.week - 1) * 7;
+    while (day > daysInMonth)
+    {
+        day -= 7;
+    }
+
+    int64_t local = (int64_t)(first + day - 1) * 86400 + (int32_t)transition.minute * 60;
+    return local - offset;
+}
@@ -0,0 +1,68 @@
+#ifndef TIME_ZONE_H
+#define TIME_ZONE_H
+
+#include <stdint.h>
+
+#define TIME_ZONE_MINUTES_PER_DAY 1440
+
+/*
+ * Local time change, "the week-th weekday of month at minute", with week 5
+ * meaning the last one. POSIX TZ "Mm.w.d/time".
+ */
+struct TimeZoneTransition
+{
+    uint8_t month;   // 1 - 12
+    uint8_t week;    // 1 - 5
+    uint8_t weekday; // 0 = Sunday
+    int16_t minute;  // Local minutes after midnight, may be negative or past a day.
+};
+
+/*
+ * Offsets in seconds east of UTC, and the daylight saving period if any.
+ */
+struct TimeZoneRule
+{
+    int32_t offset;
+    int32_t dstOffset;
+    bool dst;
+    TimeZoneTransition start; // In standard time.
+    TimeZoneTransition end;   // In daylight saving time.
+};
+
+/*
+ * UTC to local time from a POSIX TZ rule such as "CST-8" or
+ * "CET-1CEST,M3.5.0,M10.5.0/3", with integer arithmetic only.
+ *
+ * The transitions of the current year are worked out once and cached, so
+ * offset() is two compares. Only the "M" form of the DST dates is
+ * supported, which every zone in use today can be written in.
+ */
+class TimeZone
+{
+public:
+    TimeZone(void);
+
+    bool set(const char *posix);
+    static bool parse(const char *posix, TimeZoneRule &rule);
+
+    int32_t offset(uint32_t utc);
+    bool isDst(uint32_t utc);
+    uint32_t toLocal(uint32_t utc) { return utc + offset(utc); }
+
+    static uint16_t minuteOfDay(uint32_t local) { return (local / 60) % TIME_ZONE_MINUTES_PER_DAY; }
+
+    // Days since 1970-01-01, and back, in the Gregorian calendar.
+    static int32_t daysFromCivil(int32_t year, uint8_t month, uint8_t day);
+    static void civilFromDays(int32_t days, int32_t &year, uint8_t &month, uint8_t &day);
+    static uint8_t weekday(int32_t days) { return (days % 7 + 11) % 7; } // 0 = Sunday
+
+private:
+    static int64_t transitionTime(int32_t year, const TimeZoneTransition &transition, int32_t offset);
+
+    TimeZoneRule _rule;
+    int32_t _year;
+    int64_t _start;
+    int64_t _end;
+};
+
+#endif
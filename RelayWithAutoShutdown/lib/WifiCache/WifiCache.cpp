@@ -0,0 +1,45 @@
+#include "WifiCache.h"
+#include <LittleFS.h>
+#include <Crc32.h>
+
+WifiCache::WifiCache(const char *path) : _path(path)
+{
+}
+
+bool WifiCache::load(WifiCacheRecord &record)
+{
+    File file = LittleFS.open(_path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    size_t length = file.read((uint8_t *)&record, sizeof(record));
+    file.close();
+
+    return length == sizeof(record) && record.magic == WIFI_CACHE_MAGIC && record.version == WIFI_CACHE_VERSION &&
+           record.size == sizeof(record) && record.crc == crc32(&record, offsetof(WifiCacheRecord, crc));
+}
+
+bool WifiCache::save(WifiCacheRecord &record)
+{
+    record.magic = WIFI_CACHE_MAGIC;
+    record.version = WIFI_CACHE_VERSION;
+    record.size = sizeof(record);
+    record.crc = crc32(&record, offsetof(WifiCacheRecord, crc));
+
+    File file = LittleFS.open(_path, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    size_t length = file.write((const uint8_t *)&record, sizeof(record));
+    file.close();
+    return length == sizeof(record);
+}
+
+bool WifiCache::remove(void)
+{
+    return LittleFS.remove(_path);
+}
@@ -0,0 +1,49 @@
+#ifndef WIFI_CACHE_H
+#define WIFI_CACHE_H
+
+#include <Arduino.h>
+
+#define WIFI_CACHE_MAGIC 0x48434657 // "WFCH"
+#define WIFI_CACHE_VERSION 1
+
+#define WIFI_CACHE_SSID_SIZE 33
+
+/*
+ * Access point and addresses of the last successful station connection.
+ * Addresses are stored as IPAddress' uint32_t value.
+ */
+struct WifiCacheRecord
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+
+    char ssid[WIFI_CACHE_SSID_SIZE];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+
+    uint32_t crc;
+};
+
+/*
+ * Keeps a WifiCacheRecord in one LittleFS file. The record is only a hint,
+ * losing it costs one full scan, so it is written in place.
+ */
+class WifiCache
+{
+public:
+    WifiCache(const char *path);
+
+    bool load(WifiCacheRecord &record);
+    bool save(WifiCacheRecord &record);
+    bool remove(void);
+
+private:
+    const char *_path;
+};
+
+#endif
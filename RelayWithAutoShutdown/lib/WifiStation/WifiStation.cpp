@@ -0,0 +1,343 @@
+#include "WifiStation.h"
+#include <ESP8266WiFi.h>
+
+static const char *connectModeName(WifiConnectMode mode)
+{
+    switch (mode)
+    {
+    case WIFI_CONNECT_CACHED:
+        return "Cached";
+    case WIFI_CONNECT_SCANNED:
+        return "Scanned";
+    default:
+        return "Plain";
+    }
+}
+
+WifiStation::WifiStation(const char *cachePath)
+    : _cache(cachePath), _networkCount(0), _candidateCount(0), _nextCandidate(0), _state(STATE_IDLE), _mode(WIFI_CONNECT_NONE), _roaming(false),
+      _associated(false), _cachePending(false), _connectStartMillis(0), _associatedMillis(0), _scanStartMillis(0),
+      _lastScanMillis(0), _associationTime(-1), _dhcpTime(-1)
+{
+}
+
+void WifiStation::clearNetworks(void)
+{
+    _networkCount = 0;
+}
+
+bool WifiStation::addNetwork(const char *ssid, const char *password)
+{
+    if (_networkCount >= WIFI_STATION_MAX_NETWORKS || ssid[0] == '\0')
+    {
+        return false;
+    }
+
+    ConfigNetwork &network = _networks[_networkCount++];
+    ConfigStore::setString(network.ssid, sizeof(network.ssid), ssid);
+    ConfigStore::setString(network.password, sizeof(network.password), password);
+    return true;
+}
+
+void WifiStation::begin(void)
+{
+    _roaming = false;
+    if (_networkCount == 0)
+    {
+        _state = STATE_IDLE;
+        return;
+    }
+
+    WifiCacheRecord cache;
+    int network;
+    if (_cache.load(cache) && (network = findNetwork(cache.ssid)) >= 0)
+    {
+#ifdef WIFI_REUSE_IP
+        if (cache.ip != 0)
+        {
+            WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+        }
+#endif
+        Serial.printf("[WIFI] Fast connect: %s, %02X:%02X:%02X:%02X:%02X:%02X, channel %d.\r\n", cache.ssid, cache.bssid[0],
+                      cache.bssid[1], cache.bssid[2], cache.bssid[3], cache.bssid[4], cache.bssid[5], cache.channel);
+        connect(network, cache.bssid, cache.channel, WIFI_CONNECT_CACHED);
+        return;
+    }
+
+    startScan(false);
+}
+
+void WifiStation::loop(void)
+{
+    if (_cachePending)
+    {
+        _cachePending = false;
+        saveCache();
+    }
+
+    unsigned long currentMillis = millis();
+    switch (_state)
+    {
+    case STATE_CONNECTING:
+        if (!_associated && (currentMillis - _connectStartMillis) > WIFI_CONNECT_TIMEOUT)
+        {
+            if (_mode == WIFI_CONNECT_CACHED)
+            {
+                _cache.remove();
+            }
+            if (_mode == WIFI_CONNECT_SCANNED && _nextCandidate < _candidateCount)
+            {
+                // Next network of the same scan, no need to scan again yet.
+                Serial.println("[WIFI] Not connected, trying the next network.");
+                connectCandidate();
+                break;
+            }
+            Serial.println("[WIFI] Not connected, scanning.");
+            startScan(false);
+        }
+        break;
+
+    case STATE_CONNECTED:
+        if ((currentMillis - _lastScanMillis) > WIFI_RESCAN_INTERVAL && WiFi.RSSI() < WIFI_WEAK_RSSI)
+        {
+            Serial.printf("[WIFI] Weak signal (%d dBm), scanning.\r\n", WiFi.RSSI());
+            startScan(true);
+        }
+        break;
+
+    case STATE_SCANNING:
+    {
+        int8_t count = WiFi.scanComplete();
+        if (count == WIFI_SCAN_RUNNING && (currentMillis - _scanStartMillis) < WIFI_SCAN_TIMEOUT)
+        {
+            break;
+        }
+        finishScan(count);
+        break;
+    }
+
+    case STATE_WAITING:
+        if ((currentMillis - _lastScanMillis) > WIFI_RESCAN_INTERVAL)
+        {
+            startScan(false);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void WifiStation::forgetCache(void)
+{
+    _cache.remove();
+}
+
+void WifiStation::onConnected(void)
+{
+    if (_associated)
+    {
+        return;
+    }
+    _associated = true;
+    _associatedMillis = millis();
+    _associationTime = _associatedMillis - _connectStartMillis;
+}
+
+void WifiStation::onGotIP(void)
+{
+    if (_associated && _dhcpTime < 0)
+    {
+        _dhcpTime = millis() - _associatedMillis;
+        Serial.printf("[WIFI] %s connect: associated in %ld ms, IP after %ld ms.\r\n", connectModeName(_mode),
+                      _associationTime, _dhcpTime);
+    }
+
+    // The SDK may also have found the network by itself while waiting.
+    if (_state == STATE_CONNECTING || _state == STATE_WAITING)
+    {
+        _state = STATE_CONNECTED;
+        _lastScanMillis = millis();
+    }
+    // A later failover starts from a fresh scan.
+    _candidateCount = 0;
+    _nextCandidate = 0;
+    _cachePending = true;
+}
+
+void WifiStation::onDisconnected(void)
+{
+    // A lost link during a roaming scan is handled as a failover.
+    _roaming = false;
+    if (!_associated)
+    {
+        return;
+    }
+
+    // The SDK reconnects on its own; a scan follows if that takes too long.
+    _associated = false;
+    _connectStartMillis = millis();
+    _dhcpTime = -1;
+    if (_state == STATE_CONNECTED)
+    {
+        _state = STATE_CONNECTING;
+    }
+}
+
+void WifiStation::connect(uint8_t network, const uint8_t *bssid, int32_t channel, WifiConnectMode mode)
+{
+#ifdef WIFI_REUSE_IP
+    if (mode != WIFI_CONNECT_CACHED)
+    {
+        WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
+    }
+#endif
+
+    _state = (mode == WIFI_CONNECT_PLAIN) ? STATE_WAITING : STATE_CONNECTING;
+    _mode = mode;
+    _associated = false;
+    _connectStartMillis = millis();
+    _associationTime = -1;
+    _dhcpTime = -1;
+
+    WiFi.begin(_networks[network].ssid, _networks[network].password, channel, bssid);
+}
+
+void WifiStation::startScan(bool roaming)
+{
+    // The SDK does not scan while it is still trying to connect.
+    if (!roaming)
+    {
+        WiFi.disconnect(false);
+    }
+    _roaming = roaming;
+    _state = STATE_SCANNING;
+    _scanStartMillis = millis();
+    WiFi.scanNetworks(true, false);
+}
+
+void WifiStation::finishScan(int count)
+{
+    // Strongest access point of every configured network, strongest first.
+    _candidateCount = 0;
+    _nextCandidate = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int network = findNetwork(WiFi.SSID(i).c_str());
+        if (network < 0)
+        {
+            continue;
+        }
+
+        int32_t rssi = WiFi.RSSI(i);
+        uint8_t index = 0;
+        while (index < _candidateCount && _candidates[index].network != network)
+        {
+            index++;
+        }
+        if (index < _candidateCount)
+        {
+            if (rssi <= _candidates[index].rssi)
+            {
+                continue;
+            }
+        }
+        else
+        {
+            _candidateCount++;
+        }
+
+        // Move it up past the weaker ones.
+        while (index > 0 && _candidates[index - 1].rssi < rssi)
+        {
+            _candidates[index] = _candidates[index - 1];
+            index--;
+        }
+        Candidate &candidate = _candidates[index];
+        candidate.network = network;
+        memcpy(candidate.bssid, WiFi.BSSID(i), sizeof(candidate.bssid));
+        candidate.channel = WiFi.channel(i);
+        candidate.rssi = rssi;
+    }
+    WiFi.scanDelete();
+    _lastScanMillis = millis();
+
+    if (_roaming)
+    {
+        _roaming = false;
+        _state = STATE_CONNECTED;
+        const Candidate &best = _candidates[0];
+        if (_candidateCount == 0 || memcmp(best.bssid, WiFi.BSSID(), sizeof(best.bssid)) == 0 ||
+            best.rssi < WiFi.RSSI() + WIFI_ROAM_MARGIN)
+        {
+            return;
+        }
+        Serial.printf("[WIFI] Moving to %s (%d dBm).\r\n", _networks[best.network].ssid, best.rssi);
+        connectCandidate();
+        return;
+    }
+
+    if (_candidateCount == 0)
+    {
+        // Let the SDK look for the first network until the next scan.
+        Serial.println("[WIFI] No configured network in range.");
+        connect(0, NULL, 0, WIFI_CONNECT_PLAIN);
+        return;
+    }
+
+    for (uint8_t i = 0; i < _candidateCount; i++)
+    {
+        Serial.printf("[WIFI] %d. %s (%d dBm, channel %d)\r\n", i + 1, _networks[_candidates[i].network].ssid,
+                      _candidates[i].rssi, _candidates[i].channel);
+    }
+    connectCandidate();
+}
+
+void WifiStation::connectCandidate(void)
+{
+    const Candidate &candidate = _candidates[_nextCandidate++];
+    Serial.printf("[WIFI] Connecting to %s.\r\n", _networks[candidate.network].ssid);
+    connect(candidate.network, candidate.bssid, candidate.channel, WIFI_CONNECT_SCANNED);
+}
+
+void WifiStation::saveCache(void)
+{
+    if (WiFi.status() != WL_CONNECTED)
+    {
+        return;
+    }
+
+    WifiCacheRecord cache;
+    memset(&cache, 0, sizeof(cache));
+    strncpy(cache.ssid, WiFi.SSID().c_str(), sizeof(cache.ssid) - 1);
+    memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+    cache.channel = WiFi.channel();
+    cache.ip = WiFi.localIP();
+    cache.gateway = WiFi.gatewayIP();
+    cache.subnet = WiFi.subnetMask();
+    cache.dns = WiFi.dnsIP();
+
+    // Only written when the access point or the lease changed.
+    WifiCacheRecord saved;
+    size_t length = offsetof(WifiCacheRecord, crc) - offsetof(WifiCacheRecord, ssid);
+    if (_cache.load(saved) && memcmp(saved.ssid, cache.ssid, length) == 0)
+    {
+        return;
+    }
+    if (_cache.save(cache))
+    {
+        Serial.println("[WIFI] Access point cached.");
+    }
+}
+
+int WifiStation::findNetwork(const char *ssid) const
+{
+    for (uint8_t i = 0; i < _networkCount; i++)
+    {
+        if (strcmp(_networks[i].ssid, ssid) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
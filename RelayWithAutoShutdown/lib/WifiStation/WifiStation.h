@@ -0,0 +1,109 @@
+#ifndef WIFI_STATION_H
+#define WIFI_STATION_H
+
+#include <Arduino.h>
+#include <ConfigStore.h>
+#include <WifiCache.h>
+
+#define WIFI_STATION_MAX_NETWORKS (1 + CONFIG_BACKUP_NETWORKS)
+
+// An attempt that has not associated after this long is given up for a scan.
+#define WIFI_CONNECT_TIMEOUT 5000L
+#define WIFI_SCAN_TIMEOUT 15000L
+// Rescan interval while the link is weak or no network was found.
+#define WIFI_RESCAN_INTERVAL 60000L
+#define WIFI_WEAK_RSSI -75
+// A weak link only moves to an access point at least this much stronger.
+#define WIFI_ROAM_MARGIN 8
+
+enum WifiConnectMode
+{
+    WIFI_CONNECT_NONE,
+    WIFI_CONNECT_CACHED,  // BSSID and channel from the last connection.
+    WIFI_CONNECT_SCANNED, // Strongest configured access point of a scan.
+    WIFI_CONNECT_PLAIN    // Nothing in range, the SDK keeps searching.
+};
+
+/*
+ * Keeps the station connected to the best of several configured networks,
+ * driven from loop() and the WiFi event handlers; nothing here blocks.
+ *
+ * begin() first tries the access point cached in WifiCache. When an attempt
+ * has not associated after WIFI_CONNECT_TIMEOUT, an asynchronous scan ranks
+ * all configured networks in range by RSSI (the strongest access point of
+ * each) and they are joined by BSSID and channel in that order, each given
+ * WIFI_CONNECT_TIMEOUT, before the next scan. While connected with an RSSI
+ * below WIFI_WEAK_RSSI a scan runs every WIFI_RESCAN_INTERVAL and the
+ * station moves when another access point is WIFI_ROAM_MARGIN dB stronger.
+ */
+class WifiStation
+{
+public:
+    WifiStation(const char *cachePath);
+
+    void clearNetworks(void);
+    bool addNetwork(const char *ssid, const char *password);
+    uint8_t networkCount(void) const { return _networkCount; }
+
+    void begin(void);
+    void loop(void);
+    void forgetCache(void);
+
+    // Called from the matching WiFi event handlers.
+    void onConnected(void);
+    void onGotIP(void);
+    void onDisconnected(void);
+
+    WifiConnectMode connectMode(void) const { return _mode; }
+    long associationTime(void) const { return _associationTime; }
+    long dhcpTime(void) const { return _dhcpTime; }
+
+private:
+    enum State
+    {
+        STATE_IDLE,
+        STATE_CONNECTING,
+        STATE_CONNECTED,
+        STATE_SCANNING,
+        STATE_WAITING
+    };
+
+    // A configured network seen by the last scan.
+    struct Candidate
+    {
+        uint8_t network;
+        uint8_t bssid[6];
+        int32_t channel;
+        int32_t rssi;
+    };
+
+    void connect(uint8_t network, const uint8_t *bssid, int32_t channel, WifiConnectMode mode);
+    void connectCandidate(void);
+    void startScan(bool roaming);
+    void finishScan(int count);
+    void saveCache(void);
+    int findNetwork(const char *ssid) const;
+
+    WifiCache _cache;
+    ConfigNetwork _networks[WIFI_STATION_MAX_NETWORKS];
+    uint8_t _networkCount;
+
+    Candidate _candidates[WIFI_STATION_MAX_NETWORKS];
+    uint8_t _candidateCount;
+    uint8_t _nextCandidate;
+
+    State _state;
+    WifiConnectMode _mode;
+    bool _roaming;
+    bool _associated;
+    bool _cachePending;
+
+    unsigned long _connectStartMillis;
+    unsigned long _associatedMillis;
+    unsigned long _scanStartMillis;
+    unsigned long _lastScanMillis;
+    long _associationTime;
+    long _dhcpTime;
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include <Arduino.h>
+#include <Ticker.h>
+
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static int pinValues[SHIM_PIN_COUNT];
+static int analogValue = 512;
+static unsigned long millisOffset = 0;
+static uint32_t rtcMemory[128];
+
+static std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+static bool clockFrozen = false;
+static std::chrono::steady_clock::duration frozenElapsed;
+
+static std::chrono::steady_clock::duration elapsedTime(void)
+{
+    return clockFrozen ? frozenElapsed : std::chrono::steady_clock::now() - startTime;
+}
+
+unsigned long millis(void)
+{
+    auto elapsed = elapsedTime();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() + millisOffset;
+}
+
+unsigned long micros(void)
+{
+    auto elapsed = elapsedTime();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + millisOffset * 1000UL;
+}
+
+void delay(unsigned long ms)
+{
+    if (clockFrozen)
+    {
+        millisOffset += ms;
+    }
+    else
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+    shim_runTickers();
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield(void)
+{
+    shim_runTickers();
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin < SHIM_PIN_COUNT && mode == INPUT_PULLUP)
+    {
+        pinValues[pin] = HIGH;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (pin < SHIM_PIN_COUNT)
+    {
+        pinValues[pin] = value ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    return pin < SHIM_PIN_COUNT ? pinValues[pin] : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+    (void)pin;
+    return analogValue;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode)
+{
+    (void)pin;
+    (void)handler;
+    (void)mode;
+}
+
+void detachInterrupt(uint8_t pin)
+{
+    (void)pin;
+}
+
+long random(long max)
+{
+    return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max)
+{
+    return min + random(max - min);
+}
+
+void shim_setAnalogValue(int value)
+{
+    analogValue = value;
+}
+
+void shim_setDigitalValue(uint8_t pin, int value)
+{
+    digitalWrite(pin, (uint8_t)value);
+}
+
+void shim_advanceMillis(unsigned long ms)
+{
+    millisOffset += ms;
+    shim_runTickers();
+}
+
+void shim_freezeClock(bool frozen)
+{
+    if (frozen && !clockFrozen)
+    {
+        frozenElapsed = std::chrono::steady_clock::now() - startTime;
+    }
+    else if (!frozen && clockFrozen)
+    {
+        startTime = std::chrono::steady_clock::now() - frozenElapsed;
+    }
+    clockFrozen = frozen;
+}
+
+void EspClass::restart(void)
+{
+    Serial.println("[Shim] ESP.restart()");
+    exit(0);
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size)
+{
+    if (offset * 4 + size > sizeof(rtcMemory))
+    {
+        return false;
+    }
+    memcpy(data, (uint8_t *)rtcMemory + offset * 4, size);
+    return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size)
+{
+    if (offset * 4 + size > sizeof(rtcMemory))
+    {
+        return false;
+    }
+    memcpy((uint8_t *)rtcMemory + offset * 4, data, size);
+    return true;
+}
+
+#if !defined(SHIM_NO_MAIN) && !defined(PIO_UNIT_TESTING)
+void setup(void);
+void loop(void);
+
+/*
+ * Runs the sketch like the core does. SHIM_LOOPS limits the number of
+ * loop() iterations so the firmware can be used in scripted runs.
+ */
+int main(void)
+{
+    const char *loops = getenv("SHIM_LOOPS");
+    long remaining = loops ? atol(loops) : -1;
+
+    setup();
+    while (remaining != 0)
+    {
+        loop();
+        delay(1);
+        if (remaining > 0)
+        {
+            remaining--;
+        }
+    }
+    return 0;
+}
+#endif
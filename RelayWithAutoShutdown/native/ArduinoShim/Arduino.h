@@ -0,0 +1,121 @@
+#ifndef SHIM_ARDUINO_H
+#define SHIM_ARDUINO_H
+
+/*
+ * Minimal host (native) replacement for the ESP8266 Arduino core.
+ * Provides just enough of the API for the firmware in src/ to compile and
+ * run on Linux. Pins and the ADC are backed by plain arrays which tests and
+ * benchmarks can drive through the shim_* helpers.
+ *
+ * main() runs setup() and loop() like the core; SHIM_LOOPS=<n> stops after
+ * n loops; the unit tests in test/ bring their own main(). LittleFS lives
+ * in the host directory SHIM_FS_ROOT (./data).
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <strings.h>
+
+#include "WString.h"
+#include "Print.h"
+
+/* -------------------------------------------------- */
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper *>(p))
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+#define strlen_P strlen
+#define strncmp_P strncmp
+#define strcmp_P strcmp
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+
+/* -------------------------------------------------- */
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x00
+#define INPUT_PULLUP 0x02
+#define OUTPUT 0x01
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define D0 16
+#define D1 5
+#define D2 4
+#define D3 0
+#define D4 2
+#define D5 14
+#define D6 12
+#define D7 13
+#define D8 15
+#define A0 17
+
+#define LED_BUILTIN 2
+#define LED_BUILTIN_AUX 16
+
+#define SHIM_PIN_COUNT 18
+
+/* -------------------------------------------------- */
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield(void);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+long random(long max);
+long random(long min, long max);
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+/* Host-side hooks used by tests and benchmarks. */
+void shim_setAnalogValue(int value);
+void shim_setDigitalValue(uint8_t pin, int value);
+void shim_advanceMillis(unsigned long ms);
+// Stops the host clock: millis() then only moves with shim_advanceMillis()
+// and delay(), so runs are repeatable.
+void shim_freezeClock(bool frozen);
+
+/* -------------------------------------------------- */
+
+class EspClass
+{
+public:
+    uint32_t getChipId(void) { return 0x00C0FFEE; }
+    uint32_t getFreeHeap(void) { return 40 * 1024; }
+    uint32_t getMaxFreeBlockSize(void) { return 32 * 1024; }
+    uint8_t getHeapFragmentation(void) { return 0; }
+    uint32_t getFreeSketchSpace(void) { return 1024 * 1024; }
+    void restart(void);
+    void reset(void) { restart(); }
+
+    bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size);
+    bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size);
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef SHIM_ESP8266HTTPUPDATESERVER_H
+#define SHIM_ESP8266HTTPUPDATESERVER_H
+
+#include "ESP8266WebServer.h"
+
+class ESP8266HTTPUpdateServer
+{
+public:
+    void setup(ESP8266WebServer *server) { (void)server; }
+    void setup(ESP8266WebServer *server, const String &path) { (void)server, (void)path; }
+};
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef SHIM_ESP8266WEBSERVER_H
+#define SHIM_ESP8266WEBSERVER_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ESP8266WiFi.h"
+
+enum HTTPMethod
+{
+    HTTP_ANY,
+    HTTP_GET,
+    HTTP_HEAD,
+    HTTP_POST,
+    HTTP_PUT,
+    HTTP_PATCH,
+    HTTP_DELETE,
+    HTTP_OPTIONS
+};
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+/*
+ * Fake web server: routes are registered as usual and requests are injected
+ * with shim_request(). The raw HTTP response (status line, headers, body) is
+ * written to the request's WiFiClient so tests can inspect it.
+ */
+class ESP8266WebServer
+{
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    ESP8266WebServer(int port = 80) : _port(port) {}
+
+    void begin(void) {}
+    void begin(uint16_t port) { _port = port; }
+    void close(void) {}
+    void stop(void) {}
+    void handleClient(void) {}
+
+    void on(const String &uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const String &uri, HTTPMethod method, THandlerFunction handler) { _routes.push_back(Route{uri, method, handler}); }
+    void onNotFound(THandlerFunction handler) { _notFound = handler; }
+
+    void collectHeaders(const char *headerKeys[], size_t count)
+    {
+        (void)headerKeys;
+        (void)count;
+    }
+
+    HTTPMethod method(void) { return _method; }
+    String uri(void) { return _uri; }
+    WiFiClient &client(void) { return _client; }
+
+    String arg(const String &name)
+    {
+        for (auto &a : _args)
+        {
+            if (a.first == name)
+            {
+                return a.second;
+            }
+        }
+        return String();
+    }
+    String arg(int index) { return index < (int)_args.size() ? _args[index].second : String(); }
+    String argName(int index) { return index < (int)_args.size() ? _args[index].first : String(); }
+    int args(void) { return (int)_args.size(); }
+    bool hasArg(const String &name)
+    {
+        for (auto &a : _args)
+        {
+            if (a.first == name)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    String header(const String &name)
+    {
+        auto it = _requestHeaders.find(std::string(name.c_str()));
+        return it == _requestHeaders.end() ? String() : String(it->second);
+    }
+    bool hasHeader(const String &name) { return _requestHeaders.count(std::string(name.c_str())) > 0; }
+
+    void sendHeader(const String &name, const String &value, bool first = false)
+    {
+        std::string line = std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+        if (first)
+        {
+            _responseHeaders = line + _responseHeaders;
+        }
+        else
+        {
+            _responseHeaders += line;
+        }
+    }
+    void setContentLength(size_t length) { _contentLength = length; }
+
+    void send(int code) { send(code, nullptr, nullptr, 0); }
+    void send(int code, const char *contentType, const String &content) { send(code, contentType, content.c_str(), content.length()); }
+    void send(int code, const String &contentType, const String &content) { send(code, contentType.c_str(), content.c_str(), content.length()); }
+    void send(int code, const char *contentType, const char *content) { send(code, contentType, content, content ? strlen(content) : 0); }
+    void send(int code, const char *contentType, const char *content, size_t length)
+    {
+        _writeHead(code, contentType, length);
+        _client.write(content, length);
+    }
+    void send_P(int code, PGM_P contentType, PGM_P content, size_t length) { send(code, contentType, content, length); }
+    void send_P(int code, PGM_P contentType, PGM_P content) { send(code, contentType, content); }
+
+    void sendContent(const String &content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char *content) { sendContent(content, strlen(content)); }
+    void sendContent(const char *content, size_t length)
+    {
+        if (_chunked)
+        {
+            char head[16];
+            snprintf(head, sizeof(head), "%zX\r\n", length);
+            _client.write(head);
+            _client.write(content, length);
+            _client.write("\r\n");
+            if (length == 0)
+            {
+                _chunked = false;
+            }
+        }
+        else
+        {
+            _client.write(content, length);
+        }
+    }
+    void sendContent_P(PGM_P content) { sendContent(content); }
+    void sendContent_P(PGM_P content, size_t length) { sendContent(content, length); }
+
+    /* Host-side hook: dispatch a request and return the raw response. */
+    std::string shim_request(HTTPMethod method, const char *uri,
+                             const std::vector<std::pair<String, String>> &args = {},
+                             const std::map<std::string, std::string> &headers = {})
+    {
+        _method = method;
+        _uri = uri;
+        _args = args;
+        _requestHeaders = headers;
+        _responseHeaders.clear();
+        _contentLength = CONTENT_LENGTH_NOT_SET;
+        _chunked = false;
+        _client = WiFiClient::shim_create();
+
+        for (auto &route : _routes)
+        {
+            if (route.uri == _uri && (route.method == HTTP_ANY || route.method == method))
+            {
+                route.handler();
+                return _client.shim_output();
+            }
+        }
+        if (_notFound)
+        {
+            _notFound();
+        }
+        return _client.shim_output();
+    }
+
+private:
+    struct Route
+    {
+        String uri;
+        HTTPMethod method;
+        THandlerFunction handler;
+    };
+
+    void _writeHead(int code, const char *contentType, size_t length)
+    {
+        char line[64];
+        snprintf(line, sizeof(line), "HTTP/1.1 %d\r\n", code);
+        std::string head = line;
+        if (contentType && *contentType)
+        {
+            head += std::string("Content-Type: ") + contentType + "\r\n";
+        }
+        if (_contentLength == CONTENT_LENGTH_UNKNOWN)
+        {
+            head += "Transfer-Encoding: chunked\r\n";
+            _chunked = true;
+        }
+        else
+        {
+            size_t n = (_contentLength == CONTENT_LENGTH_NOT_SET) ? length : _contentLength;
+            head += "Content-Length: " + std::to_string(n) + "\r\n";
+        }
+        head += _responseHeaders + "\r\n";
+        _client.write(head.c_str(), head.size());
+        _contentLength = CONTENT_LENGTH_NOT_SET;
+    }
+
+    int _port;
+    std::vector<Route> _routes;
+    THandlerFunction _notFound;
+
+    HTTPMethod _method = HTTP_GET;
+    String _uri;
+    std::vector<std::pair<String, String>> _args;
+    std::map<std::string, std::string> _requestHeaders;
+    std::string _responseHeaders;
+    size_t _contentLength = CONTENT_LENGTH_NOT_SET;
+    bool _chunked = false;
+    WiFiClient _client;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#include <ESP8266WiFi.h>
+
+ESP8266WiFiClass WiFi;
+
+wl_status_t ESP8266WiFiClass::begin(const String &ssid, const String &password, int32_t channel, const uint8_t *bssid, bool connect)
+{
+    (void)channel;
+    if (bssid != nullptr)
+    {
+        memcpy(_bssid, bssid, sizeof(_bssid));
+    }
+
+    _ssid = ssid;
+    _password = password;
+    if (!connect)
+    {
+        return _status;
+    }
+
+    bool reachable = _reachable;
+    for (const String &name : _unreachable)
+    {
+        reachable = reachable && !(name == ssid);
+    }
+    if (!reachable)
+    {
+        _status = WL_NO_SSID_AVAIL;
+        WiFiEventStationModeDisconnected event = {ssid, {0}, 201};
+        _fire(_onDisconnected, event);
+        return _status;
+    }
+
+    _status = WL_CONNECTED;
+    WiFiEventStationModeConnected connected = {ssid, {_bssid[0], _bssid[1], _bssid[2], _bssid[3], _bssid[4], _bssid[5]}, 6};
+    _fire(_onConnected, connected);
+
+    if (!_localIP.isSet())
+    {
+        _localIP = IPAddress(192, 168, 1, 100);
+        _gatewayIP = IPAddress(192, 168, 1, 1);
+        _subnetMask = IPAddress(255, 255, 255, 0);
+        _dnsIP = IPAddress(192, 168, 1, 1);
+    }
+    WiFiEventStationModeGotIP gotIP = {_localIP, _subnetMask, _gatewayIP};
+    _fire(_onGotIP, gotIP);
+    return _status;
+}
+
+bool ESP8266WiFiClass::disconnect(bool wifioff)
+{
+    (void)wifioff;
+    if (_status == WL_CONNECTED)
+    {
+        _status = WL_DISCONNECTED;
+        WiFiEventStationModeDisconnected event = {_ssid, {0}, 8};
+        _fire(_onDisconnected, event);
+    }
+    return true;
+}
@@ -0,0 +1,273 @@
+#ifndef SHIM_ESP8266WIFI_H
+#define SHIM_ESP8266WIFI_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+
+typedef enum
+{
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_WRONG_PASSWORD = 6,
+    WL_DISCONNECTED = 7
+} wl_status_t;
+
+typedef enum
+{
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} WiFiMode_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+struct WiFiEventSoftAPModeStationConnected
+{
+    uint8_t mac[6];
+    uint8_t aid;
+};
+
+struct WiFiEventSoftAPModeStationDisconnected
+{
+    uint8_t mac[6];
+    uint8_t aid;
+};
+
+struct WiFiEventStationModeConnected
+{
+    String ssid;
+    uint8_t bssid[6];
+    uint8_t channel;
+};
+
+struct WiFiEventStationModeGotIP
+{
+    IPAddress ip;
+    IPAddress mask;
+    IPAddress gw;
+};
+
+struct WiFiEventStationModeDisconnected
+{
+    String ssid;
+    uint8_t bssid[6];
+    uint8_t reason;
+};
+
+struct WiFiEventStationModeAuthModeChanged
+{
+    uint8_t oldMode;
+    uint8_t newMode;
+};
+
+typedef std::shared_ptr<void> WiFiEventHandler;
+
+/*
+ * Host WiFi: the station "connects" on begin() and the registered event
+ * handlers are fired synchronously so the firmware sees the usual sequence.
+ */
+class ESP8266WiFiClass
+{
+public:
+    bool mode(WiFiMode_t mode)
+    {
+        _mode = mode;
+        return true;
+    }
+    WiFiMode_t getMode(void) { return _mode; }
+    bool setAutoConnect(bool autoConnect) { return (void)autoConnect, true; }
+    bool setAutoReconnect(bool autoReconnect) { return (void)autoReconnect, true; }
+    bool persistent(bool persistent) { return (void)persistent, true; }
+    bool setHostname(const char *name)
+    {
+        _hostname = name;
+        return true;
+    }
+    bool hostname(const String &name) { return setHostname(name.c_str()); }
+    String hostname(void) { return _hostname; }
+    String macAddress(void) { return String("5C:CF:7F:C0:FF:EE"); }
+
+    wl_status_t begin(const String &ssid, const String &password, int32_t channel = 0, const uint8_t *bssid = nullptr, bool connect = true);
+    wl_status_t begin(const char *ssid, const char *password, int32_t channel = 0, const uint8_t *bssid = nullptr, bool connect = true)
+    {
+        return begin(String(ssid), String(password), channel, bssid, connect);
+    }
+    bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress())
+    {
+        (void)dns2;
+        _localIP = local;
+        _gatewayIP = gateway;
+        _subnetMask = subnet;
+        _dnsIP = dns1;
+        return true;
+    }
+    bool disconnect(bool wifioff = false);
+    bool reconnect(void) { return begin(_ssid, _password) == WL_CONNECTED; }
+    bool isConnected(void) { return _status == WL_CONNECTED; }
+    wl_status_t status(void) { return _status; }
+
+    String SSID(void) { return _ssid; }
+    String psk(void) { return _password; }
+    uint8_t *BSSID(void) { return _bssid; }
+    String BSSIDstr(void) { return String("02:00:00:00:00:01"); }
+    int32_t channel(void) { return 6; }
+    int32_t RSSI(void) { return _rssi; }
+    IPAddress localIP(void) { return _localIP; }
+    IPAddress gatewayIP(void) { return _gatewayIP; }
+    IPAddress subnetMask(void) { return _subnetMask; }
+    IPAddress dnsIP(uint8_t index = 0) { return (void)index, _dnsIP; }
+
+    bool softAPConfig(IPAddress local, IPAddress gateway, IPAddress subnet)
+    {
+        (void)gateway;
+        (void)subnet;
+        _softAPIP = local;
+        return true;
+    }
+    bool softAP(const String &ssid, const String &password = String())
+    {
+        (void)password;
+        _softAPSSID = ssid;
+        return true;
+    }
+    bool softAP(const char *ssid, const char *password = nullptr) { return softAP(String(ssid), String(password)); }
+    bool softAPdisconnect(bool wifioff = false)
+    {
+        (void)wifioff;
+        _softAPSSID = String();
+        return true;
+    }
+    IPAddress softAPIP(void) { return _softAPIP; }
+    String softAPSSID(void) { return _softAPSSID; }
+    uint8_t softAPgetStationNum(void) { return _softAPStations; }
+
+    int8_t scanNetworks(bool async = false, bool showHidden = false)
+    {
+        (void)showHidden;
+        return async ? WIFI_SCAN_RUNNING : (int8_t)_scanResults.size();
+    }
+    void scanNetworksAsync(std::function<void(int)> onComplete, bool showHidden = false)
+    {
+        (void)showHidden;
+        onComplete((int)_scanResults.size());
+    }
+    int8_t scanComplete(void)
+    {
+        // An async scan finishes on the first poll.
+        return (int8_t)_scanResults.size();
+    }
+    void scanDelete(void) {}
+    String SSID(uint8_t index) { return index < _scanResults.size() ? _scanResults[index].ssid : String(); }
+    int32_t RSSI(uint8_t index) { return index < _scanResults.size() ? _scanResults[index].rssi : -100; }
+    uint8_t *BSSID(uint8_t index) { return index < _scanResults.size() ? _scanResults[index].bssid : _bssid; }
+    int32_t channel(uint8_t index) { return index < _scanResults.size() ? _scanResults[index].channel : 1; }
+
+    WiFiEventHandler onSoftAPModeStationConnected(std::function<void(const WiFiEventSoftAPModeStationConnected &)> f) { return _add(_onSoftAPConnected, f); }
+    WiFiEventHandler onSoftAPModeStationDisconnected(std::function<void(const WiFiEventSoftAPModeStationDisconnected &)> f) { return _add(_onSoftAPDisconnected, f); }
+    WiFiEventHandler onStationModeConnected(std::function<void(const WiFiEventStationModeConnected &)> f) { return _add(_onConnected, f); }
+    WiFiEventHandler onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP &)> f) { return _add(_onGotIP, f); }
+    WiFiEventHandler onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected &)> f) { return _add(_onDisconnected, f); }
+    WiFiEventHandler onStationModeAuthModeChanged(std::function<void(const WiFiEventStationModeAuthModeChanged &)> f) { return _add(_onAuthModeChanged, f); }
+    WiFiEventHandler onStationModeDHCPTimeout(std::function<void(void)> f) { return _add(_onDHCPTimeout, f); }
+
+    /* Host-side hook: make the next begin() fail, or drop the current link. */
+    void shim_setReachable(bool reachable) { _reachable = reachable; }
+    void shim_setReachable(const String &ssid, bool reachable)
+    {
+        for (size_t i = 0; i < _unreachable.size(); i++)
+        {
+            if (_unreachable[i] == ssid)
+            {
+                _unreachable.erase(_unreachable.begin() + i);
+                break;
+            }
+        }
+        if (!reachable)
+        {
+            _unreachable.push_back(ssid);
+        }
+    }
+    void shim_setRSSI(int32_t rssi) { _rssi = rssi; }
+    /* Host-side hook: clients associated with the SoftAP. */
+    void shim_setSoftAPStations(uint8_t count) { _softAPStations = count; }
+
+    /* Host-side hook: access points returned by the next scans. */
+    void shim_addScanResult(const String &ssid, int32_t rssi, int32_t channel, uint8_t bssidLast)
+    {
+        ShimScanResult result = {ssid, rssi, channel, {0x02, 0, 0, 0, 0, bssidLast}};
+        _scanResults.push_back(result);
+    }
+    void shim_clearScanResults(void) { _scanResults.clear(); }
+
+private:
+    struct ShimScanResult
+    {
+        String ssid;
+        int32_t rssi;
+        int32_t channel;
+        uint8_t bssid[6];
+    };
+
+    template <typename T>
+    WiFiEventHandler _add(std::vector<std::shared_ptr<std::function<T>>> &list, std::function<T> f)
+    {
+        std::shared_ptr<std::function<T>> handler = std::make_shared<std::function<T>>(f);
+        list.push_back(handler);
+        return handler;
+    }
+
+    template <typename T, typename... A>
+    void _fire(std::vector<std::shared_ptr<std::function<T>>> &list, A &&...args)
+    {
+        for (auto &handler : list)
+        {
+            if (handler.use_count() > 1)
+            {
+                (*handler)(args...);
+            }
+        }
+    }
+
+    WiFiMode_t _mode = WIFI_OFF;
+    wl_status_t _status = WL_DISCONNECTED;
+    bool _reachable = true;
+    int32_t _rssi = -60;
+    String _hostname;
+    String _ssid;
+    String _password;
+    String _softAPSSID;
+    uint8_t _softAPStations = 0;
+    uint8_t _bssid[6] = {0x02, 0, 0, 0, 0, 0x01};
+    std::vector<ShimScanResult> _scanResults;
+    std::vector<String> _unreachable;
+    IPAddress _localIP;
+    IPAddress _gatewayIP;
+    IPAddress _subnetMask;
+    IPAddress _dnsIP;
+    IPAddress _softAPIP;
+
+    std::vector<std::shared_ptr<std::function<void(const WiFiEventSoftAPModeStationConnected &)>>> _onSoftAPConnected;
+    std::vector<std::shared_ptr<std::function<void(const WiFiEventSoftAPModeStationDisconnected &)>>> _onSoftAPDisconnected;
+    std::vector<std::shared_ptr<std::function<void(const WiFiEventStationModeConnected &)>>> _onConnected;
+    std::vector<std::shared_ptr<std::function<void(const WiFiEventStationModeGotIP &)>>> _onGotIP;
+    std::vector<std::shared_ptr<std::function<void(const WiFiEventStationModeDisconnected &)>>> _onDisconnected;
+    std::vector<std::shared_ptr<std::function<void(const WiFiEventStationModeAuthModeChanged &)>>> _onAuthModeChanged;
+    std::vector<std::shared_ptr<std::function<void(void)>>> _onDHCPTimeout;
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif
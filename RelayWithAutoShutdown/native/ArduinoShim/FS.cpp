@@ -0,0 +1,77 @@
+#include <FS.h>
+#include <LittleFS.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+fs::FS LittleFS;
+
+namespace fs
+{
+
+std::string FS::_path(const char *path)
+{
+    const char *root = getenv("SHIM_FS_ROOT");
+    std::string full = root ? root : "./data";
+    if (path[0] != '/')
+    {
+        full += "/";
+    }
+    return full + path;
+}
+
+bool FS::begin(void)
+{
+    std::string root = _path("");
+    mkdir(root.c_str(), 0755);
+    struct stat st;
+    return stat(root.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool FS::format(void)
+{
+    return false;
+}
+
+bool FS::info(FSInfo &info)
+{
+    info.totalBytes = 1024 * 1024;
+    info.usedBytes = 0;
+    info.blockSize = 8192;
+    info.pageSize = 256;
+    info.maxOpenFiles = 5;
+    info.maxPathLength = 32;
+    return true;
+}
+
+File FS::open(const char *path, const char *mode)
+{
+    std::string m = mode;
+    if (m.find('b') == std::string::npos)
+    {
+        m += "b";
+    }
+    FILE *fp = fopen(_path(path).c_str(), m.c_str());
+    if (!fp)
+    {
+        return File();
+    }
+    return File(fp, String(path));
+}
+
+bool FS::exists(const char *path)
+{
+    return access(_path(path).c_str(), F_OK) == 0;
+}
+
+bool FS::remove(const char *path)
+{
+    return ::remove(_path(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to)
+{
+    return ::rename(_path(from).c_str(), _path(to).c_str()) == 0;
+}
+
+} // namespace fs
@@ -0,0 +1,136 @@
+#ifndef SHIM_FS_H
+#define SHIM_FS_H
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "Arduino.h"
+
+namespace fs
+{
+
+enum SeekMode
+{
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+/*
+ * File backed by a host stdio FILE. Closing is reference counted the same
+ * way as the ESP8266 core so copies of a File share one handle.
+ */
+class File : public Stream
+{
+public:
+    File(void) {}
+    File(FILE *fp, const String &name) : _fp(std::shared_ptr<FILE>(fp, fclose)), _name(name) {}
+
+    operator bool(void) const { return (bool)_fp; }
+    void close(void) { _fp.reset(); }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override { return _fp ? fwrite(buffer, 1, size, _fp.get()) : 0; }
+    using Print::write;
+    void flush(void) override
+    {
+        if (_fp)
+        {
+            fflush(_fp.get());
+        }
+    }
+
+    int available(void) override
+    {
+        if (!_fp)
+        {
+            return 0;
+        }
+        long pos = ftell(_fp.get());
+        return (int)(size() - (size_t)pos);
+    }
+    int read(void) override { return _fp ? fgetc(_fp.get()) : -1; }
+    int read(uint8_t *buffer, size_t size) { return _fp ? (int)fread(buffer, 1, size, _fp.get()) : -1; }
+    size_t readBytes(char *buffer, size_t length) override { return _fp ? fread(buffer, 1, length, _fp.get()) : 0; }
+    int peek(void) override
+    {
+        if (!_fp)
+        {
+            return -1;
+        }
+        int c = fgetc(_fp.get());
+        if (c != EOF)
+        {
+            ungetc(c, _fp.get());
+        }
+        return c;
+    }
+
+    bool seek(uint32_t pos, SeekMode mode = SeekSet) { return _fp && fseek(_fp.get(), (long)pos, (int)mode) == 0; }
+    size_t position(void) const { return _fp ? (size_t)ftell(_fp.get()) : 0; }
+    size_t size(void) const
+    {
+        if (!_fp)
+        {
+            return 0;
+        }
+        long pos = ftell(_fp.get());
+        fseek(_fp.get(), 0, SEEK_END);
+        long end = ftell(_fp.get());
+        fseek(_fp.get(), pos, SEEK_SET);
+        return (size_t)end;
+    }
+    const char *name(void) const { return _name.c_str(); }
+
+private:
+    std::shared_ptr<FILE> _fp;
+    String _name;
+};
+
+struct FSInfo
+{
+    size_t totalBytes;
+    size_t usedBytes;
+    size_t blockSize;
+    size_t pageSize;
+    size_t maxOpenFiles;
+    size_t maxPathLength;
+};
+
+/*
+ * File system rooted at a host directory. The root defaults to "./data" and
+ * can be moved with the SHIM_FS_ROOT environment variable.
+ */
+class FS
+{
+public:
+    bool begin(void);
+    void end(void) {}
+    bool format(void);
+    bool info(FSInfo &info);
+
+    File open(const char *path, const char *mode);
+    File open(const String &path, const char *mode) { return open(path.c_str(), mode); }
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path);
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char *from, const char *to);
+    bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+
+private:
+    std::string _path(const char *path);
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::FSInfo;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
+
+#endif
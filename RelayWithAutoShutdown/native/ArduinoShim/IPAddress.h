@@ -0,0 +1,40 @@
+#ifndef SHIM_IPADDRESS_H
+#define SHIM_IPADDRESS_H
+
+#include "Arduino.h"
+
+class IPAddress
+{
+public:
+    IPAddress(void) : _address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+    IPAddress(uint32_t address) : _address(address) {}
+
+    operator uint32_t(void) const { return _address; }
+    uint8_t operator[](int index) const { return (uint8_t)(_address >> (8 * index)); }
+    bool isSet(void) const { return _address != 0; }
+
+    bool fromString(const char *str)
+    {
+        unsigned int a, b, c, d;
+        if (sscanf(str, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255)
+        {
+            return false;
+        }
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+    bool fromString(const String &str) { return fromString(str.c_str()); }
+
+    String toString(void) const
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+        return String(buf);
+    }
+
+private:
+    uint32_t _address;
+};
+
+#endif
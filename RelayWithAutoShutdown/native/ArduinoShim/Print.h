@@ -0,0 +1,118 @@
+#ifndef SHIM_PRINT_H
+#define SHIM_PRINT_H
+
+#include <cstdarg>
+#include <cstdio>
+#include "WString.h"
+
+class Print
+{
+public:
+    virtual ~Print(void) {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size--)
+        {
+            n += write(*buffer++);
+        }
+        return n;
+    }
+    size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    virtual void flush(void) {}
+
+    size_t print(const String &str) { return write(str.c_str(), str.length()); }
+    size_t print(const char *str) { return write(str); }
+    size_t print(const __FlashStringHelper *str) { return write(reinterpret_cast<const char *>(str)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value) { return print(String(value)); }
+    size_t print(unsigned int value) { return print(String(value)); }
+    size_t print(long value) { return print(String(value)); }
+    size_t print(unsigned long value) { return print(String(value)); }
+    size_t print(double value, int decimals = 2) { return print(String(value, (unsigned char)decimals)); }
+
+    template <typename T>
+    size_t println(const T &value)
+    {
+        size_t n = print(value);
+        return n + println();
+    }
+    size_t println(void) { return write("\r\n"); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char buf[512];
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        if (len < 0)
+        {
+            return 0;
+        }
+        return write(buf, (size_t)len < sizeof(buf) ? (size_t)len : sizeof(buf) - 1);
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) = 0;
+
+    virtual size_t readBytes(char *buffer, size_t length)
+    {
+        size_t n = 0;
+        while (n < length && available() > 0)
+        {
+            buffer[n++] = (char)read();
+        }
+        return n;
+    }
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+
+    String readString(void)
+    {
+        String str;
+        int c;
+        while ((c = read()) >= 0)
+        {
+            str.concat((char)c);
+        }
+        return str;
+    }
+    String readStringUntil(char terminator)
+    {
+        String str;
+        int c;
+        while ((c = read()) >= 0 && c != terminator)
+        {
+            str.concat((char)c);
+        }
+        return str;
+    }
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+
+protected:
+    unsigned long _timeout = 1000;
+};
+
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t *buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+    int available(void) override { return 0; }
+    int read(void) override { return -1; }
+    int peek(void) override { return -1; }
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif
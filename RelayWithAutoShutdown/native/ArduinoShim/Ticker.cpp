@@ -0,0 +1,50 @@
+#include "Ticker.h"
+
+static Ticker *tickers = NULL;
+
+Ticker::Ticker(void) : _interval(0), _lastMillis(0), _next(tickers)
+{
+    tickers = this;
+}
+
+Ticker::~Ticker(void)
+{
+    for (Ticker **link = &tickers; *link != NULL; link = &(*link)->_next)
+    {
+        if (*link == this)
+        {
+            *link = _next;
+            break;
+        }
+    }
+}
+
+void Ticker::attach_ms(uint32_t milliseconds, callback_function_t callback)
+{
+    _interval = milliseconds > 0 ? milliseconds : 1;
+    _lastMillis = millis();
+    _callback = callback;
+}
+
+void Ticker::detach(void)
+{
+    _interval = 0;
+    _callback = NULL;
+}
+
+void Ticker::run(void)
+{
+    while (_interval != 0 && (millis() - _lastMillis) >= _interval)
+    {
+        _lastMillis += _interval;
+        _callback();
+    }
+}
+
+void shim_runTickers(void)
+{
+    for (Ticker *ticker = tickers; ticker != NULL; ticker = ticker->_next)
+    {
+        ticker->run();
+    }
+}
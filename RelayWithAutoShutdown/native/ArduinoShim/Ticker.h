@@ -0,0 +1,48 @@
+#ifndef SHIM_TICKER_H
+#define SHIM_TICKER_H
+
+#include "Arduino.h"
+
+#include <functional>
+
+/*
+ * Ticker on the host. Like the SDK timers, callbacks never interrupt the
+ * sketch: due ones run from delay(), yield() and shim_advanceMillis(), once
+ * per elapsed period.
+ */
+class Ticker
+{
+public:
+    typedef std::function<void(void)> callback_function_t;
+
+    Ticker(void);
+    ~Ticker(void);
+
+    void attach_ms(uint32_t milliseconds, callback_function_t callback);
+
+    template <typename TArg>
+    void attach_ms(uint32_t milliseconds, void (*callback)(TArg), TArg arg)
+    {
+        attach_ms(milliseconds, [callback, arg]() { callback(arg); });
+    }
+
+    void attach(float seconds, callback_function_t callback) { attach_ms((uint32_t)(seconds * 1000), callback); }
+
+    void detach(void);
+    bool active(void) const { return _interval != 0; }
+
+    void run(void);
+
+private:
+    uint32_t _interval;
+    unsigned long _lastMillis;
+    callback_function_t _callback;
+    Ticker *_next;
+
+    friend void shim_runTickers(void);
+};
+
+/* Runs the callbacks of every attached Ticker that are due. */
+void shim_runTickers(void);
+
+#endif
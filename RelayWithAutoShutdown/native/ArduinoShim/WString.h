@@ -0,0 +1,192 @@
+#ifndef SHIM_WSTRING_H
+#define SHIM_WSTRING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+class __FlashStringHelper;
+
+/*
+ * Host replacement for the Arduino String class, backed by std::string.
+ * Only the members used by the firmware are provided.
+ */
+class String
+{
+public:
+    String(void) {}
+    String(const char *str) : _str(str ? str : "") {}
+    String(const char *str, size_t length) : _str(str, length) {}
+    String(const __FlashStringHelper *str) : _str(reinterpret_cast<const char *>(str)) {}
+    String(const std::string &str) : _str(str) {}
+    explicit String(char c) : _str(1, c) {}
+    explicit String(int value, unsigned char base = 10) { _fromLong(value, base); }
+    explicit String(unsigned int value, unsigned char base = 10) { _fromULong(value, base); }
+    explicit String(long value, unsigned char base = 10) { _fromLong(value, base); }
+    explicit String(unsigned long value, unsigned char base = 10) { _fromULong(value, base); }
+    explicit String(float value, unsigned char decimals = 2) { _fromDouble(value, decimals); }
+    explicit String(double value, unsigned char decimals = 2) { _fromDouble(value, decimals); }
+
+    const char *c_str(void) const { return _str.c_str(); }
+    unsigned int length(void) const { return _str.length(); }
+    bool isEmpty(void) const { return _str.empty(); }
+    bool reserve(unsigned int size)
+    {
+        _str.reserve(size);
+        return true;
+    }
+
+    bool concat(const String &str)
+    {
+        _str += str._str;
+        return true;
+    }
+    bool concat(const char *str)
+    {
+        _str += str;
+        return true;
+    }
+    bool concat(const char *str, unsigned int length)
+    {
+        _str.append(str, length);
+        return true;
+    }
+    bool concat(char c)
+    {
+        _str += c;
+        return true;
+    }
+    bool concat(int value) { return concat(String(value)); }
+    bool concat(unsigned int value) { return concat(String(value)); }
+    bool concat(long value) { return concat(String(value)); }
+    bool concat(unsigned long value) { return concat(String(value)); }
+    bool concat(float value) { return concat(String(value)); }
+
+    template <typename T>
+    String &operator+=(const T &value)
+    {
+        concat(value);
+        return *this;
+    }
+
+    bool equals(const String &str) const { return _str == str._str; }
+    bool equals(const char *str) const { return _str == str; }
+    bool equalsIgnoreCase(const String &str) const { return strcasecmp(_str.c_str(), str.c_str()) == 0; }
+    bool startsWith(const String &prefix) const { return _str.compare(0, prefix._str.size(), prefix._str) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return _str.size() >= suffix._str.size() && _str.compare(_str.size() - suffix._str.size(), suffix._str.size(), suffix._str) == 0;
+    }
+
+    char charAt(unsigned int index) const { return index < _str.size() ? _str[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index) { return _str[index]; }
+
+    int indexOf(char c, unsigned int from = 0) const { return _pos(_str.find(c, from)); }
+    int indexOf(const String &str, unsigned int from = 0) const { return _pos(_str.find(str._str, from)); }
+    int lastIndexOf(char c) const { return _pos(_str.rfind(c)); }
+
+    String substring(unsigned int from) const { return from < _str.size() ? String(_str.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to)
+        {
+            unsigned int t = from;
+            from = to;
+            to = t;
+        }
+        if (from >= _str.size())
+        {
+            return String();
+        }
+        return String(_str.substr(from, to - from));
+    }
+
+    void replace(const String &find, const String &replace)
+    {
+        if (find._str.empty())
+        {
+            return;
+        }
+        size_t pos = 0;
+        while ((pos = _str.find(find._str, pos)) != std::string::npos)
+        {
+            _str.replace(pos, find._str.size(), replace._str);
+            pos += replace._str.size();
+        }
+    }
+    void remove(unsigned int index) { remove(index, (unsigned int)-1); }
+    void remove(unsigned int index, unsigned int count)
+    {
+        if (index < _str.size())
+        {
+            _str.erase(index, count);
+        }
+    }
+    void trim(void)
+    {
+        size_t begin = _str.find_first_not_of(" \t\r\n");
+        size_t end = _str.find_last_not_of(" \t\r\n");
+        _str = (begin == std::string::npos) ? std::string() : _str.substr(begin, end - begin + 1);
+    }
+    void toLowerCase(void)
+    {
+        for (char &c : _str)
+        {
+            c = (char)tolower((unsigned char)c);
+        }
+    }
+
+    long toInt(void) const { return strtol(_str.c_str(), nullptr, 10); }
+    float toFloat(void) const { return strtof(_str.c_str(), nullptr); }
+
+    friend bool operator==(const String &a, const String &b) { return a._str == b._str; }
+    friend bool operator==(const String &a, const char *b) { return a._str == b; }
+    friend bool operator!=(const String &a, const String &b) { return a._str != b._str; }
+    friend bool operator!=(const String &a, const char *b) { return a._str != b; }
+    friend bool operator<(const String &a, const String &b) { return a._str < b._str; }
+    friend String operator+(const String &a, const String &b) { return String(a._str + b._str); }
+    friend String operator+(const String &a, const char *b) { return String(a._str + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b._str); }
+
+private:
+    static int _pos(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+    void _fromLong(long value, unsigned char base)
+    {
+        if (base == 10)
+        {
+            _str = std::to_string(value);
+        }
+        else
+        {
+            _fromULong((unsigned long)value, base);
+        }
+    }
+    void _fromULong(unsigned long value, unsigned char base)
+    {
+        char buf[8 * sizeof(unsigned long) + 1];
+        char *p = buf + sizeof(buf) - 1;
+        *p = '\0';
+        do
+        {
+            unsigned long digit = value % base;
+            *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+            value /= base;
+        } while (value);
+        _str = p;
+    }
+    void _fromDouble(double value, unsigned char decimals)
+    {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+        _str = buf;
+    }
+
+    std::string _str;
+};
+
+#endif
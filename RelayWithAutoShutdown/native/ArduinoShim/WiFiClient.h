@@ -0,0 +1,85 @@
+#ifndef SHIM_WIFICLIENT_H
+#define SHIM_WIFICLIENT_H
+
+#include <memory>
+#include <string>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+/*
+ * In-memory TCP client. Requests are queued with shim_feed() and everything
+ * the firmware writes is collected in shim_output().
+ */
+class WiFiClient : public Stream
+{
+public:
+    WiFiClient(void) {}
+
+    static WiFiClient shim_create(void)
+    {
+        WiFiClient client;
+        client._state = std::make_shared<State>();
+        return client;
+    }
+
+    void shim_feed(const char *data, size_t length) { _state->input.append(data, length); }
+    void shim_feed(const char *data) { shim_feed(data, strlen(data)); }
+    const std::string &shim_output(void) const { return _state->output; }
+    void shim_clearOutput(void) { _state->output.clear(); }
+
+    operator bool(void) const { return _state && _state->connected; }
+    uint8_t connected(void) { return _state && (_state->connected || available() > 0); }
+    void stop(void)
+    {
+        if (_state)
+        {
+            _state->connected = false;
+        }
+    }
+    void setNoDelay(bool noDelay) { (void)noDelay; }
+    void keepAlive(uint16_t idle = 7200, uint16_t intv = 75, uint8_t count = 9) { (void)idle, (void)intv, (void)count; }
+    IPAddress remoteIP(void) { return IPAddress(192, 168, 10, 2); }
+    uint16_t remotePort(void) { return 50000; }
+    size_t availableForWrite(void) { return _state && _state->connected ? 1460 : 0; }
+
+    int available(void) override { return _state ? (int)(_state->input.size() - _state->readPos) : 0; }
+    int read(void) override { return available() > 0 ? (uint8_t)_state->input[_state->readPos++] : -1; }
+    int read(uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (n < size && available() > 0)
+        {
+            buffer[n++] = (uint8_t)read();
+        }
+        return (int)n;
+    }
+    int peek(void) override { return available() > 0 ? (uint8_t)_state->input[_state->readPos] : -1; }
+    void flush(void) override {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        if (!_state || !_state->connected)
+        {
+            return 0;
+        }
+        _state->output.append((const char *)buffer, size);
+        return size;
+    }
+    size_t write_P(PGM_P buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    using Print::write;
+
+private:
+    struct State
+    {
+        std::string input;
+        size_t readPos = 0;
+        std::string output;
+        bool connected = true;
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+#endif
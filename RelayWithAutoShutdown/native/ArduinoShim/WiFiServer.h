@@ -0,0 +1,38 @@
+#ifndef SHIM_WIFISERVER_H
+#define SHIM_WIFISERVER_H
+
+#include <deque>
+
+#include "WiFiClient.h"
+
+class WiFiServer
+{
+public:
+    WiFiServer(uint16_t port) : _port(port) {}
+
+    void begin(void) {}
+    void begin(uint16_t port) { _port = port; }
+    void setNoDelay(bool noDelay) { (void)noDelay; }
+    bool hasClient(void) { return !_pending.empty(); }
+
+    WiFiClient available(void)
+    {
+        if (_pending.empty())
+        {
+            return WiFiClient();
+        }
+        WiFiClient client = _pending.front();
+        _pending.pop_front();
+        return client;
+    }
+    WiFiClient accept(void) { return available(); }
+
+    /* Host-side hook: queue an incoming connection. */
+    void shim_connect(const WiFiClient &client) { _pending.push_back(client); }
+
+private:
+    uint16_t _port;
+    std::deque<WiFiClient> _pending;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef SHIM_WIFIUDP_H
+#define SHIM_WIFIUDP_H
+
+#include "Arduino.h"
+
+/*
+ * UDP with an NTP server behind port 123. A 48-byte request is answered
+ * with the host clock, or with the time pinned by shim_setNtpEpoch(), once
+ * shim_setNtpDelay() milliseconds of millis() have passed; each request
+ * replaces an unanswered one. shim_setNtpStratum(0) makes the server refuse.
+ */
+class WiFiUDP
+{
+public:
+    uint8_t begin(uint16_t port) { return (void)port, 1; }
+    void stop(void) {}
+
+    int beginPacket(const char *host, uint16_t port)
+    {
+        (void)host;
+        _port = port;
+        _written = 0;
+        return 1;
+    }
+    size_t write(const uint8_t *buffer, size_t size)
+    {
+        (void)buffer;
+        _written += size;
+        return size;
+    }
+    int endPacket(void)
+    {
+        if (_port == 123 && _written >= 48)
+        {
+            _answerPending = true;
+            _answerMillis = millis() + _ntpDelay;
+        }
+        return 1;
+    }
+
+    int parsePacket(void)
+    {
+        if (!_answerPending || (long)(millis() - _answerMillis) < 0)
+        {
+            return 0;
+        }
+        _answerPending = false;
+
+        uint32_t seconds = (uint32_t)((_ntpEpoch ? _ntpEpoch : (unsigned long)time(nullptr)) + 2208988800UL);
+        memset(_packet, 0, sizeof(_packet));
+        _packet[0] = (4 << 3) | 4;
+        _packet[1] = _ntpStratum;
+        _packet[40] = seconds >> 24;
+        _packet[41] = seconds >> 16;
+        _packet[42] = seconds >> 8;
+        _packet[43] = seconds;
+        _available = sizeof(_packet);
+        return sizeof(_packet);
+    }
+    int read(uint8_t *buffer, size_t size)
+    {
+        size_t length = size < _available ? size : _available;
+        memcpy(buffer, _packet + sizeof(_packet) - _available, length);
+        _available -= length;
+        return length;
+    }
+    void flush(void) { _available = 0; }
+
+    static void shim_setNtpEpoch(unsigned long epoch) { _ntpEpoch = epoch; }
+    static void shim_setNtpDelay(unsigned long milliseconds) { _ntpDelay = milliseconds; }
+    static void shim_setNtpStratum(uint8_t stratum) { _ntpStratum = stratum; }
+
+private:
+    uint16_t _port = 0;
+    size_t _written = 0;
+    bool _answerPending = false;
+    unsigned long _answerMillis = 0;
+    uint8_t _packet[48];
+    size_t _available = 0;
+
+    static inline unsigned long _ntpEpoch = 0;
+    static inline unsigned long _ntpDelay = 0;
+    static inline uint8_t _ntpStratum = 2;
+};
+
+#endif
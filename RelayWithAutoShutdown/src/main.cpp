@@ -1,36 +1,108 @@
 #include <Arduino.h>
 #include <ESP8266WiFi.h>
-#include <ESP8266WebServer.h>
-#include <ESP8266HTTPUpdateServer.h>
+#include <HttpServer.h>
+#include <HttpUpdateServer.h>
 #include <FS.h>
 #include <LittleFS.h>
 #include <resource.h>
 #include <ArduinoJson.h>
 #include <WiFiUdp.h>
-#include <NTPClient.h>
+#include <NtpClock.h>
+#include <PageTemplate.h>
+#include <BufferedPrint.h>
+#include <EventStream.h>
+#include <ConfigStore.h>
+#include <StateLog.h>
+#include <BootCache.h>
+#include <WifiStation.h>
+#include <RuleEngine.h>
+#include <RuleStore.h>
+#include <AdcSampler.h>
+#include <SensorFilter.h>
+#include <TimeZone.h>
+#include <Scheduler.h>
+#include <ScheduleStore.h>
+#include <SunTimes.h>
 
 #define RELAY_STATE_OFF 0
 #define RELAY_STATE_ON 1
 #define RELAY_STATE_DEFAULT RELAY_STATE_OFF
+#define RELAY_COUNT 1
 
 #define BUTTON_PIN D3
 #define LED_STATE_PIN LED_BUILTIN
 #define RELAY_PIN D1
 
+#define CONFIG_FILE "/config.bin"
+#define LEGACY_JSON_CONFIG_FILE "/config.json"
+#define LEGACY_WIFI_CONFIG_FILE "/wifi.cfg"
+#define RELAY_STATE_FILE "/relay"
+#define WIFI_CACHE_FILE "/wifi.bin"
+#define RULES_FILE "/rules.bin"
+#define SCHEDULE_FILE "/schedule.bin"
+
+#define NTP_UPDATE_INTERVAL 3600000L
+#define NTP_RETRY_INTERVAL 60000L
+
+#define LDR_EVENT_INTERVAL 1000L
+#define LDR_EVENT_MIN_DELTA 0.1f
+#define LDR_EVENT_DELTA_RATIO 0.05f
+
+// A0 is sampled at LDR_SAMPLE_RATE Hz, override with -D LDR_SAMPLE_RATE=<n>.
+// Every LDR_SAMPLE_INTERVAL the median of the sample window goes into the
+// average, which follows a step to 63% in about 10 s.
+#ifndef LDR_SAMPLE_RATE
+#define LDR_SAMPLE_RATE 50
+#endif
+#define LDR_SAMPLE_INTERVAL 250L
+#define LDR_FILTER_ALPHA 0.025f
+
+// Rules run when an input crosses a rule boundary, and at least this often.
+#define AUTOMATION_POLL_INTERVAL 300000L
+
 /* -------------------------------------------------- */
 
 unsigned long perviousMillis = 0;
 
+bool warmBoot = false;
+unsigned long uptimeOffset = 0;
+
+// Set by the button interrupt, handled in loop().
+volatile bool factoryResetRequested = false;
+
 String deviceName;
 
 int relayState = RELAY_STATE_DEFAULT;
+StateLog relayStateLog(RELAY_STATE_FILE);
+bool relaySwitched = false;
+unsigned long relaySwitchedMillis = 0;
+
+AdcSampler ldrSampler(A0);
+SensorFilter ldrFilter(LDR_FILTER_ALPHA);
+unsigned long lastLDRSampleMillis = 0;
+
+unsigned long lastNTPMillis = 0;
+bool ntpAttempted = false;
+
+// The clock is right: synced over NTP, or restored from the warm-boot
+// snapshot. isTimeSet() only covers the former.
+bool timeKnown = false;
+
+unsigned long lastAutomationMillis = 0;
+bool automationRetry = false;
+unsigned long automationRetryMillis = 0;
 
 /* -------------------------------------------------- */
 
 String ssidName;
 String ssidPassword;
+ConfigNetwork backupNetworks[CONFIG_BACKUP_NETWORKS];
 String relayDisplayName(RELAY_DEFAULT_NAME);
 
+ConfigStore configStore(CONFIG_FILE);
+
+WifiStation wifiStation(WIFI_CACHE_FILE);
+
 /* -------------------------------------------------- */
 
 bool enableTurnOnThreshold = false;
@@ -44,27 +116,65 @@ bool enableTurnOnTimeRange = false;
 
 int turnOnBeginHour = -1;
 int turnOnBeginMinute = -1;
-time_t turnOnBeginTime = 0;
 
 int turnOnEndHour = -1;
 int turnOnEndMinute = -1;
-time_t turnOnEndTime = 0;
 
 bool enableShutdownTimeRange = false;
 
 int shutdownBeginHour = -1;
 int shutdownBeginMinute = -1;
-time_t shutdownBeginTime = 0;
 
 int shutdownEndHour = -1;
 int shutdownEndMinute = -1;
-time_t shutdownEndTime = 0;
 
 /* -------------------------------------------------- */
 
-ESP8266WebServer webserver;
+// Automation may not switch the relay back within these many seconds.
+uint16_t minOnTime = 0;
+uint16_t minOffTime = 0;
+uint8_t ldrHysteresis = 0;
+
+// POSIX TZ rule for the local time the rules see, the NTP client runs on UTC.
+String timeZoneRule;
+TimeZone timeZone;
+
+// Sunrise, sunset and twilight of the local day, for rules and schedules.
+bool enableLocation = false;
+float latitude = 0.0f;
+float longitude = 0.0f;
+SunTimes sunTimes;
+const char *SUN_ANCHOR_NAMES[RULE_ANCHOR_COUNT] = {NULL, "sunrise", "sunset", "dawn", "dusk"};
+static_assert(RULE_ANCHOR_DUSK - RULE_ANCHOR_SUNRISE == SUN_EVENT_DUSK, "Anchors follow the sun events");
+
+/* -------------------------------------------------- */
+
+// Rules from the settings above first, then the ones added over HTTP.
+RuleEngine ruleEngine;
+RuleStore ruleStore(RULES_FILE);
+Rule customRules[RULE_STORE_MAX_RULES];
+uint8_t customRuleCount = 0;
+
+// Weekly and dated switching times, run on local time once NTP has synced.
+Scheduler scheduler;
+ScheduleStore scheduleStore(SCHEDULE_FILE);
+
+/* -------------------------------------------------- */
+
+HttpServer webserver;
+
+HttpUpdateServer httpUpdateServer;
+
+PageTemplate homePageTemplate(HOME_PAGE, RELAY_PAGE_KEYS, RELAY_SLOT_COUNT);
+PageTemplate statusPageTemplate(STATUS_PAGE, STATUS_PAGE_KEYS, STATUS_SLOT_COUNT);
 
-ESP8266HTTPUpdateServer httpUpdateServer;
+EventStream eventStream("/api/v1/events");
+
+bool relayEventPending = false;
+bool wifiEventPending = false;
+bool ldrEventPending = false;
+float lastLDREventValue = -1.0f;
+unsigned long lastLDREventMillis = 0;
 
 IPAddress ipAddress(192, 168, 10, 1);
 
@@ -79,19 +189,23 @@ WiFiEventHandler onStationModeDHCPTimeoutEvent;
 /* -------------------------------------------------- */
 
 WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, "cn.ntp.org.cn");
+NtpClock timeClient(ntpUDP, "cn.ntp.org.cn");
 
 /* -------------------------------------------------- */
 
 void serial_init(void);
 void button_init(void);
 void relay_init(void);
+void restoreRelayState(void);
 void led_init(void);
 void misc_init(void);
 
 void IRAM_ATTR buttonHandler(void);
+void factoryReset(void);
 
 float getLDRValue(void);
+void sampleLDR(void);
+float adcToLDR(float adcValue);
 
 void ledStatusOn(void);
 void ledStatusOff(void);
@@ -101,19 +215,45 @@ void writeRelay(int state);
 
 bool loadWifiConfig(void);
 bool saveWifiConfig(void);
+bool migrateJsonConfig(ConfigRecord &record);
+bool migrateWifiConfig(ConfigRecord &record);
+void applyConfigRecord(const ConfigRecord &record);
+void makeConfigRecord(ConfigRecord &record);
+void saveBootCache(void);
+bool restoreConfig(const BootSnapshot &snapshot);
+void connectStation(void);
+bool applyConfigChange(const ConfigRecord &next);
+bool patchConfigField(ConfigRecord &record, const char *key, JsonVariant value);
+bool patchTimeField(int8_t &field, JsonVariant value, int max);
 
 void onPageNotFound(void);
 void onStatusPage(void);
 void onConfigHomePage(void);
 void onConfigApplyPage(void);
+void setFormNetwork(char *ssid, char *password, const char *ssidKey, const char *passwordKey);
 void onRelayHomePage(void);
 void onRelayOn(void);
 void onRelayOff(void);
-
-String buildStatusPageHtml(void);
-String buildConfigPageHtml(void);
-String buildHomePageHtml(void);
-String buildRedirectHtml(void);
+void onApiStatus(void);
+void onApiRelay(void);
+void onApiConfig(void);
+void onApiRules(void);
+void onApiSchedules(void);
+void onEventClientConnected(void);
+
+void sendStatusPageHtml(void);
+void sendHomePageHtml(void);
+void sendConfigPageHtml(void);
+void sendRedirectHtml(void);
+void sendGzipPage(const uint8_t *page, size_t length, const char *etag, const char *cacheControl);
+String getStatusPageValue(uint8_t slot);
+String getHomePageValue(uint8_t slot);
+void sendJson(int code, JsonDocument &doc);
+void sendJsonError(int code, const char *message);
+void buildRelayJson(JsonObject relay);
+void buildWifiJson(JsonObject wifi);
+void buildConfigJson(JsonObject config);
+void publishEvents(void);
 
 void onSoftAPModeStationConnected(const WiFiEventSoftAPModeStationConnected &event);
 void onSoftAPModeStationDisconnected(const WiFiEventSoftAPModeStationDisconnected &event);
@@ -126,9 +266,29 @@ void onStationModeDHCPTimeout(void);
 
 String getStatusString(void);
 
-void makeTurnOnTime(void);
-void makeShutdownTime(void);
-bool isInTimeRange(time_t* from, time_t* to, time_t* cur);
+void loadRules(void);
+void compileRules(void);
+void makeThresholdRule(Rule &rule, uint8_t action, uint8_t op, float threshold, bool timeRange, int beginHour,
+                       int beginMinute, int endHour, int endMinute);
+void updateTime(void);
+void onTimeUpdate(bool updated);
+uint32_t getLocalTime(void);
+void updateSunTimes(void);
+void setSunAnchors(void);
+int16_t getSunMinute(uint8_t anchor, uint16_t day);
+void makeRuleInputs(RuleInputs &inputs);
+void evaluateRules(const RuleInputs &inputs);
+bool parseRule(JsonObject object, Rule &rule);
+bool parseRuleValue(JsonVariant value, uint8_t sensor, float &result, uint8_t &anchor);
+void buildRuleJson(JsonObject object, const Rule &rule);
+void setRuleValue(JsonObject object, const char *key, uint8_t sensor, float value, uint8_t anchor);
+void loadSchedules(void);
+void startScheduler(void);
+void runSchedules(uint32_t now);
+bool parseSchedule(JsonObject object, ScheduleEntry &entry);
+bool parseDate(JsonVariant value, uint16_t &day);
+void buildScheduleJson(JsonObject object, const ScheduleEntry &entry);
+String formatDate(uint16_t day);
 
 /* -------------------------------------------------- */
 
@@ -136,12 +296,22 @@ void setup()
 {
     // put your setup code here, to run once:
 
+    /* Warm boot: state kept in RTC memory across a software reset */
+    BootSnapshot snapshot;
+    warmBoot = BootCache::load(snapshot);
+    if (warmBoot)
+    {
+        relayState = (snapshot.relayState == RELAY_STATE_ON) ? RELAY_STATE_ON : RELAY_STATE_OFF;
+        uptimeOffset = snapshot.uptimeMillis;
+    }
+
     /* Peripherals */
     serial_init();
     button_init();
     led_init();
     relay_init();
     misc_init();
+    restoreRelayState();
     Serial.println("[Setup] Peripherals have been initialized.");
 
     Serial.printf("ESP8266 Chip ID: %08X\r\n", ESP.getChipId());
@@ -151,8 +321,20 @@ void setup()
     deviceName.concat(chipID);
     deviceName.concat(")");
 
+    if (warmBoot && snapshot.epoch != 0)
+    {
+        // Counts on from here with millis(), until the first NTP answer.
+        timeClient.setEpochTime(snapshot.epoch);
+        timeKnown = true;
+        Serial.println("[Setup] Warm boot, clock restored from RTC memory.");
+    }
+
     /* Load WIFI config */
-    if (loadWifiConfig() == true)
+    if (warmBoot && restoreConfig(snapshot))
+    {
+        Serial.println("[Setup] Warm boot, configuration restored from RTC memory.");
+    }
+    else if (loadWifiConfig() == true)
     {
         /* WIFI already configured */
         Serial.println("[Setup] Load configuration successfully.");
@@ -163,10 +345,23 @@ void setup()
         Serial.println("[Setup] Load configuration failed.");
     }
 
+    /* Automation rules */
+    scheduler.setAnchorFunction(getSunMinute);
+    loadRules();
+    loadSchedules();
+
+    /* Page Templates */
+    if (!homePageTemplate.compile() || !statusPageTemplate.compile())
+    {
+        Serial.println("[Setup] Failed to compile page templates.");
+    }
+
     /* HTTP Update Server */
     httpUpdateServer.setup(&webserver);
 
     /* Web Server */
+    const char *headerKeys[] = {"If-None-Match", "Accept-Encoding"};
+    webserver.collectHeaders(headerKeys, 2);
     webserver.begin(80);
     webserver.on("/", onRelayHomePage);
     webserver.on("/relay_on", onRelayOn);
@@ -174,6 +369,12 @@ void setup()
     webserver.on("/config", onConfigHomePage);
     webserver.on("/postconfig", onConfigApplyPage);
     webserver.on("/status", onStatusPage);
+    webserver.on("/api/v1/status", onApiStatus);
+    webserver.on("/api/v1/relay", onApiRelay);
+    webserver.on("/api/v1/config", onApiConfig);
+    webserver.on("/api/v1/rules", onApiRules);
+    webserver.on("/api/v1/schedules", onApiSchedules);
+    eventStream.begin(webserver, onEventClientConnected);
     webserver.onNotFound(onPageNotFound);
 
     /* WIFI */
@@ -196,88 +397,63 @@ void setup()
     WiFi.softAP(deviceName);
 
     /* WIFI Station */
-    if (!ssidName.isEmpty() && !ssidPassword.isEmpty())
-    {
-        WiFi.begin(ssidName, ssidPassword);
-    }
+    connectStation();
 
     /* Finished */
     Serial.println("[Setup] Finished.");
     Serial.println();
 
+    saveBootCache();
     perviousMillis = millis();
 }
 
 void loop()
 {
     // put your main code here, to run repeatedly:
-    webserver.handleClient();
-
-    unsigned long currentMillis = millis();
-    if ((currentMillis - perviousMillis) > 30000L)
+    if (factoryResetRequested)
     {
-        perviousMillis = currentMillis;
+        factoryReset();
+    }
+    webserver.handleClient();
+    publishEvents();
+    relayStateLog.loop();
+    wifiStation.loop();
+    ldrSampler.update();
 
-        // LDR value
-        float ldr = getLDRValue();
-        Serial.printf("[LDR] LDR Value: %.1f\r\n", ldr);
+    updateTime();
+    updateSunTimes();
 
-        // NTP Time
-        bool ntpUpdated = timeClient.update();
-        Serial.printf("[NTP] NTP %s. Time Now: %02d:%02d:%02d\r\n", ntpUpdated ? "True" : "False", timeClient.getHours(), timeClient.getMinutes(), timeClient.getSeconds());
-        tm now = {0};
-        now.tm_hour = timeClient.getHours();
-        now.tm_min = timeClient.getMinutes();
-        time_t timeNow = mktime(&now);
+    // Nothing to do until the earliest schedule entry is due.
+    if (scheduler.next() != SCHEDULE_NEVER && getLocalTime() >= scheduler.next())
+    {
+        runSchedules(getLocalTime());
+    }
 
-        // Turn On
-        if (enableTurnOnThreshold && turnOnThreshold >= 0.0f)
+    unsigned long currentMillis = millis();
+    if ((currentMillis - lastLDRSampleMillis) >= LDR_SAMPLE_INTERVAL)
+    {
+        lastLDRSampleMillis = currentMillis;
+        sampleLDR();
+
+        // Automation, when a rule boundary is crossed, a held back switch is
+        // due, or as a safety net.
+        RuleInputs inputs;
+        makeRuleInputs(inputs);
+        if (ruleEngine.changed(inputs) || (automationRetry && (long)(currentMillis - automationRetryMillis) >= 0) ||
+            (currentMillis - lastAutomationMillis) >= AUTOMATION_POLL_INTERVAL)
         {
-            bool shouldTurnOn = (ldr <= turnOnThreshold);
-            if (enableTurnOnTimeRange)
-            {
-                if (!ntpUpdated)
-                {
-                    shouldTurnOn = false;
-                }
-
-                if (!isInTimeRange(&turnOnBeginTime, &turnOnEndTime, &timeNow))
-                {
-                    shouldTurnOn = false;
-                }
-            }
-
-            if (shouldTurnOn && (readRelay() == RELAY_STATE_OFF))
-            {
-                Serial.printf("Turn On Automatic.\r\n");
-                writeRelay(RELAY_STATE_ON);
-            }
+            evaluateRules(inputs);
         }
+    }
 
-        // Shutdown
-        if (enableShutdownThreshold && shutdownThreshold >= 0.0f)
-        {
-            bool shouldShutdown = (ldr >= shutdownThreshold);
-
-            if (enableShutdownTimeRange)
-            {
-                if (!ntpUpdated)
-                {
-                    shouldShutdown = false;
-                }
-
-                if (!isInTimeRange(&shutdownBeginTime, &shutdownEndTime, &timeNow))
-                {
-                    shouldShutdown = false;
-                }
-            }
+    if ((currentMillis - perviousMillis) > 30000L)
+    {
+        perviousMillis = currentMillis;
 
-            if (shouldShutdown && (readRelay() == RELAY_STATE_ON))
-            {
-                Serial.printf("Shutdown Automatic.\r\n");
-                writeRelay(RELAY_STATE_OFF);
-            }
-        }
+        Serial.printf("[LDR] LDR Value: %.1f\r\n", getLDRValue());
+        uint32_t now = getLocalTime();
+        Serial.printf("[NTP] NTP %s. Time Now: %02u:%02u:%02u\r\n", timeClient.isTimeSet() ? "True" : (timeKnown ? "Restored" : "False"), now / 3600 % 24, now / 60 % 60, now % 60);
+        saveBootCache();
     }
 }
 
@@ -294,8 +470,27 @@ void button_init(void)
 
 void relay_init(void)
 {
+    // relayState already holds the RTC copy on a warm boot.
+    digitalWrite(RELAY_PIN, (relayState == RELAY_STATE_OFF) ? LOW : HIGH);
     pinMode(RELAY_PIN, OUTPUT);
-    digitalWrite(RELAY_PIN, LOW);
+}
+
+void restoreRelayState(void)
+{
+    // Needs LittleFS, so runs after misc_init().
+    uint32_t savedState;
+    bool saved = relayStateLog.load(savedState);
+    if (warmBoot)
+    {
+        // The RTC copy is newer if a write was still pending at the reset.
+        relayStateLog.set(relayState);
+    }
+    else if (saved && savedState == RELAY_STATE_ON)
+    {
+        relayState = RELAY_STATE_ON;
+        digitalWrite(RELAY_PIN, HIGH);
+    }
+    Serial.printf("[Relay] Restored state: %s\r\n", (relayState == RELAY_STATE_OFF) ? "off" : "on");
 }
 
 void led_init(void)
@@ -314,22 +509,55 @@ void misc_init(void)
 
     // NTP
     timeClient.begin();
-    timeClient.setTimeOffset(28800); // 28800: UTC+8
+
+    // LDR
+    ldrSampler.begin(LDR_SAMPLE_RATE);
 }
 
 void IRAM_ATTR buttonHandler(void)
+{
+    // Flash and Serial are off limits here, loop() does the reset.
+    factoryResetRequested = true;
+}
+
+void factoryReset(void)
 {
     Serial.println("Button pressed. Reset configuration.");
-    if (LittleFS.exists("/config.json"))
+    BootCache::invalidate();
+    wifiStation.forgetCache();
+    ruleStore.remove();
+    scheduleStore.remove();
+    configStore.remove();
+    ESP.restart();
+}
+
+float getLDRValue(void)
+{
+    // The filter averages ADC counts, the first call starts it.
+    if (!ldrFilter.ready())
     {
-        LittleFS.remove("/config.json");
-        ESP.restart();
+        sampleLDR();
     }
+    return adcToLDR(ldrFilter.value());
 }
 
-float getLDRValue(void)
+void sampleLDR(void)
+{
+    // Only before the first tick, later samples come from the Ticker.
+    if (ldrSampler.count() == 0)
+    {
+        ldrSampler.sample();
+    }
+    ldrFilter.add(ldrSampler.percentile(50));
+}
+
+float adcToLDR(float adcValue)
 {
-    int adcValue = analogRead(A0);
+    // A reading of 0 (full dark) would divide by zero.
+    if (adcValue < 1.0f)
+    {
+        adcValue = 1.0f;
+    }
     return 10.0f * (1024.0f - adcValue) / adcValue;
 }
 
@@ -350,54 +578,56 @@ int readRelay(void)
 
 void writeRelay(int state)
 {
+    if (state != relayState)
+    {
+        relaySwitched = true;
+        relaySwitchedMillis = millis();
+    }
     relayState = state;
     digitalWrite(RELAY_PIN, (relayState == RELAY_STATE_OFF) ? LOW : HIGH);
+    relayStateLog.set(relayState);
+    relayEventPending = true;
+    saveBootCache();
 }
 
 bool loadWifiConfig(void)
 {
-    File file = LittleFS.open("/config.json", "r");
-    if (!file)
+    ConfigRecord record;
+    if (!configStore.load(record))
     {
-        Serial.println("Failed to open config.json.");
-        return false;
-    }
-
-    StaticJsonDocument<768> doc;
-    DeserializationError error = deserializeJson(doc, file);
+        // First boot after an update: convert the old formats once.
+        if (migrateJsonConfig(record))
+        {
+            Serial.println("[Config] Migrated " LEGACY_JSON_CONFIG_FILE ".");
+        }
+        else if (migrateWifiConfig(record))
+        {
+            Serial.println("[Config] Migrated " LEGACY_WIFI_CONFIG_FILE ".");
+        }
+        else
+        {
+            Serial.println("Failed to open " CONFIG_FILE ".");
+            return false;
+        }
 
-    if (error)
-    {
-        Serial.printf("Failed to deserialize Json, error code: %s\r\n", String(error.f_str()).c_str());
-        file.close();
-        return false;
+        if (!configStore.save(record))
+        {
+            Serial.println("[Config] Failed to write " CONFIG_FILE ".");
+            return false;
+        }
+        LittleFS.remove(LEGACY_JSON_CONFIG_FILE);
+        LittleFS.remove(LEGACY_WIFI_CONFIG_FILE);
     }
 
-    ssidName = String(doc["SSID"].as<const char *>());
-    ssidPassword = String(doc["Password"].as<const char *>());
-    relayDisplayName = String(doc["RelayDisplayName"].as<const char *>());
-    enableTurnOnThreshold = doc["EnableTurnOnThreshold"].as<bool>();
-    turnOnThreshold = doc["TurnOnThreshold"].as<float>();
-    enableShutdownThreshold = doc["EnableShutdownThreshold"].as<bool>();
-    shutdownThreshold = doc["ShutdownThreshold"].as<float>();
-
-    enableTurnOnTimeRange = doc["EnableTurnOnTimeRange"].as<bool>();
-    turnOnBeginHour = doc["TurnOnBeginHour"].as<int>();
-    turnOnBeginMinute = doc["TurnOnBeginMinute"].as<int>();
-    turnOnEndHour = doc["TurnOnEndHour"].as<int>();
-    turnOnEndMinute = doc["TurnOnEndMinute"].as<int>();
-    makeTurnOnTime();
-
-    enableShutdownTimeRange = doc["EnableShutdownTimeRange"].as<bool>();
-    shutdownBeginHour = doc["ShutdownBeginHour"].as<int>();
-    shutdownBeginMinute = doc["ShutdownBeginMinute"].as<int>();
-    shutdownEndHour = doc["ShutdownEndHour"].as<int>();
-    shutdownEndMinute = doc["ShutdownEndMinute"].as<int>();
-    makeShutdownTime();
+    applyConfigRecord(record);
 
     Serial.println("Load Configuration:");
     Serial.printf("    SSID: %s\r\n", ssidName.c_str());
     Serial.printf("    Password: %s\r\n", ssidPassword.c_str());
+    for (uint8_t i = 0; i < CONFIG_BACKUP_NETWORKS; i++)
+    {
+        Serial.printf("    SSID%d: %s\r\n", i + 2, backupNetworks[i].ssid);
+    }
     Serial.printf("    RelayDisplayName: %s\r\n", relayDisplayName.c_str());
 
     Serial.printf("    EnableTurnOnThreshold: %s\r\n", enableTurnOnThreshold ? "True" : "False");
@@ -413,248 +643,1841 @@ bool loadWifiConfig(void)
     Serial.printf("    Shutdown Begin at %02d:%02d\r\n", shutdownBeginHour, shutdownBeginMinute);
     Serial.printf("    Shutdown End at %02d:%02d\r\n", shutdownEndHour, shutdownEndMinute);
 
-    file.close();
+    Serial.printf("    MinOnTime: %d s, MinOffTime: %d s\r\n", minOnTime, minOffTime);
+    Serial.printf("    LDRHysteresis: %d%%\r\n", ldrHysteresis);
+    Serial.printf("    TimeZone: %s\r\n", timeZoneRule.c_str());
+    Serial.printf("    EnableLocation: %s, %.4f, %.4f\r\n", enableLocation ? "True" : "False", latitude, longitude);
+
     return true;
 }
 
 bool saveWifiConfig(void)
 {
-    if (LittleFS.exists("/config.json"))
+    ConfigRecord record;
+    makeConfigRecord(record);
+    if (!configStore.save(record))
     {
-        LittleFS.remove("/config.json");
+        Serial.println("[SaveConfig] Failed to write configuration.");
+        return false;
     }
+    saveBootCache();
+    return true;
+}
 
-    File file = LittleFS.open("/config.json", "w");
+bool migrateJsonConfig(ConfigRecord &record)
+{
+    File file = LittleFS.open(LEGACY_JSON_CONFIG_FILE, "r");
     if (!file)
     {
-        Serial.println("[SaveConfig] Failed to write configuration.");
         return false;
     }
 
     StaticJsonDocument<768> doc;
-    doc["SSID"] = ssidName;
-    doc["Password"] = ssidPassword;
-    doc["RelayDisplayName"] = relayDisplayName;
-
-    doc["EnableTurnOnThreshold"] = enableTurnOnThreshold;
-    doc["TurnOnThreshold"] = turnOnThreshold;
-    doc["EnableShutdownThreshold"] = enableShutdownThreshold;
-    doc["ShutdownThreshold"] = shutdownThreshold;
-
-    doc["EnableTurnOnTimeRange"] = enableTurnOnTimeRange;
-    doc["TurnOnBeginHour"] = turnOnBeginHour;
-    doc["TurnOnBeginMinute"] = turnOnBeginMinute;
-    doc["TurnOnEndHour"] = turnOnEndHour;
-    doc["TurnOnEndMinute"] = turnOnEndMinute;
-
-    doc["EnableShutdownTimeRange"] = enableShutdownTimeRange;
-    doc["ShutdownBeginHour"] = shutdownBeginHour;
-    doc["ShutdownBeginMinute"] = shutdownBeginMinute;
-    doc["ShutdownEndHour"] = shutdownEndHour;
-    doc["ShutdownEndMinute"] = shutdownEndMinute;
-
-    size_t result = serializeJson(doc, file);
+    DeserializationError error = deserializeJson(doc, file);
     file.close();
-    return result == 0 ? true : false;
-}
-
-void onPageNotFound(void)
-{
-    Serial.print("[WebServer] Page Not Found: ");
-    Serial.println(webserver.uri());
-}
 
-void onStatusPage(void)
-{
-    Serial.println("[WebServer] Opening 'Status' page.");
-    webserver.send(200, "text/html", buildStatusPageHtml());
-}
+    if (error)
+    {
+        Serial.printf("Failed to deserialize Json, error code: %s\r\n", String(error.f_str()).c_str());
+        return false;
+    }
 
-void onConfigHomePage(void)
-{
-    Serial.println("[WebServer] Opening 'Config' page.");
-    webserver.send(200, "text/html", buildConfigPageHtml());
+    ConfigStore::clear(record);
+    ConfigStore::setString(record.ssid, sizeof(record.ssid), String(doc["SSID"].as<const char *>()));
+    ConfigStore::setString(record.password, sizeof(record.password), String(doc["Password"].as<const char *>()));
+    ConfigStore::setString(record.relayDisplayName, sizeof(record.relayDisplayName), String(doc["RelayDisplayName"].as<const char *>()));
+
+    record.enableTurnOnThreshold = doc["EnableTurnOnThreshold"].as<bool>();
+    record.turnOnThreshold = doc["TurnOnThreshold"].as<float>();
+    record.enableShutdownThreshold = doc["EnableShutdownThreshold"].as<bool>();
+    record.shutdownThreshold = doc["ShutdownThreshold"].as<float>();
+
+    record.enableTurnOnTimeRange = doc["EnableTurnOnTimeRange"].as<bool>();
+    record.turnOnBeginHour = doc["TurnOnBeginHour"].as<int>();
+    record.turnOnBeginMinute = doc["TurnOnBeginMinute"].as<int>();
+    record.turnOnEndHour = doc["TurnOnEndHour"].as<int>();
+    record.turnOnEndMinute = doc["TurnOnEndMinute"].as<int>();
+
+    record.enableShutdownTimeRange = doc["EnableShutdownTimeRange"].as<bool>();
+    record.shutdownBeginHour = doc["ShutdownBeginHour"].as<int>();
+    record.shutdownBeginMinute = doc["ShutdownBeginMinute"].as<int>();
+    record.shutdownEndHour = doc["ShutdownEndHour"].as<int>();
+    record.shutdownEndMinute = doc["ShutdownEndMinute"].as<int>();
+    return true;
 }
 
-void onConfigApplyPage(void)
+bool migrateWifiConfig(ConfigRecord &record)
 {
-    Serial.println("[WebServer] Received New Configuration.");
-    if (webserver.method() != HTTP_POST)
+    // Relay / RelayX2 format: SSID, password and display name, one per line.
+    File file = LittleFS.open(LEGACY_WIFI_CONFIG_FILE, "r");
+    if (!file)
     {
-        Serial.println("[WebServer] Only allow POST method.");
-        webserver.send(404, "text/plain", "Method not allow");
-        return;
+        return false;
     }
 
-    ssidName = webserver.arg("SSID");
-    ssidPassword = webserver.arg("Password");
-    relayDisplayName = webserver.arg("RelayDisplayName");
+    String lines[3];
+    for (uint8_t i = 0; i < 3 && file.available(); i++)
+    {
+        lines[i] = file.readStringUntil('\n');
+        lines[i].trim();
+    }
+    file.close();
 
-    enableTurnOnThreshold = webserver.arg("EnableTurnOnThreshold") == "on" ? true : false;
-    turnOnThreshold = webserver.arg("TurnOnThreshold").toFloat();
-    enableShutdownThreshold = webserver.arg("EnableShutdownThreshold") == "on" ? true : false;
-    shutdownThreshold = webserver.arg("ShutdownThreshold").toFloat();
+    ConfigStore::clear(record);
+    ConfigStore::setString(record.ssid, sizeof(record.ssid), lines[0]);
+    ConfigStore::setString(record.password, sizeof(record.password), lines[1]);
+    ConfigStore::setString(record.relayDisplayName, sizeof(record.relayDisplayName), lines[2]);
+    return true;
+}
 
-    /*
-     * EnableTurnOnTimeRange
-     * TurnOnBeginTime
-     * TurnOnEndTime
-     */
-    if (webserver.arg("TurnOnBeginTime").length() == 5 && webserver.arg("TurnOnEndTime").length() == 5 )
+void applyConfigRecord(const ConfigRecord &record)
+{
+    ssidName = record.ssid;
+    ssidPassword = record.password;
+    for (uint8_t i = 0; i < CONFIG_BACKUP_NETWORKS; i++)
     {
-        enableTurnOnTimeRange = webserver.arg("EnableTurnOnTimeRange") == "on" ? true : false;
-        turnOnBeginHour = webserver.arg("TurnOnBeginTime").substring(0, 2).toInt();
-        turnOnBeginMinute = webserver.arg("TurnOnBeginTime").substring(3, 5).toInt();
-        turnOnEndHour = webserver.arg("TurnOnEndTime").substring(0, 2).toInt();
-        turnOnEndMinute = webserver.arg("TurnOnEndTime").substring(3, 5).toInt();
-        makeTurnOnTime();
+        backupNetworks[i] = ConfigStore::backupNetwork(record, i);
     }
-    else
+    relayDisplayName = record.relayDisplayName;
+
+    enableTurnOnThreshold = record.enableTurnOnThreshold;
+    turnOnThreshold = record.turnOnThreshold;
+    enableShutdownThreshold = record.enableShutdownThreshold;
+    shutdownThreshold = record.shutdownThreshold;
+
+    enableTurnOnTimeRange = record.enableTurnOnTimeRange;
+    turnOnBeginHour = record.turnOnBeginHour;
+    turnOnBeginMinute = record.turnOnBeginMinute;
+    turnOnEndHour = record.turnOnEndHour;
+    turnOnEndMinute = record.turnOnEndMinute;
+
+    enableShutdownTimeRange = record.enableShutdownTimeRange;
+    shutdownBeginHour = record.shutdownBeginHour;
+    shutdownBeginMinute = record.shutdownBeginMinute;
+    shutdownEndHour = record.shutdownEndHour;
+    shutdownEndMinute = record.shutdownEndMinute;
+
+    minOnTime = record.minOnTime;
+    minOffTime = record.minOffTime;
+    ldrHysteresis = record.ldrHysteresis;
+
+    timeZoneRule = record.timeZone;
+    if (!timeZone.set(record.timeZone))
     {
-        enableTurnOnTimeRange = false;
-        turnOnBeginHour = -1;
-        turnOnBeginMinute = -1;
-        turnOnEndHour = -1;
-        turnOnEndMinute = -1;
-        turnOnBeginTime = 0;
-        turnOnEndTime = 0;
+        Serial.printf("[Config] Invalid time zone %s ignored.\r\n", record.timeZone);
     }
 
-    /*
-     * EnableShutdownTimeRange
-     * ShutdownBeginTime
-     * ShutdownEndTime
-     */
-    if (webserver.arg("ShutdownBeginTime").length() == 5 && webserver.arg("ShutdownEndTime").length() == 5 )
+    enableLocation = record.enableLocation;
+    latitude = record.latitude;
+    longitude = record.longitude;
+    if (enableLocation)
     {
-        enableShutdownTimeRange = webserver.arg("EnableShutdownTimeRange") == "on" ? true : false;
-        shutdownBeginHour = webserver.arg("ShutdownBeginTime").substring(0, 2).toInt();
-        shutdownBeginMinute = webserver.arg("ShutdownBeginTime").substring(3, 5).toInt();
-        shutdownEndHour = webserver.arg("ShutdownEndTime").substring(0, 2).toInt();
-        shutdownEndMinute = webserver.arg("ShutdownEndTime").substring(3, 5).toInt();
-        makeShutdownTime();
+        sunTimes.setLocation(latitude, longitude);
     }
     else
     {
-        enableShutdownTimeRange = false;
-        shutdownBeginHour = -1;
-        shutdownBeginMinute = -1;
-        shutdownEndHour = -1;
-        shutdownEndMinute = -1;
-        shutdownBeginTime = 0;
-        shutdownEndTime = 0;
+        sunTimes.clearLocation();
     }
 
-    Serial.printf("[WebServer] SSID: %s\r\n", ssidName.c_str());
-    Serial.printf("[WebServer] Password: %s\r\n", ssidPassword.c_str());
-
-    Serial.printf("[WebServer] Turn On Threshold: %s, %.2f\r\n", enableTurnOnThreshold ? "True" : "False", turnOnThreshold);
-    Serial.printf("[WebServer] Shutdown Threshold: %s, %.2f\r\n", enableShutdownThreshold ? "True" : "False", shutdownThreshold);
-
-    Serial.printf("[WebServer] Turn On by Time: %s; From %02d:%02d to %02d:%02d\r\n", enableTurnOnTimeRange ? "True" : "False", turnOnBeginHour, turnOnBeginMinute, turnOnEndHour, turnOnEndMinute);
-    Serial.printf("[WebServer] Shutdown by Time: %s; From %02d:%02d to %02d:%02d\r\n", enableShutdownTimeRange ? "True" : "False", shutdownBeginHour, shutdownBeginMinute, shutdownEndHour, shutdownEndMinute);
-
-    webserver.send(200, "text/html", buildRedirectHtml());
-
-    saveWifiConfig();
+    // The time zone or the location may have moved the sun times.
+    setSunAnchors();
+    compileRules();
+    startScheduler();
+}
 
-    WiFi.disconnect(false);
-    if (!ssidName.isEmpty() && !ssidPassword.isEmpty())
+void makeConfigRecord(ConfigRecord &record)
+{
+    ConfigStore::clear(record);
+    ConfigStore::setString(record.ssid, sizeof(record.ssid), ssidName);
+    ConfigStore::setString(record.password, sizeof(record.password), ssidPassword);
+    for (uint8_t i = 0; i < CONFIG_BACKUP_NETWORKS; i++)
     {
-        WiFi.begin(ssidName, ssidPassword);
+        ConfigStore::backupNetwork(record, i) = backupNetworks[i];
     }
+    ConfigStore::setString(record.relayDisplayName, sizeof(record.relayDisplayName), relayDisplayName);
+
+    record.enableTurnOnThreshold = enableTurnOnThreshold;
+    record.turnOnThreshold = turnOnThreshold;
+    record.enableShutdownThreshold = enableShutdownThreshold;
+    record.shutdownThreshold = shutdownThreshold;
+
+    record.enableTurnOnTimeRange = enableTurnOnTimeRange;
+    record.turnOnBeginHour = turnOnBeginHour;
+    record.turnOnBeginMinute = turnOnBeginMinute;
+    record.turnOnEndHour = turnOnEndHour;
+    record.turnOnEndMinute = turnOnEndMinute;
+
+    record.enableShutdownTimeRange = enableShutdownTimeRange;
+    record.shutdownBeginHour = shutdownBeginHour;
+    record.shutdownBeginMinute = shutdownBeginMinute;
+    record.shutdownEndHour = shutdownEndHour;
+    record.shutdownEndMinute = shutdownEndMinute;
+
+    record.minOnTime = minOnTime;
+    record.minOffTime = minOffTime;
+    record.ldrHysteresis = ldrHysteresis;
+
+    ConfigStore::setString(record.timeZone, sizeof(record.timeZone), timeZoneRule);
+
+    record.enableLocation = enableLocation;
+    record.latitude = latitude;
+    record.longitude = longitude;
 }
 
-void onRelayHomePage(void)
+void saveBootCache(void)
 {
-    Serial.println("[WebServer] Opening 'Home' page.");
-    webserver.send(200, "text/html", buildHomePageHtml());
+    // RTC memory has no wear, so this runs on every change.
+    BootSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.relayState = relayState;
+    snapshot.epoch = timeKnown ? timeClient.getEpochTime() : 0;
+    snapshot.uptimeMillis = uptimeOffset + millis();
+
+    ConfigRecord record;
+    makeConfigRecord(record);
+    ConfigStore::seal(record);
+    snapshot.configCrc = record.crc;
+    ConfigStore::getSettings(record, snapshot.configSettings);
+    BootCache::save(snapshot);
 }
 
-void onRelayOn(void)
+/*
+ * Warm boot: the settings come from the snapshot and only the credentials
+ * from config.bin. Put together they must have the CRC of the record the
+ * snapshot was taken from, else loadWifiConfig() reads the whole file.
+ */
+bool restoreConfig(const BootSnapshot &snapshot)
 {
-    Serial.println("[WebServer] Relay ON");
-    writeRelay(RELAY_STATE_ON);
-    webserver.send(200, "text/html", buildRedirectHtml());
+    ConfigRecord record;
+    ConfigStore::clear(record);
+    ConfigStore::setSettings(record, snapshot.configSettings);
+    if (!configStore.loadCredentials(record))
+    {
+        return false;
+    }
+
+    ConfigStore::seal(record);
+    if (record.crc != snapshot.configCrc)
+    {
+        return false;
+    }
+    applyConfigRecord(record);
+    return true;
 }
 
-void onRelayOff(void)
+/*
+ * Hands the configured networks to the station and starts connecting. The
+ * primary network comes first, backups are tried when it is out of reach.
+ */
+void connectStation(void)
 {
-    Serial.println("[WebServer] Relay OFF");
-    writeRelay(RELAY_STATE_OFF);
-    webserver.send(200, "text/html", buildRedirectHtml());
+    wifiStation.clearNetworks();
+    if (!ssidPassword.isEmpty())
+    {
+        wifiStation.addNetwork(ssidName.c_str(), ssidPassword.c_str());
+    }
+    for (uint8_t i = 0; i < CONFIG_BACKUP_NETWORKS; i++)
+    {
+        if (backupNetworks[i].password[0] != '\0')
+        {
+            wifiStation.addNetwork(backupNetworks[i].ssid, backupNetworks[i].password);
+        }
+    }
+    wifiStation.begin();
 }
 
-String buildHomePageHtml(void)
+void loadRules(void)
 {
-    String str = String(RELAY_PAGE);
-    str.replace(RELAY_NAME, relayDisplayName);
-    str.replace(RELAY_STATE, (relayState == RELAY_STATE_OFF) ? "关" : "开");
-    str.replace(RELAY_SHOW_ON, (relayState == RELAY_STATE_OFF) ? "" : RELAY_DISPLAY_NONE);
-    str.replace(RELAY_SHOW_OFF, (relayState == RELAY_STATE_OFF) ? RELAY_DISPLAY_NONE : "");
-    return str;
+    if (ruleStore.load(customRules, customRuleCount))
+    {
+        Serial.printf("[Rules] Loaded %d rules.\r\n", customRuleCount);
+    }
+    compileRules();
 }
 
-String buildStatusPageHtml(void)
+/*
+ * Rebuilds the rule table from the threshold and time range settings and
+ * the rules added over HTTP. Runs whenever either changes, never per tick.
+ */
+void compileRules(void)
 {
-    String str = String(STATUS_PAGE);
-    str.replace(STATUS_STA_STATUS, getStatusString());
-    str.replace(STATUS_SSID_NAME, (WiFi.status() == WL_CONNECTED) ? WiFi.SSID() : NOT_AVAILABLE);
-    str.replace(STATUS_STA_IP_ADDRESS, (WiFi.status() == WL_CONNECTED) ? WiFi.localIP().toString() : NOT_AVAILABLE);
-    str.replace(STATUS_AP_SSID, deviceName);
-    str.replace(STATUS_AP_IP_ADDRESS, WiFi.softAPIP().toString());
-    str.replace(STATUS_LDR_VALUE, String(getLDRValue()));
-    return str;
+    ruleEngine.clear();
+    ruleEngine.setHysteresis(RULE_SENSOR_LDR, ldrHysteresis / 100.0f);
+
+    Rule rule;
+    if (enableTurnOnThreshold && turnOnThreshold >= 0.0f)
+    {
+        makeThresholdRule(rule, RULE_ACTION_RELAY_ON, RULE_OP_LESS_EQUAL, turnOnThreshold, enableTurnOnTimeRange,
+                          turnOnBeginHour, turnOnBeginMinute, turnOnEndHour, turnOnEndMinute);
+        ruleEngine.add(rule);
+    }
+    if (enableShutdownThreshold && shutdownThreshold >= 0.0f)
+    {
+        makeThresholdRule(rule, RULE_ACTION_RELAY_OFF, RULE_OP_GREATER_EQUAL, shutdownThreshold, enableShutdownTimeRange,
+                          shutdownBeginHour, shutdownBeginMinute, shutdownEndHour, shutdownEndMinute);
+        ruleEngine.add(rule);
+    }
+
+    for (uint8_t i = 0; i < customRuleCount; i++)
+    {
+        if (!ruleEngine.add(customRules[i]))
+        {
+            Serial.printf("[Rules] Rule %d skipped.\r\n", i);
+        }
+    }
+    Serial.printf("[Rules] %d rules active.\r\n", ruleEngine.count());
 }
 
-String buildConfigPageHtml(void)
+void makeThresholdRule(Rule &rule, uint8_t action, uint8_t op, float threshold, bool timeRange, int beginHour,
+                       int beginMinute, int endHour, int endMinute)
 {
-    return CONFIG_PAGE;
+    memset(&rule, 0, sizeof(rule));
+    rule.action = action;
+    rule.conditionCount = 1;
+    rule.conditions[0].sensor = RULE_SENSOR_LDR;
+    rule.conditions[0].op = op;
+    rule.conditions[0].low = threshold;
+    rule.conditions[0].high = threshold;
+
+    // An unset time makes the rule invalid, so it never fires.
+    if (timeRange)
+    {
+        rule.conditionCount = 2;
+        rule.conditions[1].sensor = RULE_SENSOR_TIME;
+        rule.conditions[1].op = RULE_OP_BETWEEN;
+        rule.conditions[1].low = (beginHour < 0 || beginMinute < 0) ? -1 : beginHour * 60 + beginMinute;
+        rule.conditions[1].high = (endHour < 0 || endMinute < 0) ? -1 : endHour * 60 + endMinute;
+    }
 }
 
-String buildRedirectHtml(void)
+void updateTime(void)
 {
-    return REDIRECT_PAGE;
+    // The answer is taken on a later loop, nothing waits for it.
+    if (timeClient.waiting())
+    {
+        NtpClockResult result = timeClient.poll();
+        if (result != NTP_CLOCK_WAITING)
+        {
+            onTimeUpdate(result == NTP_CLOCK_UPDATED);
+        }
+        return;
+    }
+
+    if (WiFi.status() != WL_CONNECTED)
+    {
+        return;
+    }
+
+    // A clock restored from RTC memory keeps asking until NTP has answered.
+    unsigned long interval = timeClient.isTimeSet() ? NTP_UPDATE_INTERVAL : NTP_RETRY_INTERVAL;
+    if (ntpAttempted && (millis() - lastNTPMillis) < interval)
+    {
+        return;
+    }
+    ntpAttempted = true;
+    lastNTPMillis = millis();
+    if (!timeClient.request())
+    {
+        onTimeUpdate(false);
+    }
 }
 
-void onSoftAPModeStationConnected(const WiFiEventSoftAPModeStationConnected &event)
+void onTimeUpdate(bool updated)
 {
-    Serial.printf("[SoftAP] Device connected, MAC: %02X-%02X-%02X-%02X-%02X-%02X\r\n", event.mac[0], event.mac[1], event.mac[2], event.mac[3], event.mac[4], event.mac[5]);
+    bool wasKnown = timeKnown;
+    timeKnown = timeKnown || updated;
+    uint32_t now = getLocalTime();
+    Serial.printf("[NTP] Update %s. Time Now: %02u:%02u:%02u\r\n", updated ? "succeeded" : "failed", now / 3600 % 24, now / 60 % 60, now % 60);
+
+    // Fire times are worked out once the clock is first known. Later
+    // corrections are small, entries they skip past still fire on poll.
+    if (updated && !wasKnown)
+    {
+        startScheduler();
+    }
 }
 
-void onSoftAPModeStationDisconnected(const WiFiEventSoftAPModeStationDisconnected &event)
+uint32_t getLocalTime(void)
 {
-    Serial.printf("[SoftAP] Device disconnected, MAC: %02X-%02X-%02X-%02X-%02X-%02X\r\n", event.mac[0], event.mac[1], event.mac[2], event.mac[3], event.mac[4], event.mac[5]);
+    return timeZone.toLocal(timeClient.getEpochTime());
 }
 
-void onStationModeConnected(const WiFiEventStationModeConnected &event)
+/*
+ * Once a local day starts, works out its sun times and compiles them into
+ * the rules and the schedule. Otherwise this is one compare per loop.
+ */
+void updateSunTimes(void)
 {
-    Serial.printf("[WIFI] Connected. SSID: %s\r\n", event.ssid.c_str());
-    ledStatusOn();
+    if (!timeKnown || getLocalTime() / 86400 == sunTimes.day())
+    {
+        return;
+    }
+    setSunAnchors();
+    compileRules();
+    startScheduler();
 }
 
-void onStationModeGotIP(const WiFiEventStationModeGotIP &event)
+void setSunAnchors(void)
 {
-    Serial.printf("[WIFI] Got IP: %s\r\n", event.ip.toString().c_str());
-    ledStatusOff();
+    bool known = timeKnown;
+    uint16_t day = getLocalTime() / 86400;
+    if (known)
+    {
+        sunTimes.update(day);
+    }
+
+    for (uint8_t anchor = RULE_ANCHOR_SUNRISE; anchor < RULE_ANCHOR_COUNT; anchor++)
+    {
+        int16_t minute = known ? getSunMinute(anchor, day) : -1;
+        ruleEngine.setAnchor(anchor, minute);
+        if (minute >= 0)
+        {
+            Serial.printf("[Sun] %s at %02d:%02d.\r\n", SUN_ANCHOR_NAMES[anchor], minute / 60, minute % 60);
+        }
+    }
 }
 
-void onStationModeDisconnected(const WiFiEventStationModeDisconnected &event)
+/*
+ * Local minute of the day of a sun anchor, -1 without a location or when
+ * the sun does not rise or set that day. Only today is cached; the
+ * scheduler asks for other days only when an anchored entry fires.
+ */
+int16_t getSunMinute(uint8_t anchor, uint16_t day)
 {
-    Serial.println("[WIFI] Disconnected.");
+    uint8_t event = anchor - RULE_ANCHOR_SUNRISE;
+    if (!sunTimes.hasLocation() || anchor < RULE_ANCHOR_SUNRISE || event >= SUN_EVENT_COUNT)
+    {
+        return -1;
+    }
+
+    uint32_t time = sunTimes.time(event);
+    if (day != sunTimes.day())
+    {
+        uint32_t times[SUN_EVENT_COUNT];
+        SunTimes::calculate(day, latitude, longitude, times);
+        time = times[event];
+    }
+    return (time == SUN_TIME_NONE) ? -1 : TimeZone::minuteOfDay(timeZone.toLocal(time));
+}
+
+void makeRuleInputs(RuleInputs &inputs)
+{
+    inputs.values[RULE_SENSOR_LDR] = getLDRValue();
+    inputs.valid[RULE_SENSOR_LDR] = true;
+    inputs.values[RULE_SENSOR_TIME] = TimeZone::minuteOfDay(getLocalTime());
+    inputs.valid[RULE_SENSOR_TIME] = timeKnown;
+}
+
+void evaluateRules(const RuleInputs &inputs)
+{
+    lastAutomationMillis = millis();
+    automationRetry = false;
+
+    int8_t match = ruleEngine.evaluate(inputs);
+    if (match < 0)
+    {
+        return;
+    }
+
+    int state = (ruleEngine.rule(match).action == RULE_ACTION_RELAY_ON) ? RELAY_STATE_ON : RELAY_STATE_OFF;
+    if (readRelay() == state)
+    {
+        return;
+    }
+
+    // Minimum dwell, counted from the last switch by anyone.
+    unsigned long dwell = (readRelay() == RELAY_STATE_ON ? minOnTime : minOffTime) * 1000UL;
+    unsigned long elapsed = millis() - relaySwitchedMillis;
+    if (relaySwitched && elapsed < dwell)
+    {
+        // Nothing may change by then, so come back when the dwell is over.
+        Serial.printf("[Rules] Rule %d held back, switched %lu s ago.\r\n", match, elapsed / 1000);
+        automationRetry = true;
+        automationRetryMillis = relaySwitchedMillis + dwell;
+        return;
+    }
+
+    Serial.printf("[Rules] Rule %d: %s Automatic. LDR %.2f, time %02d:%02d.\r\n", match,
+                  (state == RELAY_STATE_ON) ? "Turn On" : "Shutdown", inputs.values[RULE_SENSOR_LDR],
+                  (int)inputs.values[RULE_SENSOR_TIME] / 60, (int)inputs.values[RULE_SENSOR_TIME] % 60);
+    writeRelay(state);
+}
+
+void onPageNotFound(void)
+{
+    Serial.print("[WebServer] Page Not Found: ");
+    Serial.println(webserver.uri());
+}
+
+void onStatusPage(void)
+{
+    Serial.println("[WebServer] Opening 'Status' page.");
+    sendStatusPageHtml();
+}
+
+void onConfigHomePage(void)
+{
+    Serial.println("[WebServer] Opening 'Config' page.");
+    sendConfigPageHtml();
+}
+
+void onConfigApplyPage(void)
+{
+    Serial.println("[WebServer] Received New Configuration.");
+    if (webserver.method() != HTTP_POST)
+    {
+        Serial.println("[WebServer] Only allow POST method.");
+        webserver.send(404, "text/plain", "Method not allow");
+        return;
+    }
+
+    // Edit a copy so only what changed gets saved and applied.
+    ConfigRecord next;
+    makeConfigRecord(next);
+    setFormNetwork(next.ssid, next.password, "SSID", "Password");
+    for (uint8_t i = 0; i < CONFIG_BACKUP_NETWORKS; i++)
+    {
+        ConfigNetwork &network = ConfigStore::backupNetwork(next, i);
+        char ssidKey[12];
+        char passwordKey[12];
+        snprintf(ssidKey, sizeof(ssidKey), "SSID%d", i + 2);
+        snprintf(passwordKey, sizeof(passwordKey), "Password%d", i + 2);
+        setFormNetwork(network.ssid, network.password, ssidKey, passwordKey);
+    }
+    ConfigStore::setString(next.relayDisplayName, sizeof(next.relayDisplayName), webserver.arg("RelayDisplayName"));
+
+    next.enableTurnOnThreshold = webserver.arg("EnableTurnOnThreshold") == "on" ? true : false;
+    next.turnOnThreshold = webserver.arg("TurnOnThreshold").toFloat();
+    next.enableShutdownThreshold = webserver.arg("EnableShutdownThreshold") == "on" ? true : false;
+    next.shutdownThreshold = webserver.arg("ShutdownThreshold").toFloat();
+
+    /*
+     * EnableTurnOnTimeRange
+     * TurnOnBeginTime
+     * TurnOnEndTime
+     */
+    if (webserver.arg("TurnOnBeginTime").length() == 5 && webserver.arg("TurnOnEndTime").length() == 5 )
+    {
+        next.enableTurnOnTimeRange = webserver.arg("EnableTurnOnTimeRange") == "on" ? true : false;
+        next.turnOnBeginHour = webserver.arg("TurnOnBeginTime").substring(0, 2).toInt();
+        next.turnOnBeginMinute = webserver.arg("TurnOnBeginTime").substring(3, 5).toInt();
+        next.turnOnEndHour = webserver.arg("TurnOnEndTime").substring(0, 2).toInt();
+        next.turnOnEndMinute = webserver.arg("TurnOnEndTime").substring(3, 5).toInt();
+    }
+    else
+    {
+        next.enableTurnOnTimeRange = false;
+        next.turnOnBeginHour = -1;
+        next.turnOnBeginMinute = -1;
+        next.turnOnEndHour = -1;
+        next.turnOnEndMinute = -1;
+    }
+
+    /*
+     * EnableShutdownTimeRange
+     * ShutdownBeginTime
+     * ShutdownEndTime
+     */
+    if (webserver.arg("ShutdownBeginTime").length() == 5 && webserver.arg("ShutdownEndTime").length() == 5 )
+    {
+        next.enableShutdownTimeRange = webserver.arg("EnableShutdownTimeRange") == "on" ? true : false;
+        next.shutdownBeginHour = webserver.arg("ShutdownBeginTime").substring(0, 2).toInt();
+        next.shutdownBeginMinute = webserver.arg("ShutdownBeginTime").substring(3, 5).toInt();
+        next.shutdownEndHour = webserver.arg("ShutdownEndTime").substring(0, 2).toInt();
+        next.shutdownEndMinute = webserver.arg("ShutdownEndTime").substring(3, 5).toInt();
+    }
+    else
+    {
+        next.enableShutdownTimeRange = false;
+        next.shutdownBeginHour = -1;
+        next.shutdownBeginMinute = -1;
+        next.shutdownEndHour = -1;
+        next.shutdownEndMinute = -1;
+    }
+
+    // Missing from pages cached before these settings existed.
+    if (webserver.hasArg("MinOnTime"))
+    {
+        next.minOnTime = constrain(webserver.arg("MinOnTime").toInt(), 0, 65535);
+    }
+    if (webserver.hasArg("MinOffTime"))
+    {
+        next.minOffTime = constrain(webserver.arg("MinOffTime").toInt(), 0, 65535);
+    }
+    if (webserver.hasArg("LDRHysteresis"))
+    {
+        next.ldrHysteresis = constrain(webserver.arg("LDRHysteresis").toInt(), 0, 100);
+    }
+
+    // A rule that does not parse keeps the current one.
+    TimeZoneRule zone;
+    if (webserver.hasArg("TimeZone") && webserver.arg("TimeZone").length() < sizeof(next.timeZone) &&
+        TimeZone::parse(webserver.arg("TimeZone").c_str(), zone))
+    {
+        ConfigStore::setString(next.timeZone, sizeof(next.timeZone), webserver.arg("TimeZone"));
+    }
+
+    if (webserver.hasArg("Latitude") && webserver.hasArg("Longitude"))
+    {
+        next.enableLocation = webserver.arg("EnableLocation") == "on" ? true : false;
+        next.latitude = constrain(webserver.arg("Latitude").toFloat(), -90.0f, 90.0f);
+        next.longitude = constrain(webserver.arg("Longitude").toFloat(), -180.0f, 180.0f);
+    }
+
+    Serial.printf("[WebServer] SSID: %s\r\n", next.ssid);
+    Serial.printf("[WebServer] Password: %s\r\n", next.password);
+
+    Serial.printf("[WebServer] Turn On Threshold: %s, %.2f\r\n", next.enableTurnOnThreshold ? "True" : "False", next.turnOnThreshold);
+    Serial.printf("[WebServer] Shutdown Threshold: %s, %.2f\r\n", next.enableShutdownThreshold ? "True" : "False", next.shutdownThreshold);
+
+    Serial.printf("[WebServer] Turn On by Time: %s; From %02d:%02d to %02d:%02d\r\n", next.enableTurnOnTimeRange ? "True" : "False", next.turnOnBeginHour, next.turnOnBeginMinute, next.turnOnEndHour, next.turnOnEndMinute);
+    Serial.printf("[WebServer] Shutdown by Time: %s; From %02d:%02d to %02d:%02d\r\n", next.enableShutdownTimeRange ? "True" : "False", next.shutdownBeginHour, next.shutdownBeginMinute, next.shutdownEndHour, next.shutdownEndMinute);
+    Serial.printf("[WebServer] Time Zone: %s\r\n", next.timeZone);
+    Serial.printf("[WebServer] Location: %s, %.4f, %.4f\r\n", next.enableLocation ? "True" : "False", next.latitude, next.longitude);
+
+    sendRedirectHtml();
+
+    applyConfigChange(next);
+}
+
+/*
+ * Takes a network from the config form. The page is filled from
+ * /api/v1/config, which does not export passwords, so an empty password
+ * keeps the stored one as long as the SSID stays the same.
+ */
+void setFormNetwork(char *ssid, char *password, const char *ssidKey, const char *passwordKey)
+{
+    String newSSID = webserver.arg(ssidKey);
+    String newPassword = webserver.arg(passwordKey);
+    if (newPassword.length() > 0 || newSSID != ssid)
+    {
+        ConfigStore::setString(password, CONFIG_PASSWORD_SIZE, newPassword);
+    }
+    ConfigStore::setString(ssid, CONFIG_SSID_SIZE, newSSID);
+}
+
+/*
+ * Applies and saves a configuration. Nothing is written when it equals the
+ * current one, and the station only reconnects when a network changed.
+ */
+bool applyConfigChange(const ConfigRecord &next)
+{
+    ConfigRecord current;
+    makeConfigRecord(current);
+    if (memcmp(&current, &next, sizeof(current)) == 0)
+    {
+        Serial.println("[Config] No changes.");
+        return true;
+    }
+
+    bool wifiChanged = strcmp(current.ssid, next.ssid) != 0 || strcmp(current.password, next.password) != 0;
+    for (uint8_t i = 0; i < CONFIG_BACKUP_NETWORKS; i++)
+    {
+        wifiChanged = wifiChanged || memcmp(&ConfigStore::backupNetwork(current, i), &ConfigStore::backupNetwork(next, i),
+                                            sizeof(ConfigNetwork)) != 0;
+    }
+
+    applyConfigRecord(next);
+    bool saved = saveWifiConfig();
+
+    if (wifiChanged)
+    {
+        Serial.println("[Config] WiFi credentials changed, reconnecting.");
+        WiFi.disconnect(false);
+        connectStation();
+    }
+    return saved;
+}
+
+void onRelayHomePage(void)
+{
+    Serial.println("[WebServer] Opening 'Home' page.");
+    sendHomePageHtml();
+}
+
+void onRelayOn(void)
+{
+    Serial.println("[WebServer] Relay ON");
+    writeRelay(RELAY_STATE_ON);
+    sendRedirectHtml();
+}
+
+void onRelayOff(void)
+{
+    Serial.println("[WebServer] Relay OFF");
+    writeRelay(RELAY_STATE_OFF);
+    sendRedirectHtml();
+}
+
+void onApiStatus(void)
+{
+    if (webserver.method() != HTTP_GET)
+    {
+        sendJsonError(405, "Method not allowed");
+        return;
+    }
+
+    StaticJsonDocument<1024> doc;
+    buildRelayJson(doc.createNestedObject("relay"));
+
+    buildWifiJson(doc.createNestedObject("sta"));
+
+    JsonObject ap = doc.createNestedObject("ap");
+    ap["ssid"] = deviceName.c_str();
+    ap["ip"] = WiFi.softAPIP().toString();
+
+    doc["ldr"] = getLDRValue();
+
+    // Raw counts over the last ADC_SAMPLER_WINDOW samples.
+    JsonObject adc = doc.createNestedObject("adc");
+    adc["rate"] = ldrSampler.rate();
+    adc["count"] = ldrSampler.count();
+    adc["min"] = ldrSampler.minimum();
+    adc["max"] = ldrSampler.maximum();
+    adc["mean"] = ldrSampler.mean();
+    adc["p50"] = ldrSampler.percentile(50);
+    adc["p90"] = ldrSampler.percentile(90);
+    adc["overruns"] = ldrSampler.overruns();
+
+    // Today's local sun times, null without a location or a clock.
+    if (sunTimes.hasLocation() && timeKnown)
+    {
+        JsonObject sun = doc.createNestedObject("sun");
+        for (uint8_t anchor = RULE_ANCHOR_SUNRISE; anchor < RULE_ANCHOR_COUNT; anchor++)
+        {
+            int16_t minute = getSunMinute(anchor, sunTimes.day());
+            if (minute < 0)
+            {
+                sun[SUN_ANCHOR_NAMES[anchor]] = nullptr;
+                continue;
+            }
+            setRuleValue(sun, SUN_ANCHOR_NAMES[anchor], RULE_SENSOR_TIME, minute, RULE_ANCHOR_NONE);
+        }
+    }
+    else
+    {
+        doc["sun"] = nullptr;
+    }
+
+    doc["uptime"] = (uptimeOffset + millis()) / 1000;
+    doc["heap"] = ESP.getFreeHeap();
+
+    sendJson(200, doc);
+}
+
+void onApiRelay(void)
+{
+    if (webserver.method() == HTTP_PUT)
+    {
+        StaticJsonDocument<64> request;
+        DeserializationError error = deserializeJson(request, webserver.arg("plain"));
+        if (error)
+        {
+            sendJsonError(400, error.c_str());
+            return;
+        }
+
+        // Accept {"state": true|false}, {"state": 1|0} or {"state": "on"|"off"}.
+        JsonVariant state = request["state"];
+        int newState;
+        if (state.is<bool>() || state.is<int>())
+        {
+            newState = state.as<bool>() ? RELAY_STATE_ON : RELAY_STATE_OFF;
+        }
+        else if (state.is<const char *>() && strcmp(state.as<const char *>(), "on") == 0)
+        {
+            newState = RELAY_STATE_ON;
+        }
+        else if (state.is<const char *>() && strcmp(state.as<const char *>(), "off") == 0)
+        {
+            newState = RELAY_STATE_OFF;
+        }
+        else
+        {
+            sendJsonError(400, "Invalid state");
+            return;
+        }
+
+        Serial.printf("[WebServer] API Relay %s\r\n", (newState == RELAY_STATE_OFF) ? "OFF" : "ON");
+        writeRelay(newState);
+    }
+    else if (webserver.method() != HTTP_GET)
+    {
+        sendJsonError(405, "Method not allowed");
+        return;
+    }
+
+    StaticJsonDocument<128> doc;
+    buildRelayJson(doc.to<JsonObject>());
+    sendJson(200, doc);
+}
+
+void onEventClientConnected(void)
+{
+    Serial.println("[WebServer] Event client subscribed.");
+
+    // Bring the new client up to date with a full set of events.
+    relayEventPending = true;
+    wifiEventPending = true;
+    ldrEventPending = true;
+}
+
+void publishEvents(void)
+{
+    eventStream.loop();
+    if (!eventStream.hasSubscribers())
+    {
+        return;
+    }
+
+    if (relayEventPending)
+    {
+        relayEventPending = false;
+        StaticJsonDocument<128> doc;
+        buildRelayJson(doc.to<JsonObject>());
+        eventStream.publish("relay", doc);
+    }
+
+    if (wifiEventPending)
+    {
+        wifiEventPending = false;
+        StaticJsonDocument<256> doc;
+        buildWifiJson(doc.to<JsonObject>());
+        eventStream.publish("wifi", doc);
+    }
+
+    // The LDR is only sampled while somebody listens, and only sent when it moved.
+    unsigned long currentMillis = millis();
+    if ((currentMillis - lastLDREventMillis) < LDR_EVENT_INTERVAL)
+    {
+        return;
+    }
+    lastLDREventMillis = currentMillis;
+
+    float ldr = getLDRValue();
+    float delta = lastLDREventValue * LDR_EVENT_DELTA_RATIO;
+    if (delta < LDR_EVENT_MIN_DELTA)
+    {
+        delta = LDR_EVENT_MIN_DELTA;
+    }
+
+    if (ldrEventPending || fabs(ldr - lastLDREventValue) >= delta)
+    {
+        ldrEventPending = false;
+        lastLDREventValue = ldr;
+        StaticJsonDocument<32> doc;
+        doc["ldr"] = ldr;
+        eventStream.publish("ldr", doc);
+    }
+}
+
+void onApiConfig(void)
+{
+    if (webserver.method() == HTTP_PATCH)
+    {
+        StaticJsonDocument<1024> request;
+        DeserializationError error = deserializeJson(request, webserver.arg("plain"));
+        if (error)
+        {
+            sendJsonError(400, error.c_str());
+            return;
+        }
+        if (!request.is<JsonObject>())
+        {
+            sendJsonError(400, "Expected an object");
+            return;
+        }
+
+        // Fields not in the request keep their value; one bad field rejects all.
+        ConfigRecord next;
+        makeConfigRecord(next);
+        for (JsonPair field : request.as<JsonObject>())
+        {
+            if (!patchConfigField(next, field.key().c_str(), field.value()))
+            {
+                String message("Invalid field: ");
+                message.concat(field.key().c_str());
+                sendJsonError(400, message.c_str());
+                return;
+            }
+        }
+
+        if (!applyConfigChange(next))
+        {
+            sendJsonError(500, "Failed to save configuration");
+            return;
+        }
+    }
+    else if (webserver.method() != HTTP_GET)
+    {
+        sendJsonError(405, "Method not allowed");
+        return;
+    }
+
+    // Export only, the device keeps its configuration in CONFIG_FILE.
+    StaticJsonDocument<768> doc;
+    buildConfigJson(doc.to<JsonObject>());
+    sendJson(200, doc);
+}
+
+bool patchConfigField(ConfigRecord &record, const char *key, JsonVariant value)
+{
+    // Backup networks are "SSID2"/"Password2" and so on.
+    for (uint8_t i = 0; i < CONFIG_BACKUP_NETWORKS; i++)
+    {
+        ConfigNetwork &network = ConfigStore::backupNetwork(record, i);
+        char ssidKey[12];
+        char passwordKey[12];
+        snprintf(ssidKey, sizeof(ssidKey), "SSID%d", i + 2);
+        snprintf(passwordKey, sizeof(passwordKey), "Password%d", i + 2);
+        bool isSSID = strcmp(key, ssidKey) == 0;
+        if (isSSID || strcmp(key, passwordKey) == 0)
+        {
+            if (!value.is<const char *>())
+            {
+                return false;
+            }
+            if (isSSID)
+            {
+                ConfigStore::setString(network.ssid, sizeof(network.ssid), String(value.as<const char *>()));
+            }
+            else
+            {
+                ConfigStore::setString(network.password, sizeof(network.password), String(value.as<const char *>()));
+            }
+            return true;
+        }
+    }
+
+    if (strcmp(key, "SSID") == 0 || strcmp(key, "Password") == 0 || strcmp(key, "RelayDisplayName") == 0)
+    {
+        if (!value.is<const char *>())
+        {
+            return false;
+        }
+        String text(value.as<const char *>());
+        if (strcmp(key, "SSID") == 0)
+        {
+            ConfigStore::setString(record.ssid, sizeof(record.ssid), text);
+        }
+        else if (strcmp(key, "Password") == 0)
+        {
+            ConfigStore::setString(record.password, sizeof(record.password), text);
+        }
+        else
+        {
+            ConfigStore::setString(record.relayDisplayName, sizeof(record.relayDisplayName), text);
+        }
+        return true;
+    }
+
+    if (strcmp(key, "EnableTurnOnThreshold") == 0 || strcmp(key, "EnableShutdownThreshold") == 0 ||
+        strcmp(key, "EnableTurnOnTimeRange") == 0 || strcmp(key, "EnableShutdownTimeRange") == 0 ||
+        strcmp(key, "EnableLocation") == 0)
+    {
+        if (!value.is<bool>())
+        {
+            return false;
+        }
+        uint8_t enable = value.as<bool>() ? 1 : 0;
+        if (strcmp(key, "EnableTurnOnThreshold") == 0)
+        {
+            record.enableTurnOnThreshold = enable;
+        }
+        else if (strcmp(key, "EnableShutdownThreshold") == 0)
+        {
+            record.enableShutdownThreshold = enable;
+        }
+        else if (strcmp(key, "EnableTurnOnTimeRange") == 0)
+        {
+            record.enableTurnOnTimeRange = enable;
+        }
+        else if (strcmp(key, "EnableShutdownTimeRange") == 0)
+        {
+            record.enableShutdownTimeRange = enable;
+        }
+        else
+        {
+            record.enableLocation = enable;
+        }
+        return true;
+    }
+
+    if (strcmp(key, "TurnOnThreshold") == 0 || strcmp(key, "ShutdownThreshold") == 0)
+    {
+        if (!value.is<float>())
+        {
+            return false;
+        }
+        float &threshold = (strcmp(key, "TurnOnThreshold") == 0) ? record.turnOnThreshold : record.shutdownThreshold;
+        threshold = value.as<float>();
+        return true;
+    }
+
+    if (strcmp(key, "TurnOnBeginHour") == 0)
+    {
+        return patchTimeField(record.turnOnBeginHour, value, 23);
+    }
+    if (strcmp(key, "TurnOnBeginMinute") == 0)
+    {
+        return patchTimeField(record.turnOnBeginMinute, value, 59);
+    }
+    if (strcmp(key, "TurnOnEndHour") == 0)
+    {
+        return patchTimeField(record.turnOnEndHour, value, 23);
+    }
+    if (strcmp(key, "TurnOnEndMinute") == 0)
+    {
+        return patchTimeField(record.turnOnEndMinute, value, 59);
+    }
+    if (strcmp(key, "ShutdownBeginHour") == 0)
+    {
+        return patchTimeField(record.shutdownBeginHour, value, 23);
+    }
+    if (strcmp(key, "ShutdownBeginMinute") == 0)
+    {
+        return patchTimeField(record.shutdownBeginMinute, value, 59);
+    }
+    if (strcmp(key, "ShutdownEndHour") == 0)
+    {
+        return patchTimeField(record.shutdownEndHour, value, 23);
+    }
+    if (strcmp(key, "ShutdownEndMinute") == 0)
+    {
+        return patchTimeField(record.shutdownEndMinute, value, 59);
+    }
+
+    if (strcmp(key, "MinOnTime") == 0 || strcmp(key, "MinOffTime") == 0 || strcmp(key, "LDRHysteresis") == 0)
+    {
+        int max = (strcmp(key, "LDRHysteresis") == 0) ? 100 : 65535;
+        if (!value.is<int>() || value.as<int>() < 0 || value.as<int>() > max)
+        {
+            return false;
+        }
+        if (strcmp(key, "MinOnTime") == 0)
+        {
+            record.minOnTime = value.as<int>();
+        }
+        else if (strcmp(key, "MinOffTime") == 0)
+        {
+            record.minOffTime = value.as<int>();
+        }
+        else
+        {
+            record.ldrHysteresis = value.as<int>();
+        }
+        return true;
+    }
+
+    if (strcmp(key, "TimeZone") == 0)
+    {
+        TimeZoneRule zone;
+        if (!value.is<const char *>() || strlen(value.as<const char *>()) >= sizeof(record.timeZone) ||
+            !TimeZone::parse(value.as<const char *>(), zone))
+        {
+            return false;
+        }
+        ConfigStore::setString(record.timeZone, sizeof(record.timeZone), String(value.as<const char *>()));
+        return true;
+    }
+
+    if (strcmp(key, "Latitude") == 0 || strcmp(key, "Longitude") == 0)
+    {
+        float limit = (strcmp(key, "Latitude") == 0) ? 90.0f : 180.0f;
+        if (!value.is<float>() || value.as<float>() < -limit || value.as<float>() > limit)
+        {
+            return false;
+        }
+        float &coordinate = (strcmp(key, "Latitude") == 0) ? record.latitude : record.longitude;
+        coordinate = value.as<float>();
+        return true;
+    }
+
+    return false;
+}
+
+bool patchTimeField(int8_t &field, JsonVariant value, int max)
+{
+    // -1 clears the field, like an empty time on the config page.
+    if (!value.is<int>() || value.as<int>() < -1 || value.as<int>() > max)
+    {
+        return false;
+    }
+    field = value.as<int>();
+    return true;
+}
+
+/*
+ * GET lists the rules added over HTTP, PUT replaces them:
+ *
+ *   {"rules": [{"action": "on", "when": [
+ *       {"sensor": "ldr", "op": "<=", "value": 3.5},
+ *       {"sensor": "time", "op": "between", "from": "18:00", "to": "01:30"}]}]}
+ *
+ * A time may also be "sunrise", "sunset", "dawn" or "dusk" (civil
+ * twilight), optionally with an offset in minutes such as "sunset-15". It
+ * needs the location set, and never matches on a day that event has not.
+ * The threshold and time range settings are compiled in ahead of them.
+ */
+void onApiRules(void)
+{
+    if (webserver.method() == HTTP_PUT)
+    {
+        DynamicJsonDocument request(3072);
+        DeserializationError error = deserializeJson(request, webserver.arg("plain"));
+        if (error)
+        {
+            sendJsonError(400, error.c_str());
+            return;
+        }
+
+        JsonArray rules = request["rules"].as<JsonArray>();
+        if (rules.isNull())
+        {
+            sendJsonError(400, "Expected a rules array");
+            return;
+        }
+        if (rules.size() > RULE_STORE_MAX_RULES)
+        {
+            sendJsonError(400, "Too many rules");
+            return;
+        }
+
+        Rule next[RULE_STORE_MAX_RULES];
+        uint8_t count = 0;
+        for (JsonVariant rule : rules)
+        {
+            if (!parseRule(rule.as<JsonObject>(), next[count]))
+            {
+                String message("Invalid rule: ");
+                message.concat(count);
+                sendJsonError(400, message.c_str());
+                return;
+            }
+            count++;
+        }
+
+        if (!ruleStore.save(next, count))
+        {
+            sendJsonError(500, "Failed to save rules");
+            return;
+        }
+        memcpy(customRules, next, sizeof(Rule) * count);
+        customRuleCount = count;
+        compileRules();
+    }
+    else if (webserver.method() != HTTP_GET)
+    {
+        sendJsonError(405, "Method not allowed");
+        return;
+    }
+
+    DynamicJsonDocument doc(3072);
+    JsonArray rules = doc.createNestedArray("rules");
+    for (uint8_t i = 0; i < customRuleCount; i++)
+    {
+        buildRuleJson(rules.createNestedObject(), customRules[i]);
+    }
+    doc["active"] = ruleEngine.count();
+    sendJson(200, doc);
+}
+
+bool parseRule(JsonObject object, Rule &rule)
+{
+    memset(&rule, 0, sizeof(rule));
+    if (object.isNull() || !object["action"].is<const char *>())
+    {
+        return false;
+    }
+    const char *action = object["action"].as<const char *>();
+    if (strcmp(action, "on") == 0)
+    {
+        rule.action = RULE_ACTION_RELAY_ON;
+    }
+    else if (strcmp(action, "off") == 0)
+    {
+        rule.action = RULE_ACTION_RELAY_OFF;
+    }
+    else
+    {
+        return false;
+    }
+
+    JsonArray conditions = object["when"].as<JsonArray>();
+    if (conditions.isNull() || conditions.size() == 0 || conditions.size() > RULE_MAX_CONDITIONS)
+    {
+        return false;
+    }
+    for (JsonVariant item : conditions)
+    {
+        JsonObject condition = item.as<JsonObject>();
+        RuleCondition &target = rule.conditions[rule.conditionCount++];
+        if (condition.isNull() || !condition["sensor"].is<const char *>() || !condition["op"].is<const char *>())
+        {
+            return false;
+        }
+
+        const char *sensor = condition["sensor"].as<const char *>();
+        if (strcmp(sensor, "ldr") == 0)
+        {
+            target.sensor = RULE_SENSOR_LDR;
+        }
+        else if (strcmp(sensor, "time") == 0)
+        {
+            target.sensor = RULE_SENSOR_TIME;
+        }
+        else
+        {
+            return false;
+        }
+
+        const char *op = condition["op"].as<const char *>();
+        bool valid;
+        if (strcmp(op, "<=") == 0)
+        {
+            target.op = RULE_OP_LESS_EQUAL;
+            valid = parseRuleValue(condition["value"], target.sensor, target.high, target.highAnchor);
+        }
+        else if (strcmp(op, ">=") == 0)
+        {
+            target.op = RULE_OP_GREATER_EQUAL;
+            valid = parseRuleValue(condition["value"], target.sensor, target.low, target.lowAnchor);
+        }
+        else if (strcmp(op, "between") == 0)
+        {
+            target.op = RULE_OP_BETWEEN;
+            valid = parseRuleValue(condition["from"], target.sensor, target.low, target.lowAnchor) &&
+                    parseRuleValue(condition["to"], target.sensor, target.high, target.highAnchor);
+        }
+        else
+        {
+            valid = false;
+        }
+        if (!valid)
+        {
+            return false;
+        }
+    }
+    return RuleEngine::isValid(rule);
+}
+
+bool parseRuleValue(JsonVariant value, uint8_t sensor, float &result, uint8_t &anchor)
+{
+    // Times are "HH:MM" or a sun time with an optional offset in minutes,
+    // such as "sunset-15"; anything else a number.
+    anchor = RULE_ANCHOR_NONE;
+    if (sensor == RULE_SENSOR_TIME && value.is<const char *>() && isalpha(value.as<const char *>()[0]))
+    {
+        const char *text = value.as<const char *>();
+        for (uint8_t i = RULE_ANCHOR_SUNRISE; i < RULE_ANCHOR_COUNT; i++)
+        {
+            size_t length = strlen(SUN_ANCHOR_NAMES[i]);
+            if (strncmp(text, SUN_ANCHOR_NAMES[i], length) != 0)
+            {
+                continue;
+            }
+
+            const char *offset = text + length;
+            if (*offset == '\0')
+            {
+                anchor = i;
+                result = 0;
+                return true;
+            }
+            if ((*offset != '+' && *offset != '-') || strlen(offset) > 4)
+            {
+                return false;
+            }
+            for (const char *p = offset + 1; *p != '\0'; p++)
+            {
+                if (!isdigit(*p))
+                {
+                    return false;
+                }
+            }
+            anchor = i;
+            result = atoi(offset);
+            return offset[1] != '\0' && fabsf(result) <= RULE_MAX_ANCHOR_OFFSET;
+        }
+        return false;
+    }
+    if (sensor == RULE_SENSOR_TIME)
+    {
+        const char *text = value.as<const char *>();
+        if (!value.is<const char *>() || strlen(text) != 5 || text[2] != ':' || !isdigit(text[0]) ||
+            !isdigit(text[1]) || !isdigit(text[3]) || !isdigit(text[4]))
+        {
+            return false;
+        }
+        int hour = (text[0] - '0') * 10 + (text[1] - '0');
+        int minute = (text[3] - '0') * 10 + (text[4] - '0');
+        if (hour > 23 || minute > 59)
+        {
+            return false;
+        }
+        result = hour * 60 + minute;
+        return true;
+    }
+
+    if (!value.is<float>())
+    {
+        return false;
+    }
+    result = value.as<float>();
+    return true;
+}
+
+void buildRuleJson(JsonObject object, const Rule &rule)
+{
+    object["action"] = (rule.action == RULE_ACTION_RELAY_ON) ? "on" : "off";
+    JsonArray conditions = object.createNestedArray("when");
+    for (uint8_t i = 0; i < rule.conditionCount; i++)
+    {
+        const RuleCondition &condition = rule.conditions[i];
+        JsonObject item = conditions.createNestedObject();
+        item["sensor"] = (condition.sensor == RULE_SENSOR_TIME) ? "time" : "ldr";
+        if (condition.op == RULE_OP_LESS_EQUAL)
+        {
+            item["op"] = "<=";
+            setRuleValue(item, "value", condition.sensor, condition.high, condition.highAnchor);
+        }
+        else if (condition.op == RULE_OP_GREATER_EQUAL)
+        {
+            item["op"] = ">=";
+            setRuleValue(item, "value", condition.sensor, condition.low, condition.lowAnchor);
+        }
+        else
+        {
+            item["op"] = "between";
+            setRuleValue(item, "from", condition.sensor, condition.low, condition.lowAnchor);
+            setRuleValue(item, "to", condition.sensor, condition.high, condition.highAnchor);
+        }
+    }
+}
+
+void setRuleValue(JsonObject object, const char *key, uint8_t sensor, float value, uint8_t anchor)
+{
+    if (sensor != RULE_SENSOR_TIME)
+    {
+        object[key] = value;
+        return;
+    }
+
+    char text[16];
+    if (anchor != RULE_ANCHOR_NONE && anchor < RULE_ANCHOR_COUNT)
+    {
+        if (value == 0)
+        {
+            object[key] = SUN_ANCHOR_NAMES[anchor];
+            return;
+        }
+        snprintf(text, sizeof(text), "%s%+d", SUN_ANCHOR_NAMES[anchor], (int)value);
+        object[key] = String(text);
+        return;
+    }
+
+    unsigned int minutes = (unsigned int)value % RULE_MINUTES_PER_DAY;
+    snprintf(text, sizeof(text), "%02u:%02u", minutes / 60, minutes % 60);
+    object[key] = String(text);
+}
+
+void loadSchedules(void)
+{
+    ScheduleEntry entries[SCHEDULE_MAX_ENTRIES];
+    uint16_t exceptions[SCHEDULE_MAX_EXCEPTIONS];
+    uint8_t count, exceptionCount;
+    scheduler.clear();
+    if (scheduleStore.load(entries, count, exceptions, exceptionCount))
+    {
+        for (uint8_t i = 0; i < count; i++)
+        {
+            scheduler.add(entries[i]);
+        }
+        for (uint8_t i = 0; i < exceptionCount; i++)
+        {
+            scheduler.addException(exceptions[i]);
+        }
+        Serial.printf("[Schedule] Loaded %d entries, %d exception dates.\r\n", scheduler.count(), scheduler.exceptionCount());
+    }
+    startScheduler();
+}
+
+void startScheduler(void)
+{
+    if (timeKnown)
+    {
+        scheduler.start(getLocalTime());
+    }
+}
+
+void runSchedules(uint32_t now)
+{
+    int8_t index;
+    while ((index = scheduler.poll(now)) >= 0)
+    {
+        const ScheduleEntry &entry = scheduler.entry(index);
+        int state = (entry.action == SCHEDULE_ACTION_RELAY_ON) ? RELAY_STATE_ON : RELAY_STATE_OFF;
+        Serial.printf("[Schedule] Entry %d: %s at %02u:%02u.\r\n", index, (state == RELAY_STATE_ON) ? "Turn On" : "Shutdown",
+                      now / 3600 % 24, now / 60 % 60);
+        if (readRelay() != state)
+        {
+            writeRelay(state);
+        }
+    }
+}
+
+/*
+ * GET lists the schedule, PUT replaces it:
+ * {"schedules":[{"action":"on","at":"07:00","days":["mon","fri"]},
+ *               {"action":"off","at":"18:00","date":"2026-12-24"}],
+ *  "exceptions":["2026-12-25"]}
+ * Weekly entries do not fire on the exception dates. "at" takes the same
+ * times as the rules, "sunset-15" included. "relay" selects the relay, 0 by
+ * default.
+ */
+void onApiSchedules(void)
+{
+    if (webserver.method() == HTTP_PUT)
+    {
+        DynamicJsonDocument request(4096);
+        DeserializationError error = deserializeJson(request, webserver.arg("plain"));
+        if (error)
+        {
+            sendJsonError(400, error.c_str());
+            return;
+        }
+
+        JsonArray schedules = request["schedules"].as<JsonArray>();
+        JsonArray dates = request["exceptions"].as<JsonArray>();
+        if (schedules.isNull())
+        {
+            sendJsonError(400, "Expected a schedules array");
+            return;
+        }
+        if (schedules.size() > SCHEDULE_MAX_ENTRIES || dates.size() > SCHEDULE_MAX_EXCEPTIONS)
+        {
+            sendJsonError(400, "Too many entries");
+            return;
+        }
+
+        ScheduleEntry entries[SCHEDULE_MAX_ENTRIES];
+        uint16_t exceptions[SCHEDULE_MAX_EXCEPTIONS];
+        uint8_t count = 0, exceptionCount = 0;
+        for (JsonVariant schedule : schedules)
+        {
+            if (!parseSchedule(schedule.as<JsonObject>(), entries[count]))
+            {
+                String message("Invalid schedule: ");
+                message.concat(count);
+                sendJsonError(400, message.c_str());
+                return;
+            }
+            count++;
+        }
+        for (JsonVariant date : dates)
+        {
+            if (!parseDate(date, exceptions[exceptionCount]))
+            {
+                String message("Invalid exception date: ");
+                message.concat(exceptionCount);
+                sendJsonError(400, message.c_str());
+                return;
+            }
+            exceptionCount++;
+        }
+
+        if (!scheduleStore.save(entries, count, exceptions, exceptionCount))
+        {
+            sendJsonError(500, "Failed to save schedules");
+            return;
+        }
+        scheduler.clear();
+        for (uint8_t i = 0; i < count; i++)
+        {
+            scheduler.add(entries[i]);
+        }
+        for (uint8_t i = 0; i < exceptionCount; i++)
+        {
+            scheduler.addException(exceptions[i]);
+        }
+        startScheduler();
+    }
+    else if (webserver.method() != HTTP_GET)
+    {
+        sendJsonError(405, "Method not allowed");
+        return;
+    }
+
+    DynamicJsonDocument doc(4096);
+    JsonArray schedules = doc.createNestedArray("schedules");
+    for (uint8_t i = 0; i < scheduler.count(); i++)
+    {
+        buildScheduleJson(schedules.createNestedObject(), scheduler.entry(i));
+    }
+    JsonArray dates = doc.createNestedArray("exceptions");
+    for (uint8_t i = 0; i < scheduler.exceptionCount(); i++)
+    {
+        dates.add(formatDate(scheduler.exception(i)));
+    }
+
+    // Local time of the earliest entry, null until NTP has synced.
+    if (scheduler.next() == SCHEDULE_NEVER)
+    {
+        doc["next"] = nullptr;
+    }
+    else
+    {
+        JsonObject next = doc.createNestedObject("next");
+        uint32_t time = scheduler.next();
+        char text[8];
+        snprintf(text, sizeof(text), "%02u:%02u", time / 3600 % 24, time / 60 % 60);
+        next["index"] = scheduler.nextEntry();
+        next["date"] = formatDate(time / 86400);
+        next["at"] = String(text);
+    }
+    sendJson(200, doc);
+}
+
+bool parseSchedule(JsonObject object, ScheduleEntry &entry)
+{
+    static const char *WEEKDAYS[] = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+    memset(&entry, 0, sizeof(entry));
+    if (object.isNull() || !object["action"].is<const char *>())
+    {
+        return false;
+    }
+    const char *action = object["action"].as<const char *>();
+    if (strcmp(action, "on") == 0)
+    {
+        entry.action = SCHEDULE_ACTION_RELAY_ON;
+    }
+    else if (strcmp(action, "off") == 0)
+    {
+        entry.action = SCHEDULE_ACTION_RELAY_OFF;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (!object["relay"].isNull())
+    {
+        if (!object["relay"].is<int>() || object["relay"].as<int>() < 0 || object["relay"].as<int>() >= RELAY_COUNT)
+        {
+            return false;
+        }
+        entry.relay = object["relay"].as<int>();
+    }
+
+    float minute;
+    if (!parseRuleValue(object["at"], RULE_SENSOR_TIME, minute, entry.anchor))
+    {
+        return false;
+    }
+    entry.minute = minute;
+
+    if (!object["date"].isNull() && !parseDate(object["date"], entry.day))
+    {
+        return false;
+    }
+
+    for (JsonVariant day : object["days"].as<JsonArray>())
+    {
+        uint8_t i = 0;
+        while (i < 7 && !(day.is<const char *>() && strcmp(day.as<const char *>(), WEEKDAYS[i]) == 0))
+        {
+            i++;
+        }
+        if (i == 7)
+        {
+            return false;
+        }
+        entry.weekdays |= 1 << i;
+    }
+    return Scheduler::isValid(entry);
+}
+
+bool parseDate(JsonVariant value, uint16_t &day)
+{
+    // "YYYY-MM-DD", checked by converting it back.
+    const char *text = value.as<const char *>();
+    if (!value.is<const char *>() || strlen(text) != 10 || text[4] != '-' || text[7] != '-')
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        if (i != 4 && i != 7 && !isdigit(text[i]))
+        {
+            return false;
+        }
+    }
+
+    int32_t year = atoi(text);
+    uint8_t month = atoi(text + 5);
+    uint8_t date = atoi(text + 8);
+    int32_t days = TimeZone::daysFromCivil(year, month, date);
+
+    int32_t checkYear;
+    uint8_t checkMonth, checkDate;
+    TimeZone::civilFromDays(days, checkYear, checkMonth, checkDate);
+    if (days <= 0 || days > 0xFFFF || checkYear != year || checkMonth != month || checkDate != date)
+    {
+        return false;
+    }
+    day = days;
+    return true;
+}
+
+void buildScheduleJson(JsonObject object, const ScheduleEntry &entry)
+{
+    static const char *WEEKDAYS[] = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+    object["action"] = (entry.action == SCHEDULE_ACTION_RELAY_ON) ? "on" : "off";
+    object["relay"] = entry.relay;
+    setRuleValue(object, "at", RULE_SENSOR_TIME, entry.minute, entry.anchor);
+    if (entry.day != 0)
+    {
+        object["date"] = formatDate(entry.day);
+        return;
+    }
+
+    JsonArray days = object.createNestedArray("days");
+    for (uint8_t i = 0; i < 7; i++)
+    {
+        if (entry.weekdays & (1 << i))
+        {
+            days.add(WEEKDAYS[i]);
+        }
+    }
+}
+
+String formatDate(uint16_t day)
+{
+    int32_t year;
+    uint8_t month, date;
+    TimeZone::civilFromDays(day, year, month, date);
+
+    char text[16];
+    snprintf(text, sizeof(text), "%04d-%02u-%02u", (int)year, month, date);
+    return String(text);
+}
+
+void buildRelayJson(JsonObject relay)
+{
+    relay["name"] = relayDisplayName.c_str();
+    relay["state"] = (readRelay() == RELAY_STATE_OFF) ? "off" : "on";
+}
+
+void buildWifiJson(JsonObject wifi)
+{
+    bool connected = (WiFi.status() == WL_CONNECTED);
+    wifi["connected"] = connected;
+    wifi["status"] = getStatusString();
+    if (connected)
+    {
+        wifi["ssid"] = WiFi.SSID();
+        wifi["ip"] = WiFi.localIP().toString();
+        wifi["rssi"] = WiFi.RSSI();
+        wifi["fastConnect"] = wifiStation.connectMode() == WIFI_CONNECT_CACHED;
+        wifi["associationMs"] = wifiStation.associationTime();
+        wifi["dhcpMs"] = wifiStation.dhcpTime();
+    }
+}
+
+void buildConfigJson(JsonObject config)
+{
+    // Same keys as the old config.json, without the WiFi password.
+    config["SSID"] = ssidName.c_str();
+    for (uint8_t i = 0; i < CONFIG_BACKUP_NETWORKS; i++)
+    {
+        char key[12];
+        snprintf(key, sizeof(key), "SSID%d", i + 2);
+        config[String(key)] = backupNetworks[i].ssid;
+    }
+    config["RelayDisplayName"] = relayDisplayName.c_str();
+
+    config["EnableTurnOnThreshold"] = enableTurnOnThreshold;
+    config["TurnOnThreshold"] = turnOnThreshold;
+    config["EnableShutdownThreshold"] = enableShutdownThreshold;
+    config["ShutdownThreshold"] = shutdownThreshold;
+
+    config["EnableTurnOnTimeRange"] = enableTurnOnTimeRange;
+    config["TurnOnBeginHour"] = turnOnBeginHour;
+    config["TurnOnBeginMinute"] = turnOnBeginMinute;
+    config["TurnOnEndHour"] = turnOnEndHour;
+    config["TurnOnEndMinute"] = turnOnEndMinute;
+
+    config["EnableShutdownTimeRange"] = enableShutdownTimeRange;
+    config["ShutdownBeginHour"] = shutdownBeginHour;
+    config["ShutdownBeginMinute"] = shutdownBeginMinute;
+    config["ShutdownEndHour"] = shutdownEndHour;
+    config["ShutdownEndMinute"] = shutdownEndMinute;
+
+    config["MinOnTime"] = minOnTime;
+    config["MinOffTime"] = minOffTime;
+    config["LDRHysteresis"] = ldrHysteresis;
+    config["TimeZone"] = timeZoneRule.c_str();
+    config["EnableLocation"] = enableLocation;
+    config["Latitude"] = latitude;
+    config["Longitude"] = longitude;
+}
+
+void sendJson(int code, JsonDocument &doc)
+{
+    // Serialize straight into the response, no intermediate String.
+    webserver.setContentLength(measureJson(doc));
+    webserver.send(code, "application/json", "");
+
+    HttpContentPrint content(webserver);
+    BufferedPrint output(content);
+    serializeJson(doc, output);
+}
+
+void sendJsonError(int code, const char *message)
+{
+    StaticJsonDocument<96> doc;
+    doc["error"] = message;
+    sendJson(code, doc);
+}
+
+void sendHomePageHtml(void)
+{
+    homePageTemplate.send(webserver, 200, "text/html", getHomePageValue);
+}
+
+void sendStatusPageHtml(void)
+{
+    statusPageTemplate.send(webserver, 200, "text/html", getStatusPageValue);
+}
+
+String getHomePageValue(uint8_t slot)
+{
+    switch (slot)
+    {
+    case RELAY_SLOT_NAME:
+        return relayDisplayName;
+    case RELAY_SLOT_STATE:
+        return (relayState == RELAY_STATE_OFF) ? "关" : "开";
+    case RELAY_SLOT_SHOW_ON:
+        return (relayState == RELAY_STATE_OFF) ? "" : RELAY_DISPLAY_NONE;
+    case RELAY_SLOT_SHOW_OFF:
+        return (relayState == RELAY_STATE_OFF) ? RELAY_DISPLAY_NONE : "";
+    default:
+        return "";
+    }
+}
+
+String getStatusPageValue(uint8_t slot)
+{
+    switch (slot)
+    {
+    case STATUS_SLOT_STA_STATUS:
+        return getStatusString();
+    case STATUS_SLOT_SSID_NAME:
+        return (WiFi.status() == WL_CONNECTED) ? WiFi.SSID() : NOT_AVAILABLE;
+    case STATUS_SLOT_STA_IP_ADDRESS:
+        return (WiFi.status() == WL_CONNECTED) ? WiFi.localIP().toString() : NOT_AVAILABLE;
+    case STATUS_SLOT_AP_SSID:
+        return deviceName;
+    case STATUS_SLOT_AP_IP_ADDRESS:
+        return WiFi.softAPIP().toString();
+    case STATUS_SLOT_LDR_VALUE:
+        return String(getLDRValue());
+    default:
+        return "";
+    }
+}
+
+void sendConfigPageHtml(void)
+{
+    sendGzipPage(CONFIG_PAGE, CONFIG_PAGE_LENGTH, CONFIG_PAGE_ETAG, CACHE_CONTROL_PAGE);
+}
+
+void sendRedirectHtml(void)
+{
+    // The action already ran, send a client without gzip home all the same.
+    if (webserver.header("Accept-Encoding").indexOf("gzip") < 0)
+    {
+        webserver.sendHeader("Location", "/");
+        webserver.send(303, "text/html", "<a href=\"/\">Back</a>");
+        return;
+    }
+
+    sendGzipPage(REDIRECT_PAGE, REDIRECT_PAGE_LENGTH, REDIRECT_PAGE_ETAG, CACHE_CONTROL_PAGE);
+}
+
+void sendGzipPage(const uint8_t *page, size_t length, const char *etag, const char *cacheControl)
+{
+    // The pages are only stored gzipped, tell caches the body depends on it.
+    webserver.sendHeader("Vary", "Accept-Encoding");
+    if (webserver.header("Accept-Encoding").indexOf("gzip") < 0)
+    {
+        webserver.send(406, "text/plain", "This page needs a browser that accepts gzip.");
+        return;
+    }
+
+    webserver.sendHeader("ETag", etag);
+    webserver.sendHeader("Cache-Control", cacheControl);
+
+    // Conditional GET, the client already has this page.
+    if (webserver.header("If-None-Match").indexOf(etag) >= 0)
+    {
+        webserver.send(304);
+        return;
+    }
+
+    webserver.sendHeader("Content-Encoding", "gzip");
+    webserver.send_P(200, "text/html", (PGM_P)page, length);
+}
+
+void onSoftAPModeStationConnected(const WiFiEventSoftAPModeStationConnected &event)
+{
+    Serial.printf("[SoftAP] Device connected, MAC: %02X-%02X-%02X-%02X-%02X-%02X\r\n", event.mac[0], event.mac[1], event.mac[2], event.mac[3], event.mac[4], event.mac[5]);
+}
+
+void onSoftAPModeStationDisconnected(const WiFiEventSoftAPModeStationDisconnected &event)
+{
+    Serial.printf("[SoftAP] Device disconnected, MAC: %02X-%02X-%02X-%02X-%02X-%02X\r\n", event.mac[0], event.mac[1], event.mac[2], event.mac[3], event.mac[4], event.mac[5]);
+}
+
+void onStationModeConnected(const WiFiEventStationModeConnected &event)
+{
+    Serial.printf("[WIFI] Connected. SSID: %s\r\n", event.ssid.c_str());
+    wifiStation.onConnected();
+    ledStatusOn();
+    wifiEventPending = true;
+}
+
+void onStationModeGotIP(const WiFiEventStationModeGotIP &event)
+{
+    Serial.printf("[WIFI] Got IP: %s\r\n", event.ip.toString().c_str());
+    wifiStation.onGotIP();
+    ledStatusOff();
+    wifiEventPending = true;
+}
+
+void onStationModeDisconnected(const WiFiEventStationModeDisconnected &event)
+{
+    Serial.println("[WIFI] Disconnected.");
+    wifiStation.onDisconnected();
     ledStatusOn();
+    wifiEventPending = true;
 }
 
 void onStationModeAuthModeChanged(const WiFiEventStationModeAuthModeChanged &event)
 {
     Serial.println("[WIFI] Auth Mode Changed.");
     ledStatusOn();
+    wifiEventPending = true;
 }
 
 void onStationModeDHCPTimeout(void)
 {
     Serial.println("[WIFI] DHCP Timeout.");
     ledStatusOn();
+    wifiEventPending = true;
 }
 
 String getStatusString(void)
@@ -674,46 +2497,4 @@ String getStatusString(void)
     default:
         return "未知";
     }
-}
-
-void makeTurnOnTime(void)
-{
-    tm begin = {0};
-    begin.tm_hour = turnOnBeginHour;
-    begin.tm_min = turnOnBeginMinute;
-    turnOnBeginTime = mktime(&begin);
-
-    tm end = {0};
-    end.tm_hour = turnOnEndHour;
-    end.tm_min = turnOnEndMinute;
-    turnOnEndTime = mktime(&end);
-}
-
-void makeShutdownTime(void)
-{
-    tm begin = {0};
-    begin.tm_hour = shutdownBeginHour;
-    begin.tm_min = shutdownBeginMinute;
-    shutdownBeginTime = mktime(&begin);
-
-    tm end = {0};
-    end.tm_hour = shutdownEndHour;
-    end.tm_min = shutdownEndMinute;
-    shutdownEndTime = mktime(&end);
-}
-
-bool isInTimeRange(time_t* from, time_t* to, time_t* cur)
-{
-    if (*from > *to)
-    {
-        return (*cur >= *from) || (*cur <= *to);
-    }
-    else if (*from < *to)
-    {
-        return (*cur >= *from) && (*cur <= *to);
-    }
-    else
-    {
-        return *from == *cur;
-    }
 }
\ No newline at end of file
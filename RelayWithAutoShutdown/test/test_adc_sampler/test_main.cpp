@@ -0,0 +1,154 @@
+/*
+ * Host tests for AdcSampler: the window statistics against a brute-force
+ * window, and samples dropped while loop() falls behind. The shim's Ticker
+ * takes the samples as shim_advanceMillis() moves the frozen clock on.
+ *
+ *     pio test -e native -f test_adc_sampler
+ */
+#include <AdcSampler.h>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+#include <vector>
+
+#define RATE 50
+#define TICK (1000 / RATE)
+
+void setUp(void)
+{
+    // Samples are taken only when the test moves the clock.
+    shim_freezeClock(true);
+    srand(3);
+}
+
+void tearDown(void)
+{
+}
+
+/* -------------------------------------------------- */
+
+static void test_window_statistics(void)
+{
+    AdcSampler sampler(A0);
+    sampler.begin(RATE);
+    TEST_ASSERT_EQUAL(RATE, sampler.rate());
+    TEST_ASSERT_EQUAL(0, sampler.count());
+
+    std::vector<int> all;
+    char message[96];
+    for (int i = 0; i < 5000; i++)
+    {
+        // Alternating noise and a steady level, with a full-scale outlier now and then.
+        int value = (i % 500 < 250) ? rand() % ADC_SAMPLER_RANGE : 300 + rand() % 40;
+        if (i % 97 == 0)
+        {
+            value = ADC_SAMPLER_RANGE - 1;
+        }
+        shim_setAnalogValue(value);
+        shim_advanceMillis(TICK);
+        all.push_back(value);
+
+        // loop() takes the queued samples at irregular intervals.
+        if (i % 7 != 0 && i % 13 != 0)
+        {
+            continue;
+        }
+        sampler.update();
+
+        std::vector<int> window(all.end() - std::min<size_t>(all.size(), ADC_SAMPLER_WINDOW), all.end());
+        double sum = 0;
+        for (int sample : window)
+        {
+            sum += sample;
+        }
+        int minimum = *std::min_element(window.begin(), window.end());
+        int maximum = *std::max_element(window.begin(), window.end());
+        std::sort(window.begin(), window.end());
+        int median = window[(window.size() - 1) / 2];
+
+        snprintf(message, sizeof(message), "sample %d", i);
+        TEST_ASSERT_EQUAL_MESSAGE(window.size(), sampler.count(), message);
+        TEST_ASSERT_EQUAL_MESSAGE(value, sampler.latest(), message);
+        TEST_ASSERT_EQUAL_MESSAGE(minimum, sampler.minimum(), message);
+        TEST_ASSERT_EQUAL_MESSAGE(maximum, sampler.maximum(), message);
+        TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-3, sum / window.size(), sampler.mean(), message);
+        // Interpolated within a histogram bin.
+        TEST_ASSERT_FLOAT_WITHIN_MESSAGE(ADC_SAMPLER_RANGE / ADC_SAMPLER_BINS, median, sampler.percentile(50), message);
+    }
+    TEST_ASSERT_EQUAL(0, sampler.overruns());
+    sampler.end();
+}
+
+static void test_percentile_ends(void)
+{
+    AdcSampler sampler(A0);
+    sampler.begin(RATE);
+    for (int i = 0; i < ADC_SAMPLER_WINDOW; i++)
+    {
+        shim_setAnalogValue(100 + i * 10);
+        shim_advanceMillis(TICK);
+        if (i % 16 == 15)
+        {
+            sampler.update();
+        }
+    }
+    TEST_ASSERT_EQUAL(ADC_SAMPLER_WINDOW, sampler.count());
+    TEST_ASSERT_FLOAT_WITHIN(ADC_SAMPLER_RANGE / ADC_SAMPLER_BINS, 100, sampler.percentile(0));
+    TEST_ASSERT_FLOAT_WITHIN(ADC_SAMPLER_RANGE / ADC_SAMPLER_BINS, 100 + (ADC_SAMPLER_WINDOW - 1) * 10, sampler.percentile(100));
+    TEST_ASSERT_TRUE(sampler.percentile(25) <= sampler.percentile(75));
+    sampler.end();
+}
+
+static void test_overrun_is_counted(void)
+{
+    AdcSampler sampler(A0);
+    sampler.begin(RATE);
+    shim_setAnalogValue(512);
+
+    // loop() stalls for longer than the ring holds.
+    const int ticks = ADC_SAMPLER_QUEUE_SIZE + 8;
+    for (int i = 0; i < ticks; i++)
+    {
+        shim_advanceMillis(TICK);
+    }
+    sampler.update();
+    TEST_ASSERT_TRUE(sampler.overruns() > 0);
+    TEST_ASSERT_EQUAL(ticks, sampler.count() + sampler.overruns());
+    TEST_ASSERT_EQUAL(512, sampler.latest());
+
+    // Nothing more is lost once loop() keeps up.
+    uint32_t overruns = sampler.overruns();
+    for (int i = 0; i < 100; i++)
+    {
+        shim_advanceMillis(TICK);
+        sampler.update();
+    }
+    TEST_ASSERT_EQUAL(overruns, sampler.overruns());
+    sampler.end();
+}
+
+static void test_end_stops_sampling(void)
+{
+    AdcSampler sampler(A0);
+    sampler.begin(RATE);
+    shim_advanceMillis(TICK * 4);
+    sampler.update();
+    uint16_t count = sampler.count();
+    TEST_ASSERT_TRUE(count > 0);
+
+    sampler.end();
+    shim_advanceMillis(TICK * 4);
+    sampler.update();
+    TEST_ASSERT_EQUAL(count, sampler.count());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_window_statistics);
+    RUN_TEST(test_percentile_ends);
+    RUN_TEST(test_overrun_is_counted);
+    RUN_TEST(test_end_stops_sampling);
+    return UNITY_END();
+}
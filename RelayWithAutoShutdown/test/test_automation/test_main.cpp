@@ -0,0 +1,261 @@
+/*
+ * Automation of the firmware on the host: the settings-page rules, rules
+ * added over /api/v1/rules, the filtered LDR switching on the update in
+ * which it crosses a threshold, the minimum dwell, and the time zone. The clock is frozen and NTP answers with
+ * the time the test moves on; the tests run in order on one booted firmware.
+ *
+ *     pio test -e native -f test_automation
+ */
+#include <Arduino.h>
+#include <ConfigStore.h>
+#include <HttpServer.h>
+#include <LittleFS.h>
+#include <NtpClock.h>
+#include <RuleStore.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+
+// 2024-07-01 13:00 UTC, 21:00 in the default CST-8.
+#define START_EPOCH 1719838800UL
+#define START_LOCAL_MINUTE (21 * 60)
+#define UPDATE_INTERVAL 250
+
+// ADC counts; the LDR value is 10 * (1024 - adc) / adc KOhm.
+#define ADC_DARK 800  // 2.8 KOhm, at most the turn-on threshold
+#define ADC_LIGHT 100 // 92 KOhm, past the shutdown threshold
+
+void setup(void);
+void loop(void);
+float getLDRValue(void);
+extern HttpServer webserver;
+extern NtpClock timeClient;
+extern int relayState;
+
+static std::filesystem::path fsRoot;
+static unsigned long startMillis;
+static unsigned long switchedOffMillis;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t utcNow(void)
+{
+    return START_EPOCH + (millis() - startMillis) / 1000;
+}
+
+uint32_t getLocalTime(void);
+
+static uint32_t localSecond(void)
+{
+    return getLocalTime() % 86400;
+}
+
+// One loop() per LDR update, with NTP answering the test's clock.
+static void step(void)
+{
+    shim_advanceMillis(UPDATE_INTERVAL);
+    WiFiUDP::shim_setNtpEpoch(utcNow());
+    loop();
+}
+
+static void run(unsigned long milliseconds)
+{
+    for (unsigned long elapsed = 0; elapsed < milliseconds; elapsed += UPDATE_INTERVAL)
+    {
+        step();
+    }
+}
+
+static std::string request(HTTPMethod method, const char *uri, const char *body)
+{
+    return webserver.shim_request(method, uri, {{"plain", body}});
+}
+
+static int status(const std::string &response)
+{
+    return atoi(response.c_str() + strlen("HTTP/1.1 "));
+}
+
+/* -------------------------------------------------- */
+
+static void test_boot(void)
+{
+    // The settings page: on at night when dark, off when light.
+    ConfigRecord record;
+    ConfigStore::clear(record);
+    ConfigStore::setString(record.ssid, sizeof(record.ssid), "home");
+    ConfigStore::setString(record.password, sizeof(record.password), "secret");
+    record.enableTurnOnThreshold = 1;
+    record.turnOnThreshold = 3.0f;
+    record.enableTurnOnTimeRange = 1;
+    record.turnOnBeginHour = 22;
+    record.turnOnBeginMinute = 0;
+    record.turnOnEndHour = 6;
+    record.turnOnEndMinute = 0;
+    record.enableShutdownThreshold = 1;
+    record.shutdownThreshold = 8.0f;
+    record.minOnTime = 0;
+    record.minOffTime = 0;
+    ConfigStore store("/config.bin");
+    TEST_ASSERT_TRUE(store.save(record));
+
+    startMillis = millis();
+    WiFiUDP::shim_setNtpEpoch(START_EPOCH);
+    shim_setAnalogValue(ADC_DARK);
+    setup();
+    run(1000);
+
+    TEST_ASSERT_TRUE(timeClient.isTimeSet());
+    TEST_ASSERT_EQUAL(START_LOCAL_MINUTE, localSecond() / 60);
+    TEST_ASSERT_EQUAL(0, relayState);
+}
+
+static void test_time_range_start(void)
+{
+    // Dark all along; the range opens at 22:00:00.
+    while (localSecond() < 21 * 3600 + 59 * 60 + 58)
+    {
+        step();
+    }
+    TEST_ASSERT_EQUAL(0, relayState);
+
+    bool open = false;
+    while (!open)
+    {
+        step();
+        open = localSecond() >= 22 * 3600;
+        TEST_ASSERT_EQUAL(open ? 1 : 0, relayState);
+    }
+    TEST_ASSERT_EQUAL(HIGH, digitalRead(D1));
+}
+
+static void test_ldr_crossing(void)
+{
+    // The relay goes off in the update in which the filter reaches 8 KOhm.
+    shim_setAnalogValue(ADC_LIGHT);
+    for (int i = 0; i < 200 && relayState == 1; i++)
+    {
+        float before = getLDRValue();
+        step();
+        float after = getLDRValue();
+        TEST_ASSERT_TRUE(before < 8.0f);
+        TEST_ASSERT_EQUAL(after >= 8.0f ? 0 : 1, relayState);
+    }
+    TEST_ASSERT_EQUAL(0, relayState);
+    switchedOffMillis = millis();
+
+    // Once settled, one dark second in four does not switch it back on.
+    run(60000);
+    for (int second = 0; second < 60; second++)
+    {
+        shim_setAnalogValue(second % 4 ? ADC_LIGHT : ADC_DARK);
+        run(1000);
+        TEST_ASSERT_TRUE(getLDRValue() > 8.0f);
+    }
+    shim_setAnalogValue(ADC_LIGHT);
+    TEST_ASSERT_EQUAL(0, relayState);
+}
+
+static void test_minimum_dwell(void)
+{
+    TEST_ASSERT_EQUAL(200, status(request(HTTP_PATCH, "/api/v1/config", "{\"MinOffTime\":180}")));
+    TEST_ASSERT_EQUAL(400, status(request(HTTP_PATCH, "/api/v1/config", "{\"LDRHysteresis\":101}")));
+
+    // Dark again long before the dwell is over: held back until then.
+    shim_setAnalogValue(ADC_DARK);
+    while (millis() - switchedOffMillis < 179000)
+    {
+        step();
+        TEST_ASSERT_EQUAL(0, relayState);
+    }
+    TEST_ASSERT_TRUE(getLDRValue() <= 3.0f);
+
+    // Retried as soon as the dwell is over.
+    run(1250);
+    TEST_ASSERT_EQUAL(1, relayState);
+}
+
+static void test_rules_api(void)
+{
+    // Off for ten minutes from now, after the settings-page rules so it wins.
+    uint32_t minute = localSecond() / 60;
+    char body[256];
+    snprintf(body, sizeof(body),
+             "{\"rules\":[{\"action\":\"off\",\"when\":[{\"sensor\":\"time\",\"op\":\"between\","
+             "\"from\":\"%02u:%02u\",\"to\":\"%02u:%02u\"}]}]}",
+             (unsigned)(minute / 60), (unsigned)(minute % 60), (unsigned)((minute + 10) / 60 % 24),
+             (unsigned)((minute + 10) % 60));
+    TEST_ASSERT_EQUAL(200, status(request(HTTP_PUT, "/api/v1/rules", body)));
+
+    std::string rules = webserver.shim_request(HTTP_GET, "/api/v1/rules");
+    TEST_ASSERT_EQUAL(200, status(rules));
+    TEST_ASSERT_TRUE(rules.find("\"action\":\"off\"") != std::string::npos);
+
+    run(1000);
+    TEST_ASSERT_EQUAL(0, relayState);
+
+    // Kept for the next boot.
+    RuleStore store("/rules.bin");
+    Rule saved[RULE_STORE_MAX_RULES];
+    uint8_t count = 0;
+    TEST_ASSERT_TRUE(store.load(saved, count));
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL(RULE_ACTION_RELAY_OFF, saved[0].action);
+
+    // Invalid rules are refused and change nothing.
+    const char *invalid[] = {
+        "{\"rules\":[{\"action\":\"dim\",\"when\":[{\"sensor\":\"ldr\",\"op\":\">=\",\"value\":1}]}]}",
+        "{\"rules\":[{\"action\":\"on\",\"when\":[{\"sensor\":\"ldr\",\"op\":\"between\",\"from\":5,\"to\":1}]}]}",
+        "{\"rules\":[{\"action\":\"on\",\"when\":[{\"sensor\":\"time\",\"op\":\">=\",\"value\":\"24:00\"}]}]}",
+        "{\"rules\":[{\"action\":\"on\",\"when\":[]}]}",
+    };
+    for (const char *rule : invalid)
+    {
+        TEST_ASSERT_EQUAL_MESSAGE(400, status(request(HTTP_PUT, "/api/v1/rules", rule)), rule);
+    }
+    TEST_ASSERT_TRUE(webserver.shim_request(HTTP_GET, "/api/v1/rules") == rules);
+}
+
+static void test_time_zone(void)
+{
+    uint32_t utc = timeClient.getEpochTime();
+    TEST_ASSERT_EQUAL(8 * 3600, getLocalTime() - utc);
+
+    TEST_ASSERT_EQUAL(200, status(request(HTTP_PATCH, "/api/v1/config", "{\"TimeZone\":\"CET-1CEST,M3.5.0,M10.5.0/3\"}")));
+    TEST_ASSERT_EQUAL(400, status(request(HTTP_PATCH, "/api/v1/config", "{\"TimeZone\":\"Mars+99\"}")));
+    step();
+
+    // Summer time in Central Europe.
+    utc = timeClient.getEpochTime();
+    TEST_ASSERT_EQUAL(2 * 3600, getLocalTime() - utc);
+    std::string config = webserver.shim_request(HTTP_GET, "/api/v1/config");
+    TEST_ASSERT_TRUE(config.find("\"TimeZone\":\"CET-1CEST,M3.5.0,M10.5.0/3\"") != std::string::npos);
+}
+
+int main(int argc, char **argv)
+{
+    fsRoot = std::filesystem::temp_directory_path() / "automation";
+    std::filesystem::remove_all(fsRoot);
+    setenv("SHIM_FS_ROOT", fsRoot.c_str(), 1);
+    LittleFS.begin();
+    shim_freezeClock(true);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_boot);
+    RUN_TEST(test_time_range_start);
+    RUN_TEST(test_ldr_crossing);
+    RUN_TEST(test_minimum_dwell);
+    RUN_TEST(test_rules_api);
+    RUN_TEST(test_time_zone);
+    int failures = UNITY_END();
+
+    std::filesystem::remove_all(fsRoot);
+    return failures;
+}
@@ -0,0 +1,124 @@
+/*
+ * Micro-benchmarks of the firmware's hot paths on the host: the config
+ * load, the evaluation of the automation's rule table, and the pages and
+ * API. Each prints its time per call; the numbers are for comparing
+ * changes on the same machine, not for the ESP8266.
+ *
+ *     pio test -e native -f test_benchmark -v
+ */
+#include <Arduino.h>
+#include <HttpServer.h>
+#include <LittleFS.h>
+#include <RuleEngine.h>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <unity.h>
+
+#define CONFIG_JSON                                                                                        \
+    "{\"SSID\":\"home\",\"Password\":\"secret\",\"RelayDisplayName\":\"Porch\","                         \
+    "\"EnableTurnOnThreshold\":true,\"TurnOnThreshold\":3.5,\"EnableShutdownThreshold\":true,"            \
+    "\"ShutdownThreshold\":8,\"EnableTurnOnTimeRange\":true,\"TurnOnBeginHour\":22,\"TurnOnBeginMinute\":0," \
+    "\"TurnOnEndHour\":6,\"TurnOnEndMinute\":30,\"EnableShutdownTimeRange\":false,\"ShutdownBeginHour\":-1," \
+    "\"ShutdownBeginMinute\":-1,\"ShutdownEndHour\":-1,\"ShutdownEndMinute\":-1}"
+
+void setup(void);
+bool loadWifiConfig(void);
+extern HttpServer webserver;
+extern RuleEngine ruleEngine;
+
+static std::filesystem::path fsRoot;
+static volatile size_t sink;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Runs fn `iterations` times and reports the mean time per call.
+template <typename Fn>
+static void bench(const char *name, int iterations, Fn fn)
+{
+    fn(); // Warm up caches and lazy state.
+
+    // Serial is stdout on the host; the firmware's logging is not what is timed.
+    fflush(stdout);
+    int console = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        fn();
+    }
+    fflush(stdout);
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    dup2(console, STDOUT_FILENO);
+    close(console);
+
+    char message[96];
+    snprintf(message, sizeof(message), "%-24s %10.3f us/call (%d calls)", name, elapsed.count() / iterations,
+             iterations);
+    TEST_MESSAGE(message);
+}
+
+/* -------------------------------------------------- */
+
+static void bench_config_load(void)
+{
+    bench("loadWifiConfig", 200, [] { TEST_ASSERT_TRUE(loadWifiConfig()); });
+}
+
+static void bench_rules(void)
+{
+    // The settings-page rules of CONFIG_JSON, over a day and a range of light.
+    RuleInputs inputs;
+    inputs.valid[RULE_SENSOR_LDR] = true;
+    inputs.valid[RULE_SENSOR_TIME] = true;
+    int minute = 0;
+    bench("RuleEngine::evaluate", 1000000, [&] {
+        inputs.values[RULE_SENSOR_TIME] = minute % RULE_MINUTES_PER_DAY;
+        inputs.values[RULE_SENSOR_LDR] = (minute % 97) * 0.1f;
+        minute++;
+        sink += ruleEngine.evaluate(inputs);
+    });
+}
+
+static void bench_pages(void)
+{
+    bench("GET /", 20000, [] { sink += webserver.shim_request(HTTP_GET, "/").size(); });
+    bench("GET /status", 20000, [] { sink += webserver.shim_request(HTTP_GET, "/status").size(); });
+    bench("GET /config", 20000, [] { sink += webserver.shim_request(HTTP_GET, "/config").size(); });
+    bench("GET /api/v1/status", 20000, [] { sink += webserver.shim_request(HTTP_GET, "/api/v1/status").size(); });
+}
+
+int main(int argc, char **argv)
+{
+    fsRoot = std::filesystem::temp_directory_path() / "benchmark";
+    std::filesystem::remove_all(fsRoot);
+    setenv("SHIM_FS_ROOT", fsRoot.c_str(), 1);
+    LittleFS.begin();
+    File file = LittleFS.open("/config.json", "w");
+    file.print(CONFIG_JSON);
+    file.close();
+    setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(bench_config_load);
+    RUN_TEST(bench_rules);
+    RUN_TEST(bench_pages);
+    int failures = UNITY_END();
+
+    std::filesystem::remove_all(fsRoot);
+    return failures;
+}
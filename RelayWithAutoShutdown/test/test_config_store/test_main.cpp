@@ -0,0 +1,353 @@
+/*
+ * Host tests for ConfigStore: the record round trip, upgrading every older
+ * record version, the patch journal, and a torn, corrupt or foreign file,
+ * on the shim's LittleFS in a scratch directory.
+ *
+ *     pio test -e native -f test_config_store
+ */
+#include <ConfigStore.h>
+#include <Crc32.h>
+#include <LittleFS.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+
+#define CONFIG_PATH "/config.bin"
+#define JOURNAL_PATH "/config.bin.jnl"
+#define TEMP_PATH "/config.bin.tmp"
+
+static const size_t VERSION_SIZES[] = {CONFIG_V1_SIZE, CONFIG_V2_SIZE, CONFIG_V3_SIZE, CONFIG_V4_SIZE, CONFIG_V5_SIZE};
+
+static std::filesystem::path fsRoot;
+
+void setUp(void)
+{
+    fsRoot = std::filesystem::temp_directory_path() / ("config_store_" + std::to_string(rand()));
+    std::filesystem::remove_all(fsRoot);
+    setenv("SHIM_FS_ROOT", fsRoot.c_str(), 1);
+    LittleFS.begin();
+}
+
+void tearDown(void)
+{
+    std::filesystem::remove_all(fsRoot);
+}
+
+static size_t fileSize(const char *path)
+{
+    File file = LittleFS.open(path, "r");
+    return file ? file.size() : 0;
+}
+
+static void writeFile(const char *path, const uint8_t *data, size_t length)
+{
+    File file = LittleFS.open(path, "w");
+    TEST_ASSERT_TRUE(file);
+    TEST_ASSERT_EQUAL(length, file.write(data, length));
+    file.close();
+}
+
+// A record with the fields of every version set away from their defaults.
+static void makeRecord(ConfigRecord &record)
+{
+    ConfigStore::clear(record);
+    ConfigStore::setString(record.ssid, sizeof(record.ssid), "home");
+    ConfigStore::setString(record.password, sizeof(record.password), "secret");
+    ConfigStore::setString(record.relayDisplayName, sizeof(record.relayDisplayName), "Porch");
+    record.enableTurnOnThreshold = 1;
+    record.turnOnThreshold = 3.5f;
+    record.enableTurnOnTimeRange = 1;
+    record.turnOnBeginHour = 22;
+    record.turnOnBeginMinute = 0;
+    record.turnOnEndHour = 6;
+    record.turnOnEndMinute = 30;
+    ConfigStore::setString(record.backupNetworks[0].ssid, CONFIG_SSID_SIZE, "backup");
+    ConfigStore::setString(record.backupNetworks[0].password, CONFIG_PASSWORD_SIZE, "other");
+    record.minOnTime = 5;
+    record.minOffTime = 7;
+    record.ldrHysteresis = 20;
+    ConfigStore::setString(record.timeZone, sizeof(record.timeZone), "CET-1CEST,M3.5.0,M10.5.0/3");
+    record.enableLocation = 1;
+    record.latitude = 51.5f;
+    record.longitude = -0.1f;
+    ConfigStore::setString(ConfigStore::backupNetwork(record, 2).ssid, CONFIG_SSID_SIZE, "third");
+}
+
+/* -------------------------------------------------- */
+
+static void test_save_and_load(void)
+{
+    ConfigRecord record;
+    makeRecord(record);
+    ConfigStore store(CONFIG_PATH);
+    TEST_ASSERT_TRUE(store.save(record));
+    TEST_ASSERT_TRUE(ConfigStore::isValid(record));
+    TEST_ASSERT_EQUAL(sizeof(ConfigRecord), fileSize(CONFIG_PATH));
+
+    ConfigStore other(CONFIG_PATH);
+    ConfigRecord loaded;
+    TEST_ASSERT_TRUE(other.load(loaded));
+    TEST_ASSERT_EQUAL(0, memcmp(&record, &loaded, sizeof(record)));
+}
+
+static void test_missing_file(void)
+{
+    ConfigStore store(CONFIG_PATH);
+    ConfigRecord record;
+    TEST_ASSERT_FALSE(store.exists());
+    TEST_ASSERT_FALSE(store.load(record));
+}
+
+static void test_upgrade_every_version(void)
+{
+    // What a record of version n held: its fields, then defaults. The
+    // version 2 backup network is the first one of version 6.
+    const size_t fieldsEnd[] = {offsetof(ConfigRecord, backupNetworks), offsetof(ConfigRecord, minOnTime),
+                                offsetof(ConfigRecord, timeZone), offsetof(ConfigRecord, enableLocation),
+                                offsetof(ConfigRecord, moreBackupNetworks)};
+    for (uint16_t version = 1; version < CONFIG_VERSION; version++)
+    {
+        char message[32];
+        snprintf(message, sizeof(message), "version %u", version);
+
+        ConfigRecord full;
+        makeRecord(full);
+        ConfigRecord expected;
+        ConfigStore::clear(expected);
+        memcpy(&expected, &full, fieldsEnd[version - 1]);
+
+        // The old layout ends with its own CRC.
+        size_t size = VERSION_SIZES[version - 1];
+        uint8_t old[sizeof(ConfigRecord)];
+        memcpy(old, &expected, size - sizeof(uint32_t));
+        ConfigRecord *header = (ConfigRecord *)old;
+        header->magic = CONFIG_MAGIC;
+        header->version = version;
+        header->size = size;
+        uint32_t crc = crc32(old, size - sizeof(crc));
+        memcpy(old + size - sizeof(crc), &crc, sizeof(crc));
+        writeFile(CONFIG_PATH, old, size);
+
+        ConfigStore store(CONFIG_PATH);
+        ConfigRecord loaded;
+        TEST_ASSERT_TRUE_MESSAGE(store.load(loaded), message);
+        ConfigStore::seal(expected);
+        TEST_ASSERT_TRUE_MESSAGE(memcmp(&expected, &loaded, sizeof(loaded)) == 0, message);
+
+        // Written back in the current layout.
+        TEST_ASSERT_EQUAL_MESSAGE(sizeof(ConfigRecord), fileSize(CONFIG_PATH), message);
+        ConfigStore again(CONFIG_PATH);
+        TEST_ASSERT_TRUE_MESSAGE(again.load(loaded), message);
+        TEST_ASSERT_EQUAL_MESSAGE(CONFIG_VERSION, loaded.version, message);
+    }
+}
+
+static void test_rejects_corrupt_record(void)
+{
+    ConfigRecord record;
+    makeRecord(record);
+    ConfigStore::seal(record);
+
+    uint8_t bytes[sizeof(record)];
+    memcpy(bytes, &record, sizeof(record));
+    bytes[offsetof(ConfigRecord, password)] ^= 0x01;
+    writeFile(CONFIG_PATH, bytes, sizeof(bytes));
+    ConfigStore store(CONFIG_PATH);
+    ConfigRecord loaded;
+    TEST_ASSERT_FALSE(store.load(loaded));
+
+    // Cut short.
+    writeFile(CONFIG_PATH, (const uint8_t *)&record, sizeof(record) - 1);
+    TEST_ASSERT_FALSE(store.load(loaded));
+
+    // A future version.
+    record.version = CONFIG_VERSION + 1;
+    writeFile(CONFIG_PATH, (const uint8_t *)&record, sizeof(record));
+    TEST_ASSERT_FALSE(store.load(loaded));
+}
+
+static void test_strings_truncated(void)
+{
+    char field[8];
+    memset(field, 'x', sizeof(field));
+    ConfigStore::setString(field, sizeof(field), "abc");
+    TEST_ASSERT_EQUAL_STRING("abc", field);
+    TEST_ASSERT_EQUAL(0, field[sizeof(field) - 1]);
+
+    ConfigStore::setString(field, sizeof(field), "abcdefghij");
+    TEST_ASSERT_EQUAL_STRING("abcdefg", field);
+
+    // "光" is three bytes and does not fit after "abcde".
+    ConfigStore::setString(field, sizeof(field), "abcde\xe5\x85\x89");
+    TEST_ASSERT_EQUAL_STRING("abcde", field);
+}
+
+static void test_settings_and_credentials(void)
+{
+    ConfigRecord record;
+    makeRecord(record);
+    ConfigStore store(CONFIG_PATH);
+    TEST_ASSERT_TRUE(store.save(record));
+
+    // No password in the settings.
+    uint8_t settings[CONFIG_SETTINGS_SIZE];
+    ConfigStore::getSettings(record, settings);
+    std::string bytes((const char *)settings, sizeof(settings));
+    TEST_ASSERT_TRUE(bytes.find("secret") == std::string::npos);
+    TEST_ASSERT_TRUE(bytes.find("other") == std::string::npos);
+    TEST_ASSERT_TRUE(bytes.find("Porch") != std::string::npos);
+
+    // The settings and the credentials on flash add up to the record.
+    ConfigRecord restored;
+    ConfigStore::clear(restored);
+    ConfigStore::setSettings(restored, settings);
+    ConfigStore other(CONFIG_PATH);
+    TEST_ASSERT_TRUE(other.loadCredentials(restored));
+    ConfigStore::seal(restored);
+    TEST_ASSERT_EQUAL(0, memcmp(&record, &restored, sizeof(record)));
+
+    // A new password, here in the journal, does not add up to its CRC.
+    ConfigStore::setString(record.password, sizeof(record.password), "changed");
+    TEST_ASSERT_TRUE(store.save(record));
+    TEST_ASSERT_TRUE(LittleFS.exists(JOURNAL_PATH));
+    ConfigStore::clear(restored);
+    ConfigStore::setSettings(restored, settings);
+    TEST_ASSERT_TRUE(other.loadCredentials(restored));
+    ConfigStore::seal(restored);
+    TEST_ASSERT_TRUE(restored.crc != record.crc);
+}
+
+static void test_small_changes_go_to_the_journal(void)
+{
+    ConfigRecord record;
+    makeRecord(record);
+    ConfigStore store(CONFIG_PATH);
+    TEST_ASSERT_TRUE(store.save(record));
+
+    bool journaled = false;
+    for (int i = 0; i < 30; i++)
+    {
+        record.turnOnThreshold = i * 0.5f;
+        record.turnOnBeginHour = i % 24;
+        TEST_ASSERT_TRUE(store.save(record));
+        TEST_ASSERT_TRUE(fileSize(JOURNAL_PATH) <= CONFIG_JOURNAL_LIMIT);
+        journaled = journaled || LittleFS.exists(JOURNAL_PATH);
+
+        ConfigStore other(CONFIG_PATH);
+        ConfigRecord loaded;
+        TEST_ASSERT_TRUE(other.load(loaded));
+        TEST_ASSERT_EQUAL(0, memcmp(&record, &loaded, sizeof(record)));
+    }
+    TEST_ASSERT_TRUE(journaled);
+
+    // Saving an unchanged record writes nothing.
+    size_t length = fileSize(JOURNAL_PATH);
+    TEST_ASSERT_TRUE(store.save(record));
+    TEST_ASSERT_EQUAL(length, fileSize(JOURNAL_PATH));
+}
+
+static void test_large_change_writes_a_full_record(void)
+{
+    ConfigRecord record;
+    makeRecord(record);
+    ConfigStore store(CONFIG_PATH);
+    TEST_ASSERT_TRUE(store.save(record));
+    record.turnOnThreshold = 9.0f;
+    TEST_ASSERT_TRUE(store.save(record));
+    TEST_ASSERT_TRUE(LittleFS.exists(JOURNAL_PATH));
+
+    // Wider than CONFIG_JOURNAL_MAX_PATCH: the journal is folded in.
+    ConfigStore::setString(record.relayDisplayName, sizeof(record.relayDisplayName), std::string(60, 'n').c_str());
+    TEST_ASSERT_TRUE(store.save(record));
+    TEST_ASSERT_FALSE(LittleFS.exists(JOURNAL_PATH));
+
+    ConfigStore other(CONFIG_PATH);
+    ConfigRecord loaded;
+    TEST_ASSERT_TRUE(other.load(loaded));
+    TEST_ASSERT_EQUAL(0, memcmp(&record, &loaded, sizeof(record)));
+}
+
+static void test_torn_journal_tail(void)
+{
+    ConfigRecord record;
+    makeRecord(record);
+    ConfigStore store(CONFIG_PATH);
+    TEST_ASSERT_TRUE(store.save(record));
+    record.turnOnThreshold = 4.0f;
+    TEST_ASSERT_TRUE(store.save(record));
+
+    // A power loss in the middle of the next append.
+    File file = LittleFS.open(JOURNAL_PATH, "a");
+    file.write((const uint8_t *)"\x10\x00\x05", 3);
+    file.close();
+
+    ConfigStore other(CONFIG_PATH);
+    ConfigRecord loaded;
+    TEST_ASSERT_TRUE(other.load(loaded));
+    TEST_ASSERT_EQUAL(0, memcmp(&record, &loaded, sizeof(record)));
+
+    // The next save must not append behind the garbage.
+    loaded.turnOnThreshold = 6.0f;
+    TEST_ASSERT_TRUE(other.save(loaded));
+    ConfigStore third(CONFIG_PATH);
+    TEST_ASSERT_TRUE(third.load(record));
+    TEST_ASSERT_EQUAL(0, memcmp(&record, &loaded, sizeof(record)));
+}
+
+static void test_stale_journal_ignored(void)
+{
+    ConfigRecord record;
+    makeRecord(record);
+    ConfigStore store(CONFIG_PATH);
+    TEST_ASSERT_TRUE(store.save(record));
+    record.turnOnThreshold = 4.0f;
+    TEST_ASSERT_TRUE(store.save(record));
+
+    // A full record written by someone else; the journal refers to the old one.
+    ConfigRecord replaced;
+    makeRecord(replaced);
+    replaced.turnOnThreshold = 8.0f;
+    ConfigStore::seal(replaced);
+    writeFile(CONFIG_PATH, (const uint8_t *)&replaced, sizeof(replaced));
+
+    ConfigStore other(CONFIG_PATH);
+    ConfigRecord loaded;
+    TEST_ASSERT_TRUE(other.load(loaded));
+    TEST_ASSERT_EQUAL(0, memcmp(&replaced, &loaded, sizeof(loaded)));
+    TEST_ASSERT_FALSE(LittleFS.exists(JOURNAL_PATH));
+}
+
+static void test_interrupted_write_ignored(void)
+{
+    ConfigRecord record;
+    makeRecord(record);
+    ConfigStore store(CONFIG_PATH);
+    TEST_ASSERT_TRUE(store.save(record));
+
+    // Power lost while the next full record was being written.
+    const uint8_t partial[] = {0x52, 0x43, 0x46};
+    writeFile(TEMP_PATH, partial, sizeof(partial));
+
+    ConfigStore other(CONFIG_PATH);
+    ConfigRecord loaded;
+    TEST_ASSERT_TRUE(other.load(loaded));
+    TEST_ASSERT_EQUAL(0, memcmp(&record, &loaded, sizeof(record)));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_save_and_load);
+    RUN_TEST(test_missing_file);
+    RUN_TEST(test_upgrade_every_version);
+    RUN_TEST(test_rejects_corrupt_record);
+    RUN_TEST(test_strings_truncated);
+    RUN_TEST(test_settings_and_credentials);
+    RUN_TEST(test_small_changes_go_to_the_journal);
+    RUN_TEST(test_large_change_writes_a_full_record);
+    RUN_TEST(test_torn_journal_tail);
+    RUN_TEST(test_stale_journal_ignored);
+    RUN_TEST(test_interrupted_write_ignored);
+    return UNITY_END();
+}
@@ -0,0 +1,234 @@
+/*
+ * The firmware on the host: the configuration record and the migration of
+ * the old config.json and wifi.cfg files, the pages and API built from
+ * them, and configuration changes that only save and reconnect when
+ * needed. The tests run in order on one booted firmware.
+ *
+ *     pio test -e native -f test_firmware
+ */
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <HttpServer.h>
+#include <LittleFS.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+
+#define CONFIG_JSON                                                                                        \
+    "{\"SSID\":\"home\",\"Password\":\"secret\",\"RelayDisplayName\":\"Porch\","                         \
+    "\"EnableTurnOnThreshold\":true,\"TurnOnThreshold\":3.5,\"EnableShutdownThreshold\":true,"            \
+    "\"ShutdownThreshold\":8,\"EnableTurnOnTimeRange\":true,\"TurnOnBeginHour\":22,\"TurnOnBeginMinute\":0," \
+    "\"TurnOnEndHour\":6,\"TurnOnEndMinute\":30,\"EnableShutdownTimeRange\":false,\"ShutdownBeginHour\":-1," \
+    "\"ShutdownBeginMinute\":-1,\"ShutdownEndHour\":-1,\"ShutdownEndMinute\":-1}"
+
+void setup(void);
+void loop(void);
+bool loadWifiConfig(void);
+extern HttpServer webserver;
+extern String ssidName;
+extern String ssidPassword;
+extern String relayDisplayName;
+extern bool enableTurnOnThreshold;
+extern float turnOnThreshold;
+extern float shutdownThreshold;
+extern int turnOnEndMinute;
+extern int relayState;
+
+static std::filesystem::path fsRoot;
+static int disconnects = 0;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static int status(const std::string &response)
+{
+    return atoi(response.c_str() + strlen("HTTP/1.1 "));
+}
+
+static size_t fileSize(const char *path)
+{
+    File file = LittleFS.open(path, "r");
+    return file ? file.size() : 0;
+}
+
+static std::string patchConfig(const char *body)
+{
+    return webserver.shim_request(HTTP_PATCH, "/api/v1/config", {{"plain", body}});
+}
+
+static void writeFile(const char *path, const char *text)
+{
+    File file = LittleFS.open(path, "w");
+    file.print(text);
+    file.close();
+}
+
+/* -------------------------------------------------- */
+
+static void test_json_config_migrated(void)
+{
+    writeFile("/config.json", CONFIG_JSON);
+    setup();
+
+    TEST_ASSERT_EQUAL_STRING("home", ssidName.c_str());
+    TEST_ASSERT_EQUAL_STRING("secret", ssidPassword.c_str());
+    TEST_ASSERT_EQUAL_STRING("Porch", relayDisplayName.c_str());
+    TEST_ASSERT_TRUE(enableTurnOnThreshold);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 3.5f, turnOnThreshold);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 8.0f, shutdownThreshold);
+    TEST_ASSERT_EQUAL(30, turnOnEndMinute);
+
+    // Converted once.
+    TEST_ASSERT_FALSE(LittleFS.exists("/config.json"));
+    TEST_ASSERT_TRUE(LittleFS.exists("/config.bin"));
+    TEST_ASSERT_TRUE(loadWifiConfig());
+    TEST_ASSERT_EQUAL_STRING("Porch", relayDisplayName.c_str());
+}
+
+static void test_damaged_config_ignored(void)
+{
+    File file = LittleFS.open("/config.bin", "r+");
+    file.seek(12);
+    file.write((uint8_t)'X');
+    file.close();
+    TEST_ASSERT_FALSE(loadWifiConfig());
+    TEST_ASSERT_EQUAL_STRING("home", ssidName.c_str());
+
+    // Neither is a broken config.json taken.
+    LittleFS.remove("/config.bin");
+    writeFile("/config.json", "{\"SSID\":");
+    TEST_ASSERT_FALSE(loadWifiConfig());
+    TEST_ASSERT_EQUAL_STRING("home", ssidName.c_str());
+    LittleFS.remove("/config.json");
+}
+
+static void test_wifi_cfg_migrated(void)
+{
+    // The Relay and RelayX2 format, written on Windows.
+    writeFile("/wifi.cfg", "office\r\nhunter2\r\nLamp\r\n");
+    TEST_ASSERT_TRUE(loadWifiConfig());
+    TEST_ASSERT_EQUAL_STRING("office", ssidName.c_str());
+    TEST_ASSERT_EQUAL_STRING("hunter2", ssidPassword.c_str());
+    TEST_ASSERT_EQUAL_STRING("Lamp", relayDisplayName.c_str());
+    TEST_ASSERT_FALSE(LittleFS.exists("/wifi.cfg"));
+    TEST_ASSERT_TRUE(LittleFS.exists("/config.bin"));
+
+    writeFile("/config.json", CONFIG_JSON);
+    LittleFS.remove("/config.bin");
+    TEST_ASSERT_TRUE(loadWifiConfig());
+    TEST_ASSERT_EQUAL_STRING("Porch", relayDisplayName.c_str());
+}
+
+static void test_home_page(void)
+{
+    std::string page = webserver.shim_request(HTTP_GET, "/");
+    TEST_ASSERT_EQUAL(200, status(page));
+    TEST_ASSERT_TRUE(page.find("Porch") != std::string::npos);
+    TEST_ASSERT_TRUE(page.find("{{") == std::string::npos);
+
+    std::string redirect = webserver.shim_request(HTTP_GET, "/relay_on", {}, {{"Accept-Encoding", "gzip, deflate"}});
+    TEST_ASSERT_EQUAL(200, status(redirect));
+    TEST_ASSERT_EQUAL(1, relayState);
+    TEST_ASSERT_EQUAL(HIGH, digitalRead(D1));
+    TEST_ASSERT_TRUE(webserver.shim_request(HTTP_GET, "/") != page);
+
+    // Without gzip the action still runs, and the client is sent home.
+    redirect = webserver.shim_request(HTTP_GET, "/relay_off");
+    TEST_ASSERT_EQUAL(303, status(redirect));
+    TEST_ASSERT_TRUE(redirect.find("Location: /\r\n") != std::string::npos);
+    TEST_ASSERT_EQUAL(0, relayState);
+    TEST_ASSERT_EQUAL(LOW, digitalRead(D1));
+}
+
+static void test_status_page_and_api(void)
+{
+    std::string page = webserver.shim_request(HTTP_GET, "/status");
+    TEST_ASSERT_EQUAL(200, status(page));
+    TEST_ASSERT_TRUE(page.find("Relay(") != std::string::npos);
+
+    std::string api = webserver.shim_request(HTTP_GET, "/api/v1/status");
+    TEST_ASSERT_EQUAL(200, status(api));
+    TEST_ASSERT_TRUE(api.find("\"relay\"") != std::string::npos);
+    TEST_ASSERT_EQUAL(405, status(webserver.shim_request(HTTP_DELETE, "/api/v1/status")));
+}
+
+static void test_config_patch(void)
+{
+    WiFiEventHandler handler = WiFi.onStationModeDisconnected(
+        [](const WiFiEventStationModeDisconnected &event) { disconnects++; });
+    // The station joins once the scan started by setup() completes.
+    loop();
+    TEST_ASSERT_TRUE(WiFi.isConnected());
+
+    // Only the given field changes, and the link stays up.
+    std::string response = patchConfig("{\"TurnOnThreshold\":4.5}");
+    TEST_ASSERT_EQUAL(200, status(response));
+    TEST_ASSERT_TRUE(response.find("\"TurnOnThreshold\":4.5") != std::string::npos);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 4.5f, turnOnThreshold);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 8.0f, shutdownThreshold);
+    TEST_ASSERT_EQUAL_STRING("Porch", relayDisplayName.c_str());
+    TEST_ASSERT_EQUAL(0, disconnects);
+    TEST_ASSERT_TRUE(loadWifiConfig());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 4.5f, turnOnThreshold);
+
+    // The same value again writes nothing.
+    size_t written = fileSize("/config.bin") + fileSize("/config.bin.jnl");
+    TEST_ASSERT_EQUAL(200, status(patchConfig("{\"TurnOnThreshold\":4.5}")));
+    TEST_ASSERT_EQUAL(written, fileSize("/config.bin") + fileSize("/config.bin.jnl"));
+
+    // One bad field rejects the whole request.
+    TEST_ASSERT_EQUAL(400, status(patchConfig("{\"TurnOnThreshold\":2,\"TurnOnBeginHour\":24}")));
+    TEST_ASSERT_EQUAL(400, status(patchConfig("{\"Colour\":\"red\"}")));
+    TEST_ASSERT_EQUAL(400, status(patchConfig("[1]")));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 4.5f, turnOnThreshold);
+
+    // New credentials reconnect the station.
+    TEST_ASSERT_EQUAL(200, status(patchConfig("{\"SSID\":\"office\",\"Password\":\"hunter2\"}")));
+    TEST_ASSERT_EQUAL(1, disconnects);
+    loop();
+    TEST_ASSERT_EQUAL_STRING("office", WiFi.SSID().c_str());
+    TEST_ASSERT_TRUE(WiFi.isConnected());
+}
+
+static void test_config_form_keeps_passwords(void)
+{
+    // What the page posts after filling itself from /api/v1/config.
+    std::string response = webserver.shim_request(
+        HTTP_POST, "/postconfig",
+        {{"SSID", "office"}, {"Password", ""}, {"RelayDisplayName", "Porch"}, {"TurnOnThreshold", "4.5"}});
+    TEST_ASSERT_EQUAL(303, status(response));
+    TEST_ASSERT_EQUAL_STRING("office", ssidName.c_str());
+    TEST_ASSERT_EQUAL_STRING("hunter2", ssidPassword.c_str());
+
+    // Not for another network.
+    webserver.shim_request(HTTP_POST, "/postconfig", {{"SSID", "cafe"}, {"Password", ""}, {"RelayDisplayName", "Porch"}});
+    TEST_ASSERT_EQUAL_STRING("cafe", ssidName.c_str());
+    TEST_ASSERT_EQUAL_STRING("", ssidPassword.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    fsRoot = std::filesystem::temp_directory_path() / "firmware";
+    std::filesystem::remove_all(fsRoot);
+    setenv("SHIM_FS_ROOT", fsRoot.c_str(), 1);
+    LittleFS.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_json_config_migrated);
+    RUN_TEST(test_damaged_config_ignored);
+    RUN_TEST(test_wifi_cfg_migrated);
+    RUN_TEST(test_home_page);
+    RUN_TEST(test_status_page_and_api);
+    RUN_TEST(test_config_patch);
+    RUN_TEST(test_config_form_keeps_passwords);
+    int failures = UNITY_END();
+
+    std::filesystem::remove_all(fsRoot);
+    return failures;
+}
@@ -0,0 +1,109 @@
+/*
+ * Host tests for NtpClock against the shim's NTP server: the answer is
+ * taken by a later poll(), a missing or refused answer is given up after
+ * NTP_CLOCK_TIMEOUT, and the clock runs on with millis().
+ *
+ *     pio test -e native -f test_ntp_clock
+ */
+#include <Arduino.h>
+#include <NtpClock.h>
+#include <WiFiUdp.h>
+#include <unity.h>
+
+#define SERVER_EPOCH 1718000000UL
+
+static WiFiUDP udp;
+static NtpClock *ntpClock;
+
+void setUp(void)
+{
+    shim_freezeClock(true);
+    WiFiUDP::shim_setNtpEpoch(SERVER_EPOCH);
+    WiFiUDP::shim_setNtpDelay(0);
+    WiFiUDP::shim_setNtpStratum(2);
+    ntpClock = new NtpClock(udp, "pool.ntp.org");
+    ntpClock->begin();
+}
+
+void tearDown(void)
+{
+    delete ntpClock;
+    shim_freezeClock(false);
+}
+
+/* -------------------------------------------------- */
+
+static void test_answer_sets_clock(void)
+{
+    WiFiUDP::shim_setNtpDelay(300);
+    TEST_ASSERT_EQUAL(NTP_CLOCK_IDLE, ntpClock->poll());
+    TEST_ASSERT_TRUE(ntpClock->request());
+    TEST_ASSERT_TRUE(ntpClock->waiting());
+
+    // Nothing blocks while the answer is on its way.
+    unsigned long start = millis();
+    TEST_ASSERT_EQUAL(NTP_CLOCK_WAITING, ntpClock->poll());
+    TEST_ASSERT_EQUAL(start, millis());
+    shim_advanceMillis(299);
+    TEST_ASSERT_EQUAL(NTP_CLOCK_WAITING, ntpClock->poll());
+    TEST_ASSERT_FALSE(ntpClock->isTimeSet());
+
+    shim_advanceMillis(1);
+    TEST_ASSERT_EQUAL(NTP_CLOCK_UPDATED, ntpClock->poll());
+    TEST_ASSERT_TRUE(ntpClock->isTimeSet());
+    TEST_ASSERT_FALSE(ntpClock->waiting());
+    TEST_ASSERT_EQUAL_UINT32(SERVER_EPOCH, ntpClock->getEpochTime());
+    TEST_ASSERT_EQUAL(NTP_CLOCK_IDLE, ntpClock->poll());
+
+    shim_advanceMillis(90500);
+    TEST_ASSERT_EQUAL_UINT32(SERVER_EPOCH + 90, ntpClock->getEpochTime());
+}
+
+static void test_no_answer_times_out(void)
+{
+    WiFiUDP::shim_setNtpDelay(NTP_CLOCK_TIMEOUT + 500);
+    TEST_ASSERT_TRUE(ntpClock->request());
+    shim_advanceMillis(NTP_CLOCK_TIMEOUT - 1);
+    TEST_ASSERT_EQUAL(NTP_CLOCK_WAITING, ntpClock->poll());
+    shim_advanceMillis(1);
+    TEST_ASSERT_EQUAL(NTP_CLOCK_TIMED_OUT, ntpClock->poll());
+    TEST_ASSERT_FALSE(ntpClock->waiting());
+    TEST_ASSERT_FALSE(ntpClock->isTimeSet());
+
+    // The next request is answered in time.
+    WiFiUDP::shim_setNtpDelay(100);
+    TEST_ASSERT_TRUE(ntpClock->request());
+    shim_advanceMillis(100);
+    TEST_ASSERT_EQUAL(NTP_CLOCK_UPDATED, ntpClock->poll());
+    TEST_ASSERT_EQUAL_UINT32(SERVER_EPOCH, ntpClock->getEpochTime());
+}
+
+static void test_refusal_ignored(void)
+{
+    // Kiss-o'-death: stratum 0 carries no time.
+    WiFiUDP::shim_setNtpStratum(0);
+    TEST_ASSERT_TRUE(ntpClock->request());
+    TEST_ASSERT_EQUAL(NTP_CLOCK_WAITING, ntpClock->poll());
+    shim_advanceMillis(NTP_CLOCK_TIMEOUT);
+    TEST_ASSERT_EQUAL(NTP_CLOCK_TIMED_OUT, ntpClock->poll());
+    TEST_ASSERT_FALSE(ntpClock->isTimeSet());
+}
+
+static void test_set_epoch_runs_on(void)
+{
+    // A restored clock counts on, but is not an answer.
+    ntpClock->setEpochTime(SERVER_EPOCH);
+    shim_advanceMillis(5000);
+    TEST_ASSERT_EQUAL_UINT32(SERVER_EPOCH + 5, ntpClock->getEpochTime());
+    TEST_ASSERT_FALSE(ntpClock->isTimeSet());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_answer_sets_clock);
+    RUN_TEST(test_no_answer_times_out);
+    RUN_TEST(test_refusal_ignored);
+    RUN_TEST(test_set_epoch_runs_on);
+    return UNITY_END();
+}
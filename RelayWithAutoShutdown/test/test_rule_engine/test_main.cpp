@@ -0,0 +1,245 @@
+/*
+ * Host tests for RuleEngine: time ranges against the old inclusive range
+ * check, precedence, hysteresis, changed(), anchored limits and the rule
+ * checks.
+ *
+ *     pio test -e native -f test_rule_engine
+ */
+#include <RuleEngine.h>
+#include <stdio.h>
+#include <unity.h>
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static RuleCondition timeBetween(float from, float to)
+{
+    RuleCondition condition = {RULE_SENSOR_TIME, RULE_OP_BETWEEN, RULE_ANCHOR_NONE, RULE_ANCHOR_NONE, from, to};
+    return condition;
+}
+
+static RuleCondition ldr(uint8_t op, float low, float high)
+{
+    RuleCondition condition = {RULE_SENSOR_LDR, op, RULE_ANCHOR_NONE, RULE_ANCHOR_NONE, low, high};
+    return condition;
+}
+
+static Rule makeRule(uint8_t action, const RuleCondition &first)
+{
+    Rule rule = {};
+    rule.action = action;
+    rule.conditionCount = 1;
+    rule.conditions[0] = first;
+    return rule;
+}
+
+static RuleInputs inputs(float ldrValue, float minute, bool timeValid = true)
+{
+    RuleInputs inputs;
+    inputs.values[RULE_SENSOR_LDR] = ldrValue;
+    inputs.valid[RULE_SENSOR_LDR] = true;
+    inputs.values[RULE_SENSOR_TIME] = minute;
+    inputs.valid[RULE_SENSOR_TIME] = timeValid;
+    return inputs;
+}
+
+// The range check the firmware used before the rule table, inclusive at both ends.
+static bool isInTimeRange(int minute, int begin, int end)
+{
+    return (begin <= end) ? (minute >= begin && minute <= end) : (minute >= begin || minute <= end);
+}
+
+/* -------------------------------------------------- */
+
+static void test_time_ranges_match_old_check(void)
+{
+    const int limits[] = {0, 1, 359, 360, 361, 719, 1320, 1438, 1439};
+    char message[64];
+    for (int begin : limits)
+    {
+        for (int end : limits)
+        {
+            RuleEngine engine;
+            TEST_ASSERT_TRUE(engine.add(makeRule(RULE_ACTION_RELAY_ON, timeBetween(begin, end))));
+            for (int minute = 0; minute < RULE_MINUTES_PER_DAY; minute++)
+            {
+                // Equal ends used to match one minute, they now cover the day.
+                bool expected = (begin == end) || isInTimeRange(minute, begin, end);
+                snprintf(message, sizeof(message), "%d-%d at %d", begin, end, minute);
+                TEST_ASSERT_EQUAL_MESSAGE(expected ? 0 : -1, engine.evaluate(inputs(0, minute)), message);
+            }
+        }
+    }
+}
+
+static void test_last_matching_rule_wins(void)
+{
+    // The settings page: on when dark between 22:00 and 06:00, off when light.
+    RuleEngine engine;
+    Rule on = makeRule(RULE_ACTION_RELAY_ON, ldr(RULE_OP_LESS_EQUAL, 0, 3));
+    on.conditions[1] = timeBetween(22 * 60, 6 * 60);
+    on.conditionCount = 2;
+    TEST_ASSERT_TRUE(engine.add(on));
+    TEST_ASSERT_TRUE(engine.add(makeRule(RULE_ACTION_RELAY_OFF, ldr(RULE_OP_GREATER_EQUAL, 8, 0))));
+    TEST_ASSERT_EQUAL(2, engine.count());
+
+    TEST_ASSERT_EQUAL(-1, engine.evaluate(inputs(2, 21 * 60)));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(inputs(2, 23 * 60)));
+    TEST_ASSERT_EQUAL(1, engine.evaluate(inputs(20, 23 * 60)));
+    TEST_ASSERT_EQUAL(-1, engine.evaluate(inputs(5, 23 * 60)));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(inputs(2, 5 * 60 + 59)));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(inputs(2, 6 * 60)));
+    TEST_ASSERT_EQUAL(-1, engine.evaluate(inputs(2, 6 * 60 + 1)));
+
+    // A later rule overrides an earlier one that also holds.
+    TEST_ASSERT_TRUE(engine.add(makeRule(RULE_ACTION_RELAY_OFF, timeBetween(23 * 60, 23 * 60 + 30))));
+    TEST_ASSERT_EQUAL(2, engine.evaluate(inputs(2, 23 * 60 + 10)));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(inputs(2, 23 * 60 + 31)));
+
+    // Without a clock the time condition never holds.
+    TEST_ASSERT_EQUAL(-1, engine.evaluate(inputs(2, 23 * 60, false)));
+}
+
+static void test_hysteresis(void)
+{
+    RuleEngine engine;
+    engine.setHysteresis(RULE_SENSOR_LDR, 0.1f);
+    TEST_ASSERT_TRUE(engine.add(makeRule(RULE_ACTION_RELAY_ON, ldr(RULE_OP_GREATER_EQUAL, 10, 0))));
+
+    TEST_ASSERT_EQUAL(-1, engine.evaluate(inputs(9.5f, 0)));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(inputs(10, 0)));
+    // Held down to 10% below the threshold.
+    TEST_ASSERT_EQUAL(0, engine.evaluate(inputs(9.5f, 0)));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(inputs(9.01f, 0)));
+    TEST_ASSERT_EQUAL(-1, engine.evaluate(inputs(8.9f, 0)));
+    // And not held again until the threshold itself.
+    TEST_ASSERT_EQUAL(-1, engine.evaluate(inputs(9.5f, 0)));
+
+    // Ranges widen at both ends.
+    RuleEngine range;
+    range.setHysteresis(RULE_SENSOR_LDR, 0.1f);
+    TEST_ASSERT_TRUE(range.add(makeRule(RULE_ACTION_RELAY_ON, ldr(RULE_OP_BETWEEN, 10, 20))));
+    TEST_ASSERT_EQUAL(0, range.evaluate(inputs(15, 0)));
+    TEST_ASSERT_EQUAL(0, range.evaluate(inputs(21.9f, 0)));
+    TEST_ASSERT_EQUAL(-1, range.evaluate(inputs(22.1f, 0)));
+    TEST_ASSERT_EQUAL(-1, range.evaluate(inputs(21.9f, 0)));
+
+    // Time ranges have no hysteresis unless one is set for time.
+    RuleEngine time;
+    time.setHysteresis(RULE_SENSOR_LDR, 0.1f);
+    TEST_ASSERT_TRUE(time.add(makeRule(RULE_ACTION_RELAY_ON, timeBetween(600, 700))));
+    TEST_ASSERT_EQUAL(0, time.evaluate(inputs(0, 700)));
+    TEST_ASSERT_EQUAL(-1, time.evaluate(inputs(0, 701)));
+}
+
+static void test_changed_only_on_crossing(void)
+{
+    RuleEngine engine;
+    engine.setHysteresis(RULE_SENSOR_LDR, 0.1f);
+    TEST_ASSERT_TRUE(engine.add(makeRule(RULE_ACTION_RELAY_ON, ldr(RULE_OP_GREATER_EQUAL, 10, 0))));
+    TEST_ASSERT_TRUE(engine.add(makeRule(RULE_ACTION_RELAY_OFF, timeBetween(7 * 60, 7 * 60 + 30))));
+    engine.evaluate(inputs(5, 6 * 60));
+
+    TEST_ASSERT_FALSE(engine.changed(inputs(9.9f, 6 * 60 + 59)));
+    TEST_ASSERT_TRUE(engine.changed(inputs(10, 6 * 60)));
+    TEST_ASSERT_TRUE(engine.changed(inputs(5, 7 * 60)));
+    // changed() does not move the state.
+    TEST_ASSERT_TRUE(engine.changed(inputs(10, 6 * 60)));
+
+    engine.evaluate(inputs(10, 6 * 60));
+    TEST_ASSERT_FALSE(engine.changed(inputs(9.1f, 6 * 60)));
+    TEST_ASSERT_TRUE(engine.changed(inputs(8.9f, 6 * 60)));
+}
+
+static void test_anchored_limits(void)
+{
+    // From sunset - 15 to dusk + 60.
+    RuleCondition evening = {RULE_SENSOR_TIME, RULE_OP_BETWEEN, RULE_ANCHOR_SUNSET, RULE_ANCHOR_DUSK, -15, 60};
+    Rule rule = makeRule(RULE_ACTION_RELAY_ON, evening);
+
+    RuleEngine engine;
+    engine.setAnchor(RULE_ANCHOR_SUNSET, 19 * 60 + 2);
+    engine.setAnchor(RULE_ANCHOR_DUSK, 19 * 60 + 30);
+    TEST_ASSERT_TRUE(engine.add(rule));
+    TEST_ASSERT_EQUAL(-1, engine.evaluate(inputs(0, 18 * 60 + 46)));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(inputs(0, 18 * 60 + 47)));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(inputs(0, 20 * 60 + 30)));
+    TEST_ASSERT_EQUAL(-1, engine.evaluate(inputs(0, 20 * 60 + 31)));
+
+    // Wrapping past midnight.
+    engine.clear();
+    engine.setAnchor(RULE_ANCHOR_DUSK, 23 * 60 + 30);
+    TEST_ASSERT_TRUE(engine.add(rule));
+    TEST_ASSERT_EQUAL(0, engine.evaluate(inputs(0, 0 * 60 + 29)));
+    TEST_ASSERT_EQUAL(-1, engine.evaluate(inputs(0, 0 * 60 + 31)));
+
+    // No sunset today: the rule never holds.
+    engine.clear();
+    engine.setAnchor(RULE_ANCHOR_SUNSET, -1);
+    TEST_ASSERT_TRUE(engine.add(rule));
+    for (int minute = 0; minute < RULE_MINUTES_PER_DAY; minute += 7)
+    {
+        TEST_ASSERT_EQUAL(-1, engine.evaluate(inputs(0, minute)));
+    }
+}
+
+static void test_rejects_invalid_rules(void)
+{
+    Rule valid = makeRule(RULE_ACTION_RELAY_ON, timeBetween(60, 120));
+    TEST_ASSERT_TRUE(RuleEngine::isValid(valid));
+
+    Rule rule = valid;
+    rule.action = 2;
+    TEST_ASSERT_FALSE(RuleEngine::isValid(rule));
+    rule = valid;
+    rule.conditionCount = 0;
+    TEST_ASSERT_FALSE(RuleEngine::isValid(rule));
+    rule = valid;
+    rule.conditionCount = RULE_MAX_CONDITIONS + 1;
+    TEST_ASSERT_FALSE(RuleEngine::isValid(rule));
+    rule = valid;
+    rule.conditions[0].high = RULE_MINUTES_PER_DAY;
+    TEST_ASSERT_FALSE(RuleEngine::isValid(rule));
+    rule = valid;
+    rule.conditions[0].low = -1;
+    TEST_ASSERT_FALSE(RuleEngine::isValid(rule));
+    rule = valid;
+    rule.conditions[0].low = 60.5f;
+    TEST_ASSERT_FALSE(RuleEngine::isValid(rule));
+    rule = valid;
+    rule.conditions[0].op = RULE_OP_OUTSIDE; // Only made by compiling.
+    TEST_ASSERT_FALSE(RuleEngine::isValid(rule));
+
+    // Only time ranges wrap, and only time limits take an anchor.
+    TEST_ASSERT_FALSE(RuleEngine::isValid(makeRule(RULE_ACTION_RELAY_ON, ldr(RULE_OP_BETWEEN, 5, 1))));
+    rule = makeRule(RULE_ACTION_RELAY_ON, ldr(RULE_OP_GREATER_EQUAL, 5, 0));
+    rule.conditions[0].lowAnchor = RULE_ANCHOR_SUNSET;
+    TEST_ASSERT_FALSE(RuleEngine::isValid(rule));
+
+    TEST_ASSERT_TRUE(RuleEngine::isValidTime(-RULE_MAX_ANCHOR_OFFSET, RULE_ANCHOR_SUNSET));
+    TEST_ASSERT_FALSE(RuleEngine::isValidTime(-RULE_MAX_ANCHOR_OFFSET - 1, RULE_ANCHOR_SUNSET));
+
+    RuleEngine engine;
+    for (int i = 0; i < RULE_MAX_RULES; i++)
+    {
+        TEST_ASSERT_TRUE(engine.add(valid));
+    }
+    TEST_ASSERT_FALSE(engine.add(valid));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_time_ranges_match_old_check);
+    RUN_TEST(test_last_matching_rule_wins);
+    RUN_TEST(test_hysteresis);
+    RUN_TEST(test_changed_only_on_crossing);
+    RUN_TEST(test_anchored_limits);
+    RUN_TEST(test_rejects_invalid_rules);
+    return UNITY_END();
+}
@@ -0,0 +1,241 @@
+/*
+ * Host tests for Scheduler: random schedules, with and without anchored
+ * entries, polled minute by minute against a brute force over three weeks,
+ * plus the entry checks.
+ *
+ *     pio test -e native -f test_scheduler
+ */
+#include <Scheduler.h>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+#include <vector>
+
+#define SECONDS_PER_DAY 86400U
+#define FIRST_DAY 20700U
+#define DAYS 21
+#define TRIALS 300
+
+void setUp(void)
+{
+    srand(7);
+}
+
+void tearDown(void)
+{
+}
+
+// A made-up anchor that moves every day; anchor 2 has no time every fifth day.
+static int16_t anchorMinute(uint8_t anchor, uint16_t day)
+{
+    if (anchor == 2 && day % 5 == 0)
+    {
+        return -1;
+    }
+    return (day * 37 + anchor * 300) % SCHEDULE_MINUTES_PER_DAY;
+}
+
+// Minute of the day an entry fires on a day, -1 if it does not.
+static int fireMinute(const ScheduleEntry &entry, uint32_t day)
+{
+    if (entry.anchor == 0)
+    {
+        return entry.minute;
+    }
+    int anchor = anchorMinute(entry.anchor, day);
+    if (anchor < 0)
+    {
+        return -1;
+    }
+    int minute = (anchor + entry.minute) % SCHEDULE_MINUTES_PER_DAY;
+    return minute < 0 ? minute + SCHEDULE_MINUTES_PER_DAY : minute;
+}
+
+static ScheduleEntry randomEntry(bool anchored)
+{
+    ScheduleEntry entry = {};
+    entry.action = rand() % 2;
+    entry.minute = rand() % SCHEDULE_MINUTES_PER_DAY;
+    if (anchored && rand() % 2)
+    {
+        entry.anchor = 1 + rand() % 2;
+        entry.minute = rand() % (SCHEDULE_MAX_ANCHOR_OFFSET * 2 + 1) - SCHEDULE_MAX_ANCHOR_OFFSET;
+    }
+    if (rand() % 4)
+    {
+        entry.weekdays = 1 + rand() % SCHEDULE_ALL_WEEKDAYS;
+    }
+    else
+    {
+        entry.day = FIRST_DAY + rand() % (DAYS - 1);
+    }
+    return entry;
+}
+
+static void compareWithBruteForce(bool anchored)
+{
+    char message[96];
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        Scheduler scheduler;
+        if (anchored)
+        {
+            scheduler.setAnchorFunction(anchorMinute);
+        }
+
+        std::vector<ScheduleEntry> entries;
+        int count = 1 + rand() % SCHEDULE_MAX_ENTRIES;
+        for (int i = 0; i < count; i++)
+        {
+            entries.push_back(randomEntry(anchored));
+            TEST_ASSERT_TRUE(scheduler.add(entries.back()));
+        }
+        std::set<uint32_t> exceptions;
+        for (int i = rand() % 6; i > 0; i--)
+        {
+            uint16_t day = FIRST_DAY + rand() % DAYS;
+            TEST_ASSERT_TRUE(scheduler.addException(day));
+            exceptions.insert(day);
+        }
+
+        uint32_t first = FIRST_DAY * SECONDS_PER_DAY;
+        uint32_t start = first + rand() % SECONDS_PER_DAY;
+        scheduler.start(start);
+        for (uint32_t now = start; now < first + DAYS * SECONDS_PER_DAY; now += 60)
+        {
+            // The firmware starts the scheduler again each day for the new anchor times.
+            if (anchored && now != start && now / SECONDS_PER_DAY != (now - 60) / SECONDS_PER_DAY)
+            {
+                scheduler.start(now - 59);
+            }
+
+            std::multiset<int> fired;
+            for (int index; (index = scheduler.poll(now)) >= 0;)
+            {
+                fired.insert(index);
+            }
+
+            // Everything due in (now - 60, now], or in [start, now] on the first poll.
+            std::multiset<int> expected;
+            uint32_t from = (now == start) ? start : now - 59;
+            for (int k = 0; k < count; k++)
+            {
+                const ScheduleEntry &entry = entries[k];
+                for (uint32_t day = from / SECONDS_PER_DAY; day <= now / SECONDS_PER_DAY; day++)
+                {
+                    int minute = fireMinute(entry, day);
+                    uint32_t time = day * SECONDS_PER_DAY + minute * 60;
+                    if (minute < 0 || time < from || time > now)
+                    {
+                        continue;
+                    }
+                    bool weekday = (entry.weekdays >> ((day + 4) % 7)) & 1;
+                    if (entry.day != 0 ? day == entry.day : (weekday && exceptions.count(day) == 0))
+                    {
+                        expected.insert(k);
+                    }
+                }
+            }
+
+            snprintf(message, sizeof(message), "trial %d at %u", trial, (unsigned)now);
+            TEST_ASSERT_TRUE_MESSAGE(fired == expected, message);
+        }
+    }
+}
+
+/* -------------------------------------------------- */
+
+static void test_fixed_times(void)
+{
+    compareWithBruteForce(false);
+}
+
+static void test_anchored_times(void)
+{
+    compareWithBruteForce(true);
+}
+
+static void test_next_is_earliest(void)
+{
+    Scheduler scheduler;
+    TEST_ASSERT_EQUAL(SCHEDULE_NEVER, scheduler.next());
+
+    ScheduleEntry late = {SCHEDULE_ACTION_RELAY_OFF, 0, SCHEDULE_ALL_WEEKDAYS, 0, 23 * 60, 0};
+    ScheduleEntry early = {SCHEDULE_ACTION_RELAY_ON, 0, SCHEDULE_ALL_WEEKDAYS, 0, 6 * 60, 0};
+    scheduler.add(late);
+    scheduler.add(early);
+    uint32_t midnight = FIRST_DAY * SECONDS_PER_DAY;
+    scheduler.start(midnight);
+    TEST_ASSERT_EQUAL(1, scheduler.nextEntry());
+    TEST_ASSERT_EQUAL(midnight + 6 * 3600, scheduler.next());
+
+    TEST_ASSERT_EQUAL(-1, scheduler.poll(midnight + 6 * 3600 - 1));
+    TEST_ASSERT_EQUAL(1, scheduler.poll(midnight + 6 * 3600));
+    TEST_ASSERT_EQUAL(0, scheduler.nextEntry());
+    TEST_ASSERT_EQUAL(midnight + 23 * 3600, scheduler.next());
+}
+
+static void test_dated_entry_drops_out(void)
+{
+    Scheduler scheduler;
+    ScheduleEntry once = {SCHEDULE_ACTION_RELAY_ON, 0, 0, 0, 12 * 60, FIRST_DAY};
+    TEST_ASSERT_TRUE(scheduler.add(once));
+
+    uint32_t noon = FIRST_DAY * SECONDS_PER_DAY + 12 * 3600;
+    scheduler.start(noon - 60);
+    TEST_ASSERT_EQUAL(0, scheduler.poll(noon + 30));
+    TEST_ASSERT_EQUAL(SCHEDULE_NEVER, scheduler.next());
+
+    // Past already when started.
+    scheduler.start(noon + 1);
+    TEST_ASSERT_EQUAL(SCHEDULE_NEVER, scheduler.next());
+}
+
+static void test_rejects_invalid_entries(void)
+{
+    ScheduleEntry valid = {SCHEDULE_ACTION_RELAY_ON, 0, 0x01, 0, 0, 0};
+    TEST_ASSERT_TRUE(Scheduler::isValid(valid));
+
+    ScheduleEntry entry = valid;
+    entry.action = 2;
+    TEST_ASSERT_FALSE(Scheduler::isValid(entry));
+    entry = valid;
+    entry.minute = SCHEDULE_MINUTES_PER_DAY;
+    TEST_ASSERT_FALSE(Scheduler::isValid(entry));
+    entry = valid;
+    entry.weekdays = 0x80;
+    TEST_ASSERT_FALSE(Scheduler::isValid(entry));
+    entry = valid;
+    entry.day = FIRST_DAY; // Both weekly and dated.
+    TEST_ASSERT_FALSE(Scheduler::isValid(entry));
+    entry = valid;
+    entry.weekdays = 0; // Neither.
+    TEST_ASSERT_FALSE(Scheduler::isValid(entry));
+
+    entry = valid;
+    entry.anchor = 2;
+    entry.minute = -SCHEDULE_MAX_ANCHOR_OFFSET;
+    TEST_ASSERT_TRUE(Scheduler::isValid(entry));
+    entry.minute = SCHEDULE_MAX_ANCHOR_OFFSET + 1;
+    TEST_ASSERT_FALSE(Scheduler::isValid(entry));
+
+    Scheduler scheduler;
+    for (int i = 0; i < SCHEDULE_MAX_ENTRIES; i++)
+    {
+        TEST_ASSERT_TRUE(scheduler.add(valid));
+    }
+    TEST_ASSERT_FALSE(scheduler.add(valid));
+    TEST_ASSERT_EQUAL(SCHEDULE_MAX_ENTRIES, scheduler.count());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fixed_times);
+    RUN_TEST(test_anchored_times);
+    RUN_TEST(test_next_is_earliest);
+    RUN_TEST(test_dated_entry_drops_out);
+    RUN_TEST(test_rejects_invalid_entries);
+    return UNITY_END();
+}
@@ -0,0 +1,234 @@
+/*
+ * Schedules of the firmware on the host: weekly and dated entries put over
+ * /api/v1/schedules firing on the minute, exception dates, and sun times
+ * from the configured location moving both the rules and the schedule from
+ * day to day. The clock is frozen and NTP answers with the time the test
+ * moves on; the tests run in order on one booted firmware.
+ *
+ *     pio test -e native -f test_schedules
+ */
+#include <Arduino.h>
+#include <ConfigStore.h>
+#include <HttpServer.h>
+#include <LittleFS.h>
+#include <NtpClock.h>
+#include <SunTimes.h>
+#include <TimeZone.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+
+// 2024-07-01 10:00 UTC, a Monday, 18:00 in the default CST-8.
+#define START_EPOCH 1719828000UL
+#define UTC_OFFSET (8 * 3600)
+#define UPDATE_INTERVAL 250
+
+#define LATITUDE 31.2304f
+#define LONGITUDE 121.4737f
+
+void setup(void);
+void loop(void);
+uint32_t getLocalTime(void);
+extern HttpServer webserver;
+extern NtpClock timeClient;
+extern int relayState;
+
+static std::filesystem::path fsRoot;
+static unsigned long startMillis;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t utcNow(void)
+{
+    return START_EPOCH + (millis() - startMillis) / 1000;
+}
+
+static void step(void)
+{
+    shim_advanceMillis(UPDATE_INTERVAL);
+    WiFiUDP::shim_setNtpEpoch(utcNow());
+    loop();
+}
+
+static void run(unsigned long milliseconds)
+{
+    for (unsigned long elapsed = 0; elapsed < milliseconds; elapsed += UPDATE_INTERVAL)
+    {
+        step();
+    }
+}
+
+static uint32_t localTime(int32_t year, uint8_t month, uint8_t day, int hour, int minute, int second)
+{
+    return TimeZone::daysFromCivil(year, month, day) * 86400UL + hour * 3600 + minute * 60 + second;
+}
+
+// Moves the clock forward to a local time without running loop().
+static void skipTo(uint32_t local)
+{
+    shim_advanceMillis((local - getLocalTime()) * 1000UL);
+    WiFiUDP::shim_setNtpEpoch(utcNow());
+}
+
+// Steps until the relay switches or the local time is reached; returns the
+// local time of the switch, 0 if none.
+static uint32_t runUntilSwitch(uint32_t until)
+{
+    int state = relayState;
+    while (getLocalTime() < until)
+    {
+        step();
+        if (relayState != state)
+        {
+            return getLocalTime();
+        }
+    }
+    return 0;
+}
+
+static std::string request(HTTPMethod method, const char *uri, const char *body)
+{
+    return webserver.shim_request(method, uri, {{"plain", body}});
+}
+
+static int status(const std::string &response)
+{
+    return atoi(response.c_str() + strlen("HTTP/1.1 "));
+}
+
+// Local minute of the day of a sun event, as the tables would print it.
+static uint32_t sunEvent(int32_t year, uint8_t month, uint8_t day, uint8_t event)
+{
+    uint32_t times[SUN_EVENT_COUNT];
+    SunTimes::calculate(TimeZone::daysFromCivil(year, month, day), LATITUDE, LONGITUDE, times);
+    TEST_ASSERT_TRUE(times[event] != SUN_TIME_NONE);
+    return (times[event] + UTC_OFFSET) / 60 * 60;
+}
+
+/* -------------------------------------------------- */
+
+static void test_boot(void)
+{
+    // No rules of the settings page, only what the tests put.
+    ConfigRecord record;
+    ConfigStore::clear(record);
+    ConfigStore::setString(record.ssid, sizeof(record.ssid), "home");
+    ConfigStore::setString(record.password, sizeof(record.password), "secret");
+    ConfigStore store("/config.bin");
+    TEST_ASSERT_TRUE(store.save(record));
+
+    startMillis = millis();
+    WiFiUDP::shim_setNtpEpoch(START_EPOCH);
+    setup();
+    run(1000);
+
+    TEST_ASSERT_TRUE(timeClient.isTimeSet());
+    TEST_ASSERT_UINT32_WITHIN(1, localTime(2024, 7, 1, 18, 0, 1), getLocalTime());
+    TEST_ASSERT_EQUAL(0, relayState);
+}
+
+static void test_weekly_and_dated(void)
+{
+    TEST_ASSERT_EQUAL(200, status(request(HTTP_PUT, "/api/v1/schedules",
+                                          "{\"schedules\":[{\"action\":\"on\",\"at\":\"18:01\",\"days\":[\"mon\",\"tue\"]},"
+                                          "{\"action\":\"off\",\"at\":\"18:03\",\"date\":\"2024-07-01\"}],"
+                                          "\"exceptions\":[\"2024-07-02\"]}")));
+    TEST_ASSERT_TRUE(LittleFS.exists("/schedule.bin"));
+
+    TEST_ASSERT_EQUAL(localTime(2024, 7, 1, 18, 1, 0), runUntilSwitch(localTime(2024, 7, 1, 18, 10, 0)));
+    TEST_ASSERT_EQUAL(1, relayState);
+    TEST_ASSERT_EQUAL(localTime(2024, 7, 1, 18, 3, 0), runUntilSwitch(localTime(2024, 7, 1, 18, 10, 0)));
+    TEST_ASSERT_EQUAL(0, relayState);
+
+    // Refused, and the schedule stays as it was.
+    const char *invalid[] = {
+        "{\"schedules\":[{\"action\":\"off\",\"at\":\"18:03\",\"date\":\"2024-02-30\"}]}",
+        "{\"schedules\":[{\"action\":\"on\",\"at\":\"18:01\",\"days\":[\"mon\"],\"relay\":1}]}",
+        "{\"schedules\":[{\"action\":\"on\",\"at\":\"18:01\",\"days\":[\"monday\"]}]}",
+        "{\"schedules\":[{\"action\":\"on\",\"at\":\"sunset+721\",\"days\":[\"mon\"]}]}",
+    };
+    for (const char *schedule : invalid)
+    {
+        TEST_ASSERT_EQUAL_MESSAGE(400, status(request(HTTP_PUT, "/api/v1/schedules", schedule)), schedule);
+    }
+    std::string schedules = webserver.shim_request(HTTP_GET, "/api/v1/schedules");
+    TEST_ASSERT_TRUE(schedules.find("\"2024-07-02\"") != std::string::npos);
+}
+
+static void test_exception_date(void)
+{
+    // Tuesday is an exception, the Monday after is not.
+    skipTo(localTime(2024, 7, 2, 18, 0, 0));
+    TEST_ASSERT_EQUAL(0, runUntilSwitch(localTime(2024, 7, 2, 18, 10, 0)));
+    TEST_ASSERT_EQUAL(0, relayState);
+
+    skipTo(localTime(2024, 7, 8, 18, 0, 0));
+    TEST_ASSERT_EQUAL(localTime(2024, 7, 8, 18, 1, 0), runUntilSwitch(localTime(2024, 7, 8, 18, 10, 0)));
+    TEST_ASSERT_EQUAL(1, relayState);
+}
+
+static void test_sun_times(void)
+{
+    TEST_ASSERT_EQUAL(400, status(request(HTTP_PATCH, "/api/v1/config", "{\"Latitude\":91}")));
+    char body[128];
+    snprintf(body, sizeof(body), "{\"EnableLocation\":true,\"Latitude\":%.4f,\"Longitude\":%.4f}", LATITUDE,
+             LONGITUDE);
+    TEST_ASSERT_EQUAL(200, status(request(HTTP_PATCH, "/api/v1/config", body)));
+
+    // On from a quarter of an hour before sunset, off half an hour after it.
+    TEST_ASSERT_EQUAL(200, status(request(HTTP_PUT, "/api/v1/rules",
+                                          "{\"rules\":[{\"action\":\"on\",\"when\":[{\"sensor\":\"time\","
+                                          "\"op\":\"between\",\"from\":\"sunset-15\",\"to\":\"sunset+20\"}]}]}")));
+    TEST_ASSERT_EQUAL(200, status(request(HTTP_PUT, "/api/v1/schedules",
+                                          "{\"schedules\":[{\"action\":\"off\",\"at\":\"sunset+30\",\"days\":"
+                                          "[\"sun\",\"mon\",\"tue\",\"wed\",\"thu\",\"fri\",\"sat\"]}]}")));
+    webserver.shim_request(HTTP_GET, "/relay_off");
+    TEST_ASSERT_EQUAL(0, relayState);
+
+    skipTo(localTime(2024, 7, 9, 18, 0, 0));
+    uint32_t sunset = localTime(2024, 7, 9, 0, 0, 0) + sunEvent(2024, 7, 9, SUN_EVENT_SUNSET) % 86400;
+    TEST_ASSERT_EQUAL(sunset - 15 * 60, runUntilSwitch(localTime(2024, 7, 9, 21, 0, 0)));
+    TEST_ASSERT_EQUAL(sunset + 30 * 60, runUntilSwitch(localTime(2024, 7, 9, 21, 0, 0)));
+}
+
+static void test_sun_times_move_on(void)
+{
+    // Six weeks on the sun sets almost half an hour earlier.
+    skipTo(localTime(2024, 8, 20, 17, 30, 0));
+    uint32_t sunset = localTime(2024, 8, 20, 0, 0, 0) + sunEvent(2024, 8, 20, SUN_EVENT_SUNSET) % 86400;
+    TEST_ASSERT_TRUE(sunEvent(2024, 7, 9, SUN_EVENT_SUNSET) % 86400 - sunset % 86400 > 20 * 60);
+    TEST_ASSERT_EQUAL(sunset - 15 * 60, runUntilSwitch(localTime(2024, 8, 20, 21, 0, 0)));
+    TEST_ASSERT_EQUAL(sunset + 30 * 60, runUntilSwitch(localTime(2024, 8, 20, 21, 0, 0)));
+
+    // And again the day after, past midnight without a skip.
+    sunset = localTime(2024, 8, 21, 0, 0, 0) + sunEvent(2024, 8, 21, SUN_EVENT_SUNSET) % 86400;
+    TEST_ASSERT_EQUAL(sunset - 15 * 60, runUntilSwitch(localTime(2024, 8, 21, 21, 0, 0)));
+    TEST_ASSERT_EQUAL(sunset + 30 * 60, runUntilSwitch(localTime(2024, 8, 21, 21, 0, 0)));
+}
+
+int main(int argc, char **argv)
+{
+    fsRoot = std::filesystem::temp_directory_path() / "schedules";
+    std::filesystem::remove_all(fsRoot);
+    setenv("SHIM_FS_ROOT", fsRoot.c_str(), 1);
+    LittleFS.begin();
+    shim_freezeClock(true);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_boot);
+    RUN_TEST(test_weekly_and_dated);
+    RUN_TEST(test_exception_date);
+    RUN_TEST(test_sun_times);
+    RUN_TEST(test_sun_times_move_on);
+    int failures = UNITY_END();
+
+    std::filesystem::remove_all(fsRoot);
+    return failures;
+}
@@ -0,0 +1,235 @@
+/*
+ * Host tests for StateLog: write debouncing, slot rotation across both
+ * files, and recovery from a torn or corrupt record, on the shim's LittleFS
+ * in a scratch directory with the shim's clock frozen.
+ *
+ *     pio test -e native -f test_state_log
+ */
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <StateLog.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+
+#define LOG_PATH "/relay"
+#define RECORD_SIZE 12
+
+static std::filesystem::path fsRoot;
+
+void setUp(void)
+{
+    fsRoot = std::filesystem::temp_directory_path() / ("state_log_" + std::to_string(rand()));
+    std::filesystem::remove_all(fsRoot);
+    setenv("SHIM_FS_ROOT", fsRoot.c_str(), 1);
+    LittleFS.begin();
+    shim_freezeClock(true);
+}
+
+void tearDown(void)
+{
+    shim_freezeClock(false);
+    std::filesystem::remove_all(fsRoot);
+}
+
+static size_t fileSize(const char *path)
+{
+    File file = LittleFS.open(path, "r");
+    return file ? file.size() : 0;
+}
+
+static size_t totalSize(void)
+{
+    return fileSize(LOG_PATH ".0") + fileSize(LOG_PATH ".1");
+}
+
+static bool loadFresh(uint32_t &value)
+{
+    StateLog log(LOG_PATH);
+    return log.load(value);
+}
+
+/* -------------------------------------------------- */
+
+static void test_empty_log(void)
+{
+    uint32_t value = 7;
+    TEST_ASSERT_FALSE(loadFresh(value));
+    TEST_ASSERT_EQUAL_UINT32(7, value);
+}
+
+static void test_write_waits_for_settle_time(void)
+{
+    StateLog log(LOG_PATH);
+    log.set(1);
+    log.loop();
+    delay(STATE_LOG_SETTLE_TIME - 1);
+    log.loop();
+    TEST_ASSERT_EQUAL(0, totalSize());
+
+    delay(1);
+    log.loop();
+    TEST_ASSERT_EQUAL(RECORD_SIZE, totalSize());
+    uint32_t value;
+    TEST_ASSERT_TRUE(loadFresh(value));
+    TEST_ASSERT_EQUAL_UINT32(1, value);
+}
+
+static void test_burst_costs_one_write(void)
+{
+    StateLog log(LOG_PATH);
+    log.set(1);
+    delay(STATE_LOG_SETTLE_TIME);
+    log.loop();
+    TEST_ASSERT_EQUAL(RECORD_SIZE, totalSize());
+
+    // Toggled every 100 ms for 30 s: nothing until the interval has passed,
+    // and no more than one write per interval.
+    for (int i = 0; i < 300; i++)
+    {
+        log.set(i & 1);
+        delay(100);
+        log.loop();
+    }
+    TEST_ASSERT_TRUE(totalSize() <= 4 * RECORD_SIZE);
+
+    log.set(0);
+    for (int i = 0; i < 200; i++)
+    {
+        delay(100);
+        log.loop();
+    }
+    uint32_t value;
+    TEST_ASSERT_TRUE(loadFresh(value));
+    TEST_ASSERT_EQUAL_UINT32(0, value);
+}
+
+static void test_unchanged_value_not_written(void)
+{
+    StateLog log(LOG_PATH);
+    log.set(1);
+    TEST_ASSERT_TRUE(log.flush());
+    size_t size = totalSize();
+
+    // Back to the stored value before the write happened.
+    delay(STATE_LOG_MIN_INTERVAL);
+    log.set(0);
+    log.set(1);
+    delay(STATE_LOG_SETTLE_TIME);
+    log.loop();
+    TEST_ASSERT_EQUAL(size, totalSize());
+
+    // Also after a reboot.
+    StateLog restarted(LOG_PATH);
+    uint32_t value;
+    TEST_ASSERT_TRUE(restarted.load(value));
+    restarted.set(value);
+    TEST_ASSERT_TRUE(restarted.flush());
+    TEST_ASSERT_EQUAL(size, totalSize());
+}
+
+static void test_rotation_across_both_files(void)
+{
+    StateLog log(LOG_PATH);
+    for (uint32_t i = 1; i <= STATE_LOG_SLOTS; i++)
+    {
+        log.set(i);
+        TEST_ASSERT_TRUE(log.flush());
+    }
+    TEST_ASSERT_EQUAL(STATE_LOG_SLOTS * RECORD_SIZE, fileSize(LOG_PATH ".0"));
+    TEST_ASSERT_FALSE(LittleFS.exists(LOG_PATH ".1"));
+
+    // The next record starts the other file, the full one stays untouched.
+    log.set(1000);
+    TEST_ASSERT_TRUE(log.flush());
+    TEST_ASSERT_EQUAL(STATE_LOG_SLOTS * RECORD_SIZE, fileSize(LOG_PATH ".0"));
+    TEST_ASSERT_EQUAL(RECORD_SIZE, fileSize(LOG_PATH ".1"));
+    uint32_t value;
+    TEST_ASSERT_TRUE(loadFresh(value));
+    TEST_ASSERT_EQUAL_UINT32(1000, value);
+
+    // Filling the second file starts the first one over.
+    for (uint32_t i = 1; i <= STATE_LOG_SLOTS; i++)
+    {
+        log.set(2000 + i);
+        TEST_ASSERT_TRUE(log.flush());
+    }
+    TEST_ASSERT_EQUAL(RECORD_SIZE, fileSize(LOG_PATH ".0"));
+    TEST_ASSERT_EQUAL(STATE_LOG_SLOTS * RECORD_SIZE, fileSize(LOG_PATH ".1"));
+    TEST_ASSERT_TRUE(loadFresh(value));
+    TEST_ASSERT_EQUAL_UINT32(2000 + STATE_LOG_SLOTS, value);
+
+    // A reloaded log carries on where the old one stopped.
+    StateLog restarted(LOG_PATH);
+    TEST_ASSERT_TRUE(restarted.load(value));
+    restarted.set(3000);
+    TEST_ASSERT_TRUE(restarted.flush());
+    TEST_ASSERT_EQUAL(2 * RECORD_SIZE, fileSize(LOG_PATH ".0"));
+    TEST_ASSERT_TRUE(loadFresh(value));
+    TEST_ASSERT_EQUAL_UINT32(3000, value);
+}
+
+static void test_torn_record_recovered(void)
+{
+    StateLog log(LOG_PATH);
+    log.set(1);
+    TEST_ASSERT_TRUE(log.flush());
+    log.set(2);
+    TEST_ASSERT_TRUE(log.flush());
+
+    // A power loss in the middle of the next append.
+    File file = LittleFS.open(LOG_PATH ".0", "a");
+    file.write((const uint8_t *)"\x03\x00\x00\x00\x00", 5);
+    file.close();
+
+    StateLog restarted(LOG_PATH);
+    uint32_t value;
+    TEST_ASSERT_TRUE(restarted.load(value));
+    TEST_ASSERT_EQUAL_UINT32(2, value);
+
+    // The next record must not be appended behind the torn one.
+    restarted.set(3);
+    TEST_ASSERT_TRUE(restarted.flush());
+    TEST_ASSERT_EQUAL(RECORD_SIZE, fileSize(LOG_PATH ".1"));
+    TEST_ASSERT_TRUE(loadFresh(value));
+    TEST_ASSERT_EQUAL_UINT32(3, value);
+}
+
+static void test_corrupt_record_skipped(void)
+{
+    StateLog log(LOG_PATH);
+    log.set(1);
+    TEST_ASSERT_TRUE(log.flush());
+    log.set(2);
+    TEST_ASSERT_TRUE(log.flush());
+
+    // Flip a bit of the newest value: its CRC no longer matches.
+    File file = LittleFS.open(LOG_PATH ".0", "r+");
+    file.seek(RECORD_SIZE + 4);
+    file.write((const uint8_t *)"\x03", 1);
+    file.close();
+
+    uint32_t value;
+    TEST_ASSERT_TRUE(loadFresh(value));
+    TEST_ASSERT_EQUAL_UINT32(1, value);
+
+    // Nothing valid left.
+    file = LittleFS.open(LOG_PATH ".0", "r+");
+    file.write((const uint8_t *)"\x00\x01", 2);
+    file.close();
+    TEST_ASSERT_FALSE(loadFresh(value));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_log);
+    RUN_TEST(test_write_waits_for_settle_time);
+    RUN_TEST(test_burst_costs_one_write);
+    RUN_TEST(test_unchanged_value_not_written);
+    RUN_TEST(test_rotation_across_both_files);
+    RUN_TEST(test_torn_record_recovered);
+    RUN_TEST(test_corrupt_record_skipped);
+    return UNITY_END();
+}
@@ -0,0 +1,123 @@
+/*
+ * Host tests for SunTimes: sunrise and sunset against published tables,
+ * civil twilight around them, the polar cases, and the per-day cache.
+ *
+ *     pio test -e native -f test_sun_times
+ */
+#include <SunTimes.h>
+#include <TimeZone.h>
+#include <unity.h>
+
+struct Place
+{
+    const char *name;
+    int32_t year;
+    uint8_t month;
+    uint8_t day;
+    float latitude;
+    float longitude;
+    int utcOffset; // Minutes, the local time of the tables.
+    int sunrise;   // Local minute of the day, from the tables.
+    int sunset;
+};
+
+static const Place PLACES[] = {
+    {"London", 2024, 6, 21, 51.5074f, -0.1278f, 60, 4 * 60 + 43, 21 * 60 + 21},
+    {"New York", 2024, 12, 21, 40.7128f, -74.0060f, -300, 7 * 60 + 16, 16 * 60 + 32},
+    {"Shanghai", 2024, 7, 1, 31.2304f, 121.4737f, 480, 4 * 60 + 53, 19 * 60 + 1},
+    {"Sydney", 2024, 6, 21, -33.8688f, 151.2093f, 600, 7 * 60, 16 * 60 + 54},
+};
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static int localMinute(uint32_t utc, int utcOffset)
+{
+    return TimeZone::minuteOfDay(utc + utcOffset * 60);
+}
+
+/* -------------------------------------------------- */
+
+static void test_matches_tables(void)
+{
+    for (const Place &place : PLACES)
+    {
+        uint32_t times[SUN_EVENT_COUNT];
+        SunTimes::calculate(TimeZone::daysFromCivil(place.year, place.month, place.day), place.latitude,
+                            place.longitude, times);
+        for (int event = 0; event < SUN_EVENT_COUNT; event++)
+        {
+            TEST_ASSERT_TRUE_MESSAGE(times[event] != SUN_TIME_NONE, place.name);
+        }
+
+        // A minute either way, plus rounding in the tables.
+        int sunrise = localMinute(times[SUN_EVENT_SUNRISE], place.utcOffset);
+        int sunset = localMinute(times[SUN_EVENT_SUNSET], place.utcOffset);
+        TEST_ASSERT_INT_WITHIN_MESSAGE(2, place.sunrise, sunrise, place.name);
+        TEST_ASSERT_INT_WITHIN_MESSAGE(2, place.sunset, sunset, place.name);
+
+        // Civil twilight lasts about half an hour to an hour at these latitudes.
+        int dawn = localMinute(times[SUN_EVENT_DAWN], place.utcOffset);
+        int dusk = localMinute(times[SUN_EVENT_DUSK], place.utcOffset);
+        TEST_ASSERT_TRUE_MESSAGE(sunrise - dawn >= 25 && sunrise - dawn <= 60, place.name);
+        TEST_ASSERT_TRUE_MESSAGE(dusk - sunset >= 25 && dusk - sunset <= 60, place.name);
+    }
+}
+
+static void test_polar_day_and_night(void)
+{
+    const float latitude = 69.6492f;
+    const float longitude = 18.9553f;
+    uint32_t times[SUN_EVENT_COUNT];
+
+    // Midsummer in Tromso: the sun never sets, nor does it get dark.
+    SunTimes::calculate(TimeZone::daysFromCivil(2024, 6, 21), latitude, longitude, times);
+    for (int event = 0; event < SUN_EVENT_COUNT; event++)
+    {
+        TEST_ASSERT_EQUAL(SUN_TIME_NONE, times[event]);
+    }
+
+    // Midwinter: no sunrise, only twilight around noon.
+    SunTimes::calculate(TimeZone::daysFromCivil(2024, 12, 21), latitude, longitude, times);
+    TEST_ASSERT_EQUAL(SUN_TIME_NONE, times[SUN_EVENT_SUNRISE]);
+    TEST_ASSERT_EQUAL(SUN_TIME_NONE, times[SUN_EVENT_SUNSET]);
+    TEST_ASSERT_TRUE(times[SUN_EVENT_DAWN] != SUN_TIME_NONE);
+    TEST_ASSERT_TRUE(times[SUN_EVENT_DUSK] != SUN_TIME_NONE);
+    TEST_ASSERT_TRUE(times[SUN_EVENT_DAWN] < times[SUN_EVENT_DUSK]);
+}
+
+static void test_cached_per_day(void)
+{
+    SunTimes sun;
+    TEST_ASSERT_FALSE(sun.hasLocation());
+
+    sun.setLocation(51.5f, 0.0f);
+    TEST_ASSERT_TRUE(sun.hasLocation());
+    TEST_ASSERT_TRUE(sun.update(19900));
+    TEST_ASSERT_EQUAL(19900, sun.day());
+    uint32_t sunrise = sun.time(SUN_EVENT_SUNRISE);
+    TEST_ASSERT_FALSE(sun.update(19900));
+    TEST_ASSERT_EQUAL(sunrise, sun.time(SUN_EVENT_SUNRISE));
+
+    TEST_ASSERT_TRUE(sun.update(19901));
+    TEST_ASSERT_TRUE(sun.time(SUN_EVENT_SUNRISE) > sunrise);
+
+    // A new location is worked out again on the same day.
+    sun.setLocation(31.2f, 121.5f);
+    TEST_ASSERT_TRUE(sun.update(19901));
+    TEST_ASSERT_EQUAL(SUN_TIME_NONE, sun.time(SUN_EVENT_COUNT));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_tables);
+    RUN_TEST(test_polar_day_and_night);
+    RUN_TEST(test_cached_per_day);
+    return UNITY_END();
+}
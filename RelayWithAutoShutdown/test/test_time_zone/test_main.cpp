@@ -0,0 +1,141 @@
+/*
+ * Host tests for TimeZone: offsets and local minutes against the C
+ * library's localtime_r() for the same POSIX TZ rules, the calendar
+ * helpers, and rules that must be refused.
+ *
+ *     pio test -e native -f test_time_zone
+ */
+#include <TimeZone.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unity.h>
+
+static const char *ZONES[] = {
+    "CST-8",
+    "CET-1CEST,M3.5.0,M10.5.0/3",
+    "EST5EDT,M3.2.0,M11.1.0",
+    "AEST-10AEDT,M10.1.0,M4.1.0/3",
+    "GMT0BST,M3.5.0/1,M10.5.0",
+    "<+0330>-3:30",
+    "NZST-12NZDT,M9.5.0,M4.1.0/3",
+    "PST8PDT,M3.2.0,M11.1.0",
+};
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/* -------------------------------------------------- */
+
+static void test_matches_libc(void)
+{
+    char message[96];
+    for (const char *zone : ZONES)
+    {
+        TimeZone timeZone;
+        TEST_ASSERT_TRUE_MESSAGE(timeZone.set(zone), zone);
+        setenv("TZ", zone, 1);
+        tzset();
+
+        // 2000 to 2100, in uneven steps so every hour of the year comes up.
+        for (uint32_t utc = 946684800u; utc < 4102444800u; utc += 3607 * 7 + (utc % 13) * 60)
+        {
+            time_t t = utc;
+            struct tm local;
+            localtime_r(&t, &local);
+            snprintf(message, sizeof(message), "%s at %u", zone, (unsigned)utc);
+            TEST_ASSERT_EQUAL_MESSAGE(local.tm_gmtoff, timeZone.offset(utc), message);
+            TEST_ASSERT_EQUAL_MESSAGE(local.tm_isdst > 0, timeZone.isDst(utc), message);
+            TEST_ASSERT_EQUAL_MESSAGE(local.tm_hour * 60 + local.tm_min, TimeZone::minuteOfDay(timeZone.toLocal(utc)),
+                                      message);
+        }
+    }
+    unsetenv("TZ");
+    tzset();
+}
+
+static void test_transition_edges(void)
+{
+    // Central Europe, 2024: summer time from 31 March 01:00 UTC to 27 October 01:00 UTC.
+    TimeZone timeZone;
+    TEST_ASSERT_TRUE(timeZone.set("CET-1CEST,M3.5.0,M10.5.0/3"));
+    const uint32_t start = 1711846800u;
+    const uint32_t end = 1729990800u;
+    TEST_ASSERT_EQUAL(3600, timeZone.offset(start - 1));
+    TEST_ASSERT_EQUAL(7200, timeZone.offset(start));
+    TEST_ASSERT_EQUAL(7200, timeZone.offset(end - 1));
+    TEST_ASSERT_EQUAL(3600, timeZone.offset(end));
+
+    // Lookups going back in time after the cache moved on.
+    TEST_ASSERT_EQUAL(7200, timeZone.offset(start + 86400 * 365));
+    TEST_ASSERT_EQUAL(3600, timeZone.offset(start - 86400 * 365 * 3 - 86400 * 30));
+}
+
+static void test_civil_days(void)
+{
+    TEST_ASSERT_EQUAL(0, TimeZone::daysFromCivil(1970, 1, 1));
+    TEST_ASSERT_EQUAL(19905, TimeZone::daysFromCivil(2024, 7, 1));
+    TEST_ASSERT_EQUAL(4, TimeZone::weekday(0));     // Thursday
+    TEST_ASSERT_EQUAL(1, TimeZone::weekday(19905)); // Monday
+
+    for (int32_t days = 0; days < 100 * 366; days++)
+    {
+        int32_t year;
+        uint8_t month;
+        uint8_t day;
+        TimeZone::civilFromDays(days, year, month, day);
+        TEST_ASSERT_EQUAL(days, TimeZone::daysFromCivil(year, month, day));
+
+        time_t t = (time_t)days * 86400;
+        struct tm utc;
+        gmtime_r(&t, &utc);
+        TEST_ASSERT_EQUAL(utc.tm_year + 1900, year);
+        TEST_ASSERT_EQUAL(utc.tm_mon + 1, month);
+        TEST_ASSERT_EQUAL(utc.tm_mday, day);
+        TEST_ASSERT_EQUAL(utc.tm_wday, TimeZone::weekday(days));
+    }
+}
+
+static void test_refuses_malformed_rules(void)
+{
+    const char *rules[] = {
+        "",
+        "C-8",
+        "CST",
+        "CST-8X",
+        "CET-1CEST",
+        "CET-1CEST,M3.5.0",
+        "CET-1CEST,J60,M10.5.0",
+        "CET-1CEST,M13.5.0,M10.5.0",
+        "CST-25",
+    };
+    for (const char *rule : rules)
+    {
+        TimeZone timeZone;
+        TEST_ASSERT_FALSE_MESSAGE(timeZone.set(rule), rule);
+    }
+}
+
+static void test_failed_set_keeps_rule(void)
+{
+    TimeZone timeZone;
+    TEST_ASSERT_TRUE(timeZone.set("CST-8"));
+    TEST_ASSERT_FALSE(timeZone.set("Mars+99"));
+    TEST_ASSERT_EQUAL(8 * 3600, timeZone.offset(1719828000u));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_libc);
+    RUN_TEST(test_transition_edges);
+    RUN_TEST(test_civil_days);
+    RUN_TEST(test_refuses_malformed_rules);
+    RUN_TEST(test_failed_set_keeps_rule);
+    return UNITY_END();
+}
@@ -0,0 +1,192 @@
+/*
+ * Warm boot of the firmware on the host: a BootSnapshot left in the shim's
+ * RTC memory restores the relay, the clock and the settings, with only the
+ * credentials read from config.bin; the automation runs on the restored
+ * clock while NTP is out of reach, and NTP takes over once the station
+ * connects. A damaged snapshot is ignored. The tests run in order
+ * on one booted firmware.
+ *
+ *     pio test -e native -f test_warm_boot
+ */
+#include <Arduino.h>
+#include <BootCache.h>
+#include <ConfigStore.h>
+#include <ESP8266WiFi.h>
+#include <HttpServer.h>
+#include <LittleFS.h>
+#include <NtpClock.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+
+// 2024-07-01 10:00 UTC, 18:00 in the default CST-8.
+#define RESTORED_EPOCH 1719828000UL
+#define RESTORED_UPTIME 3600000UL
+#define NTP_EPOCH (RESTORED_EPOCH + 600)
+
+void setup(void);
+void loop(void);
+void saveBootCache(void);
+extern HttpServer webserver;
+extern NtpClock timeClient;
+extern String ssidName;
+extern String ssidPassword;
+extern String relayDisplayName;
+extern int relayState;
+
+static std::filesystem::path fsRoot;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static void run(unsigned long milliseconds)
+{
+    for (unsigned long elapsed = 0; elapsed < milliseconds; elapsed += 250)
+    {
+        shim_advanceMillis(250);
+        loop();
+    }
+}
+
+static int status(const std::string &response)
+{
+    return atoi(response.c_str() + strlen("HTTP/1.1 "));
+}
+
+/* -------------------------------------------------- */
+
+static void test_relay_clock_and_config_restored(void)
+{
+    ConfigRecord record;
+    ConfigStore::clear(record);
+    ConfigStore::setString(record.ssid, sizeof(record.ssid), "home");
+    ConfigStore::setString(record.password, sizeof(record.password), "secret");
+    ConfigStore::setString(record.relayDisplayName, sizeof(record.relayDisplayName), "Porch");
+    ConfigStore store("/config.bin");
+    TEST_ASSERT_TRUE(store.save(record));
+
+    // What the firmware left behind before ESP.restart(); the credentials
+    // are only on flash.
+    BootSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.configCrc = record.crc;
+    ConfigStore::getSettings(record, snapshot.configSettings);
+    snapshot.relayState = 1;
+    snapshot.epoch = RESTORED_EPOCH;
+    snapshot.uptimeMillis = RESTORED_UPTIME;
+    TEST_ASSERT_TRUE(BootCache::save(snapshot));
+
+    // NTP stays out of reach for now.
+    WiFi.shim_setReachable(false);
+    unsigned long boot = millis();
+    setup();
+
+    TEST_ASSERT_EQUAL_STRING("home", ssidName.c_str());
+    TEST_ASSERT_EQUAL_STRING("secret", ssidPassword.c_str());
+    TEST_ASSERT_EQUAL_STRING("Porch", relayDisplayName.c_str());
+    TEST_ASSERT_EQUAL(1, relayState);
+    TEST_ASSERT_EQUAL(HIGH, digitalRead(D1));
+    TEST_ASSERT_FALSE(timeClient.isTimeSet());
+    TEST_ASSERT_UINT32_WITHIN(1, RESTORED_EPOCH + (millis() - boot) / 1000, timeClient.getEpochTime());
+}
+
+static void test_rules_run_on_restored_clock(void)
+{
+    // Off from 17:30 to 18:30 local, which the restored clock is in.
+    std::string response = webserver.shim_request(
+        HTTP_PUT, "/api/v1/rules",
+        {{"plain", "{\"rules\":[{\"action\":\"off\",\"when\":[{\"sensor\":\"time\",\"op\":\"between\","
+                   "\"from\":\"17:30\",\"to\":\"18:30\"}]}]}"}});
+    TEST_ASSERT_EQUAL(200, status(response));
+
+    run(1000);
+    TEST_ASSERT_EQUAL(0, relayState);
+    TEST_ASSERT_EQUAL(LOW, digitalRead(D1));
+}
+
+static void test_snapshot_keeps_running_clock(void)
+{
+    // The 30 s tick rewrites the snapshot; the epoch must not fall back to 0,
+    // and the uptime counts on from the restored one.
+    uint32_t epoch = timeClient.getEpochTime();
+    run(31000);
+
+    BootSnapshot snapshot;
+    TEST_ASSERT_TRUE(BootCache::load(snapshot));
+    TEST_ASSERT_EQUAL(0, snapshot.relayState);
+    TEST_ASSERT_UINT32_WITHIN(2, epoch + 31, snapshot.epoch);
+    TEST_ASSERT_TRUE(snapshot.uptimeMillis >= RESTORED_UPTIME + 30000);
+
+    // The settings travel with it, the credentials do not.
+    ConfigRecord record;
+    ConfigStore::clear(record);
+    ConfigStore::setSettings(record, snapshot.configSettings);
+    TEST_ASSERT_EQUAL_STRING("Porch", record.relayDisplayName);
+    TEST_ASSERT_EQUAL_STRING("", record.ssid);
+    TEST_ASSERT_EQUAL_STRING("", record.password);
+    TEST_ASSERT_TRUE(snapshot.configCrc != 0);
+}
+
+static void test_ntp_takes_over(void)
+{
+    WiFi.shim_setReachable(true);
+    WiFiUDP::shim_setNtpEpoch(NTP_EPOCH);
+
+    // Station backoff and the NTP retry both stay within a few minutes.
+    for (int second = 0; second < 600 && !timeClient.isTimeSet(); second++)
+    {
+        run(1000);
+    }
+    TEST_ASSERT_TRUE(WiFi.isConnected());
+    TEST_ASSERT_TRUE(timeClient.isTimeSet());
+    TEST_ASSERT_UINT32_WITHIN(1, NTP_EPOCH, timeClient.getEpochTime());
+
+    run(31000);
+    BootSnapshot snapshot;
+    TEST_ASSERT_TRUE(BootCache::load(snapshot));
+    TEST_ASSERT_UINT32_WITHIN(2, NTP_EPOCH + 31, snapshot.epoch);
+}
+
+static void test_garbage_is_not_a_snapshot(void)
+{
+    BootSnapshot snapshot;
+    TEST_ASSERT_TRUE(BootCache::load(snapshot));
+
+    // One flipped bit, as after a power cycle.
+    uint32_t block;
+    ESP.rtcUserMemoryRead(BOOT_CACHE_RTC_OFFSET + 3, &block, sizeof(block));
+    block ^= 0x10;
+    ESP.rtcUserMemoryWrite(BOOT_CACHE_RTC_OFFSET + 3, &block, sizeof(block));
+    TEST_ASSERT_FALSE(BootCache::load(snapshot));
+
+    saveBootCache();
+    TEST_ASSERT_TRUE(BootCache::load(snapshot));
+    BootCache::invalidate();
+    TEST_ASSERT_FALSE(BootCache::load(snapshot));
+}
+
+int main(int argc, char **argv)
+{
+    fsRoot = std::filesystem::temp_directory_path() / "warm_boot";
+    std::filesystem::remove_all(fsRoot);
+    setenv("SHIM_FS_ROOT", fsRoot.c_str(), 1);
+    LittleFS.begin();
+    shim_freezeClock(true);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_relay_clock_and_config_restored);
+    RUN_TEST(test_rules_run_on_restored_clock);
+    RUN_TEST(test_snapshot_keeps_running_clock);
+    RUN_TEST(test_ntp_takes_over);
+    RUN_TEST(test_garbage_is_not_a_snapshot);
+    int failures = UNITY_END();
+
+    std::filesystem::remove_all(fsRoot);
+    return failures;
+}
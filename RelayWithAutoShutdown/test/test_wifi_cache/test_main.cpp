@@ -0,0 +1,188 @@
+/*
+ * Host tests for WifiCache and the fast reconnect of the firmware: the
+ * record round trip and a damaged file, the access point cached after the
+ * first connect, the scan skipped with the cache, and the fall back to a
+ * scan when the cached access point does not answer. The firmware tests
+ * run in order on one booted firmware.
+ *
+ *     pio test -e native -f test_wifi_cache
+ */
+#include <Arduino.h>
+#include <ConfigStore.h>
+#include <ESP8266WiFi.h>
+#include <HttpServer.h>
+#include <LittleFS.h>
+#include <WifiCache.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+
+#define CACHE_PATH "/wifi.bin"
+#define TEST_CACHE_PATH "/test_wifi.bin"
+
+void setup(void);
+void loop(void);
+void connectStation(void);
+extern HttpServer webserver;
+
+static std::filesystem::path fsRoot;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static void run(unsigned long milliseconds)
+{
+    for (unsigned long elapsed = 0; elapsed < milliseconds; elapsed += 250)
+    {
+        shim_advanceMillis(250);
+        loop();
+    }
+}
+
+static bool fastConnect(void)
+{
+    std::string response = webserver.shim_request(HTTP_GET, "/api/v1/status");
+    TEST_ASSERT_TRUE(response.find("\"connected\":true") != std::string::npos);
+    return response.find("\"fastConnect\":true") != std::string::npos;
+}
+
+static void makeRecord(WifiCacheRecord &record)
+{
+    memset(&record, 0, sizeof(record));
+    strcpy(record.ssid, "home");
+    const uint8_t bssid[6] = {0x02, 0, 0, 0, 0, 0x07};
+    memcpy(record.bssid, bssid, sizeof(bssid));
+    record.channel = 11;
+    record.ip = IPAddress(192, 168, 1, 42);
+    record.gateway = IPAddress(192, 168, 1, 1);
+    record.subnet = IPAddress(255, 255, 255, 0);
+    record.dns = IPAddress(192, 168, 1, 1);
+}
+
+/* -------------------------------------------------- */
+
+static void test_record_round_trip(void)
+{
+    WifiCache cache(TEST_CACHE_PATH);
+    WifiCacheRecord record;
+    TEST_ASSERT_FALSE(cache.load(record));
+
+    makeRecord(record);
+    TEST_ASSERT_TRUE(cache.save(record));
+    WifiCacheRecord loaded;
+    TEST_ASSERT_TRUE(cache.load(loaded));
+    TEST_ASSERT_EQUAL(0, memcmp(&record, &loaded, sizeof(record)));
+
+    TEST_ASSERT_TRUE(cache.remove());
+    TEST_ASSERT_FALSE(cache.load(loaded));
+}
+
+static void test_damaged_record_ignored(void)
+{
+    WifiCache cache(TEST_CACHE_PATH);
+    WifiCacheRecord record;
+    makeRecord(record);
+    TEST_ASSERT_TRUE(cache.save(record));
+
+    File file = LittleFS.open(TEST_CACHE_PATH, "r+");
+    file.seek(offsetof(WifiCacheRecord, channel));
+    file.write((uint8_t)6);
+    file.close();
+    WifiCacheRecord loaded;
+    TEST_ASSERT_FALSE(cache.load(loaded));
+
+    // Cut short.
+    file = LittleFS.open(TEST_CACHE_PATH, "w");
+    file.write((const uint8_t *)&record, sizeof(record) - 1);
+    file.close();
+    TEST_ASSERT_FALSE(cache.load(loaded));
+    cache.remove();
+}
+
+static void test_first_connect_is_cached(void)
+{
+    ConfigRecord record;
+    ConfigStore::clear(record);
+    ConfigStore::setString(record.ssid, sizeof(record.ssid), "home");
+    ConfigStore::setString(record.password, sizeof(record.password), "secret");
+    ConfigStore store("/config.bin");
+    TEST_ASSERT_TRUE(store.save(record));
+
+    // Nothing cached yet: the station scans and joins from loop().
+    setup();
+    run(250);
+    TEST_ASSERT_FALSE(fastConnect());
+
+    // Written from loop(), not the event handler.
+    TEST_ASSERT_FALSE(LittleFS.exists(CACHE_PATH));
+    run(250);
+    WifiCache cache(CACHE_PATH);
+    WifiCacheRecord cached;
+    TEST_ASSERT_TRUE(cache.load(cached));
+    TEST_ASSERT_EQUAL_STRING("home", cached.ssid);
+    TEST_ASSERT_EQUAL(0, memcmp(WiFi.BSSID(), cached.bssid, sizeof(cached.bssid)));
+    TEST_ASSERT_EQUAL(WiFi.channel(), cached.channel);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)WiFi.localIP(), cached.ip);
+}
+
+static void test_reconnect_skips_scan(void)
+{
+    // An unchanged access point is not written again.
+    std::filesystem::path file = fsRoot / "wifi.bin";
+    auto written = std::filesystem::last_write_time(file) - std::chrono::hours(1);
+    std::filesystem::last_write_time(file, written);
+
+    WiFi.disconnect(false);
+    connectStation();
+    TEST_ASSERT_TRUE(WiFi.isConnected());
+    TEST_ASSERT_TRUE(fastConnect());
+    run(250);
+    TEST_ASSERT_TRUE(std::filesystem::last_write_time(file) == written);
+}
+
+static void test_silent_access_point_falls_back_to_scan(void)
+{
+    // The cached access point does not answer any more.
+    WiFi.shim_setReachable(false);
+    WiFi.disconnect(false);
+    connectStation();
+    TEST_ASSERT_FALSE(WiFi.isConnected());
+    WiFi.shim_setReachable(true);
+
+    run(4750);
+    TEST_ASSERT_FALSE(WiFi.isConnected());
+    TEST_ASSERT_TRUE(LittleFS.exists(CACHE_PATH));
+
+    // After 5 s the cache is dropped and a scan follows.
+    run(1000);
+    TEST_ASSERT_TRUE(WiFi.isConnected());
+    TEST_ASSERT_FALSE(fastConnect());
+    run(250);
+    TEST_ASSERT_TRUE(LittleFS.exists(CACHE_PATH));
+}
+
+int main(int argc, char **argv)
+{
+    fsRoot = std::filesystem::temp_directory_path() / "wifi_cache";
+    std::filesystem::remove_all(fsRoot);
+    setenv("SHIM_FS_ROOT", fsRoot.c_str(), 1);
+    LittleFS.begin();
+    shim_freezeClock(true);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_record_round_trip);
+    RUN_TEST(test_damaged_record_ignored);
+    RUN_TEST(test_first_connect_is_cached);
+    RUN_TEST(test_reconnect_skips_scan);
+    RUN_TEST(test_silent_access_point_falls_back_to_scan);
+    int failures = UNITY_END();
+
+    std::filesystem::remove_all(fsRoot);
+    return failures;
+}
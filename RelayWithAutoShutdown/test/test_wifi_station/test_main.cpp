@@ -0,0 +1,181 @@
+/*
+ * Host tests for WifiStation against the shim's scan results: the
+ * strongest configured network is joined, an attempt that does not
+ * associate falls through the scan ranking, a weak link roams to a
+ * stronger access point, and with nothing in range the station waits and
+ * rescans.
+ *
+ *     pio test -e native -f test_wifi_station
+ */
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <LittleFS.h>
+#include <WifiStation.h>
+#include <filesystem>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+
+#define CACHE_PATH "/station.bin"
+
+static std::filesystem::path fsRoot;
+static WifiStation *station;
+static WiFiEventHandler handlers[3];
+
+void setUp(void)
+{
+    fsRoot = std::filesystem::temp_directory_path() / ("wifi_station_" + std::to_string(rand()));
+    std::filesystem::remove_all(fsRoot);
+    setenv("SHIM_FS_ROOT", fsRoot.c_str(), 1);
+    LittleFS.begin();
+    shim_freezeClock(true);
+
+    WiFi.disconnect(false);
+    WiFi.shim_setReachable(true);
+    WiFi.shim_setRSSI(-60);
+    WiFi.shim_clearScanResults();
+
+    station = new WifiStation(CACHE_PATH);
+    station->addNetwork("home", "secret");
+    station->addNetwork("backup", "other");
+    handlers[0] = WiFi.onStationModeConnected([](const WiFiEventStationModeConnected &event) { station->onConnected(); });
+    handlers[1] = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP &event) { station->onGotIP(); });
+    handlers[2] = WiFi.onStationModeDisconnected(
+        [](const WiFiEventStationModeDisconnected &event) { station->onDisconnected(); });
+}
+
+void tearDown(void)
+{
+    for (WiFiEventHandler &handler : handlers)
+    {
+        handler = nullptr;
+    }
+    delete station;
+    WiFi.shim_setReachable("b2", true);
+    WiFi.shim_setReachable("b3", true);
+    shim_freezeClock(false);
+    std::filesystem::remove_all(fsRoot);
+}
+
+static void run(unsigned long milliseconds)
+{
+    for (unsigned long elapsed = 0; elapsed < milliseconds; elapsed += 250)
+    {
+        shim_advanceMillis(250);
+        station->loop();
+    }
+}
+
+/* -------------------------------------------------- */
+
+static void test_strongest_network_joined(void)
+{
+    WiFi.shim_addScanResult("home", -80, 1, 1);
+    WiFi.shim_addScanResult("backup", -60, 11, 2);
+    WiFi.shim_addScanResult("neighbour", -40, 6, 3);
+
+    station->begin();
+    TEST_ASSERT_FALSE(WiFi.isConnected());
+    run(250);
+    TEST_ASSERT_TRUE(WiFi.isConnected());
+    TEST_ASSERT_EQUAL_STRING("backup", WiFi.SSID().c_str());
+    TEST_ASSERT_EQUAL(2, WiFi.BSSID()[5]);
+    TEST_ASSERT_EQUAL(WIFI_CONNECT_SCANNED, station->connectMode());
+
+    // Cached from loop() once the address is known; the next begin() uses it.
+    run(250);
+    TEST_ASSERT_TRUE(LittleFS.exists(CACHE_PATH));
+    WiFi.disconnect(false);
+    WiFi.shim_clearScanResults();
+    station->begin();
+    TEST_ASSERT_TRUE(WiFi.isConnected());
+    TEST_ASSERT_EQUAL_STRING("backup", WiFi.SSID().c_str());
+    TEST_ASSERT_EQUAL(WIFI_CONNECT_CACHED, station->connectMode());
+}
+
+static void test_fails_over_through_ranking(void)
+{
+    station->addNetwork("b2", "two");
+    station->addNetwork("b3", "three");
+    WiFi.shim_addScanResult("home", -70, 1, 1);
+    WiFi.shim_addScanResult("backup", -80, 11, 2);
+    WiFi.shim_addScanResult("b2", -50, 6, 3);
+    WiFi.shim_addScanResult("b3", -60, 6, 4);
+    WiFi.shim_setReachable("b2", false);
+    WiFi.shim_setReachable("b3", false);
+
+    station->begin();
+    run(250);
+    TEST_ASSERT_FALSE(WiFi.isConnected());
+
+    // The ranking of the first scan is worked through, no rescan in between.
+    WiFi.shim_clearScanResults();
+    run(WIFI_CONNECT_TIMEOUT + 250);
+    TEST_ASSERT_FALSE(WiFi.isConnected());
+    run(WIFI_CONNECT_TIMEOUT + 250);
+    TEST_ASSERT_TRUE(WiFi.isConnected());
+    TEST_ASSERT_EQUAL_STRING("home", WiFi.SSID().c_str());
+    TEST_ASSERT_EQUAL(1, WiFi.BSSID()[5]);
+}
+
+static void test_weak_link_roams(void)
+{
+    WiFi.shim_addScanResult("backup", -60, 11, 2);
+    station->begin();
+    run(250);
+    TEST_ASSERT_EQUAL(2, WiFi.BSSID()[5]);
+
+    // A good link is left alone.
+    WiFi.shim_clearScanResults();
+    WiFi.shim_addScanResult("backup", -60, 11, 2);
+    WiFi.shim_addScanResult("home", -50, 1, 1);
+    run(WIFI_RESCAN_INTERVAL + 1000);
+    TEST_ASSERT_EQUAL(2, WiFi.BSSID()[5]);
+
+    // Weak, and the other access point is not stronger by the margin.
+    WiFi.shim_setRSSI(-80);
+    WiFi.shim_clearScanResults();
+    WiFi.shim_addScanResult("backup", -80, 11, 2);
+    WiFi.shim_addScanResult("home", -80 + WIFI_ROAM_MARGIN - 1, 1, 1);
+    run(WIFI_RESCAN_INTERVAL + 1000);
+    TEST_ASSERT_EQUAL(2, WiFi.BSSID()[5]);
+
+    WiFi.shim_clearScanResults();
+    WiFi.shim_addScanResult("backup", -80, 11, 2);
+    WiFi.shim_addScanResult("home", -80 + WIFI_ROAM_MARGIN, 1, 1);
+    run(WIFI_RESCAN_INTERVAL + 1000);
+    TEST_ASSERT_TRUE(WiFi.isConnected());
+    TEST_ASSERT_EQUAL_STRING("home", WiFi.SSID().c_str());
+    TEST_ASSERT_EQUAL(1, WiFi.BSSID()[5]);
+}
+
+static void test_waits_while_nothing_in_range(void)
+{
+    WiFi.shim_setReachable(false);
+    WiFi.shim_addScanResult("neighbour", -40, 6, 3);
+    station->begin();
+    run(250);
+    TEST_ASSERT_FALSE(WiFi.isConnected());
+    TEST_ASSERT_EQUAL(WIFI_CONNECT_PLAIN, station->connectMode());
+
+    // No rescan before the interval is up.
+    WiFi.shim_setReachable(true);
+    WiFi.shim_addScanResult("home", -70, 1, 1);
+    run(WIFI_RESCAN_INTERVAL - 1000);
+    TEST_ASSERT_FALSE(WiFi.isConnected());
+
+    run(2000);
+    TEST_ASSERT_TRUE(WiFi.isConnected());
+    TEST_ASSERT_EQUAL_STRING("home", WiFi.SSID().c_str());
+    TEST_ASSERT_EQUAL(WIFI_CONNECT_SCANNED, station->connectMode());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_strongest_network_joined);
+    RUN_TEST(test_fails_over_through_ranking);
+    RUN_TEST(test_weak_link_roams);
+    RUN_TEST(test_waits_while_nothing_in_range);
+    return UNITY_END();
+}
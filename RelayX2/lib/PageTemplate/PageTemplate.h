@@ -0,0 +1,74 @@
+#ifndef PAGE_TEMPLATE_H
+#define PAGE_TEMPLATE_H
+
+#include <Arduino.h>
+#include <HttpServer.h>
+
+#ifdef ASYNC_WEBSERVER
+#include <memory>
+#endif
+
+#define PAGE_TEMPLATE_MAX_SEGMENTS 32
+#define PAGE_TEMPLATE_CHUNK_SIZE 256
+#define PAGE_TEMPLATE_NO_SLOT 0xFF
+
+/*
+ * Returns the text for one placeholder slot of a page template.
+ */
+typedef String (*PageTemplateValue)(uint8_t slot);
+
+/*
+ * HTML page with "{{...}}" style placeholders, stored in PROGMEM.
+ *
+ * compile() splits the page once into static segments and placeholder slots.
+ * send() then streams the segments and the slot values to the client with
+ * chunked transfer encoding, so the full page is never held in RAM.
+ * With ASYNC_WEBSERVER the slot values are taken when send() is called and
+ * the TCP stack pulls the page from PROGMEM as it goes out.
+ */
+class PageTemplate
+{
+public:
+    PageTemplate(PGM_P source, const char *const *keys, uint8_t keyCount);
+
+    bool compile(void);
+    void send(HttpServer &server, int code, const char *contentType, PageTemplateValue value);
+
+private:
+    struct Segment
+    {
+        uint16_t offset;
+        uint16_t length;
+        uint8_t slot;
+    };
+
+#ifdef ASYNC_WEBSERVER
+    // Position of one async response in the page, owned by its filler.
+    struct Cursor
+    {
+        std::unique_ptr<String[]> values;
+        uint8_t segment;
+        size_t offset;
+    };
+
+    size_t fill(Cursor &cursor, uint8_t *buffer, size_t maxLength) const;
+#else
+    void write(HttpServer &server, const char *data, size_t length);
+    void write_P(HttpServer &server, PGM_P data, size_t length);
+    void flush(HttpServer &server);
+#endif
+
+    bool addSegment(size_t offset, size_t length, uint8_t slot);
+
+    PGM_P _source;
+    const char *const *_keys;
+    uint8_t _keyCount;
+
+    Segment _segments[PAGE_TEMPLATE_MAX_SEGMENTS];
+    uint8_t _segmentCount;
+
+    char *_chunk;
+    size_t _chunkLength;
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "WifiConnection.h"
+
+WifiConnection::WifiConnection(void)
+    : _fallbackSSID(NULL), _gotIP(false), _disconnected(false), _state(WIFI_CONNECTION_IDLE), _fallback(false),
+      _failures(0), _backoff(WIFI_CONNECTION_BACKOFF_MIN), _stateMillis(0)
+{
+}
+
+void WifiConnection::setFallbackAP(const char *ssid, const IPAddress &ip)
+{
+    _fallbackSSID = ssid;
+    _fallbackIP = ip;
+}
+
+void WifiConnection::begin(const String &ssid, const String &password)
+{
+    _ssid = ssid;
+    _password = password;
+
+    // Runs in the SDK's context, loop() does the work.
+    _gotIPEvent = WiFi.onStationModeGotIP([this](const WiFiEventStationModeGotIP &event) { _gotIP = true; });
+    _disconnectedEvent = WiFi.onStationModeDisconnected([this](const WiFiEventStationModeDisconnected &event) { _disconnected = true; });
+
+    // Retries are paced here instead of by the SDK.
+    WiFi.mode(_fallback ? WIFI_AP_STA : WIFI_STA);
+    WiFi.setAutoReconnect(false);
+
+    _failures = 0;
+    _backoff = WIFI_CONNECTION_BACKOFF_MIN;
+    connect();
+}
+
+void WifiConnection::loop(void)
+{
+    if (_gotIP)
+    {
+        _gotIP = false;
+        if (_state == WIFI_CONNECTION_CONNECTING)
+        {
+            _failures = 0;
+            _backoff = WIFI_CONNECTION_BACKOFF_MIN;
+            stopFallback();
+            setState(WIFI_CONNECTION_CONNECTED);
+        }
+    }
+
+    if (_disconnected)
+    {
+        _disconnected = false;
+        if (_state == WIFI_CONNECTION_CONNECTED)
+        {
+            Serial.println("[WIFI] Connection lost, reconnecting.");
+            connect();
+        }
+        else if (_state == WIFI_CONNECTION_CONNECTING)
+        {
+            fail("Connection failed");
+        }
+    }
+
+    unsigned long elapsed = millis() - _stateMillis;
+    if (_state == WIFI_CONNECTION_CONNECTING && elapsed > WIFI_CONNECTION_TIMEOUT)
+    {
+        fail("Connection timed out");
+    }
+    else if (_state == WIFI_CONNECTION_BACKOFF && elapsed > _backoff)
+    {
+        if (_fallback && WiFi.softAPgetStationNum() > 0)
+        {
+            // Keep the SoftAP on its channel while someone is configuring.
+            _stateMillis = millis();
+            return;
+        }
+        _backoff *= 2;
+        if (_backoff > WIFI_CONNECTION_BACKOFF_MAX)
+        {
+            _backoff = WIFI_CONNECTION_BACKOFF_MAX;
+        }
+        connect();
+    }
+}
+
+void WifiConnection::connect(void)
+{
+    Serial.printf("[WIFI] Connecting to %s.\r\n", _ssid.c_str());
+    _gotIP = false;
+    _disconnected = false;
+    setState(WIFI_CONNECTION_CONNECTING);
+    WiFi.begin(_ssid, _password);
+}
+
+void WifiConnection::fail(const char *reason)
+{
+    // Stop the SDK from trying on its own until the next attempt.
+    WiFi.disconnect(false);
+
+    if (_failures < 0xFF)
+    {
+        _failures++;
+    }
+    if (_failures >= WIFI_CONNECTION_FALLBACK_ATTEMPTS)
+    {
+        startFallback();
+    }
+    if (_fallback)
+    {
+        _backoff = WIFI_CONNECTION_BACKOFF_MAX;
+    }
+
+    Serial.printf("[WIFI] %s (%d), next attempt in %lu s.\r\n", reason, _failures, _backoff / 1000);
+    setState(WIFI_CONNECTION_BACKOFF);
+}
+
+void WifiConnection::setState(WifiConnectionState state)
+{
+    _stateMillis = millis();
+    if (_state == state)
+    {
+        return;
+    }
+    _state = state;
+    if (_stateHandler)
+    {
+        _stateHandler(state);
+    }
+}
+
+void WifiConnection::startFallback(void)
+{
+    if (_fallback || _fallbackSSID == NULL)
+    {
+        return;
+    }
+
+    Serial.printf("[WIFI] Starting SoftAP %s.\r\n", _fallbackSSID);
+    _fallback = true;
+    WiFi.mode(WIFI_AP_STA);
+    WiFi.softAPConfig(_fallbackIP, _fallbackIP, IPAddress(255, 255, 255, 0));
+    WiFi.softAP(_fallbackSSID);
+}
+
+void WifiConnection::stopFallback(void)
+{
+    if (!_fallback)
+    {
+        return;
+    }
+
+    Serial.println("[WIFI] Stopping SoftAP.");
+    _fallback = false;
+    WiFi.softAPdisconnect(true);
+}
@@ -0,0 +1,135 @@
+"""
+Embed the web pages from doc/ into the firmware.
+
+Every doc/<name>.html is minified and written to include/pages.h as a
+PROGMEM array named <NAME>_PAGE:
+
+  * Pages listed in `custom_template_pages` (platformio.ini) keep their
+    placeholders and are stored as plain text for PageTemplate.
+  * All other pages are gzipped and emitted as a byte array together with
+    <NAME>_PAGE_LENGTH, to be sent with "Content-Encoding: gzip", and
+    <NAME>_PAGE_ETAG, a content hash used for conditional GET.
+
+Runs as a PlatformIO pre-build script, or standalone from the project
+directory:
+
+    python scripts/build_pages.py
+"""
+
+import configparser
+import gzip
+import hashlib
+import os
+import re
+
+HEADER_NAME = "pages.h"
+BYTES_PER_LINE = 16
+
+
+def minify_html(html):
+    html = html.lstrip("\ufeff")
+    html = re.sub(r"<!--.*?-->", "", html, flags=re.S)
+
+    output = []
+    in_script = False
+    for line in html.splitlines():
+        line = line.strip()
+        if not line:
+            continue
+        if "<script" in line:
+            in_script = True
+        # Keep line breaks inside scripts, statements may rely on them.
+        # Elsewhere a line break becomes one space: it may separate two
+        # attributes or the gap between inline elements.
+        output.append(line + "\n" if in_script else line + " ")
+        if "</script>" in line:
+            in_script = False
+    return "".join(output).rstrip()
+
+
+def c_string(text):
+    data = text.encode("utf-8")
+    escaped = []
+    for byte in data:
+        char = chr(byte)
+        if char in "\\\"":
+            escaped.append("\\" + char)
+        elif char == "\n":
+            escaped.append("\\n")
+        elif 0x20 <= byte < 0x7F:
+            escaped.append(char)
+        else:
+            escaped.append("\\%03o" % byte)
+    return "\"" + "".join(escaped) + "\""
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), BYTES_PER_LINE):
+        chunk = data[i:i + BYTES_PER_LINE]
+        lines.append("    " + ", ".join("0x%02X" % b for b in chunk) + ",")
+    return "\n".join(lines)
+
+
+def build_pages(project_dir, template_pages):
+    doc_dir = os.path.join(project_dir, "doc")
+    header_path = os.path.join(project_dir, "include", HEADER_NAME)
+
+    lines = [
+        "/* Generated by scripts/build_pages.py from the pages in doc/, do not edit. */",
+        "",
+        "#ifndef PAGES_H",
+        "#define PAGES_H",
+        "",
+        "#include <Arduino.h>",
+        "",
+    ]
+
+    for file_name in sorted(os.listdir(doc_dir)):
+        base, ext = os.path.splitext(file_name)
+        if ext.lower() != ".html":
+            continue
+
+        with open(os.path.join(doc_dir, file_name), encoding="utf-8") as f:
+            html = minify_html(f.read())
+        name = re.sub(r"\W", "_", base).upper() + "_PAGE"
+
+        if file_name in template_pages:
+            lines.append("/* %s: %d bytes, template */" % (file_name, len(html.encode("utf-8"))))
+            lines.append("const char %s[] PROGMEM = %s;" % (name, c_string(html)))
+        else:
+            data = gzip.compress(html.encode("utf-8"), 9, mtime=0)
+            lines.append("/* %s: %d bytes, %d bytes gzipped */" % (file_name, len(html.encode("utf-8")), len(data)))
+            lines.append("const uint8_t %s[] PROGMEM = {" % name)
+            lines.append(c_bytes(data))
+            lines.append("};")
+            lines.append("const size_t %s_LENGTH = %d;" % (name, len(data)))
+            lines.append("const char %s_ETAG[] = \"\\\"%s\\\"\";" % (name, hashlib.sha1(data).hexdigest()[:16]))
+        lines.append("")
+
+    lines.append("#endif")
+    content = "\n".join(lines) + "\n"
+
+    # Only touch the header when it changes, so it does not force a rebuild.
+    if os.path.exists(header_path):
+        with open(header_path, encoding="utf-8") as f:
+            if f.read() == content:
+                return
+    with open(header_path, "w", encoding="utf-8", newline="\n") as f:
+        f.write(content)
+    print("Generated %s" % os.path.relpath(header_path, project_dir))
+
+
+def read_template_pages(value):
+    return set(value.split()) if value else set()
+
+
+if __name__ == "__main__":
+    project_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    config = configparser.ConfigParser(inline_comment_prefixes=(";",))
+    config.read(os.path.join(project_dir, "platformio.ini"), encoding="utf-8")
+    section = next(s for s in config.sections() if s.startswith("env:"))
+    build_pages(project_dir, read_template_pages(config.get(section, "custom_template_pages", fallback="")))
+else:
+    Import("env")  # noqa: F821 (provided by PlatformIO)
+    build_pages(env.subst("$PROJECT_DIR"), read_template_pages(env.GetProjectOption("custom_template_pages", "")))  # noqa: F821
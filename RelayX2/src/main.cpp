@@ -1,12 +1,15 @@
 #include <Arduino.h>
 
 #include "ESP8266WiFi.h"
-#include "ESP8266WebServer.h"
+#include "HttpServer.h"
 
 #include "FS.h"
 #include "LittleFS.h"
+#include "LineReader.h"
+#include "WifiConnection.h"
 
 #include "resource.h"
+#include "PageTemplate.h"
 
 #define BUTTON_GPIO D3
 #define LED_STATE_GPIO LED_BUILTIN_AUX
@@ -30,7 +33,10 @@ int deviceState = DEVICE_STATE_INIT;
 int relayAState = RELAY_STATE_DEFAULT;
 int relayBState = RELAY_STATE_DEFAULT;
 
-ESP8266WebServer webserver;
+HttpServer webserver;
+WifiConnection wifiConnection;
+
+PageTemplate homePageTemplate(RELAY_PAGE, RELAY_PAGE_KEYS, RELAY_SLOT_COUNT);
 
 IPAddress ipAddress(192, 168, 10, 1);
 WiFiEventHandler onSoftAPModeStationConnectedEvent;
@@ -56,6 +62,7 @@ void enterWifiConfigMode(void);
 
 void runasStation(void);
 void runasToSoftAP(void);
+void onWifiStateChanged(WifiConnectionState state);
 
 void onPageNotFound(void);
 void onConfigHomePage(void);
@@ -66,9 +73,11 @@ void onRelayAOff(void);
 void onRelayBOn(void);
 void onRelayBOff(void);
 
-String buildHomePageHtml(void);
-String buildConfigPageHtml(void);
-String buildRedirectHtml(void);
+void sendHomePageHtml(void);
+void sendConfigPageHtml(void);
+void sendRedirectHtml(void);
+void sendGzipPage(const uint8_t *page, size_t length, const char *etag, const char *cacheControl);
+String getHomePageValue(uint8_t slot);
 
 void onSoftAPModeStationConnected(const WiFiEventSoftAPModeStationConnected& event);
 void onSoftAPModeStationDisconnected(const WiFiEventSoftAPModeStationDisconnected& event);
@@ -108,6 +117,7 @@ void setup() {
 void loop() {
   // put your main code here, to run repeatedly:
   webserver.handleClient();
+  wifiConnection.loop();
 }
 
 void serial_init(void) {
@@ -153,19 +163,23 @@ void enterWifiRelayMode(void) {
 
   deviceState = DEVICE_STATE_WIFI_CONNECTING;
 
+  // Returns right away, the pages are served while the station connects.
   runasStation();
 
+  if (!homePageTemplate.compile()) {
+    Serial.println("Failed to compile page templates.");
+  }
+
+  const char *headerKeys[] = {"If-None-Match", "Accept-Encoding"};
+  webserver.collectHeaders(headerKeys, 2);
   webserver.begin(80);
   webserver.on("/", onRelayHomePage);
   webserver.on("/relay_a_on", onRelayAOn);
   webserver.on("/relay_a_off", onRelayAOff);
   webserver.on("/relay_b_on", onRelayBOn);
   webserver.on("/relay_b_off", onRelayBOff);
+  webserver.on("/postconfig", onConfigApplyPage);
   webserver.onNotFound(onPageNotFound);
-
-  deviceState = DEVICE_STATE_RELAY;
-  
-  Serial.println("Device runs in 'Relay' mode.");
 }
 
 void enterWifiConfigMode(void) {
@@ -173,6 +187,8 @@ void enterWifiConfigMode(void) {
 
   runasToSoftAP();
 
+  const char *headerKeys[] = {"If-None-Match", "Accept-Encoding"};
+  webserver.collectHeaders(headerKeys, 2);
   webserver.begin(80);
   webserver.on("/", onConfigHomePage);
   webserver.on("/postconfig", onConfigApplyPage);
@@ -194,19 +210,34 @@ void runasStation(void) {
   //   webserver.stop();
   //   WiFi.softAPdisconnect();
   // }
-  // STA mode
-  WiFi.mode(WIFI_STA);
-  // Connect to WIFI
-  WiFi.begin(ssidName, ssidPassword);
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
+  // Falls back to the configuration SoftAP when the network stays out of reach.
+  onSoftAPModeStationConnectedEvent = WiFi.onSoftAPModeStationConnected(&onSoftAPModeStationConnected);
+  onSoftAPModeStationDisconnectedEvent = WiFi.onSoftAPModeStationDisconnected(&onSoftAPModeStationDisconnected);
+  wifiConnection.setFallbackAP("RelayX2_CFG", ipAddress);
+  wifiConnection.onStateChanged(onWifiStateChanged);
+  // STA mode, connect to WIFI
+  wifiConnection.begin(ssidName, ssidPassword);
+}
+
+void onWifiStateChanged(WifiConnectionState state) {
+  if (state == WIFI_CONNECTION_CONNECTED) {
+    /* Connected */
+    Serial.print("WIFI connected. SSID: ");
+    Serial.print(WiFi.SSID());
+    Serial.print(", IP: ");
+    Serial.println(WiFi.localIP());
+    deviceState = DEVICE_STATE_RELAY;
+    Serial.println("Device runs in 'Relay' mode.");
+  }
+  else if (wifiConnection.fallback()) {
+    if (deviceState != DEVICE_STATE_CONFIG) {
+      Serial.println("WIFI not reachable, configuration page on 'RelayX2_CFG'.");
+    }
+    deviceState = DEVICE_STATE_CONFIG;
+  }
+  else {
+    deviceState = DEVICE_STATE_WIFI_CONNECTING;
   }
-  /* Connected */
-  Serial.print("WIFI connected. SSID: ");
-  Serial.print(WiFi.SSID());
-  Serial.print(", IP: ");
-  Serial.println(WiFi.localIP());
 }
 
 void runasToSoftAP(void) {
@@ -241,22 +272,14 @@ bool loadWifiConfig(void) {
     return false;
   }
 
-  String cfg = file.readString();
+  // One field per line: SSID, password, relay A and relay B names.
+  LineReader reader(file);
+  LineView line;
+  ssidName = reader.next(line) ? line.data : "";
+  ssidPassword = reader.next(line) ? line.data : "";
+  relayADisplayName = reader.next(line) ? line.data : "";
+  relayBDisplayName = reader.next(line) ? line.data : "";
   file.close();
-
-  int index = cfg.indexOf("\r\n");
-  ssidName = cfg.substring(0, index);
-  cfg.remove(0, index + 2);
-
-  index = cfg.indexOf("\r\n");
-  ssidPassword = cfg.substring(0, index);
-  cfg.remove(0, index + 2);
-
-  index = cfg.indexOf("\r\n");
-  relayADisplayName = cfg.substring(0, index);
-  cfg.remove(0, index + 2);
-
-  relayBDisplayName = cfg;
   
   Serial.println("Loaded WIFI configuration.");
   Serial.printf("SSID: %s\r\n", ssidName.c_str());
@@ -310,7 +333,7 @@ void onPageNotFound(void) {
 
 void onConfigHomePage(void) {
   Serial.println("[Web_CFG] Opening configuration page.");
-  webserver.send(200, "text/html", buildConfigPageHtml());
+  sendConfigPageHtml();
 }
 
 void onConfigApplyPage(void) {
@@ -336,7 +359,7 @@ void onConfigApplyPage(void) {
   Serial.printf("Relay B display as: %s\r\n", relayBDisplayName.c_str());
   saveWifiConfig(ssidName, ssidPassword, relayADisplayName, relayBDisplayName);
 
-  webserver.send(200, "text/html", buildRedirectHtml());
+  sendRedirectHtml();
 
   delay(5000);
 
@@ -344,51 +367,97 @@ void onConfigApplyPage(void) {
 }
 
 void onRelayHomePage(void) {
+  // Station fell back to the SoftAP, offer the configuration instead.
+  if (deviceState == DEVICE_STATE_CONFIG) {
+    onConfigHomePage();
+    return;
+  }
+
   Serial.println("Opening relay page.");
-  webserver.send(200, "text/html", buildHomePageHtml());
+  sendHomePageHtml();
 }
 
 void onRelayAOn(void) {
   Serial.println("Relay A -> ON");
   writeRelayA(RELAY_STATE_ON);
-  webserver.send(200, "text/html", buildRedirectHtml());
+  sendRedirectHtml();
 }
 
 void onRelayAOff(void) {
   Serial.println("Relay A -> OFF");
   writeRelayA(RELAY_STATE_OFF);
-  webserver.send(200, "text/html", buildRedirectHtml());
+  sendRedirectHtml();
 }
 
 void onRelayBOn(void) {
   Serial.println("Relay B -> ON");
   writeRelayB(RELAY_STATE_ON);
-  webserver.send(200, "text/html", buildRedirectHtml());
+  sendRedirectHtml();
 }
 
 void onRelayBOff(void) {
   Serial.println("Relay B -> OFF");
   writeRelayB(RELAY_STATE_OFF);
-  webserver.send(200, "text/html", buildRedirectHtml());
+  sendRedirectHtml();
 }
 
-String buildHomePageHtml(void) {
-  String str = String(RELAY_PAGE);
-  str.replace(KEYWORD_RELAY_A_DISPLAY, relayADisplayName);
-  str.replace(KEYWORD_RELAY_A_STATUS, (relayAState == RELAY_STATE_OFF) ? "ON" : "OFF");
-  str.replace(KEYWORD_RELAY_A_HREF, (relayAState == RELAY_STATE_OFF) ? "/relay_a_on" : "/relay_a_off");
-  str.replace(KEYWORD_RELAY_B_DISPLAY, relayBDisplayName);
-  str.replace(KEYWORD_RELAY_B_STATUS, (relayBState == RELAY_STATE_OFF) ? "ON" : "OFF");
-  str.replace(KEYWORD_RELAY_B_HREF, (relayBState == RELAY_STATE_OFF) ? "/relay_b_on" : "/relay_b_off");
-  return str;
+void sendHomePageHtml(void) {
+  homePageTemplate.send(webserver, 200, "text/html", getHomePageValue);
 }
 
-String buildConfigPageHtml(void) {
-  return CONFIG_PAGE;
+String getHomePageValue(uint8_t slot) {
+  switch (slot) {
+  case RELAY_SLOT_A_DISPLAY:
+    return relayADisplayName;
+  case RELAY_SLOT_A_STATUS:
+    return (relayAState == RELAY_STATE_OFF) ? "ON" : "OFF";
+  case RELAY_SLOT_A_HREF:
+    return (relayAState == RELAY_STATE_OFF) ? "/relay_a_on" : "/relay_a_off";
+  case RELAY_SLOT_B_DISPLAY:
+    return relayBDisplayName;
+  case RELAY_SLOT_B_STATUS:
+    return (relayBState == RELAY_STATE_OFF) ? "ON" : "OFF";
+  case RELAY_SLOT_B_HREF:
+    return (relayBState == RELAY_STATE_OFF) ? "/relay_b_on" : "/relay_b_off";
+  default:
+    return "";
+  }
+}
+
+void sendConfigPageHtml(void) {
+  sendGzipPage(CONFIG_PAGE, CONFIG_PAGE_LENGTH, CONFIG_PAGE_ETAG, CACHE_CONTROL_PAGE);
+}
+
+void sendRedirectHtml(void) {
+  // The action already ran, send a client without gzip home all the same.
+  if (webserver.header("Accept-Encoding").indexOf("gzip") < 0) {
+    webserver.sendHeader("Location", "/");
+    webserver.send(303, "text/html", "<a href=\"/\">Back</a>");
+    return;
+  }
+
+  sendGzipPage(REDIRECT_PAGE, REDIRECT_PAGE_LENGTH, REDIRECT_PAGE_ETAG, CACHE_CONTROL_PAGE);
 }
 
-String buildRedirectHtml(void) {
-  return REDIRECT_PAGE;
+void sendGzipPage(const uint8_t *page, size_t length, const char *etag, const char *cacheControl) {
+  // The pages are only stored gzipped, tell caches the body depends on it.
+  webserver.sendHeader("Vary", "Accept-Encoding");
+  if (webserver.header("Accept-Encoding").indexOf("gzip") < 0) {
+    webserver.send(406, "text/plain", "This page needs a browser that accepts gzip.");
+    return;
+  }
+
+  webserver.sendHeader("ETag", etag);
+  webserver.sendHeader("Cache-Control", cacheControl);
+
+  // Conditional GET, the client already has this page.
+  if (webserver.header("If-None-Match").indexOf(etag) >= 0) {
+    webserver.send(304);
+    return;
+  }
+
+  webserver.sendHeader("Content-Encoding", "gzip");
+  webserver.send_P(200, "text/html", (PGM_P)page, length);
 }
 
 void onSoftAPModeStationConnected(const WiFiEventSoftAPModeStationConnected& event) {
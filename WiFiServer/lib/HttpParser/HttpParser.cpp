@@ -0,0 +1,365 @@
+#include "HttpParser.h"
+
+#include <string.h>
+
+static inline char toLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static bool equalsIgnoreCase(const char *a, const char *b, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if (toLower(a[i]) != toLower(b[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Visible characters of the request target, bytes above 0x7F are let through.
+static inline bool isTargetChar(uint8_t c)
+{
+    return c > 0x20 && c != 0x7F;
+}
+
+// RFC 7230 "tchar", the characters of a header name.
+static inline bool isTokenChar(uint8_t c)
+{
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+    {
+        return true;
+    }
+    return c != 0 && strchr("!#$%&'*+-.^_`|~", c) != NULL;
+}
+
+/* -------------------------------------------------- */
+
+bool HttpView::equals(const char *text) const
+{
+    size_t textLength = strlen(text);
+    return textLength == length && memcmp(data, text, length) == 0;
+}
+
+bool HttpView::equalsIgnoreCase(const char *text) const
+{
+    size_t textLength = strlen(text);
+    return textLength == length && ::equalsIgnoreCase(data, text, length);
+}
+
+bool HttpView::containsIgnoreCase(const char *token) const
+{
+    size_t tokenLength = strlen(token);
+    for (size_t i = 0; i + tokenLength <= length; i++)
+    {
+        if (::equalsIgnoreCase(data + i, token, tokenLength))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* -------------------------------------------------- */
+
+HttpParser::HttpParser(void)
+{
+    reset();
+}
+
+void HttpParser::reset(void)
+{
+    _data = NULL;
+    _offset = 0;
+    _lineStart = 0;
+    _state = STATE_METHOD;
+    _error = HTTP_ERROR_NONE;
+    _method = _path = _query = _version = Span{0, 0};
+    _headerCount = 0;
+    _contentLength = 0;
+}
+
+HttpParseResult HttpParser::parse(const char *data, size_t length)
+{
+    _data = data;
+    if (_state == STATE_DONE)
+    {
+        return HTTP_PARSE_DONE;
+    }
+    if (_state == STATE_ERROR)
+    {
+        return HTTP_PARSE_ERROR;
+    }
+
+    // Spans hold 16-bit offsets; a longer head never completes.
+    if (length > 0xFFFF)
+    {
+        length = 0xFFFF;
+    }
+
+    while (_offset < length)
+    {
+        uint8_t c = (uint8_t)data[_offset];
+        if (_offset - _lineStart >= HTTP_PARSER_MAX_LINE)
+        {
+            return fail(HTTP_ERROR_LINE_TOO_LONG);
+        }
+
+        switch (_state)
+        {
+        case STATE_METHOD:
+            if (c == ' ' && _offset > _lineStart)
+            {
+                endSpan(_method, _offset);
+                _path.offset = _offset + 1;
+                _state = STATE_PATH;
+            }
+            else if (c < 'A' || c > 'Z')
+            {
+                return fail(HTTP_ERROR_BAD_REQUEST_LINE);
+            }
+            break;
+
+        case STATE_PATH:
+            if ((c == ' ' || c == '?') && _offset > _path.offset)
+            {
+                endSpan(_path, _offset);
+                if (c == '?')
+                {
+                    _query.offset = _offset + 1;
+                    _state = STATE_QUERY;
+                }
+                else
+                {
+                    _version.offset = _offset + 1;
+                    _state = STATE_VERSION;
+                }
+            }
+            else if (!isTargetChar(c) || c == '?')
+            {
+                return fail(HTTP_ERROR_BAD_REQUEST_LINE);
+            }
+            break;
+
+        case STATE_QUERY:
+            if (c == ' ')
+            {
+                endSpan(_query, _offset);
+                _version.offset = _offset + 1;
+                _state = STATE_VERSION;
+            }
+            else if (!isTargetChar(c))
+            {
+                return fail(HTTP_ERROR_BAD_REQUEST_LINE);
+            }
+            break;
+
+        case STATE_VERSION:
+            if (c == '\r' || c == '\n')
+            {
+                endSpan(_version, _offset);
+                HttpView version = view(_version);
+                if (version.length != 8 || memcmp(version.data, "HTTP/1.", 7) != 0 || version.data[7] < '0' || version.data[7] > '9')
+                {
+                    return fail(HTTP_ERROR_BAD_VERSION);
+                }
+                _state = (c == '\r') ? STATE_REQUEST_LINE_END : STATE_HEADER_START;
+                _lineStart = _offset + 1;
+            }
+            else if (!isTargetChar(c))
+            {
+                return fail(HTTP_ERROR_BAD_REQUEST_LINE);
+            }
+            break;
+
+        case STATE_REQUEST_LINE_END:
+        case STATE_HEADER_LINE_END:
+            if (c != '\n')
+            {
+                return fail(_state == STATE_REQUEST_LINE_END ? HTTP_ERROR_BAD_REQUEST_LINE : HTTP_ERROR_BAD_HEADER);
+            }
+            _state = STATE_HEADER_START;
+            _lineStart = _offset + 1;
+            break;
+
+        case STATE_HEADER_START:
+            if (c == '\r')
+            {
+                _state = STATE_HEAD_END;
+            }
+            else if (c == '\n')
+            {
+                _offset++;
+                return finish();
+            }
+            else if (_headerCount >= HTTP_PARSER_MAX_HEADERS)
+            {
+                return fail(HTTP_ERROR_TOO_MANY_HEADERS);
+            }
+            else if (!isTokenChar(c))
+            {
+                // Also rejects obsolete line folding (a line starting with whitespace).
+                return fail(HTTP_ERROR_BAD_HEADER);
+            }
+            else
+            {
+                _headerNames[_headerCount].offset = _offset;
+                _state = STATE_HEADER_NAME;
+            }
+            break;
+
+        case STATE_HEADER_NAME:
+            if (c == ':')
+            {
+                endSpan(_headerNames[_headerCount], _offset);
+                _state = STATE_HEADER_VALUE_START;
+            }
+            else if (!isTokenChar(c))
+            {
+                return fail(HTTP_ERROR_BAD_HEADER);
+            }
+            break;
+
+        case STATE_HEADER_VALUE_START:
+            if (c == ' ' || c == '\t')
+            {
+                break;
+            }
+            _headerValues[_headerCount].offset = _offset;
+            _state = STATE_HEADER_VALUE;
+            continue;
+
+        case STATE_HEADER_VALUE:
+            if (c == '\r' || c == '\n')
+            {
+                Span &value = _headerValues[_headerCount];
+                size_t end = _offset;
+                while (end > value.offset && (data[end - 1] == ' ' || data[end - 1] == '\t'))
+                {
+                    end--;
+                }
+                endSpan(value, end);
+                _headerCount++;
+                _state = (c == '\r') ? STATE_HEADER_LINE_END : STATE_HEADER_START;
+                _lineStart = _offset + 1;
+            }
+            else if ((c < 0x20 && c != '\t') || c == 0x7F)
+            {
+                return fail(HTTP_ERROR_BAD_HEADER);
+            }
+            break;
+
+        case STATE_HEAD_END:
+            if (c != '\n')
+            {
+                return fail(HTTP_ERROR_BAD_HEADER);
+            }
+            _offset++;
+            return finish();
+
+        default:
+            return fail(HTTP_ERROR_BAD_REQUEST_LINE);
+        }
+
+        _offset++;
+    }
+
+    return HTTP_PARSE_INCOMPLETE;
+}
+
+HttpHeader HttpParser::header(uint8_t index) const
+{
+    HttpHeader header = {view(_headerNames[index]), view(_headerValues[index])};
+    return header;
+}
+
+bool HttpParser::findHeader(const char *name, HttpView &value) const
+{
+    for (uint8_t i = 0; i < _headerCount; i++)
+    {
+        if (view(_headerNames[i]).equalsIgnoreCase(name))
+        {
+            value = view(_headerValues[i]);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HttpParser::isHttp11(void) const
+{
+    return view(_version).equals("HTTP/1.1");
+}
+
+bool HttpParser::keepAlive(void) const
+{
+    // HTTP/1.1 keeps the connection unless told otherwise, HTTP/1.0 the reverse.
+    HttpView connection;
+    if (!findHeader("Connection", connection))
+    {
+        return isHttp11();
+    }
+    return isHttp11() ? !connection.containsIgnoreCase("close") : connection.containsIgnoreCase("keep-alive");
+}
+
+HttpParseResult HttpParser::fail(HttpParseError error)
+{
+    _state = STATE_ERROR;
+    _error = error;
+    return HTTP_PARSE_ERROR;
+}
+
+/*
+ * Called once the empty line ending the head was read. The body length must
+ * be unambiguous, or the next pipelined request would be read from the
+ * wrong place (request smuggling).
+ */
+HttpParseResult HttpParser::finish(void)
+{
+    bool hasLength = false;
+    for (uint8_t i = 0; i < _headerCount; i++)
+    {
+        HttpView name = view(_headerNames[i]);
+        if (name.equalsIgnoreCase("Transfer-Encoding"))
+        {
+            return fail(HTTP_ERROR_TRANSFER_ENCODING);
+        }
+        if (!name.equalsIgnoreCase("Content-Length"))
+        {
+            continue;
+        }
+
+        HttpView value = view(_headerValues[i]);
+        if (hasLength || value.length == 0)
+        {
+            return fail(HTTP_ERROR_BAD_CONTENT_LENGTH);
+        }
+        hasLength = true;
+
+        for (uint16_t j = 0; j < value.length; j++)
+        {
+            char c = value.data[j];
+            if (c < '0' || c > '9' || _contentLength > (SIZE_MAX - (c - '0')) / 10)
+            {
+                return fail(HTTP_ERROR_BAD_CONTENT_LENGTH);
+            }
+            _contentLength = _contentLength * 10 + (c - '0');
+        }
+    }
+
+    _state = STATE_DONE;
+    return HTTP_PARSE_DONE;
+}
+
+void HttpParser::endSpan(Span &span, size_t offset)
+{
+    span.length = offset - span.offset;
+}
+
+HttpView HttpParser::view(const Span &span) const
+{
+    HttpView view = {_data + span.offset, span.length};
+    return view;
+}
@@ -0,0 +1,133 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HTTP_PARSER_MAX_HEADERS 16
+#define HTTP_PARSER_MAX_LINE 256
+
+/*
+ * Read-only view of a part of the request buffer. Not NUL-terminated.
+ */
+struct HttpView
+{
+    const char *data;
+    uint16_t length;
+
+    bool equals(const char *text) const;
+    bool equalsIgnoreCase(const char *text) const;
+    bool containsIgnoreCase(const char *token) const;
+};
+
+struct HttpHeader
+{
+    HttpView name;
+    HttpView value;
+};
+
+enum HttpParseResult
+{
+    HTTP_PARSE_INCOMPLETE,
+    HTTP_PARSE_DONE,
+    HTTP_PARSE_ERROR
+};
+
+enum HttpParseError
+{
+    HTTP_ERROR_NONE,
+    HTTP_ERROR_BAD_REQUEST_LINE,
+    HTTP_ERROR_BAD_VERSION,
+    HTTP_ERROR_BAD_HEADER,
+    HTTP_ERROR_LINE_TOO_LONG,
+    HTTP_ERROR_TOO_MANY_HEADERS,
+    HTTP_ERROR_BAD_CONTENT_LENGTH,
+    HTTP_ERROR_TRANSFER_ENCODING
+};
+
+/*
+ * Incremental HTTP/1.x request head parser.
+ *
+ * parse() is called with the connection's buffer each time more bytes have
+ * arrived; it carries on from where it stopped, so every byte is looked at
+ * once. Method, path, query and headers are returned as views into that
+ * buffer, nothing is copied or allocated. The buffer must not be moved or
+ * changed until the request is handled and reset() is called.
+ *
+ * Lines longer than HTTP_PARSER_MAX_LINE and more than
+ * HTTP_PARSER_MAX_HEADERS headers are rejected. So is a head whose body
+ * length is ambiguous: a Content-Length that is not a plain decimal number,
+ * does not fit in size_t or is given twice, and any Transfer-Encoding, as
+ * chunked bodies are not supported. Plain C++, no Arduino dependencies, so
+ * it also builds on the host (see test/).
+ */
+class HttpParser
+{
+public:
+    HttpParser(void);
+
+    void reset(void);
+    HttpParseResult parse(const char *data, size_t length);
+
+    HttpParseError error(void) const { return _error; }
+    size_t headerLength(void) const { return _offset; }
+
+    HttpView method(void) const { return view(_method); }
+    HttpView path(void) const { return view(_path); }
+    HttpView query(void) const { return view(_query); }
+    HttpView version(void) const { return view(_version); }
+
+    uint8_t headerCount(void) const { return _headerCount; }
+    HttpHeader header(uint8_t index) const;
+    bool findHeader(const char *name, HttpView &value) const;
+
+    bool isHttp11(void) const;
+    bool keepAlive(void) const;
+    size_t contentLength(void) const { return _contentLength; }
+
+private:
+    struct Span
+    {
+        uint16_t offset;
+        uint16_t length;
+    };
+
+    enum State
+    {
+        STATE_METHOD,
+        STATE_PATH,
+        STATE_QUERY,
+        STATE_VERSION,
+        STATE_REQUEST_LINE_END,
+        STATE_HEADER_START,
+        STATE_HEADER_NAME,
+        STATE_HEADER_VALUE_START,
+        STATE_HEADER_VALUE,
+        STATE_HEADER_LINE_END,
+        STATE_HEAD_END,
+        STATE_DONE,
+        STATE_ERROR
+    };
+
+    HttpParseResult fail(HttpParseError error);
+    HttpParseResult finish(void);
+    void endSpan(Span &span, size_t offset);
+    HttpView view(const Span &span) const;
+
+    const char *_data;
+    size_t _offset;
+    size_t _lineStart;
+    State _state;
+    HttpParseError _error;
+
+    Span _method;
+    Span _path;
+    Span _query;
+    Span _version;
+    Span _headerNames[HTTP_PARSER_MAX_HEADERS];
+    Span _headerValues[HTTP_PARSER_MAX_HEADERS];
+    uint8_t _headerCount;
+    size_t _contentLength;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef WIFI_CONNECTION_H
+#define WIFI_CONNECTION_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <functional>
+
+// An attempt that has no IP address after this long counts as failed.
+#define WIFI_CONNECTION_TIMEOUT 15000L
+// Delay before the next attempt, doubled after every failure.
+#define WIFI_CONNECTION_BACKOFF_MIN 1000L
+#define WIFI_CONNECTION_BACKOFF_MAX 60000L
+// Failed attempts in a row before the fallback SoftAP is started.
+#define WIFI_CONNECTION_FALLBACK_ATTEMPTS 4
+
+enum WifiConnectionState
+{
+    WIFI_CONNECTION_IDLE,
+    WIFI_CONNECTION_CONNECTING, // Waiting for association and an address.
+    WIFI_CONNECTION_CONNECTED,
+    WIFI_CONNECTION_BACKOFF     // Waiting before the next attempt.
+};
+
+/*
+ * Connects the station without blocking. begin() only starts an attempt,
+ * loop() moves the state machine on from the onStationMode* events, which
+ * are just flagged in the SDK's context.
+ *
+ * A failed or timed out attempt is retried after an exponential backoff;
+ * a lost connection is retried right away. After
+ * WIFI_CONNECTION_FALLBACK_ATTEMPTS failures in a row the fallback SoftAP,
+ * when one is set, is started next to the station so the device can be
+ * reached and configured. Attempts carry on at the longest backoff and are
+ * put off while a client is on the SoftAP, since the radio follows the
+ * station's channel. The SoftAP is stopped once the station is connected.
+ */
+class WifiConnection
+{
+public:
+    typedef std::function<void(WifiConnectionState state)> StateHandler;
+
+    WifiConnection(void);
+
+    void setFallbackAP(const char *ssid, const IPAddress &ip);
+    void onStateChanged(StateHandler handler) { _stateHandler = handler; }
+
+    void begin(const String &ssid, const String &password);
+    void loop(void);
+
+    WifiConnectionState state(void) const { return _state; }
+    bool connected(void) const { return _state == WIFI_CONNECTION_CONNECTED; }
+    bool fallback(void) const { return _fallback; }
+    uint8_t failures(void) const { return _failures; }
+
+private:
+    void connect(void);
+    void fail(const char *reason);
+    void setState(WifiConnectionState state);
+    void startFallback(void);
+    void stopFallback(void);
+
+    String _ssid;
+    String _password;
+    const char *_fallbackSSID;
+    IPAddress _fallbackIP;
+    StateHandler _stateHandler;
+
+    WiFiEventHandler _gotIPEvent;
+    WiFiEventHandler _disconnectedEvent;
+    volatile bool _gotIP;
+    volatile bool _disconnected;
+
+    WifiConnectionState _state;
+    bool _fallback;
+    uint8_t _failures;
+    unsigned long _backoff;
+    unsigned long _stateMillis;
+};
+
+#endif
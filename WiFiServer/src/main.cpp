@@ -3,75 +3,239 @@
 #include <ESP8266WiFi.h>
 #include <WiFiServer.h>
 #include <WiFiClient.h>
+#include <HttpParser.h>
+#include <WifiConnection.h>
 
 #define SSID_NAME "ESP8266"
 #define SSID_PASSWORD "12345678"
+#define FALLBACK_AP_NAME "ESP8266_WiFiServer"
 #define LED_GPIO LED_BUILTIN_AUX
 
+#define MAX_CLIENTS 4
+#define REQUEST_BUFFER_SIZE 512
+#define RESPONSE_BUFFER_SIZE 512
+#define CLIENT_IDLE_TIMEOUT 5000L
+#define MAX_REQUEST_BODY 1024
+
+/*
+ * One persistent connection. Bytes are collected in a fixed buffer and fed
+ * to the parser until a request's headers are complete; it is answered right
+ * away and removed, and any pipelined request behind it is handled next.
+ */
+struct ClientSlot {
+  WiFiClient client;
+  HttpParser parser;
+  char buffer[REQUEST_BUFFER_SIZE];
+  size_t length;
+  size_t skipBody;
+  unsigned long lastActivityMillis;
+};
+
 WiFiServer wifiServer(80);
+ClientSlot slots[MAX_CLIENTS];
+WifiConnection wifiConnection;
+
+void onWifiStateChanged(WifiConnectionState state);
+void acceptClients(void);
+void serviceClient(ClientSlot &slot);
+void handleRequest(ClientSlot &slot, bool keepAlive);
+void sendResponse(WiFiClient &client, int code, const char *reason, const char *body, bool keepAlive);
 
 void setup() {
   // put your setup code here, to run once:
   pinMode(LED_GPIO, OUTPUT);
   Serial.begin(9600);
 
-  /* Connecting to WIFI */
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(SSID_NAME, SSID_PASSWORD);
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
-  }
-  Serial.println();
-
-  /* WIFI Connected */
-  Serial.print("WIFI connected : ");
-  Serial.print(WiFi.SSID());
-  Serial.print(", IP :");
-  Serial.println(WiFi.localIP());
+  /* Connecting to WIFI, without waiting for it */
+  wifiConnection.setFallbackAP(FALLBACK_AP_NAME, IPAddress(192, 168, 4, 1));
+  wifiConnection.onStateChanged(onWifiStateChanged);
+  wifiConnection.begin(SSID_NAME, SSID_PASSWORD);
 
-  /* WiFi Server */
+  /* WiFi Server, answers on whichever interface is up */
   wifiServer.begin();
 }
 
 void loop() {
   // put your main code here, to run repeatedly:
-  WiFiClient client = wifiServer.available();
-  if (!client) {
+  wifiConnection.loop();
+  acceptClients();
+  for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+    serviceClient(slots[i]);
+  }
+}
+
+void onWifiStateChanged(WifiConnectionState state) {
+  if (state == WIFI_CONNECTION_CONNECTED) {
+    /* WIFI Connected */
+    Serial.print("WIFI connected : ");
+    Serial.print(WiFi.SSID());
+    Serial.print(", IP :");
+    Serial.println(WiFi.localIP());
+  } else if (state == WIFI_CONNECTION_BACKOFF && wifiConnection.fallback()) {
+    Serial.print("WIFI not reachable, SoftAP " FALLBACK_AP_NAME ", IP :");
+    Serial.println(WiFi.softAPIP());
+  }
+}
+
+void acceptClients(void) {
+  while (wifiServer.hasClient()) {
+    WiFiClient client = wifiServer.available();
+    ClientSlot *slot = NULL;
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+      if (!slots[i].client.connected()) {
+        slot = &slots[i];
+        break;
+      }
+    }
+
+    if (slot == NULL) {
+      Serial.println("No free client slot");
+      sendResponse(client, 503, "Service Unavailable", "Busy", false);
+      client.stop();
+      continue;
+    }
+
+    Serial.print("New client : ");
+    Serial.println(client.remoteIP());
+
+    client.setNoDelay(true);
+    slot->client = client;
+    slot->parser.reset();
+    slot->length = 0;
+    slot->skipBody = 0;
+    slot->lastActivityMillis = millis();
+  }
+}
+
+void serviceClient(ClientSlot &slot) {
+  if (!slot.client.connected()) {
     return;
   }
 
-  String request = client.readString();
+  // Discard the body of the previous request, the LED commands take none.
+  while (slot.skipBody > 0 && slot.client.available() > 0) {
+    char discard[64];
+    size_t size = slot.skipBody < sizeof(discard) ? slot.skipBody : sizeof(discard);
+    slot.skipBody -= slot.client.read((uint8_t *)discard, size);
+  }
 
-  Serial.print("New client : ");
-  Serial.println(request);
+  // Only request bytes count as activity, a body still being skipped has to
+  // arrive within the idle timeout of its head.
+  if (slot.skipBody > 0 || slot.client.available() <= 0) {
+    if ((millis() - slot.lastActivityMillis) > CLIENT_IDLE_TIMEOUT) {
+      slot.client.stop();
+    }
+    return;
+  }
+  slot.lastActivityMillis = millis();
+
+  size_t space = REQUEST_BUFFER_SIZE - slot.length;
+  if (space > 0) {
+    slot.length += slot.client.read((uint8_t *)slot.buffer + slot.length, space);
+  }
+
+  // Answer every complete request in the buffer (pipelining).
+  HttpParseResult result;
+  while (slot.skipBody == 0 && (result = slot.parser.parse(slot.buffer, slot.length)) != HTTP_PARSE_INCOMPLETE) {
+    if (result == HTTP_PARSE_ERROR) {
+      Serial.printf("Bad request (%d)\r\n", slot.parser.error());
+      if (slot.parser.error() == HTTP_ERROR_LINE_TOO_LONG || slot.parser.error() == HTTP_ERROR_TOO_MANY_HEADERS) {
+        sendResponse(slot.client, 431, "Request Header Fields Too Large", "Request too large", false);
+      } else if (slot.parser.error() == HTTP_ERROR_TRANSFER_ENCODING) {
+        sendResponse(slot.client, 501, "Not Implemented", "Transfer-Encoding not supported", false);
+      } else {
+        sendResponse(slot.client, 400, "Bad Request", "Bad request", false);
+      }
+      slot.client.stop();
+      return;
+    }
+
+    size_t bodyLength = slot.parser.contentLength();
+    if (bodyLength > MAX_REQUEST_BODY) {
+      sendResponse(slot.client, 413, "Payload Too Large", "Request body too large", false);
+      slot.client.stop();
+      return;
+    }
 
-  client.flush();
+    bool keepAlive = slot.parser.keepAlive();
+    handleRequest(slot, keepAlive);
 
-  if (request.indexOf("/led_on") != -1)
-  {
+    size_t consumed = slot.parser.headerLength();
+    size_t bufferedBody = slot.length - consumed;
+    if (bodyLength <= bufferedBody) {
+      consumed += bodyLength;
+    } else {
+      consumed = slot.length;
+      slot.skipBody = bodyLength - bufferedBody;
+    }
+
+    memmove(slot.buffer, slot.buffer + consumed, slot.length - consumed);
+    slot.length -= consumed;
+    slot.parser.reset();
+
+    if (!keepAlive) {
+      slot.client.stop();
+      return;
+    }
+  }
+
+  if (slot.length == REQUEST_BUFFER_SIZE) {
+    sendResponse(slot.client, 431, "Request Header Fields Too Large", "Request too large", false);
+    slot.client.stop();
+  }
+}
+
+/*
+ * Handles the parsed request in slot.parser.
+ */
+void handleRequest(ClientSlot &slot, bool keepAlive) {
+  HttpView method = slot.parser.method();
+  HttpView path = slot.parser.path();
+
+  Serial.print("Request : ");
+  Serial.write(method.data, method.length);
+  Serial.print(" ");
+  Serial.write(path.data, path.length);
+  Serial.println();
+
+  if (path.equals("/led_on")) {
     Serial.println("LED ON");
     digitalWrite(LED_GPIO, LOW);
   }
-  if (request.indexOf("/led_off") != -1)
-  {
+  if (path.equals("/led_off")) {
     Serial.println("LED OFF");
     digitalWrite(LED_GPIO, HIGH);
   }
 
-  client.println("HTTP/1.1 200 OK");
-  client.println("Content-Type: text/html");
-  client.println();
-  client.println("<!DOCTYPE HTML>");
-  client.println("<html>");
-  client.println("<head><title>ESP8266 WiFi Server Demo</title></head>");
-  client.println("<body>");
   if (digitalRead(LED_GPIO) == HIGH) {
-    client.println("<p><a href=\"/led_on\">Turn ON</a></p>");
+    sendResponse(slot.client, 200, "OK", "<p><a href=\"/led_on\">Turn ON</a></p>", keepAlive);
   } else {
-    client.println("<p><a href=\"/led_off\">Turn OFF</a></p>");
+    sendResponse(slot.client, 200, "OK", "<p><a href=\"/led_off\">Turn OFF</a></p>", keepAlive);
   }
-  client.println("</body>");
-  client.println("</html>");
-  client.stop();
+}
+
+/*
+ * Sends status line, headers and page in a single write.
+ */
+void sendResponse(WiFiClient &client, int code, const char *reason, const char *body, bool keepAlive) {
+  char content[RESPONSE_BUFFER_SIZE / 2];
+  int contentLength = snprintf(content, sizeof(content),
+                               "<!DOCTYPE HTML>\r\n"
+                               "<html>\r\n"
+                               "<head><title>ESP8266 WiFi Server Demo</title></head>\r\n"
+                               "<body>\r\n%s\r\n</body>\r\n"
+                               "</html>\r\n",
+                               body);
+
+  char response[RESPONSE_BUFFER_SIZE];
+  int responseLength = snprintf(response, sizeof(response),
+                                "HTTP/1.1 %d %s\r\n"
+                                "Content-Type: text/html\r\n"
+                                "Content-Length: %d\r\n"
+                                "Connection: %s\r\n"
+                                "\r\n"
+                                "%s",
+                                code, reason, contentLength, keepAlive ? "keep-alive" : "close", content);
+
+  client.write((const uint8_t *)response, responseLength);
 }
\ No newline at end of file
@@ -0,0 +1,241 @@
+/*
+ * Host tests for HttpParser: well-formed requests, requests split at every
+ * byte, and a corpus of malformed heads that must be rejected.
+ *
+ *     pio test -e native
+ */
+#include <HttpParser.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+static HttpParser parser;
+
+void setUp(void)
+{
+    parser.reset();
+}
+
+void tearDown(void)
+{
+}
+
+static HttpParseResult parseAll(const char *request)
+{
+    return parser.parse(request, strlen(request));
+}
+
+// Feeds the request one byte more at a time, as slow clients send it.
+static HttpParseResult parseBytewise(const char *request)
+{
+    size_t length = strlen(request);
+    HttpParseResult result = HTTP_PARSE_INCOMPLETE;
+    for (size_t i = 1; i <= length && result == HTTP_PARSE_INCOMPLETE; i++)
+    {
+        result = parser.parse(request, i);
+    }
+    return result;
+}
+
+static bool viewIs(const HttpView &view, const char *text)
+{
+    return view.equals(text);
+}
+
+/* -------------------------------------------------- */
+
+static void test_simple_get(void)
+{
+    const char *request = "GET /led_on?x=1 HTTP/1.1\r\nHost: esp8266\r\nAccept: */*\r\n\r\n";
+    TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, parseAll(request));
+    TEST_ASSERT_TRUE(viewIs(parser.method(), "GET"));
+    TEST_ASSERT_TRUE(viewIs(parser.path(), "/led_on"));
+    TEST_ASSERT_TRUE(viewIs(parser.query(), "x=1"));
+    TEST_ASSERT_TRUE(parser.isHttp11());
+    TEST_ASSERT_TRUE(parser.keepAlive());
+    TEST_ASSERT_EQUAL(2, parser.headerCount());
+    TEST_ASSERT_EQUAL(strlen(request), parser.headerLength());
+    TEST_ASSERT_EQUAL(0, parser.contentLength());
+
+    HttpView host;
+    TEST_ASSERT_TRUE(parser.findHeader("host", host));
+    TEST_ASSERT_TRUE(viewIs(host, "esp8266"));
+}
+
+static void test_bare_lf_and_whitespace(void)
+{
+    TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, parseAll("GET / HTTP/1.0\nConnection:  keep-alive \t\n\n"));
+    HttpView connection;
+    TEST_ASSERT_TRUE(parser.findHeader("Connection", connection));
+    TEST_ASSERT_TRUE(viewIs(connection, "keep-alive"));
+    TEST_ASSERT_TRUE(parser.keepAlive());
+}
+
+static void test_connection_close(void)
+{
+    TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, parseAll("GET / HTTP/1.1\r\nConnection: close\r\n\r\n"));
+    TEST_ASSERT_FALSE(parser.keepAlive());
+
+    parser.reset();
+    TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, parseAll("GET / HTTP/1.0\r\n\r\n"));
+    TEST_ASSERT_FALSE(parser.keepAlive());
+}
+
+static void test_content_length(void)
+{
+    TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, parseAll("POST / HTTP/1.1\r\nContent-Length: 0042\r\n\r\nbody"));
+    TEST_ASSERT_EQUAL(42, parser.contentLength());
+}
+
+static void test_content_length_max(void)
+{
+    char request[96];
+    snprintf(request, sizeof(request), "POST / HTTP/1.1\r\nContent-Length: %llu\r\n\r\n", (unsigned long long)SIZE_MAX);
+    TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, parseAll(request));
+    TEST_ASSERT_TRUE(parser.contentLength() == SIZE_MAX);
+}
+
+static void test_incomplete(void)
+{
+    TEST_ASSERT_EQUAL(HTTP_PARSE_INCOMPLETE, parseAll("GET / HTTP/1.1\r\nHost: a\r\n"));
+    TEST_ASSERT_EQUAL(HTTP_PARSE_INCOMPLETE, parseAll("GET / HTTP/1.1\r\nHost: a\r\n\r"));
+    TEST_ASSERT_EQUAL(HTTP_ERROR_NONE, parser.error());
+}
+
+static void test_bytewise_matches_whole(void)
+{
+    const char *request = "POST /a/b?c=d HTTP/1.1\r\nHost: x\r\nContent-Length: 5\r\nConnection: close\r\n\r\nhello";
+    TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, parseBytewise(request));
+    TEST_ASSERT_TRUE(viewIs(parser.path(), "/a/b"));
+    TEST_ASSERT_TRUE(viewIs(parser.query(), "c=d"));
+    TEST_ASSERT_EQUAL(3, parser.headerCount());
+    TEST_ASSERT_EQUAL(5, parser.contentLength());
+    TEST_ASSERT_FALSE(parser.keepAlive());
+    TEST_ASSERT_EQUAL(strlen(request) - 5, parser.headerLength());
+}
+
+static void test_pipelined(void)
+{
+    const char *requests = "GET /led_on HTTP/1.1\r\n\r\nGET /led_off HTTP/1.1\r\n\r\n";
+    TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, parseAll(requests));
+    TEST_ASSERT_TRUE(viewIs(parser.path(), "/led_on"));
+
+    const char *next = requests + parser.headerLength();
+    parser.reset();
+    TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, parseAll(next));
+    TEST_ASSERT_TRUE(viewIs(parser.path(), "/led_off"));
+}
+
+static void test_too_many_headers(void)
+{
+    char request[512] = "GET / HTTP/1.1\r\n";
+    for (int i = 0; i <= HTTP_PARSER_MAX_HEADERS; i++)
+    {
+        strcat(request, "X-A: b\r\n");
+    }
+    strcat(request, "\r\n");
+    TEST_ASSERT_EQUAL(HTTP_PARSE_ERROR, parseAll(request));
+    TEST_ASSERT_EQUAL(HTTP_ERROR_TOO_MANY_HEADERS, parser.error());
+}
+
+static void test_line_too_long(void)
+{
+    char request[HTTP_PARSER_MAX_LINE + 64] = "GET /";
+    memset(request + 5, 'a', HTTP_PARSER_MAX_LINE);
+    strcpy(request + 5 + HTTP_PARSER_MAX_LINE, " HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_EQUAL(HTTP_PARSE_ERROR, parseAll(request));
+    TEST_ASSERT_EQUAL(HTTP_ERROR_LINE_TOO_LONG, parser.error());
+}
+
+/* -------------------------------------------------- */
+
+struct MalformedRequest
+{
+    const char *request;
+    HttpParseError error;
+};
+
+static const MalformedRequest MALFORMED[] = {
+    // Request line
+    {"get / HTTP/1.1\r\n\r\n", HTTP_ERROR_BAD_REQUEST_LINE},
+    {" GET / HTTP/1.1\r\n\r\n", HTTP_ERROR_BAD_REQUEST_LINE},
+    {"GET  / HTTP/1.1\r\n\r\n", HTTP_ERROR_BAD_REQUEST_LINE},
+    {"GET /a b HTTP/1.1\r\n\r\n", HTTP_ERROR_BAD_REQUEST_LINE},
+    {"GET /\x01 HTTP/1.1\r\n\r\n", HTTP_ERROR_BAD_REQUEST_LINE},
+    {"GET / HTTP/1.1\rX\n\r\n", HTTP_ERROR_BAD_REQUEST_LINE},
+    {"\r\n", HTTP_ERROR_BAD_REQUEST_LINE},
+    // Version
+    {"GET / HTTP/2.0\r\n\r\n", HTTP_ERROR_BAD_VERSION},
+    {"GET / HTTP/1.10\r\n\r\n", HTTP_ERROR_BAD_VERSION},
+    {"GET / http/1.1\r\n\r\n", HTTP_ERROR_BAD_VERSION},
+    {"GET / HTTP/1.x\r\n\r\n", HTTP_ERROR_BAD_VERSION},
+    // Headers
+    {"GET / HTTP/1.1\r\nNo colon\r\n\r\n", HTTP_ERROR_BAD_HEADER},
+    {"GET / HTTP/1.1\r\nHost : a\r\n\r\n", HTTP_ERROR_BAD_HEADER},
+    {"GET / HTTP/1.1\r\n: a\r\n\r\n", HTTP_ERROR_BAD_HEADER},
+    {"GET / HTTP/1.1\r\nHost: a\r\n folded\r\n\r\n", HTTP_ERROR_BAD_HEADER},
+    {"GET / HTTP/1.1\r\nHost: a\x01\r\n\r\n", HTTP_ERROR_BAD_HEADER},
+    {"GET / HTTP/1.1\r\nHost: a\rX\r\n\r\n", HTTP_ERROR_BAD_HEADER},
+    {"GET / HTTP/1.1\r\nHost: a\r\n\rX", HTTP_ERROR_BAD_HEADER},
+    // Body length
+    {"POST / HTTP/1.1\r\nContent-Length: 12a\r\n\r\n", HTTP_ERROR_BAD_CONTENT_LENGTH},
+    {"POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n", HTTP_ERROR_BAD_CONTENT_LENGTH},
+    {"POST / HTTP/1.1\r\nContent-Length: +5\r\n\r\n", HTTP_ERROR_BAD_CONTENT_LENGTH},
+    {"POST / HTTP/1.1\r\nContent-Length: 1 2\r\n\r\n", HTTP_ERROR_BAD_CONTENT_LENGTH},
+    {"POST / HTTP/1.1\r\nContent-Length: 5, 5\r\n\r\n", HTTP_ERROR_BAD_CONTENT_LENGTH},
+    {"POST / HTTP/1.1\r\nContent-Length:\r\n\r\n", HTTP_ERROR_BAD_CONTENT_LENGTH},
+    {"POST / HTTP/1.1\r\nContent-Length: 0x10\r\n\r\n", HTTP_ERROR_BAD_CONTENT_LENGTH},
+    {"POST / HTTP/1.1\r\nContent-Length: 99999999999999999999999\r\n\r\n", HTTP_ERROR_BAD_CONTENT_LENGTH},
+    {"POST / HTTP/1.1\r\nContent-Length: 5\r\ncontent-length: 5\r\n\r\n", HTTP_ERROR_BAD_CONTENT_LENGTH},
+    {"POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 6\r\n\r\n", HTTP_ERROR_BAD_CONTENT_LENGTH},
+    {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n", HTTP_ERROR_TRANSFER_ENCODING},
+    {"POST / HTTP/1.1\r\ntransfer-encoding: identity\r\n\r\n", HTTP_ERROR_TRANSFER_ENCODING},
+    {"POST / HTTP/1.1\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n", HTTP_ERROR_TRANSFER_ENCODING},
+};
+
+static void test_malformed_corpus(void)
+{
+    char message[160];
+    for (size_t i = 0; i < sizeof(MALFORMED) / sizeof(MALFORMED[0]); i++)
+    {
+        const MalformedRequest &entry = MALFORMED[i];
+        HttpParseResult expected = (entry.error == HTTP_ERROR_NONE) ? HTTP_PARSE_DONE : HTTP_PARSE_ERROR;
+        snprintf(message, sizeof(message), "corpus entry %u", (unsigned)i);
+
+        // Whole and byte by byte must agree.
+        parser.reset();
+        TEST_ASSERT_EQUAL_MESSAGE(expected, parseAll(entry.request), message);
+        TEST_ASSERT_EQUAL_MESSAGE(entry.error, parser.error(), message);
+
+        parser.reset();
+        TEST_ASSERT_EQUAL_MESSAGE(expected, parseBytewise(entry.request), message);
+        TEST_ASSERT_EQUAL_MESSAGE(entry.error, parser.error(), message);
+    }
+}
+
+static void test_error_is_sticky(void)
+{
+    TEST_ASSERT_EQUAL(HTTP_PARSE_ERROR, parseAll("BAD\x01"));
+    TEST_ASSERT_EQUAL(HTTP_PARSE_ERROR, parseAll("GET / HTTP/1.1\r\n\r\n"));
+
+    parser.reset();
+    TEST_ASSERT_EQUAL(HTTP_PARSE_DONE, parseAll("GET / HTTP/1.1\r\n\r\n"));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_simple_get);
+    RUN_TEST(test_bare_lf_and_whitespace);
+    RUN_TEST(test_connection_close);
+    RUN_TEST(test_content_length);
+    RUN_TEST(test_content_length_max);
+    RUN_TEST(test_incomplete);
+    RUN_TEST(test_bytewise_matches_whole);
+    RUN_TEST(test_pipelined);
+    RUN_TEST(test_too_many_headers);
+    RUN_TEST(test_line_too_long);
+    RUN_TEST(test_malformed_corpus);
+    RUN_TEST(test_error_is_sticky);
+    return UNITY_END();
+}
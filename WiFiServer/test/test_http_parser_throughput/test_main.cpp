@@ -0,0 +1,81 @@
+/*
+ * Throughput of HttpParser on the host, for a typical browser request fed
+ * whole and in small TCP-sized pieces. Prints MB/s; the assertions only
+ * check that every request parsed, the numbers are for comparison between
+ * changes on the same machine.
+ *
+ *     pio test -e native -f test_http_parser_throughput
+ */
+#include <HttpParser.h>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#define ITERATIONS 200000
+
+static const char REQUEST[] =
+    "GET /led_on?source=page HTTP/1.1\r\n"
+    "Host: 192.168.4.1\r\n"
+    "Connection: keep-alive\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Referer: http://192.168.4.1/\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "\r\n";
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Parses the request ITERATIONS times, handing it over `piece` bytes at a time.
+static void measure(const char *label, size_t piece)
+{
+    size_t length = strlen(REQUEST);
+    HttpParser parser;
+    size_t done = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        parser.reset();
+        HttpParseResult result = HTTP_PARSE_INCOMPLETE;
+        for (size_t available = piece; result == HTTP_PARSE_INCOMPLETE; available += piece)
+        {
+            result = parser.parse(REQUEST, available < length ? available : length);
+        }
+        done += (result == HTTP_PARSE_DONE && parser.headerCount() == 8) ? 1 : 0;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    char message[128];
+    snprintf(message, sizeof(message), "%s: %.1f MB/s, %.0f requests/s", label,
+             length * (double)ITERATIONS / seconds / 1e6, ITERATIONS / seconds);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL(ITERATIONS, done);
+}
+
+static void test_throughput_whole(void)
+{
+    measure("whole request", strlen(REQUEST));
+}
+
+static void test_throughput_segments(void)
+{
+    // Roughly what a slow link delivers per read.
+    measure("64-byte reads", 64);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_throughput_whole);
+    RUN_TEST(test_throughput_segments);
+    return UNITY_END();
+}
@@ -0,0 +1,171 @@
+/*
+ * Host tests for WifiConnection against the shim's WiFi: the backoff
+ * between failed attempts, the fallback SoftAP and how it waits for a
+ * client, the return of the network, and the immediate retry after a lost
+ * connection.
+ *
+ *     pio test -e native -f test_wifi_connection
+ */
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <WifiConnection.h>
+#include <unity.h>
+#include <vector>
+
+#define STEP 100
+#define FALLBACK_SSID "Device_CFG"
+
+static WifiConnection *connection;
+static std::vector<unsigned long> attempts;
+
+void setUp(void)
+{
+    shim_freezeClock(true);
+    WiFi.shim_setReachable(true);
+    WiFi.shim_setSoftAPStations(0);
+    WiFi.disconnect(false);
+    WiFi.softAPdisconnect(true);
+
+    attempts.clear();
+    connection = new WifiConnection();
+    connection->setFallbackAP(FALLBACK_SSID, IPAddress(192, 168, 4, 1));
+    connection->onStateChanged([](WifiConnectionState state) {
+        if (state == WIFI_CONNECTION_CONNECTING)
+        {
+            attempts.push_back(millis());
+        }
+    });
+}
+
+void tearDown(void)
+{
+    delete connection;
+    shim_freezeClock(false);
+}
+
+static void run(unsigned long milliseconds)
+{
+    for (unsigned long elapsed = 0; elapsed < milliseconds; elapsed += STEP)
+    {
+        shim_advanceMillis(STEP);
+        connection->loop();
+    }
+}
+
+// Runs until the attempt count reaches `count`, at most `limit` ms.
+static void runUntilAttempt(size_t count, unsigned long limit)
+{
+    for (unsigned long elapsed = 0; elapsed < limit && attempts.size() < count; elapsed += STEP)
+    {
+        shim_advanceMillis(STEP);
+        connection->loop();
+    }
+}
+
+// Fails the first WIFI_CONNECTION_FALLBACK_ATTEMPTS attempts.
+static void failIntoFallback(void)
+{
+    WiFi.shim_setReachable(false);
+    connection->begin("home", "secret");
+    runUntilAttempt(WIFI_CONNECTION_FALLBACK_ATTEMPTS, 60000);
+    run(STEP);
+    TEST_ASSERT_TRUE(connection->fallback());
+}
+
+/* -------------------------------------------------- */
+
+static void test_connects(void)
+{
+    connection->begin("home", "secret");
+    TEST_ASSERT_EQUAL(WIFI_CONNECTION_CONNECTING, connection->state());
+    run(STEP);
+    TEST_ASSERT_TRUE(connection->connected());
+    TEST_ASSERT_EQUAL(1, attempts.size());
+    TEST_ASSERT_EQUAL(0, connection->failures());
+    TEST_ASSERT_FALSE(connection->fallback());
+}
+
+static void test_backoff_doubles(void)
+{
+    WiFi.shim_setReachable(false);
+    connection->begin("home", "secret");
+    run(STEP);
+    TEST_ASSERT_EQUAL(WIFI_CONNECTION_BACKOFF, connection->state());
+    TEST_ASSERT_EQUAL(1, connection->failures());
+
+    // Each wait is counted from the failure, one loop after the attempt.
+    runUntilAttempt(WIFI_CONNECTION_FALLBACK_ATTEMPTS, 60000);
+    TEST_ASSERT_EQUAL(WIFI_CONNECTION_FALLBACK_ATTEMPTS, attempts.size());
+    const unsigned long backoffs[] = {1000, 2000, 4000};
+    for (size_t i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_UINT32_WITHIN(2 * STEP, backoffs[i] + STEP, attempts[i + 1] - attempts[i]);
+    }
+    TEST_ASSERT_FALSE(connection->fallback());
+    TEST_ASSERT_EQUAL_STRING("", WiFi.softAPSSID().c_str());
+
+    // The fourth failure starts the SoftAP and the longest backoff.
+    run(STEP);
+    TEST_ASSERT_TRUE(connection->fallback());
+    TEST_ASSERT_EQUAL_STRING(FALLBACK_SSID, WiFi.softAPSSID().c_str());
+    TEST_ASSERT_EQUAL(WIFI_AP_STA, WiFi.getMode());
+    run(WIFI_CONNECTION_BACKOFF_MAX - STEP);
+    TEST_ASSERT_EQUAL(WIFI_CONNECTION_FALLBACK_ATTEMPTS, attempts.size());
+    run(2 * STEP);
+    TEST_ASSERT_EQUAL(WIFI_CONNECTION_FALLBACK_ATTEMPTS + 1, attempts.size());
+}
+
+static void test_fallback_waits_for_client(void)
+{
+    failIntoFallback();
+    size_t count = attempts.size();
+
+    // Nothing moves the radio off the SoftAP's channel while a client is on it.
+    WiFi.shim_setSoftAPStations(1);
+    run(3 * WIFI_CONNECTION_BACKOFF_MAX);
+    TEST_ASSERT_EQUAL(count, attempts.size());
+
+    WiFi.shim_setSoftAPStations(0);
+    run(WIFI_CONNECTION_BACKOFF_MAX + 2 * STEP);
+    TEST_ASSERT_EQUAL(count + 1, attempts.size());
+}
+
+static void test_network_returns(void)
+{
+    failIntoFallback();
+
+    WiFi.shim_setReachable(true);
+    run(WIFI_CONNECTION_BACKOFF_MAX + 2 * STEP);
+    TEST_ASSERT_TRUE(connection->connected());
+    TEST_ASSERT_EQUAL(0, connection->failures());
+    TEST_ASSERT_FALSE(connection->fallback());
+    TEST_ASSERT_EQUAL_STRING("", WiFi.softAPSSID().c_str());
+}
+
+static void test_lost_connection_retried_at_once(void)
+{
+    connection->begin("home", "secret");
+    run(STEP);
+    TEST_ASSERT_TRUE(connection->connected());
+
+    // The access point drops the link; no backoff for a working network.
+    WiFi.disconnect(false);
+    unsigned long lost = millis();
+    run(STEP);
+    TEST_ASSERT_EQUAL(2, attempts.size());
+    TEST_ASSERT_EQUAL(lost + STEP, attempts[1]);
+    run(STEP);
+    TEST_ASSERT_TRUE(connection->connected());
+    TEST_ASSERT_EQUAL(0, connection->failures());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_connects);
+    RUN_TEST(test_backoff_doubles);
+    RUN_TEST(test_fallback_waits_for_client);
+    RUN_TEST(test_network_returns);
+    RUN_TEST(test_lost_connection_retried_at_once);
+    return UNITY_END();
+}